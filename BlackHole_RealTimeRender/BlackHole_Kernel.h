@@ -1,1251 +0,0 @@
-#if 0
-//
-// Generated by Microsoft (R) HLSL Shader Compiler 10.1
-//
-//
-// Buffer Definitions: 
-//
-// cbuffer CameraBuffer
-// {
-//
-//   float3 camPos;                     // Offset:    0 Size:    12
-//   float pad1;                        // Offset:   12 Size:     4 [unused]
-//   float3 camDir;                     // Offset:   16 Size:    12
-//   float pad2;                        // Offset:   28 Size:     4 [unused]
-//   float3 camUp;                      // Offset:   32 Size:    12
-//   float fov;                         // Offset:   44 Size:     4
-//   float2 resolution;                 // Offset:   48 Size:     8
-//   float mass;                        // Offset:   56 Size:     4 [unused]
-//   float spin;                        // Offset:   60 Size:     4 [unused]
-//
-// }
-//
-//
-// Resource Bindings:
-//
-// Name                                 Type  Format         Dim      HLSL Bind  Count
-// ------------------------------ ---------- ------- ----------- -------------- ------
-// SkyboxSampler                     sampler      NA          NA             s0      1 
-// SkyboxTex                         texture  float4          2d             t0      1 
-// OutputBuffer                          UAV  float4          2d             u0      1 
-// CameraBuffer                      cbuffer      NA          NA            cb0      1 
-//
-//
-//
-// Input signature:
-//
-// Name                 Index   Mask Register SysValue  Format   Used
-// -------------------- ----- ------ -------- -------- ------- ------
-// no Input
-//
-// Output signature:
-//
-// Name                 Index   Mask Register SysValue  Format   Used
-// -------------------- ----- ------ -------- -------- ------- ------
-// no Output
-cs_5_0
-dcl_globalFlags refactoringAllowed
-dcl_constantbuffer CB0[4], immediateIndexed
-dcl_sampler s0, mode_default
-dcl_resource_texture2d (float,float,float,float) t0
-dcl_uav_typed_texture2d (float,float,float,float) u0
-dcl_input vThreadID.xy
-dcl_temps 11
-dcl_thread_group 16, 16, 1
-ftou r0.xy, cb0[3].xyxx
-uge r0.xy, vThreadID.xyxx, r0.xyxx
-or r0.x, r0.y, r0.x
-if_nz r0.x
-  ret 
-endif 
-utof r0.xy, vThreadID.xyxx
-div r0.xy, r0.xyxx, cb0[3].xyxx
-mad r0.xy, r0.xyxx, l(2.000000, 2.000000, 0.000000, 0.000000), l(-1.000000, -1.000000, 0.000000, 0.000000)
-div r0.z, cb0[3].x, cb0[3].y
-dp3 r0.w, cb0[1].xyzx, cb0[1].xyzx
-rsq r0.w, r0.w
-mul r1.xyz, r0.wwww, cb0[1].xyzx
-dp3 r0.w, cb0[2].xyzx, cb0[2].xyzx
-rsq r0.w, r0.w
-mul r2.xyz, r0.wwww, cb0[2].yzxy
-mul r3.xyz, r1.zxyz, r2.xyzx
-mad r2.xyz, r1.yzxy, r2.yzxy, -r3.xyzx
-dp3 r0.w, r2.xyzx, r2.xyzx
-rsq r0.w, r0.w
-mul r2.xyz, r0.wwww, r2.xyzx
-mul r3.xyz, r1.yzxy, r2.zxyz
-mad r3.xyz, r2.yzxy, r1.zxyz, -r3.xyzx
-mul r0.w, cb0[2].w, l(0.500000)
-sincos r4.x, r5.x, r0.w
-div r0.w, r4.x, r5.x
-mul r2.xyz, r0.xxxx, r2.xyzx
-mul r2.xyz, r0.zzzz, r2.xyzx
-mad r1.xyz, r2.xyzx, r0.wwww, r1.xyzx
-mul r0.xyz, -r0.yyyy, r3.xyzx
-mad r0.xyz, r0.xyzx, r0.wwww, r1.xyzx
-dp3 r0.w, r0.xyzx, r0.xyzx
-rsq r0.w, r0.w
-mul r0.xyz, r0.wwww, r0.xyzx
-dp3 r0.w, cb0[0].xyzx, cb0[0].xyzx
-sqrt r0.w, r0.w
-add r0.w, r0.w, l(10.000000)
-max r0.w, r0.w, l(30.000000)
-mov r1.xyz, cb0[0].xyzx
-mov r2.xyz, r0.yxzy
-mov r1.w, l(0)
-mov r2.w, l(0)
-loop 
-  ige r3.x, r2.w, l(2000)
-  breakc_nz r3.x
-  dp3 r3.x, r1.xyzx, r1.xyzx
-  sqrt r3.y, r3.x
-  mul r3.x, r3.x, r3.x
-  mul r3.x, r3.y, r3.x
-  ge r3.y, r3.x, l(0.000100)
-  mul r4.xyz, r1.zxyz, r2.xzyx
-  mad r4.xyz, r1.yzxy, r2.zyxz, -r4.xyzx
-  dp3 r3.z, r4.xyzx, r4.xyzx
-  mul r3.z, r3.z, l(3.000000)
-  div r3.x, r3.z, r3.x
-  mul r3.xzw, r1.xxyz, -r3.xxxx
-  and r3.xyz, r3.xzwx, r3.yyyy
-  mad r4.xyz, r2.yxzy, l(0.050000, 0.050000, 0.050000, 0.000000), r1.xyzx
-  mad r5.xyz, r3.xyzx, l(0.050000, 0.050000, 0.050000, 0.000000), r2.yxzy
-  dp3 r3.w, r4.xyzx, r4.xyzx
-  sqrt r4.w, r3.w
-  mul r3.w, r3.w, r3.w
-  mul r3.w, r4.w, r3.w
-  ge r4.w, r3.w, l(0.000100)
-  mul r6.xyz, r4.zxyz, r5.yzxy
-  mad r6.xyz, r4.yzxy, r5.zxyz, -r6.xyzx
-  dp3 r5.w, r6.xyzx, r6.xyzx
-  mul r5.w, r5.w, l(3.000000)
-  div r3.w, r5.w, r3.w
-  mul r4.xyz, r4.xyzx, -r3.wwww
-  and r4.xyz, r4.xyzx, r4.wwww
-  mad r6.xyz, r5.xyzx, l(0.050000, 0.050000, 0.050000, 0.000000), r1.xyzx
-  mad r7.xyz, r4.xyzx, l(0.050000, 0.050000, 0.050000, 0.000000), r2.yxzy
-  dp3 r3.w, r6.xyzx, r6.xyzx
-  sqrt r4.w, r3.w
-  mul r3.w, r3.w, r3.w
-  mul r3.w, r4.w, r3.w
-  ge r4.w, r3.w, l(0.000100)
-  mul r8.xyz, r6.zxyz, r7.yzxy
-  mad r8.xyz, r6.yzxy, r7.zxyz, -r8.xyzx
-  dp3 r5.w, r8.xyzx, r8.xyzx
-  mul r5.w, r5.w, l(3.000000)
-  div r3.w, r5.w, r3.w
-  mul r6.xyz, r6.xyzx, -r3.wwww
-  and r6.xyz, r4.wwww, r6.xyzx
-  mad r8.xyz, r7.xyzx, l(0.100000, 0.100000, 0.100000, 0.000000), r1.xyzx
-  mad r9.xyz, r6.xyzx, l(0.100000, 0.100000, 0.100000, 0.000000), r2.yxzy
-  dp3 r3.w, r8.xyzx, r8.xyzx
-  sqrt r4.w, r3.w
-  mul r3.w, r3.w, r3.w
-  mul r3.w, r4.w, r3.w
-  ge r4.w, r3.w, l(0.000100)
-  mul r10.xyz, r8.zxyz, r9.yzxy
-  mad r10.xyz, r8.yzxy, r9.zxyz, -r10.xyzx
-  dp3 r5.w, r10.xyzx, r10.xyzx
-  mul r5.w, r5.w, l(3.000000)
-  div r3.w, r5.w, r3.w
-  mul r8.xyz, r8.xyzx, -r3.wwww
-  and r8.xyz, r4.wwww, r8.xyzx
-  mad r5.xyz, r5.xyzx, l(2.000000, 2.000000, 2.000000, 0.000000), r2.yxzy
-  mad r5.xyz, r7.xyzx, l(2.000000, 2.000000, 2.000000, 0.000000), r5.xyzx
-  add r5.xyz, r9.xyzx, r5.xyzx
-  mad r1.xyz, r5.xyzx, l(0.016667, 0.016667, 0.016667, 0.000000), r1.xyzx
-  mad r3.xyz, r4.xyzx, l(2.000000, 2.000000, 2.000000, 0.000000), r3.xyzx
-  mad r3.xyz, r6.xyzx, l(2.000000, 2.000000, 2.000000, 0.000000), r3.xyzx
-  add r3.xyz, r8.xyzx, r3.xyzx
-  mad r3.xyz, r3.xyzx, l(0.016667, 0.016667, 0.016667, 0.000000), r2.yxzy
-  dp3 r3.w, r1.xyzx, r1.xyzx
-  sqrt r3.w, r3.w
-  lt r4.x, r3.w, l(2.000000)
-  if_nz r4.x
-    mov r2.xyz, r3.yxzy
-    mov r1.w, l(-1)
-    break 
-  endif 
-  lt r3.w, r0.w, r3.w
-  if_nz r3.w
-    mov r2.xyz, r3.yxzy
-    mov r1.w, l(0)
-    break 
-  endif 
-  iadd r2.w, r2.w, l(1)
-  mov r2.xyz, r3.yxzy
-  mov r1.w, l(0)
-endloop 
-if_nz r1.w
-  store_uav_typed u0.xyzw, vThreadID.xyyy, l(0,0,0,1.000000)
-else 
-  dp3 r0.x, r2.xyzx, r2.xyzx
-  rsq r0.x, r0.x
-  mul r0.xyz, r0.xxxx, r2.xyzx
-  min r0.w, |r0.y|, |r0.x|
-  max r1.x, |r0.y|, |r0.x|
-  div r1.x, l(1.000000, 1.000000, 1.000000, 1.000000), r1.x
-  mul r0.w, r0.w, r1.x
-  mul r1.x, r0.w, r0.w
-  mad r1.y, r1.x, l(0.020835), l(-0.085133)
-  mad r1.y, r1.x, r1.y, l(0.180141)
-  mad r1.y, r1.x, r1.y, l(-0.330299)
-  mad r1.x, r1.x, r1.y, l(0.999866)
-  mul r1.y, r0.w, r1.x
-  lt r1.z, |r0.y|, |r0.x|
-  mad r1.y, r1.y, l(-2.000000), l(1.570796)
-  and r1.y, r1.z, r1.y
-  mad r0.w, r0.w, r1.x, r1.y
-  lt r1.xy, r0.yzyy, -r0.yzyy
-  and r1.x, r1.x, l(0xc0490fdb)
-  add r0.w, r0.w, r1.x
-  min r1.x, r0.y, r0.x
-  max r0.x, r0.y, r0.x
-  lt r0.y, r1.x, -r1.x
-  ge r0.x, r0.x, -r0.x
-  and r0.x, r0.x, r0.y
-  movc r0.x, r0.x, -r0.w, r0.w
-  mad r0.x, r0.x, l(0.159155), l(0.500000)
-  add r0.w, -|r0.z|, l(1.000000)
-  sqrt r0.w, r0.w
-  mad r1.x, |r0.z|, l(-0.018729), l(0.074261)
-  mad r1.x, r1.x, |r0.z|, l(-0.212114)
-  mad r0.z, r1.x, |r0.z|, l(1.570729)
-  mul r1.x, r0.w, r0.z
-  mad r1.x, r1.x, l(-2.000000), l(3.141593)
-  and r1.x, r1.y, r1.x
-  mad r0.z, r0.z, r0.w, r1.x
-  add r0.z, -r0.z, l(1.570796)
-  mad r0.y, -r0.z, l(0.318310), l(0.500000)
-  sample_l_indexable(texture2d)(float,float,float,float) r0.xyzw, r0.xyxx, t0.xyzw, s0, l(0.000000)
-  mul r0.xyzw, r0.xyzw, l(1.200000, 1.200000, 1.200000, 1.200000)
-  store_uav_typed u0.xyzw, vThreadID.xyyy, r0.xyzw
-endif 
-ret 
-// Approximately 171 instruction slots used
-#endif
-
-const BYTE g_BlackHoleShader[] =
-{
-     68,  88,  66,  67,  12,  72, 
-    169, 167, 104, 217, 239, 188, 
-    222, 182,  57, 216,  76, 183, 
-     11,  63,   1,   0,   0,   0, 
-    232,  23,   0,   0,   5,   0, 
-      0,   0,  52,   0,   0,   0, 
-    144,   3,   0,   0, 160,   3, 
-      0,   0, 176,   3,   0,   0, 
-     76,  23,   0,   0,  82,  68, 
-     69,  70,  84,   3,   0,   0, 
-      1,   0,   0,   0, 240,   0, 
-      0,   0,   4,   0,   0,   0, 
-     60,   0,   0,   0,   0,   5, 
-     83,  67,   0,   1,   0,   0, 
-     42,   3,   0,   0,  82,  68, 
-     49,  49,  60,   0,   0,   0, 
-     24,   0,   0,   0,  32,   0, 
-      0,   0,  40,   0,   0,   0, 
-     36,   0,   0,   0,  12,   0, 
-      0,   0,   0,   0,   0,   0, 
-    188,   0,   0,   0,   3,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-      1,   0,   0,   0,   1,   0, 
-      0,   0, 202,   0,   0,   0, 
-      2,   0,   0,   0,   5,   0, 
-      0,   0,   4,   0,   0,   0, 
-    255, 255, 255, 255,   0,   0, 
-      0,   0,   1,   0,   0,   0, 
-     13,   0,   0,   0, 212,   0, 
-      0,   0,   4,   0,   0,   0, 
-      5,   0,   0,   0,   4,   0, 
-      0,   0, 255, 255, 255, 255, 
-      0,   0,   0,   0,   1,   0, 
-      0,   0,  13,   0,   0,   0, 
-    225,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-      1,   0,   0,   0,   1,   0, 
-      0,   0,  83, 107, 121,  98, 
-    111, 120,  83,  97, 109, 112, 
-    108, 101, 114,   0,  83, 107, 
-    121,  98, 111, 120,  84, 101, 
-    120,   0,  79, 117, 116, 112, 
-    117, 116,  66, 117, 102, 102, 
-    101, 114,   0,  67,  97, 109, 
-    101, 114,  97,  66, 117, 102, 
-    102, 101, 114,   0, 171, 171, 
-    225,   0,   0,   0,   9,   0, 
-      0,   0,   8,   1,   0,   0, 
-     64,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-    112,   2,   0,   0,   0,   0, 
-      0,   0,  12,   0,   0,   0, 
-      2,   0,   0,   0, 128,   2, 
-      0,   0,   0,   0,   0,   0, 
-    255, 255, 255, 255,   0,   0, 
-      0,   0, 255, 255, 255, 255, 
-      0,   0,   0,   0, 164,   2, 
-      0,   0,  12,   0,   0,   0, 
-      4,   0,   0,   0,   0,   0, 
-      0,   0, 176,   2,   0,   0, 
-      0,   0,   0,   0, 255, 255, 
-    255, 255,   0,   0,   0,   0, 
-    255, 255, 255, 255,   0,   0, 
-      0,   0, 212,   2,   0,   0, 
-     16,   0,   0,   0,  12,   0, 
-      0,   0,   2,   0,   0,   0, 
-    128,   2,   0,   0,   0,   0, 
-      0,   0, 255, 255, 255, 255, 
-      0,   0,   0,   0, 255, 255, 
-    255, 255,   0,   0,   0,   0, 
-    219,   2,   0,   0,  28,   0, 
-      0,   0,   4,   0,   0,   0, 
-      0,   0,   0,   0, 176,   2, 
-      0,   0,   0,   0,   0,   0, 
-    255, 255, 255, 255,   0,   0, 
-      0,   0, 255, 255, 255, 255, 
-      0,   0,   0,   0, 224,   2, 
-      0,   0,  32,   0,   0,   0, 
-     12,   0,   0,   0,   2,   0, 
-      0,   0, 128,   2,   0,   0, 
-      0,   0,   0,   0, 255, 255, 
-    255, 255,   0,   0,   0,   0, 
-    255, 255, 255, 255,   0,   0, 
-      0,   0, 230,   2,   0,   0, 
-     44,   0,   0,   0,   4,   0, 
-      0,   0,   2,   0,   0,   0, 
-    176,   2,   0,   0,   0,   0, 
-      0,   0, 255, 255, 255, 255, 
-      0,   0,   0,   0, 255, 255, 
-    255, 255,   0,   0,   0,   0, 
-    234,   2,   0,   0,  48,   0, 
-      0,   0,   8,   0,   0,   0, 
-      2,   0,   0,   0, 252,   2, 
-      0,   0,   0,   0,   0,   0, 
-    255, 255, 255, 255,   0,   0, 
-      0,   0, 255, 255, 255, 255, 
-      0,   0,   0,   0,  32,   3, 
-      0,   0,  56,   0,   0,   0, 
-      4,   0,   0,   0,   0,   0, 
-      0,   0, 176,   2,   0,   0, 
-      0,   0,   0,   0, 255, 255, 
-    255, 255,   0,   0,   0,   0, 
-    255, 255, 255, 255,   0,   0, 
-      0,   0,  37,   3,   0,   0, 
-     60,   0,   0,   0,   4,   0, 
-      0,   0,   0,   0,   0,   0, 
-    176,   2,   0,   0,   0,   0, 
-      0,   0, 255, 255, 255, 255, 
-      0,   0,   0,   0, 255, 255, 
-    255, 255,   0,   0,   0,   0, 
-     99,  97, 109,  80, 111, 115, 
-      0, 102, 108, 111,  97, 116, 
-     51,   0, 171, 171,   1,   0, 
-      3,   0,   1,   0,   3,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-    119,   2,   0,   0, 112,  97, 
-    100,  49,   0, 102, 108, 111, 
-     97, 116,   0, 171,   0,   0, 
-      3,   0,   1,   0,   1,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-    169,   2,   0,   0,  99,  97, 
-    109,  68, 105, 114,   0, 112, 
-     97, 100,  50,   0,  99,  97, 
-    109,  85, 112,   0, 102, 111, 
-    118,   0, 114, 101, 115, 111, 
-    108, 117, 116, 105, 111, 110, 
-      0, 102, 108, 111,  97, 116, 
-     50,   0,   1,   0,   3,   0, 
-      1,   0,   2,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0, 245,   2, 
-      0,   0, 109,  97, 115, 115, 
-      0, 115, 112, 105, 110,   0, 
-     77, 105,  99, 114, 111, 115, 
-    111, 102, 116,  32,  40,  82, 
-     41,  32,  72,  76,  83,  76, 
-     32,  83, 104,  97, 100, 101, 
-    114,  32,  67, 111, 109, 112, 
-    105, 108, 101, 114,  32,  49, 
-     48,  46,  49,   0, 171, 171, 
-     73,  83,  71,  78,   8,   0, 
-      0,   0,   0,   0,   0,   0, 
-      8,   0,   0,   0,  79,  83, 
-     71,  78,   8,   0,   0,   0, 
-      0,   0,   0,   0,   8,   0, 
-      0,   0,  83,  72,  69,  88, 
-    148,  19,   0,   0,  80,   0, 
-      5,   0, 229,   4,   0,   0, 
-    106,   8,   0,   1,  89,   0, 
-      0,   4,  70, 142,  32,   0, 
-      0,   0,   0,   0,   4,   0, 
-      0,   0,  90,   0,   0,   3, 
-      0,  96,  16,   0,   0,   0, 
-      0,   0,  88,  24,   0,   4, 
-      0, 112,  16,   0,   0,   0, 
-      0,   0,  85,  85,   0,   0, 
-    156,  24,   0,   4,   0, 224, 
-     17,   0,   0,   0,   0,   0, 
-     85,  85,   0,   0,  95,   0, 
-      0,   2,  50,   0,   2,   0, 
-    104,   0,   0,   2,  11,   0, 
-      0,   0, 155,   0,   0,   4, 
-     16,   0,   0,   0,  16,   0, 
-      0,   0,   1,   0,   0,   0, 
-     28,   0,   0,   6,  50,   0, 
-     16,   0,   0,   0,   0,   0, 
-     70, 128,  32,   0,   0,   0, 
-      0,   0,   3,   0,   0,   0, 
-     80,   0,   0,   6,  50,   0, 
-     16,   0,   0,   0,   0,   0, 
-     70,   0,   2,   0,  70,   0, 
-     16,   0,   0,   0,   0,   0, 
-     60,   0,   0,   7,  18,   0, 
-     16,   0,   0,   0,   0,   0, 
-     26,   0,  16,   0,   0,   0, 
-      0,   0,  10,   0,  16,   0, 
-      0,   0,   0,   0,  31,   0, 
-      4,   3,  10,   0,  16,   0, 
-      0,   0,   0,   0,  62,   0, 
-      0,   1,  21,   0,   0,   1, 
-     86,   0,   0,   4,  50,   0, 
-     16,   0,   0,   0,   0,   0, 
-     70,   0,   2,   0,  14,   0, 
-      0,   8,  50,   0,  16,   0, 
-      0,   0,   0,   0,  70,   0, 
-     16,   0,   0,   0,   0,   0, 
-     70, 128,  32,   0,   0,   0, 
-      0,   0,   3,   0,   0,   0, 
-     50,   0,   0,  15,  50,   0, 
-     16,   0,   0,   0,   0,   0, 
-     70,   0,  16,   0,   0,   0, 
-      0,   0,   2,  64,   0,   0, 
-      0,   0,   0,  64,   0,   0, 
-      0,  64,   0,   0,   0,   0, 
-      0,   0,   0,   0,   2,  64, 
-      0,   0,   0,   0, 128, 191, 
-      0,   0, 128, 191,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-     14,   0,   0,   9,  66,   0, 
-     16,   0,   0,   0,   0,   0, 
-     10, 128,  32,   0,   0,   0, 
-      0,   0,   3,   0,   0,   0, 
-     26, 128,  32,   0,   0,   0, 
-      0,   0,   3,   0,   0,   0, 
-     16,   0,   0,   9, 130,   0, 
-     16,   0,   0,   0,   0,   0, 
-     70, 130,  32,   0,   0,   0, 
-      0,   0,   1,   0,   0,   0, 
-     70, 130,  32,   0,   0,   0, 
-      0,   0,   1,   0,   0,   0, 
-     68,   0,   0,   5, 130,   0, 
-     16,   0,   0,   0,   0,   0, 
-     58,   0,  16,   0,   0,   0, 
-      0,   0,  56,   0,   0,   8, 
-    114,   0,  16,   0,   1,   0, 
-      0,   0, 246,  15,  16,   0, 
-      0,   0,   0,   0,  70, 130, 
-     32,   0,   0,   0,   0,   0, 
-      1,   0,   0,   0,  16,   0, 
-      0,   9, 130,   0,  16,   0, 
-      0,   0,   0,   0,  70, 130, 
-     32,   0,   0,   0,   0,   0, 
-      2,   0,   0,   0,  70, 130, 
-     32,   0,   0,   0,   0,   0, 
-      2,   0,   0,   0,  68,   0, 
-      0,   5, 130,   0,  16,   0, 
-      0,   0,   0,   0,  58,   0, 
-     16,   0,   0,   0,   0,   0, 
-     56,   0,   0,   8, 114,   0, 
-     16,   0,   2,   0,   0,   0, 
-    246,  15,  16,   0,   0,   0, 
-      0,   0, 150, 132,  32,   0, 
-      0,   0,   0,   0,   2,   0, 
-      0,   0,  56,   0,   0,   7, 
-    114,   0,  16,   0,   3,   0, 
-      0,   0,  38,   9,  16,   0, 
-      1,   0,   0,   0,  70,   2, 
-     16,   0,   2,   0,   0,   0, 
-     50,   0,   0,  10, 114,   0, 
-     16,   0,   2,   0,   0,   0, 
-    150,   4,  16,   0,   1,   0, 
-      0,   0, 150,   4,  16,   0, 
-      2,   0,   0,   0,  70,   2, 
-     16, 128,  65,   0,   0,   0, 
-      3,   0,   0,   0,  16,   0, 
-      0,   7, 130,   0,  16,   0, 
-      0,   0,   0,   0,  70,   2, 
-     16,   0,   2,   0,   0,   0, 
-     70,   2,  16,   0,   2,   0, 
-      0,   0,  68,   0,   0,   5, 
-    130,   0,  16,   0,   0,   0, 
-      0,   0,  58,   0,  16,   0, 
-      0,   0,   0,   0,  56,   0, 
-      0,   7, 114,   0,  16,   0, 
-      2,   0,   0,   0, 246,  15, 
-     16,   0,   0,   0,   0,   0, 
-     70,   2,  16,   0,   2,   0, 
-      0,   0,  56,   0,   0,   7, 
-    114,   0,  16,   0,   3,   0, 
-      0,   0, 150,   4,  16,   0, 
-      1,   0,   0,   0,  38,   9, 
-     16,   0,   2,   0,   0,   0, 
-     50,   0,   0,  10, 114,   0, 
-     16,   0,   3,   0,   0,   0, 
-    150,   4,  16,   0,   2,   0, 
-      0,   0,  38,   9,  16,   0, 
-      1,   0,   0,   0,  70,   2, 
-     16, 128,  65,   0,   0,   0, 
-      3,   0,   0,   0,  56,   0, 
-      0,   8, 130,   0,  16,   0, 
-      0,   0,   0,   0,  58, 128, 
-     32,   0,   0,   0,   0,   0, 
-      2,   0,   0,   0,   1,  64, 
-      0,   0,   0,   0,   0,  63, 
-     77,   0,   0,   7,  18,   0, 
-     16,   0,   4,   0,   0,   0, 
-     18,   0,  16,   0,   5,   0, 
-      0,   0,  58,   0,  16,   0, 
-      0,   0,   0,   0,  14,   0, 
-      0,   7, 130,   0,  16,   0, 
-      0,   0,   0,   0,  10,   0, 
-     16,   0,   4,   0,   0,   0, 
-     10,   0,  16,   0,   5,   0, 
-      0,   0,  56,   0,   0,   7, 
-    114,   0,  16,   0,   2,   0, 
-      0,   0,   6,   0,  16,   0, 
-      0,   0,   0,   0,  70,   2, 
-     16,   0,   2,   0,   0,   0, 
-     56,   0,   0,   7, 114,   0, 
-     16,   0,   2,   0,   0,   0, 
-    166,  10,  16,   0,   0,   0, 
-      0,   0,  70,   2,  16,   0, 
-      2,   0,   0,   0,  50,   0, 
-      0,   9, 114,   0,  16,   0, 
-      1,   0,   0,   0,  70,   2, 
-     16,   0,   2,   0,   0,   0, 
-    246,  15,  16,   0,   0,   0, 
-      0,   0,  70,   2,  16,   0, 
-      1,   0,   0,   0,  56,   0, 
-      0,   8, 114,   0,  16,   0, 
-      0,   0,   0,   0,  86,   5, 
-     16, 128,  65,   0,   0,   0, 
-      0,   0,   0,   0,  70,   2, 
-     16,   0,   3,   0,   0,   0, 
-     50,   0,   0,   9, 114,   0, 
-     16,   0,   0,   0,   0,   0, 
-     70,   2,  16,   0,   0,   0, 
-      0,   0, 246,  15,  16,   0, 
-      0,   0,   0,   0,  70,   2, 
-     16,   0,   1,   0,   0,   0, 
-     16,   0,   0,   7, 130,   0, 
-     16,   0,   0,   0,   0,   0, 
-     70,   2,  16,   0,   0,   0, 
-      0,   0,  70,   2,  16,   0, 
-      0,   0,   0,   0,  68,   0, 
-      0,   5, 130,   0,  16,   0, 
-      0,   0,   0,   0,  58,   0, 
-     16,   0,   0,   0,   0,   0, 
-     56,   0,   0,   7, 114,   0, 
-     16,   0,   0,   0,   0,   0, 
-    246,  15,  16,   0,   0,   0, 
-      0,   0,  70,   2,  16,   0, 
-      0,   0,   0,   0,  16,   0, 
-      0,   9, 130,   0,  16,   0, 
-      0,   0,   0,   0,  70, 130, 
-     32,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,  70, 130, 
-     32,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,  75,   0, 
-      0,   5, 130,   0,  16,   0, 
-      0,   0,   0,   0,  58,   0, 
-     16,   0,   0,   0,   0,   0, 
-      0,   0,   0,   7, 130,   0, 
-     16,   0,   0,   0,   0,   0, 
-     58,   0,  16,   0,   0,   0, 
-      0,   0,   1,  64,   0,   0, 
-      0,   0,  32,  65,  52,   0, 
-      0,   7, 130,   0,  16,   0, 
-      0,   0,   0,   0,  58,   0, 
-     16,   0,   0,   0,   0,   0, 
-      1,  64,   0,   0,   0,   0, 
-    240,  65,  54,   0,   0,   6, 
-    114,   0,  16,   0,   1,   0, 
-      0,   0,  70, 130,  32,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,  54,   0,   0,   5, 
-    114,   0,  16,   0,   2,   0, 
-      0,   0,  22,   6,  16,   0, 
-      0,   0,   0,   0,  54,   0, 
-      0,   5, 130,   0,  16,   0, 
-      1,   0,   0,   0,   1,  64, 
-      0,   0,   0,   0,   0,   0, 
-     54,   0,   0,   5, 130,   0, 
-     16,   0,   2,   0,   0,   0, 
-      1,  64,   0,   0,   0,   0, 
-      0,   0,  48,   0,   0,   1, 
-     33,   0,   0,   7,  18,   0, 
-     16,   0,   3,   0,   0,   0, 
-     58,   0,  16,   0,   2,   0, 
-      0,   0,   1,  64,   0,   0, 
-    208,   7,   0,   0,   3,   0, 
-      4,   3,  10,   0,  16,   0, 
-      3,   0,   0,   0,  16,   0, 
-      0,   7,  18,   0,  16,   0, 
-      3,   0,   0,   0,  70,   2, 
-     16,   0,   1,   0,   0,   0, 
-     70,   2,  16,   0,   1,   0, 
-      0,   0,  75,   0,   0,   5, 
-     34,   0,  16,   0,   3,   0, 
-      0,   0,  10,   0,  16,   0, 
-      3,   0,   0,   0,  56,   0, 
-      0,   7,  18,   0,  16,   0, 
-      3,   0,   0,   0,  10,   0, 
-     16,   0,   3,   0,   0,   0, 
-     10,   0,  16,   0,   3,   0, 
-      0,   0,  56,   0,   0,   7, 
-     18,   0,  16,   0,   3,   0, 
-      0,   0,  26,   0,  16,   0, 
-      3,   0,   0,   0,  10,   0, 
-     16,   0,   3,   0,   0,   0, 
-     29,   0,   0,   7,  34,   0, 
-     16,   0,   3,   0,   0,   0, 
-     10,   0,  16,   0,   3,   0, 
-      0,   0,   1,  64,   0,   0, 
-     23, 183, 209,  56,  56,   0, 
-      0,   7, 114,   0,  16,   0, 
-      4,   0,   0,   0,  38,   9, 
-     16,   0,   1,   0,   0,   0, 
-    134,   1,  16,   0,   2,   0, 
-      0,   0,  50,   0,   0,  10, 
-    114,   0,  16,   0,   4,   0, 
-      0,   0, 150,   4,  16,   0, 
-      1,   0,   0,   0, 102,   8, 
-     16,   0,   2,   0,   0,   0, 
-     70,   2,  16, 128,  65,   0, 
-      0,   0,   4,   0,   0,   0, 
-     16,   0,   0,   7,  66,   0, 
-     16,   0,   3,   0,   0,   0, 
-     70,   2,  16,   0,   4,   0, 
-      0,   0,  70,   2,  16,   0, 
-      4,   0,   0,   0,  56,   0, 
-      0,   7,  66,   0,  16,   0, 
-      3,   0,   0,   0,  42,   0, 
-     16,   0,   3,   0,   0,   0, 
-      1,  64,   0,   0,   0,   0, 
-     64,  64,  14,   0,   0,   7, 
-     18,   0,  16,   0,   3,   0, 
-      0,   0,  42,   0,  16,   0, 
-      3,   0,   0,   0,  10,   0, 
-     16,   0,   3,   0,   0,   0, 
-     56,   0,   0,   8, 210,   0, 
-     16,   0,   3,   0,   0,   0, 
-      6,   9,  16,   0,   1,   0, 
-      0,   0,   6,   0,  16, 128, 
-     65,   0,   0,   0,   3,   0, 
-      0,   0,   1,   0,   0,   7, 
-    114,   0,  16,   0,   3,   0, 
-      0,   0, 134,   3,  16,   0, 
-      3,   0,   0,   0,  86,   5, 
-     16,   0,   3,   0,   0,   0, 
-     50,   0,   0,  12, 114,   0, 
-     16,   0,   4,   0,   0,   0, 
-     22,   6,  16,   0,   2,   0, 
-      0,   0,   2,  64,   0,   0, 
-    205, 204,  76,  61, 205, 204, 
-     76,  61, 205, 204,  76,  61, 
-      0,   0,   0,   0,  70,   2, 
-     16,   0,   1,   0,   0,   0, 
-     50,   0,   0,  12, 114,   0, 
-     16,   0,   5,   0,   0,   0, 
-     70,   2,  16,   0,   3,   0, 
-      0,   0,   2,  64,   0,   0, 
-    205, 204,  76,  61, 205, 204, 
-     76,  61, 205, 204,  76,  61, 
-      0,   0,   0,   0,  22,   6, 
-     16,   0,   2,   0,   0,   0, 
-     16,   0,   0,   7, 130,   0, 
-     16,   0,   3,   0,   0,   0, 
-     70,   2,  16,   0,   4,   0, 
-      0,   0,  70,   2,  16,   0, 
-      4,   0,   0,   0,  75,   0, 
-      0,   5, 130,   0,  16,   0, 
-      4,   0,   0,   0,  58,   0, 
-     16,   0,   3,   0,   0,   0, 
-     56,   0,   0,   7, 130,   0, 
-     16,   0,   3,   0,   0,   0, 
-     58,   0,  16,   0,   3,   0, 
-      0,   0,  58,   0,  16,   0, 
-      3,   0,   0,   0,  56,   0, 
-      0,   7, 130,   0,  16,   0, 
-      3,   0,   0,   0,  58,   0, 
-     16,   0,   4,   0,   0,   0, 
-     58,   0,  16,   0,   3,   0, 
-      0,   0,  29,   0,   0,   7, 
-    130,   0,  16,   0,   4,   0, 
-      0,   0,  58,   0,  16,   0, 
-      3,   0,   0,   0,   1,  64, 
-      0,   0,  23, 183, 209,  56, 
-     56,   0,   0,   7, 114,   0, 
-     16,   0,   6,   0,   0,   0, 
-     38,   9,  16,   0,   4,   0, 
-      0,   0, 150,   4,  16,   0, 
-      5,   0,   0,   0,  50,   0, 
-      0,  10, 114,   0,  16,   0, 
-      6,   0,   0,   0, 150,   4, 
-     16,   0,   4,   0,   0,   0, 
-     38,   9,  16,   0,   5,   0, 
-      0,   0,  70,   2,  16, 128, 
-     65,   0,   0,   0,   6,   0, 
-      0,   0,  16,   0,   0,   7, 
-    130,   0,  16,   0,   5,   0, 
-      0,   0,  70,   2,  16,   0, 
-      6,   0,   0,   0,  70,   2, 
-     16,   0,   6,   0,   0,   0, 
-     56,   0,   0,   7, 130,   0, 
-     16,   0,   5,   0,   0,   0, 
-     58,   0,  16,   0,   5,   0, 
-      0,   0,   1,  64,   0,   0, 
-      0,   0,  64,  64,  14,   0, 
-      0,   7, 130,   0,  16,   0, 
-      3,   0,   0,   0,  58,   0, 
-     16,   0,   5,   0,   0,   0, 
-     58,   0,  16,   0,   3,   0, 
-      0,   0,  56,   0,   0,   8, 
-    114,   0,  16,   0,   4,   0, 
-      0,   0,  70,   2,  16,   0, 
-      4,   0,   0,   0, 246,  15, 
-     16, 128,  65,   0,   0,   0, 
-      3,   0,   0,   0,   1,   0, 
-      0,   7, 114,   0,  16,   0, 
-      4,   0,   0,   0,  70,   2, 
-     16,   0,   4,   0,   0,   0, 
-    246,  15,  16,   0,   4,   0, 
-      0,   0,  50,   0,   0,  12, 
-    114,   0,  16,   0,   6,   0, 
-      0,   0,  70,   2,  16,   0, 
-      5,   0,   0,   0,   2,  64, 
-      0,   0, 205, 204,  76,  61, 
-    205, 204,  76,  61, 205, 204, 
-     76,  61,   0,   0,   0,   0, 
-     70,   2,  16,   0,   1,   0, 
-      0,   0,  50,   0,   0,  12, 
-    114,   0,  16,   0,   7,   0, 
-      0,   0,  70,   2,  16,   0, 
-      4,   0,   0,   0,   2,  64, 
-      0,   0, 205, 204,  76,  61, 
-    205, 204,  76,  61, 205, 204, 
-     76,  61,   0,   0,   0,   0, 
-     22,   6,  16,   0,   2,   0, 
-      0,   0,  16,   0,   0,   7, 
-    130,   0,  16,   0,   3,   0, 
-      0,   0,  70,   2,  16,   0, 
-      6,   0,   0,   0,  70,   2, 
-     16,   0,   6,   0,   0,   0, 
-     75,   0,   0,   5, 130,   0, 
-     16,   0,   4,   0,   0,   0, 
-     58,   0,  16,   0,   3,   0, 
-      0,   0,  56,   0,   0,   7, 
-    130,   0,  16,   0,   3,   0, 
-      0,   0,  58,   0,  16,   0, 
-      3,   0,   0,   0,  58,   0, 
-     16,   0,   3,   0,   0,   0, 
-     56,   0,   0,   7, 130,   0, 
-     16,   0,   3,   0,   0,   0, 
-     58,   0,  16,   0,   4,   0, 
-      0,   0,  58,   0,  16,   0, 
-      3,   0,   0,   0,  29,   0, 
-      0,   7, 130,   0,  16,   0, 
-      4,   0,   0,   0,  58,   0, 
-     16,   0,   3,   0,   0,   0, 
-      1,  64,   0,   0,  23, 183, 
-    209,  56,  56,   0,   0,   7, 
-    114,   0,  16,   0,   8,   0, 
-      0,   0,  38,   9,  16,   0, 
-      6,   0,   0,   0, 150,   4, 
-     16,   0,   7,   0,   0,   0, 
-     50,   0,   0,  10, 114,   0, 
-     16,   0,   8,   0,   0,   0, 
-    150,   4,  16,   0,   6,   0, 
-      0,   0,  38,   9,  16,   0, 
-      7,   0,   0,   0,  70,   2, 
-     16, 128,  65,   0,   0,   0, 
-      8,   0,   0,   0,  16,   0, 
-      0,   7, 130,   0,  16,   0, 
-      5,   0,   0,   0,  70,   2, 
-     16,   0,   8,   0,   0,   0, 
-     70,   2,  16,   0,   8,   0, 
-      0,   0,  56,   0,   0,   7, 
-    130,   0,  16,   0,   5,   0, 
-      0,   0,  58,   0,  16,   0, 
-      5,   0,   0,   0,   1,  64, 
-      0,   0,   0,   0,  64,  64, 
-     14,   0,   0,   7, 130,   0, 
-     16,   0,   3,   0,   0,   0, 
-     58,   0,  16,   0,   5,   0, 
-      0,   0,  58,   0,  16,   0, 
-      3,   0,   0,   0,  56,   0, 
-      0,   8, 114,   0,  16,   0, 
-      6,   0,   0,   0,  70,   2, 
-     16,   0,   6,   0,   0,   0, 
-    246,  15,  16, 128,  65,   0, 
-      0,   0,   3,   0,   0,   0, 
-      1,   0,   0,   7, 114,   0, 
-     16,   0,   6,   0,   0,   0, 
-    246,  15,  16,   0,   4,   0, 
-      0,   0,  70,   2,  16,   0, 
-      6,   0,   0,   0,  50,   0, 
-      0,  12, 114,   0,  16,   0, 
-      8,   0,   0,   0,  70,   2, 
-     16,   0,   7,   0,   0,   0, 
-      2,  64,   0,   0, 205, 204, 
-    204,  61, 205, 204, 204,  61, 
-    205, 204, 204,  61,   0,   0, 
-      0,   0,  70,   2,  16,   0, 
-      1,   0,   0,   0,  50,   0, 
-      0,  12, 114,   0,  16,   0, 
-      9,   0,   0,   0,  70,   2, 
-     16,   0,   6,   0,   0,   0, 
-      2,  64,   0,   0, 205, 204, 
-    204,  61, 205, 204, 204,  61, 
-    205, 204, 204,  61,   0,   0, 
-      0,   0,  22,   6,  16,   0, 
-      2,   0,   0,   0,  16,   0, 
-      0,   7, 130,   0,  16,   0, 
-      3,   0,   0,   0,  70,   2, 
-     16,   0,   8,   0,   0,   0, 
-     70,   2,  16,   0,   8,   0, 
-      0,   0,  75,   0,   0,   5, 
-    130,   0,  16,   0,   4,   0, 
-      0,   0,  58,   0,  16,   0, 
-      3,   0,   0,   0,  56,   0, 
-      0,   7, 130,   0,  16,   0, 
-      3,   0,   0,   0,  58,   0, 
-     16,   0,   3,   0,   0,   0, 
-     58,   0,  16,   0,   3,   0, 
-      0,   0,  56,   0,   0,   7, 
-    130,   0,  16,   0,   3,   0, 
-      0,   0,  58,   0,  16,   0, 
-      4,   0,   0,   0,  58,   0, 
-     16,   0,   3,   0,   0,   0, 
-     29,   0,   0,   7, 130,   0, 
-     16,   0,   4,   0,   0,   0, 
-     58,   0,  16,   0,   3,   0, 
-      0,   0,   1,  64,   0,   0, 
-     23, 183, 209,  56,  56,   0, 
-      0,   7, 114,   0,  16,   0, 
-     10,   0,   0,   0,  38,   9, 
-     16,   0,   8,   0,   0,   0, 
-    150,   4,  16,   0,   9,   0, 
-      0,   0,  50,   0,   0,  10, 
-    114,   0,  16,   0,  10,   0, 
-      0,   0, 150,   4,  16,   0, 
-      8,   0,   0,   0,  38,   9, 
-     16,   0,   9,   0,   0,   0, 
-     70,   2,  16, 128,  65,   0, 
-      0,   0,  10,   0,   0,   0, 
-     16,   0,   0,   7, 130,   0, 
-     16,   0,   5,   0,   0,   0, 
-     70,   2,  16,   0,  10,   0, 
-      0,   0,  70,   2,  16,   0, 
-     10,   0,   0,   0,  56,   0, 
-      0,   7, 130,   0,  16,   0, 
-      5,   0,   0,   0,  58,   0, 
-     16,   0,   5,   0,   0,   0, 
-      1,  64,   0,   0,   0,   0, 
-     64,  64,  14,   0,   0,   7, 
-    130,   0,  16,   0,   3,   0, 
-      0,   0,  58,   0,  16,   0, 
-      5,   0,   0,   0,  58,   0, 
-     16,   0,   3,   0,   0,   0, 
-     56,   0,   0,   8, 114,   0, 
-     16,   0,   8,   0,   0,   0, 
-     70,   2,  16,   0,   8,   0, 
-      0,   0, 246,  15,  16, 128, 
-     65,   0,   0,   0,   3,   0, 
-      0,   0,   1,   0,   0,   7, 
-    114,   0,  16,   0,   8,   0, 
-      0,   0, 246,  15,  16,   0, 
-      4,   0,   0,   0,  70,   2, 
-     16,   0,   8,   0,   0,   0, 
-     50,   0,   0,  12, 114,   0, 
-     16,   0,   5,   0,   0,   0, 
-     70,   2,  16,   0,   5,   0, 
-      0,   0,   2,  64,   0,   0, 
-      0,   0,   0,  64,   0,   0, 
-      0,  64,   0,   0,   0,  64, 
-      0,   0,   0,   0,  22,   6, 
-     16,   0,   2,   0,   0,   0, 
-     50,   0,   0,  12, 114,   0, 
-     16,   0,   5,   0,   0,   0, 
-     70,   2,  16,   0,   7,   0, 
-      0,   0,   2,  64,   0,   0, 
-      0,   0,   0,  64,   0,   0, 
-      0,  64,   0,   0,   0,  64, 
-      0,   0,   0,   0,  70,   2, 
-     16,   0,   5,   0,   0,   0, 
-      0,   0,   0,   7, 114,   0, 
-     16,   0,   5,   0,   0,   0, 
-     70,   2,  16,   0,   9,   0, 
-      0,   0,  70,   2,  16,   0, 
-      5,   0,   0,   0,  50,   0, 
-      0,  12, 114,   0,  16,   0, 
-      1,   0,   0,   0,  70,   2, 
-     16,   0,   5,   0,   0,   0, 
-      2,  64,   0,   0, 137, 136, 
-    136,  60, 137, 136, 136,  60, 
-    137, 136, 136,  60,   0,   0, 
-      0,   0,  70,   2,  16,   0, 
-      1,   0,   0,   0,  50,   0, 
-      0,  12, 114,   0,  16,   0, 
-      3,   0,   0,   0,  70,   2, 
-     16,   0,   4,   0,   0,   0, 
-      2,  64,   0,   0,   0,   0, 
-      0,  64,   0,   0,   0,  64, 
-      0,   0,   0,  64,   0,   0, 
-      0,   0,  70,   2,  16,   0, 
-      3,   0,   0,   0,  50,   0, 
-      0,  12, 114,   0,  16,   0, 
-      3,   0,   0,   0,  70,   2, 
-     16,   0,   6,   0,   0,   0, 
-      2,  64,   0,   0,   0,   0, 
-      0,  64,   0,   0,   0,  64, 
-      0,   0,   0,  64,   0,   0, 
-      0,   0,  70,   2,  16,   0, 
-      3,   0,   0,   0,   0,   0, 
-      0,   7, 114,   0,  16,   0, 
-      3,   0,   0,   0,  70,   2, 
-     16,   0,   8,   0,   0,   0, 
-     70,   2,  16,   0,   3,   0, 
-      0,   0,  50,   0,   0,  12, 
-    114,   0,  16,   0,   3,   0, 
-      0,   0,  70,   2,  16,   0, 
-      3,   0,   0,   0,   2,  64, 
-      0,   0, 137, 136, 136,  60, 
-    137, 136, 136,  60, 137, 136, 
-    136,  60,   0,   0,   0,   0, 
-     22,   6,  16,   0,   2,   0, 
-      0,   0,  16,   0,   0,   7, 
-    130,   0,  16,   0,   3,   0, 
-      0,   0,  70,   2,  16,   0, 
-      1,   0,   0,   0,  70,   2, 
-     16,   0,   1,   0,   0,   0, 
-     75,   0,   0,   5, 130,   0, 
-     16,   0,   3,   0,   0,   0, 
-     58,   0,  16,   0,   3,   0, 
-      0,   0,  49,   0,   0,   7, 
-     18,   0,  16,   0,   4,   0, 
-      0,   0,  58,   0,  16,   0, 
-      3,   0,   0,   0,   1,  64, 
-      0,   0,   0,   0,   0,  64, 
-     31,   0,   4,   3,  10,   0, 
-     16,   0,   4,   0,   0,   0, 
-     54,   0,   0,   5, 114,   0, 
-     16,   0,   2,   0,   0,   0, 
-     22,   6,  16,   0,   3,   0, 
-      0,   0,  54,   0,   0,   5, 
-    130,   0,  16,   0,   1,   0, 
-      0,   0,   1,  64,   0,   0, 
-    255, 255, 255, 255,   2,   0, 
-      0,   1,  21,   0,   0,   1, 
-     49,   0,   0,   7, 130,   0, 
-     16,   0,   3,   0,   0,   0, 
-     58,   0,  16,   0,   0,   0, 
-      0,   0,  58,   0,  16,   0, 
-      3,   0,   0,   0,  31,   0, 
-      4,   3,  58,   0,  16,   0, 
-      3,   0,   0,   0,  54,   0, 
-      0,   5, 114,   0,  16,   0, 
-      2,   0,   0,   0,  22,   6, 
-     16,   0,   3,   0,   0,   0, 
-     54,   0,   0,   5, 130,   0, 
-     16,   0,   1,   0,   0,   0, 
-      1,  64,   0,   0,   0,   0, 
-      0,   0,   2,   0,   0,   1, 
-     21,   0,   0,   1,  30,   0, 
-      0,   7, 130,   0,  16,   0, 
-      2,   0,   0,   0,  58,   0, 
-     16,   0,   2,   0,   0,   0, 
-      1,  64,   0,   0,   1,   0, 
-      0,   0,  54,   0,   0,   5, 
-    114,   0,  16,   0,   2,   0, 
-      0,   0,  22,   6,  16,   0, 
-      3,   0,   0,   0,  54,   0, 
-      0,   5, 130,   0,  16,   0, 
-      1,   0,   0,   0,   1,  64, 
-      0,   0,   0,   0,   0,   0, 
-     22,   0,   0,   1,  31,   0, 
-      4,   3,  58,   0,  16,   0, 
-      1,   0,   0,   0, 164,   0, 
-      0,   9, 242, 224,  17,   0, 
-      0,   0,   0,   0,  70,   5, 
-      2,   0,   2,  64,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0, 128,  63,  18,   0, 
-      0,   1,  16,   0,   0,   7, 
-     18,   0,  16,   0,   0,   0, 
-      0,   0,  70,   2,  16,   0, 
-      2,   0,   0,   0,  70,   2, 
-     16,   0,   2,   0,   0,   0, 
-     68,   0,   0,   5,  18,   0, 
-     16,   0,   0,   0,   0,   0, 
-     10,   0,  16,   0,   0,   0, 
-      0,   0,  56,   0,   0,   7, 
-    114,   0,  16,   0,   0,   0, 
-      0,   0,   6,   0,  16,   0, 
-      0,   0,   0,   0,  70,   2, 
-     16,   0,   2,   0,   0,   0, 
-     51,   0,   0,   9, 130,   0, 
-     16,   0,   0,   0,   0,   0, 
-     26,   0,  16, 128, 129,   0, 
-      0,   0,   0,   0,   0,   0, 
-     10,   0,  16, 128, 129,   0, 
-      0,   0,   0,   0,   0,   0, 
-     52,   0,   0,   9,  18,   0, 
-     16,   0,   1,   0,   0,   0, 
-     26,   0,  16, 128, 129,   0, 
-      0,   0,   0,   0,   0,   0, 
-     10,   0,  16, 128, 129,   0, 
-      0,   0,   0,   0,   0,   0, 
-     14,   0,   0,  10,  18,   0, 
-     16,   0,   1,   0,   0,   0, 
-      2,  64,   0,   0,   0,   0, 
-    128,  63,   0,   0, 128,  63, 
-      0,   0, 128,  63,   0,   0, 
-    128,  63,  10,   0,  16,   0, 
-      1,   0,   0,   0,  56,   0, 
-      0,   7, 130,   0,  16,   0, 
-      0,   0,   0,   0,  58,   0, 
-     16,   0,   0,   0,   0,   0, 
-     10,   0,  16,   0,   1,   0, 
-      0,   0,  56,   0,   0,   7, 
-     18,   0,  16,   0,   1,   0, 
-      0,   0,  58,   0,  16,   0, 
-      0,   0,   0,   0,  58,   0, 
-     16,   0,   0,   0,   0,   0, 
-     50,   0,   0,   9,  34,   0, 
-     16,   0,   1,   0,   0,   0, 
-     10,   0,  16,   0,   1,   0, 
-      0,   0,   1,  64,   0,   0, 
-     95, 174, 170,  60,   1,  64, 
-      0,   0,  54,  90, 174, 189, 
-     50,   0,   0,   9,  34,   0, 
-     16,   0,   1,   0,   0,   0, 
-     10,   0,  16,   0,   1,   0, 
-      0,   0,  26,   0,  16,   0, 
-      1,   0,   0,   0,   1,  64, 
-      0,   0, 226, 118,  56,  62, 
-     50,   0,   0,   9,  34,   0, 
-     16,   0,   1,   0,   0,   0, 
-     10,   0,  16,   0,   1,   0, 
-      0,   0,  26,   0,  16,   0, 
-      1,   0,   0,   0,   1,  64, 
-      0,   0,   4,  29, 169, 190, 
-     50,   0,   0,   9,  18,   0, 
-     16,   0,   1,   0,   0,   0, 
-     10,   0,  16,   0,   1,   0, 
-      0,   0,  26,   0,  16,   0, 
-      1,   0,   0,   0,   1,  64, 
-      0,   0,  56, 247, 127,  63, 
-     56,   0,   0,   7,  34,   0, 
-     16,   0,   1,   0,   0,   0, 
-     58,   0,  16,   0,   0,   0, 
-      0,   0,  10,   0,  16,   0, 
-      1,   0,   0,   0,  49,   0, 
-      0,   9,  66,   0,  16,   0, 
-      1,   0,   0,   0,  26,   0, 
-     16, 128, 129,   0,   0,   0, 
-      0,   0,   0,   0,  10,   0, 
-     16, 128, 129,   0,   0,   0, 
-      0,   0,   0,   0,  50,   0, 
-      0,   9,  34,   0,  16,   0, 
-      1,   0,   0,   0,  26,   0, 
-     16,   0,   1,   0,   0,   0, 
-      1,  64,   0,   0,   0,   0, 
-      0, 192,   1,  64,   0,   0, 
-    219,  15, 201,  63,   1,   0, 
-      0,   7,  34,   0,  16,   0, 
-      1,   0,   0,   0,  42,   0, 
-     16,   0,   1,   0,   0,   0, 
-     26,   0,  16,   0,   1,   0, 
-      0,   0,  50,   0,   0,   9, 
-    130,   0,  16,   0,   0,   0, 
-      0,   0,  58,   0,  16,   0, 
-      0,   0,   0,   0,  10,   0, 
-     16,   0,   1,   0,   0,   0, 
-     26,   0,  16,   0,   1,   0, 
-      0,   0,  49,   0,   0,   8, 
-     50,   0,  16,   0,   1,   0, 
-      0,   0, 150,   5,  16,   0, 
-      0,   0,   0,   0, 150,   5, 
-     16, 128,  65,   0,   0,   0, 
-      0,   0,   0,   0,   1,   0, 
-      0,   7,  18,   0,  16,   0, 
-      1,   0,   0,   0,  10,   0, 
-     16,   0,   1,   0,   0,   0, 
-      1,  64,   0,   0, 219,  15, 
-     73, 192,   0,   0,   0,   7, 
-    130,   0,  16,   0,   0,   0, 
-      0,   0,  58,   0,  16,   0, 
-      0,   0,   0,   0,  10,   0, 
-     16,   0,   1,   0,   0,   0, 
-     51,   0,   0,   7,  18,   0, 
-     16,   0,   1,   0,   0,   0, 
-     26,   0,  16,   0,   0,   0, 
-      0,   0,  10,   0,  16,   0, 
-      0,   0,   0,   0,  52,   0, 
-      0,   7,  18,   0,  16,   0, 
-      0,   0,   0,   0,  26,   0, 
-     16,   0,   0,   0,   0,   0, 
-     10,   0,  16,   0,   0,   0, 
-      0,   0,  49,   0,   0,   8, 
-     34,   0,  16,   0,   0,   0, 
-      0,   0,  10,   0,  16,   0, 
-      1,   0,   0,   0,  10,   0, 
-     16, 128,  65,   0,   0,   0, 
-      1,   0,   0,   0,  29,   0, 
-      0,   8,  18,   0,  16,   0, 
-      0,   0,   0,   0,  10,   0, 
-     16,   0,   0,   0,   0,   0, 
-     10,   0,  16, 128,  65,   0, 
-      0,   0,   0,   0,   0,   0, 
-      1,   0,   0,   7,  18,   0, 
-     16,   0,   0,   0,   0,   0, 
-     10,   0,  16,   0,   0,   0, 
-      0,   0,  26,   0,  16,   0, 
-      0,   0,   0,   0,  55,   0, 
-      0,  10,  18,   0,  16,   0, 
-      0,   0,   0,   0,  10,   0, 
-     16,   0,   0,   0,   0,   0, 
-     58,   0,  16, 128,  65,   0, 
-      0,   0,   0,   0,   0,   0, 
-     58,   0,  16,   0,   0,   0, 
-      0,   0,  50,   0,   0,   9, 
-     18,   0,  16,   0,   0,   0, 
-      0,   0,  10,   0,  16,   0, 
-      0,   0,   0,   0,   1,  64, 
-      0,   0, 131, 249,  34,  62, 
-      1,  64,   0,   0,   0,   0, 
-      0,  63,   0,   0,   0,   8, 
-    130,   0,  16,   0,   0,   0, 
-      0,   0,  42,   0,  16, 128, 
-    193,   0,   0,   0,   0,   0, 
-      0,   0,   1,  64,   0,   0, 
-      0,   0, 128,  63,  75,   0, 
-      0,   5, 130,   0,  16,   0, 
-      0,   0,   0,   0,  58,   0, 
-     16,   0,   0,   0,   0,   0, 
-     50,   0,   0,  10,  18,   0, 
-     16,   0,   1,   0,   0,   0, 
-     42,   0,  16, 128, 129,   0, 
-      0,   0,   0,   0,   0,   0, 
-      1,  64,   0,   0,  48, 110, 
-    153, 188,   1,  64,   0,   0, 
-     39,  22, 152,  61,  50,   0, 
-      0,  10,  18,   0,  16,   0, 
-      1,   0,   0,   0,  10,   0, 
-     16,   0,   1,   0,   0,   0, 
-     42,   0,  16, 128, 129,   0, 
-      0,   0,   0,   0,   0,   0, 
-      1,  64,   0,   0, 132,  52, 
-     89, 190,  50,   0,   0,  10, 
-     66,   0,  16,   0,   0,   0, 
-      0,   0,  10,   0,  16,   0, 
-      1,   0,   0,   0,  42,   0, 
-     16, 128, 129,   0,   0,   0, 
-      0,   0,   0,   0,   1,  64, 
-      0,   0, 164,  13, 201,  63, 
-     56,   0,   0,   7,  18,   0, 
-     16,   0,   1,   0,   0,   0, 
-     58,   0,  16,   0,   0,   0, 
-      0,   0,  42,   0,  16,   0, 
-      0,   0,   0,   0,  50,   0, 
-      0,   9,  18,   0,  16,   0, 
-      1,   0,   0,   0,  10,   0, 
-     16,   0,   1,   0,   0,   0, 
-      1,  64,   0,   0,   0,   0, 
-      0, 192,   1,  64,   0,   0, 
-    219,  15,  73,  64,   1,   0, 
-      0,   7,  18,   0,  16,   0, 
-      1,   0,   0,   0,  26,   0, 
-     16,   0,   1,   0,   0,   0, 
-     10,   0,  16,   0,   1,   0, 
-      0,   0,  50,   0,   0,   9, 
-     66,   0,  16,   0,   0,   0, 
-      0,   0,  42,   0,  16,   0, 
-      0,   0,   0,   0,  58,   0, 
-     16,   0,   0,   0,   0,   0, 
-     10,   0,  16,   0,   1,   0, 
-      0,   0,   0,   0,   0,   8, 
-     66,   0,  16,   0,   0,   0, 
-      0,   0,  42,   0,  16, 128, 
-     65,   0,   0,   0,   0,   0, 
-      0,   0,   1,  64,   0,   0, 
-    219,  15, 201,  63,  50,   0, 
-      0,  10,  34,   0,  16,   0, 
-      0,   0,   0,   0,  42,   0, 
-     16, 128,  65,   0,   0,   0, 
-      0,   0,   0,   0,   1,  64, 
-      0,   0, 131, 249, 162,  62, 
-      1,  64,   0,   0,   0,   0, 
-      0,  63,  72,   0,   0, 141, 
-    194,   0,   0, 128,  67,  85, 
-     21,   0, 242,   0,  16,   0, 
-      0,   0,   0,   0,  70,   0, 
-     16,   0,   0,   0,   0,   0, 
-     70, 126,  16,   0,   0,   0, 
-      0,   0,   0,  96,  16,   0, 
-      0,   0,   0,   0,   1,  64, 
-      0,   0,   0,   0,   0,   0, 
-     56,   0,   0,  10, 242,   0, 
-     16,   0,   0,   0,   0,   0, 
-     70,  14,  16,   0,   0,   0, 
-      0,   0,   2,  64,   0,   0, 
-    154, 153, 153,  63, 154, 153, 
-    153,  63, 154, 153, 153,  63, 
-    154, 153, 153,  63, 164,   0, 
-      0,   6, 242, 224,  17,   0, 
-      0,   0,   0,   0,  70,   5, 
-      2,   0,  70,  14,  16,   0, 
-      0,   0,   0,   0,  21,   0, 
-      0,   1,  62,   0,   0,   1, 
-     83,  84,  65,  84, 148,   0, 
-      0,   0, 171,   0,   0,   0, 
-     11,   0,   0,   0,   0,   0, 
-      0,   0,   1,   0,   0,   0, 
-    126,   0,   0,   0,   2,   0, 
-      0,   0,  10,   0,   0,   0, 
-      5,   0,   0,   0,   5,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   1,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-     10,   0,   0,   0,   1,   0, 
-      0,   0,   2,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   0,   0,   0,   0, 
-      0,   0,   2,   0,   0,   0
-};
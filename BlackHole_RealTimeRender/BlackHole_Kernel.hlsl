@@ -12,16 +12,35 @@ cbuffer CameraBuffer : register(b0)
     float2 resolution;
     float mass; 
     float spin; 
+    uint skySource;         // 0 = HDR ͼ1 = ǿ
+    float starGrid;         // ÿÿߵ
+    float starBrightness;
+    uint starSeed;
+    uint frameIndex;        // ֹۻ֡ţ0 Ϊĵһ֡
 };
 
 RWTexture2D<float4> OutputBuffer : register(u0);
 
+// AOV CPU  CBlackHole_AovBuffer ͬĽոʽ
+// AovBuffer.x =  | Ȧ << 16AovBuffer.y = 䳤 | ƫ۽ << 16뾫ȣ
+RWTexture2D<uint2> AovBuffer : register(u1);
+RWTexture2D<float> RedshiftBuffer : register(u2);
+
+// ݵɫۼӣдţ͵ float4 UAV ֤ɶýṹ
+RWStructuredBuffer<float4> AccumBuffer : register(u3);
+
 // HDR Դ
 Texture2D<float4> SkyboxTex : register(t0);
 SamplerState SkyboxSampler : register(s0);
 
+// 64x64 ͼCBlackHole_Sampler::BlueNoiseMask֡
+Texture2D<float> BlueNoiseTex : register(t1);
+
 static const float PI = 3.14159265359;
 
+// ߳ڹĳ䷽ڹÿϵĸǷΧɵĹ߼Ϊ 0
+groupshared float3 gs_exitDir[16 * 16];
+
 // ==========================================
 // 2. 棺۲
 
@@ -67,15 +86,115 @@ void StepRK4(inout float3 pos, inout float3 vel, float h_step, float mass)
 }
 
 // ==========================================
-// 3. Ⱦߣ׷
+// 3. ǿգϣɣռԴ棬ֱ
+
+// ϣ (PCG )ͬԶõͬ
+uint HashUint(uint v)
+{
+    uint state = v * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+float HashToFloat(uint h)
+{
+    return (h & 0x00FFFFFF) / 16777216.0;
+}
+
+//  ->  [-1, 1]
+void DirToCube(float3 d, out uint face, out float2 st)
+{
+    float3 a = abs(d);
+    if (a.x >= a.y && a.x >= a.z) { face = d.x > 0 ? 0 : 1; st = d.yz / a.x; }
+    else if (a.y >= a.z)          { face = d.y > 0 ? 2 : 3; st = d.xz / a.y; }
+    else                          { face = d.z > 0 ? 4 : 5; st = d.xy / a.z; }
+}
+
+float3 CubeToDir(uint face, float2 st)
+{
+    float s = (face & 1) ? -1.0 : 1.0;
+    if (face < 2) return normalize(float3(s, st.x, st.y));
+    if (face < 4) return normalize(float3(st.x, s, st.y));
+    return normalize(float3(st.x, st.y, s));
+}
+
+// ɫ R/G/B ȡʿ˷䣬ٰһ
+float3 BlackbodyColor(float T)
+{
+    const float3 lambda = float3(610e-9, 550e-9, 465e-9);
+    const float c2 = 1.4388e-2;     // ڶ䳣 hc/k (mK)
+    float3 B = 1.0 / (pow(lambda, 5.0) * (exp(c2 / (lambda * T)) - 1.0));
+    return B / max(B.r, max(B.g, B.b));
+}
+
+// footprintڳ䷽ϵĽǳ߶ȣȣpixelAngle͸ʱؽǳ߶
+// ǰ footprint ɸ˹㣬ȳ (pixelAngle / footprint)^2 ͸ŴʣŴȻǵ
+float3 SampleStars(float3 dir, float footprint, float pixelAngle)
+{
+    uint face;
+    float2 st;
+    DirToCube(dir, face, st);
+
+    float2 cellF = (st * 0.5 + 0.5) * starGrid;
+    int2 cell = int2(floor(cellF));
+    int grid = (int) starGrid;
+    float cellAngle = 2.0 / starGrid;       // ĸһӵĽǳ߶
+
+    float sigma = max(footprint, 1e-6);
+    float gain = clamp((pixelAngle * pixelAngle) / (sigma * sigma), 1.0, 256.0);
+
+    // ǵȷɣ = u^-0.8Ӧ N(<m)  10^(0.5 m)ֵΪ 5
+    const float baseFlux = 0.002;
+    float3 sum = 0;
+    for (int j = -1; j <= 1; ++j) {
+        for (int i = -1; i <= 1; ++i) {
+            int2 c = cell + int2(i, j);
+            if (any(c < 0) || any(c >= grid)) continue;   // ңԵֻڱ
+
+            uint h = HashUint(starSeed ^ HashUint(face * 0x9E3779B9u ^ HashUint((uint) c.x + ((uint) c.y << 16))));
+            float u0 = max(HashToFloat(h), 1e-4);
+            float u1 = HashToFloat(HashUint(h + 1));
+            float u2 = HashToFloat(HashUint(h + 2));
+            float u3 = HashToFloat(HashUint(h + 3));
+
+            float2 starSt = ((float2(c) + 0.1 + 0.8 * float2(u1, u2)) / starGrid) * 2.0 - 1.0;
+            float3 starDir = CubeToDir(face, starSt);
+
+            float theta = length(dir - starDir);   // СǶȽ
+            float w = exp(-0.5 * theta * theta / (sigma * sigma));
+            float flux = baseFlux * pow(u0, -0.8);
+            float T = 2500.0 + 27500.0 * u3 * u3 * u3;    // ǾӶ
+            sum += flux * w * BlackbodyColor(T);
+        }
+    }
+
+    // footprint ڸʱǿСһظǣ3x3 򲻹
+    // 𽥹ɵǹƽȣ͸غ
+    float3 mean = baseFlux * 5.0 * 2.0 * PI * (pixelAngle * pixelAngle) / (cellAngle * cellAngle) * float3(0.9, 0.9, 1.0);
+    float t = saturate(sigma / cellAngle - 0.5);
+    return starBrightness * lerp(sum * gain, mean, t);
+}
+
+//  frameIndex ֡ڵƫ  [-0.5, 0.5)^2ͼ̶ƫƸȡһÿ֡ R2 ƽƣ
+// ͬһ֡صֲͬһصĸ֡ھ̿ 0 ֡ۻǰĻͬ
+float2 PixelJitter(uint2 pixel)
+{
+    if (frameIndex == 0) return float2(0.0, 0.0);
+    float a = BlueNoiseTex.Load(int3(pixel & 63, 0));
+    float b = BlueNoiseTex.Load(int3((pixel + uint2(32, 21)) & 63, 0));
+    return frac(float2(a, b) + frameIndex * float2(0.7548776662, 0.5698402910)) - 0.5;
+}
+
+// ==========================================
+// 4. Ⱦߣ׷
 
 [numthreads(16, 16, 1)]
-void CSMain(uint3 id : SV_DispatchThreadID) {
-    if (id.x >= (uint) resolution.x || id.y >= (uint) resolution.y)
-        return;
+void CSMain(uint3 id : SV_DispatchThreadID, uint3 gtid : SV_GroupThreadID) {
+    // Ҫͬ䷽Խ̲߳ǰأֻǲд
+    bool inside = id.x < (uint) resolution.x && id.y < (uint) resolution.y;
 
     // --- 1. ߳ʼ ---
-    float2 uv = float2(id.xy) / resolution.xy;
+    float2 uv = (float2(id.xy) + PixelJitter(id.xy)) / resolution.xy;
     uv = uv * 2.0 - 1.0;
     uv.y = -uv.y;
 
@@ -95,18 +214,28 @@ void CSMain(uint3 id : SV_DispatchThreadID) {
     float rs = 2.0 * mass;
     
     // ͲùܴԼ 100 λ
-    int maxSteps = 2000;
+    int maxSteps = inside ? 2000 : 0;
     float h_step = 0.1;
 
     float escapeRadius = max(length(camPos) + 10.0, 30.0);
     
     // Ƿڶ
-    bool isCaptured = false;
+    bool isCaptured = !inside;
+
+    // λʸɨĽǶȣd/d = |rv| / r^2λ֣
+    int steps = 0;
+    float swept = 0.0;
+    float halfStepH = 0.5 * h_step * length(cross(pos, vel));
+    float invR2 = 1.0 / dot(pos, pos);
 
     // --- 3. Raymarching ѭ ---
     for (int i = 0; i < maxSteps; ++i) {
         StepRK4(pos, vel, h_step, mass);
         float r = length(pos);
+        ++steps;
+        float invR2Next = 1.0 / (r * r);
+        swept += halfStepH * (invR2 + invR2Next);
+        invR2 = invR2Next;
 
         //  Aײӽ磬ڶ
         if (r < rs) {
@@ -120,19 +249,60 @@ void CSMain(uint3 id : SV_DispatchThreadID) {
         }
     }
 
-    // --- 4. ɫ ---
+    // --- 4. ؽ䷽ ---
+    float3 outDir = normalize(vel);
+    uint lane = gtid.y * 16 + gtid.x;
+    gs_exitDir[lane] = isCaptured ? float3(0, 0, 0) : outDir;
+    GroupMemoryBarrierWithGroupSync();
+
+    if (!inside) return;
+
+    // --- 5. ɫ ---
+    float4 color;
     if (isCaptured) {
         // ֻбڶɣǴɫ
-        OutputBuffer[id.xy] = float4(0.0, 0.0, 0.0, 1.0);
+        color = float4(0.0, 0.0, 0.0, 1.0);
+    }
+    else if (skySource == 1) {
+        // ؽǳ߶ȣ͸ʱصļн
+        float pixelAngle = 2.0 * halfFovTan / resolution.y;
+
+        //  2x2 СڵĺھӹƳ䷽ϵĸǷΧھӱʱ˻͸߶
+        float3 nx = gs_exitDir[lane ^ 1];
+        float3 ny = gs_exitDir[lane ^ 16];
+        float dx = dot(nx, nx) > 0.5 ? length(outDir - nx) : pixelAngle;
+        float dy = dot(ny, ny) > 0.5 ? length(outDir - ny) : pixelAngle;
+        float footprint = 0.5 * max(dx, dy);
+
+        color = float4(SampleStars(outDir, footprint, 0.5 * pixelAngle), 1.0);
     }
     else  {
         // ֻҪûɶݹڵķȥǿ
-        float3 outDir = normalize(vel);
-        
         float u = 0.5 + atan2(outDir.y, outDir.x) / (2.0 * PI);
         float v = 0.5 - asin(outDir.z) / PI;
         
         float4 skyColor = SkyboxTex.SampleLevel(SkyboxSampler, float2(u, v), 0);
-        OutputBuffer[id.xy] = skyColor*1.2;
+        color = skyColor*1.2;
     }
+
+    // ֹʱ֡ۼӣĿǰΪֹƽ 0 ֡¿ʼ
+    uint pixelIndex = id.y * (uint) resolution.x + id.x;
+    float4 sum = (frameIndex == 0) ? color : AccumBuffer[pixelIndex] + color;
+    AccumBuffer[pixelIndex] = sum;
+    OutputBuffer[id.xy] = sum / (float) (frameIndex + 1);
+
+    // ֻȡ 0 ֡Ĺߣ֮֡ٸд
+    if (frameIndex != 0) return;
+
+    // --- 6.  ---
+    // ƫ۽ = ɨĽǶ + յٶԾļн֮ΪֹԴֹ۲
+    float alphaStart = atan2(length(cross(camPos, rayDir)), dot(camPos, rayDir));
+    float alphaEnd = atan2(length(cross(pos, vel)), dot(pos, vel));
+    float deflection = swept + alphaEnd - alphaStart;
+    uint halfOrbits = min((uint)(swept / PI), 0xFFu);
+    float rObs = length(camPos);
+    float redshift = (isCaptured || rObs <= rs) ? 0.0 : sqrt(1.0 - rs / rObs) - 1.0;
+    AovBuffer[id.xy] = uint2(min((uint)steps, 0xFFFFu) | (halfOrbits << 16),
+        f32tof16(steps * h_step) | (f32tof16(deflection) << 16));
+    RedshiftBuffer[id.xy] = redshift;
 }
\ No newline at end of file
@@ -10,110 +10,40 @@
 
 CBlackHole_RealTimeRenderEventWatcher::CBlackHole_RealTimeRenderEventWatcher()
 {
-	Defaults();
-}
-
-void CBlackHole_RealTimeRenderEventWatcher::Defaults( BOOL b /*= FALSE*/)
-{
-	  SetRenderMeshFlags( b);
-	  SetMaterialFlags( b);
-	  SetLightFlags( b);
 }
 
 /////////////////////////////////////////////////////////////////////////////
 // CBlackHole_RealTimeRenderEventWatcher methods
 //
 
-BOOL CBlackHole_RealTimeRenderEventWatcher::RenderSceneModified() const
-{
-	return (MaterialModified() ||
-            MaterialAdded() ||
-            MaterialDeleted() ||
-            RenderMeshModified() ||
-            RenderMeshAdded() ||
-            RenderMeshDeleted() ||
-            RenderMeshVisibilityChanged()
-          );
-}
-
-BOOL CBlackHole_RealTimeRenderEventWatcher::RenderLightingModified() const
-{
-	return(LightModified() ||
-           LightAdded() ||
-           LightDeleted()
-           );
-}
-
-BOOL CBlackHole_RealTimeRenderEventWatcher::MaterialModified() const
-{
-	return m_material_modified;
-}
-
-BOOL CBlackHole_RealTimeRenderEventWatcher::MaterialAdded() const
-{
-	return m_material_added;
-}
-
-BOOL CBlackHole_RealTimeRenderEventWatcher::MaterialDeleted() const
-{
-	return m_material_deleted;
-}
-
-BOOL CBlackHole_RealTimeRenderEventWatcher::RenderMeshModified() const
-{
-	return m_render_mesh_modified;
-}
-
-BOOL CBlackHole_RealTimeRenderEventWatcher::RenderMeshAdded() const
-{
-	return m_render_mesh_added;
-}
-
-BOOL CBlackHole_RealTimeRenderEventWatcher::RenderMeshDeleted() const
-{
-	return m_render_mesh_deleted;
-}
-
-BOOL CBlackHole_RealTimeRenderEventWatcher::RenderMeshVisibilityChanged() const
+CBlackHole_ChangeJournal& CBlackHole_RealTimeRenderEventWatcher::Journal()
 {
-	return m_render_mesh_visibility_changed;
+	return m_journal;
 }
 
-BOOL CBlackHole_RealTimeRenderEventWatcher::LightModified() const
+const CBlackHole_ChangeJournal& CBlackHole_RealTimeRenderEventWatcher::Journal() const
 {
-	return m_light_modified;
+	return m_journal;
 }
 
-BOOL CBlackHole_RealTimeRenderEventWatcher::LightAdded() const
+void CBlackHole_RealTimeRenderEventWatcher::RecordObject(SceneChangeKind kind, const CRhinoObject& object, int old_value, int new_value)
 {
-	return m_light_added;
+	SceneChange change;
+	change.kind = kind;
+	change.object = object.ModelObjectId();
+	change.oldValue = old_value;
+	change.newValue = new_value;
+	m_journal.Push(change);
 }
 
-BOOL CBlackHole_RealTimeRenderEventWatcher::LightDeleted() const
+void CBlackHole_RealTimeRenderEventWatcher::RecordTable(SceneChangeKind kind, int index, int old_value, int new_value)
 {
-	return m_light_deleted;
-}
-
-void CBlackHole_RealTimeRenderEventWatcher::SetRenderMeshFlags(BOOL b /*= FALSE*/)
-{
-	m_render_mesh_modified = b;
-	m_render_mesh_added = b;
-	m_render_mesh_deleted = b;
-	m_render_mesh_visibility_changed = b;
-}
-
-void CBlackHole_RealTimeRenderEventWatcher::SetMaterialFlags(BOOL b /*= FALSE*/)
-{
-	m_material_modified = b;
-	m_material_added = b;
-	m_material_deleted = b;
-}
-
-void CBlackHole_RealTimeRenderEventWatcher::SetLightFlags(BOOL b /*= FALSE*/)
-{
-	m_light_modified = b;
-	m_light_added = b;
-	m_light_deleted = b;
+	SceneChange change;
+	change.kind = kind;
+	change.index = index;
+	change.oldValue = old_value;
+	change.newValue = new_value;
+	m_journal.Push(change);
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -122,8 +52,9 @@ void CBlackHole_RealTimeRenderEventWatcher::SetLightFlags(BOOL b /*= FALSE*/)
 
 void CBlackHole_RealTimeRenderEventWatcher::OnEnableEventWatcher( BOOL b )
 {
-	UNREFERENCED_PARAMETER(b);
-	Defaults();
+	// Whatever happened while the watcher was disabled was not recorded
+	if (b)
+		m_journal.PushRebuild();
 }
 
 void CBlackHole_RealTimeRenderEventWatcher::OnInitRhino(CRhinoApp& app)
@@ -144,7 +75,7 @@ void CBlackHole_RealTimeRenderEventWatcher::OnCloseDocument( CRhinoDoc& doc )
 void CBlackHole_RealTimeRenderEventWatcher::OnNewDocument( CRhinoDoc& doc )
 {
 	UNREFERENCED_PARAMETER(doc);
-	Defaults( true);
+	m_journal.PushRebuild();
 }
 
 void CBlackHole_RealTimeRenderEventWatcher::OnBeginOpenDocument( CRhinoDoc& doc, const wchar_t* filename, BOOL bMerge, BOOL bReference )
@@ -153,7 +84,7 @@ void CBlackHole_RealTimeRenderEventWatcher::OnBeginOpenDocument( CRhinoDoc& doc,
 	UNREFERENCED_PARAMETER(filename);
 	UNREFERENCED_PARAMETER(bMerge);
 	UNREFERENCED_PARAMETER(bReference);
-	Defaults( true);
+	m_journal.PushRebuild();
 }
 
 void CBlackHole_RealTimeRenderEventWatcher::OnEndOpenDocument( CRhinoDoc& doc, const wchar_t* filename, BOOL bMerge, BOOL bReference )
@@ -162,7 +93,7 @@ void CBlackHole_RealTimeRenderEventWatcher::OnEndOpenDocument( CRhinoDoc& doc, c
 	UNREFERENCED_PARAMETER(filename);
 	UNREFERENCED_PARAMETER(bMerge);
 	UNREFERENCED_PARAMETER(bReference);
-	Defaults( true);
+	m_journal.PushRebuild();
 }
 
 void CBlackHole_RealTimeRenderEventWatcher::OnBeginSaveDocument( CRhinoDoc& doc, const wchar_t* filename, BOOL bExportSelected )
@@ -207,7 +138,7 @@ void CBlackHole_RealTimeRenderEventWatcher::OnAddObject( CRhinoDoc& doc, CRhinoO
 
 	// TODO: CHECK FOR LIGHTS
 	if( object.IsMeshable(ON::render_mesh) )
-		m_render_mesh_added = true;
+		RecordObject(SceneChangeKind::MeshAdded, object);
 }
 
 void CBlackHole_RealTimeRenderEventWatcher::OnDeleteObject(CRhinoDoc& doc, CRhinoObject& object)
@@ -216,7 +147,7 @@ void CBlackHole_RealTimeRenderEventWatcher::OnDeleteObject(CRhinoDoc& doc, CRhin
 
 	// TODO: CHECK FOR LIGHTS
 	if (object.IsMeshable(ON::render_mesh))
-		m_render_mesh_deleted = true;
+		RecordObject(SceneChangeKind::MeshDeleted, object);
 }
 
 void CBlackHole_RealTimeRenderEventWatcher::OnReplaceObject( CRhinoDoc& doc, CRhinoObject& old_object, CRhinoObject& new_object )
@@ -224,39 +155,44 @@ void CBlackHole_RealTimeRenderEventWatcher::OnReplaceObject( CRhinoDoc& doc, CRh
 	UNREFERENCED_PARAMETER(doc);
 
 	// TODO: CHECK FOR LIGHTS
+	// Replacing keeps the object id, so whichever kind is recorded below the
+	// renderer only needs to look at this one object again
 	ON_SimpleArray<const ON_Mesh*> old_meshes, new_meshes;
 
 	BOOL bOldMeshes = (old_object.GetMeshes(ON::render_mesh, old_meshes) < 1);
 	BOOL bNewMeshes = (new_object.GetMeshes(ON::render_mesh, new_meshes) < 1);
 
+	SceneChangeKind kind = SceneChangeKind::MeshModified;
 	if (bOldMeshes)
 	{
 		if (new_object.IsMeshable(ON::render_mesh))
 		{
 			if (bNewMeshes)
 			{
-				m_render_mesh_modified = true;
+				kind = SceneChangeKind::MeshModified;
 			}
 			else
 			{
-				m_render_mesh_deleted = true;
+				kind = SceneChangeKind::MeshDeleted;
 			}
 		}
 		else
 		{
-			m_render_mesh_deleted = true;
+			kind = SceneChangeKind::MeshDeleted;
 		}
 	}
 	else
 	if (bNewMeshes)
 	{
-		m_render_mesh_added = true;
+		kind = SceneChangeKind::MeshAdded;
 	}
 	else
 	if (new_object.IsMeshable(ON::render_mesh))
 	{
-		m_render_mesh_added = true;
+		kind = SceneChangeKind::MeshAdded;
 	}
+
+	RecordObject(kind, new_object);
 }
 
 void CBlackHole_RealTimeRenderEventWatcher::OnUnDeleteObject( CRhinoDoc& doc, CRhinoObject& object )
@@ -265,7 +201,7 @@ void CBlackHole_RealTimeRenderEventWatcher::OnUnDeleteObject( CRhinoDoc& doc, CR
 
 	// TODO: CHECK FOR LIGHTS
 	if (object.IsMeshable(ON::render_mesh))
-		m_render_mesh_added = true;
+		RecordObject(SceneChangeKind::MeshAdded, object);
 }
 
 void CBlackHole_RealTimeRenderEventWatcher::OnPurgeObject( CRhinoDoc& doc, CRhinoObject& object)
@@ -299,31 +235,31 @@ void CBlackHole_RealTimeRenderEventWatcher::OnModifyObjectAttributes(
         )
 {
 	UNREFERENCED_PARAMETER(doc);
-	UNREFERENCED_PARAMETER(object);
 
 	if (!object.IsMeshable(ON::render_mesh))
 		return;
 
+	// Every kind below makes the renderer look at the object's meshes again;
+	// the material and layer records also carry the old and new index
 	const CRhinoObjectAttributes& new_attributes = object.Attributes();
+	bool bRecorded = false;
 
-	if (old_attributes.MaterialSource() == new_attributes.MaterialSource())
+	if (old_attributes.MaterialSource() != new_attributes.MaterialSource() ||
+		old_attributes.m_material_index != new_attributes.m_material_index)
 	{
-		if (new_attributes.MaterialSource() == ON::material_from_object &&
-			old_attributes.m_material_index != new_attributes.m_material_index)
-		{
-			m_render_mesh_modified = true;
-		}
-		else
-		if (new_attributes.MaterialSource() == ON::material_from_layer &&
-			old_attributes.m_layer_index != new_attributes.m_layer_index)
-		{
-			m_render_mesh_modified = true;
-		}
+		RecordObject(SceneChangeKind::ObjectMaterial, object, old_attributes.m_material_index, new_attributes.m_material_index);
+		bRecorded = true;
 	}
-	else
+
+	if (old_attributes.m_layer_index != new_attributes.m_layer_index)
 	{
-		m_render_mesh_modified = true;
+		RecordObject(SceneChangeKind::ObjectLayer, object, old_attributes.m_layer_index, new_attributes.m_layer_index);
+		bRecorded = true;
 	}
+
+	// Visibility, display mode and the rest
+	if (!bRecorded)
+		RecordObject(SceneChangeKind::ObjectAttributes, object);
 }
 
 void CBlackHole_RealTimeRenderEventWatcher::OnUpdateObjectMesh(
@@ -333,10 +269,9 @@ void CBlackHole_RealTimeRenderEventWatcher::OnUpdateObjectMesh(
         )
 {
 	UNREFERENCED_PARAMETER(doc);
-	UNREFERENCED_PARAMETER(object);
 
 	if (mesh_type == ON::render_mesh)
-		m_render_mesh_modified = true;
+		RecordObject(SceneChangeKind::MeshModified, object);
 }
 
 void CBlackHole_RealTimeRenderEventWatcher::LayerTableEvent(
@@ -354,13 +289,11 @@ void CBlackHole_RealTimeRenderEventWatcher::LayerTableEvent(
 	if (old_settings)
 	{
 		if (layer.RenderMaterialIndex() != old_settings->RenderMaterialIndex())
-			m_render_mesh_modified = true;
+			RecordTable(SceneChangeKind::LayerMaterial, layer_index, old_settings->RenderMaterialIndex(), layer.RenderMaterialIndex());
 
+		// Showing or hiding a layer adds or removes every object (and light) on it
 		if (layer.IsVisible() != old_settings->IsVisible())
-			m_light_modified = m_render_mesh_modified = true;
-
-		if (layer.IsLocked() != old_settings->IsLocked())
-			m_light_modified = m_render_mesh_modified = true;
+			m_journal.PushRebuild();
 	}
 }
 
@@ -372,20 +305,19 @@ void CBlackHole_RealTimeRenderEventWatcher::LightTableEvent(
         )
 {
 	UNREFERENCED_PARAMETER(old_settings);
-	UNREFERENCED_PARAMETER(light_index);
 	UNREFERENCED_PARAMETER(light_table);
 
 	switch (event)
 	{
 	case light_added:
 	case light_undeleted:
-		m_light_added = true;
+		RecordTable(SceneChangeKind::LightAdded, light_index);
 		break;
 	case light_deleted:
-		m_light_deleted = true;
+		RecordTable(SceneChangeKind::LightDeleted, light_index);
 		break;
 	case light_modified:
-		m_light_modified = true;
+		RecordTable(SceneChangeKind::LightModified, light_index);
 		break;
 	}
 }
@@ -398,20 +330,19 @@ void CBlackHole_RealTimeRenderEventWatcher::MaterialTableEvent(
         )
 {
 	UNREFERENCED_PARAMETER(old_settings);
-	UNREFERENCED_PARAMETER(material_index);
 	UNREFERENCED_PARAMETER(material_table);
 
 	switch (event)
 	{
 	case CRhinoEventWatcher::material_added:
 	case CRhinoEventWatcher::material_undeleted:
-		m_material_added = true;
+		RecordTable(SceneChangeKind::MaterialAdded, material_index);
 		break;
 	case CRhinoEventWatcher::material_deleted:
-		m_material_deleted = true;
+		RecordTable(SceneChangeKind::MaterialDeleted, material_index);
 		break;
 	case CRhinoEventWatcher::material_modified:
-		m_material_modified = true;
+		RecordTable(SceneChangeKind::MaterialModified, material_index);
 		break;
 	}
 }
@@ -441,3 +372,20 @@ void CBlackHole_RealTimeRenderEventWatcher::DimStyleTableEvent(
 	UNREFERENCED_PARAMETER(dimstyle_index);
 	UNREFERENCED_PARAMETER(old_settings);
 }
+
+void CBlackHole_RealTimeRenderEventWatcher::InstanceDefinitionTableEvent(
+        CRhinoEventWatcher::idef_event event,
+        const CRhinoInstanceDefinitionTable& idef_table,
+        int idef_index,
+        const ON_InstanceDefinition* old_settings
+        )
+{
+	UNREFERENCED_PARAMETER(idef_table);
+	UNREFERENCED_PARAMETER(idef_index);
+	UNREFERENCED_PARAMETER(old_settings);
+
+	// Editing a block definition changes geometry shared by every instance of it,
+	// and the instance references themselves are not reported as modified
+	if (event == CRhinoEventWatcher::idef_modified || event == CRhinoEventWatcher::idef_deleted)
+		m_journal.PushRebuild();
+}
@@ -2,6 +2,8 @@
 //
 
 #pragma once
+#include "CBlackHole_Common.h"
+#include "CBlackHole_ChangeJournal.h"
 
 // CBlackHole_RealTimeRenderEventWatcher
 // See Rhino.1EventWatcher.cpp for the implementation of this class.
@@ -12,25 +14,11 @@ class CBlackHole_RealTimeRenderEventWatcher : public CRhinoEventWatcher
 public:
   CBlackHole_RealTimeRenderEventWatcher();
 
-  void Defaults(BOOL b = FALSE);
-
-  BOOL MaterialModified() const;
-  BOOL MaterialAdded() const;
-  BOOL MaterialDeleted() const;
-  BOOL RenderMeshModified() const;
-  BOOL RenderMeshAdded() const;
-  BOOL RenderMeshDeleted() const;
-  BOOL RenderMeshVisibilityChanged() const;
-  BOOL LightModified() const;
-  BOOL LightAdded() const;
-  BOOL LightDeleted() const;
-
-  void SetRenderMeshFlags(BOOL b = FALSE);
-  void SetMaterialFlags(BOOL b = FALSE);
-  void SetLightFlags(BOOL b = FALSE);
-
-  virtual BOOL RenderSceneModified() const;
-  virtual BOOL RenderLightingModified() const;
+  // Every change is appended to the journal as a typed record. Consumers keep
+  // their own read position and drain it when they need to; a consumer that
+  // falls a full journal behind, or meets a Rebuild record, rebuilds everything.
+  CBlackHole_ChangeJournal& Journal();
+  const CBlackHole_ChangeJournal& Journal() const;
 
   // CRhinoEventWatcher overrides
   void OnEnableEventWatcher(BOOL b) override;
@@ -59,18 +47,12 @@ public:
   void MaterialTableEvent(CRhinoEventWatcher::material_event event, const CRhinoMaterialTable& material_table, int material_index, const ON_Material* old_settings) override;
   void GroupTableEvent(CRhinoEventWatcher::group_event event, const CRhinoGroupTable& group_table, int group_index, const ON_Group* old_settings) override;
   void DimStyleTableEvent(CRhinoEventWatcher::dimstyle_event event, const CRhinoDimStyleTable& dimstyle_table, int dimstyle_index, const ON_DimStyle* old_settings) override;
+  void InstanceDefinitionTableEvent(CRhinoEventWatcher::idef_event event, const CRhinoInstanceDefinitionTable& idef_table, int idef_index, const ON_InstanceDefinition* old_settings) override;
   void OnUpdateObjectMesh(CRhinoDoc& doc, CRhinoObject& object, ON::mesh_type mesh_type) override;
 
 private:
-  BOOL m_material_modified;
-  BOOL m_material_added;
-  BOOL m_material_deleted;
-  BOOL m_render_mesh_modified;
-  BOOL m_render_mesh_added;
-  BOOL m_render_mesh_deleted;
-  BOOL m_render_mesh_visibility_changed;
-  BOOL m_light_modified;
-  BOOL m_light_added;
-  BOOL m_light_deleted;
-};
+  void RecordObject(SceneChangeKind kind, const CRhinoObject& object, int old_value = -1, int new_value = -1);
+  void RecordTable(SceneChangeKind kind, int index, int old_value = -1, int new_value = -1);
 
+  CBlackHole_ChangeJournal m_journal;
+};
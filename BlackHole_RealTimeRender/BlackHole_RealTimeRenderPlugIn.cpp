@@ -1,12 +1,14 @@
 ﻿// BlackHole_RealTimeRenderPlugIn.cpp : 定义插件的初始化流程
 
 #include "stdafx.h"
+#include <chrono>
 #include "Resource.h"
 #include "rhinoSdkPlugInDeclare.h"
 #include "BlackHole_RealTimeRenderPlugIn.h"
 #include "CBlackHole_RealTimeDisplayMode.h"
 #include "BlackHole_RealTimeRenderRdkPlugIn.h"
 #include "BlackHole_RealTimeRenderSdkRender.h"
+#include "CBlackHole_ThreadPool.h"
 
 
 // 插件对象必须在任何继承自 CRhinoCommand 的插件类之前构造。
@@ -179,6 +181,10 @@ void CBlackHole_RealTimeRenderPlugIn::OnUnloadPlugIn()
 	// TODO：在这里添加渲染插件清理代码。
 	m_event_watcher.Enable(FALSE);
 	m_event_watcher.UnRegister();
+
+	// 在 DLL 卸载前结束后台线程池，不能留给静态析构；场景加载还在往池里提交任务，先停下
+	m_sceneLoader.Cancel();
+	CBlackHole_ThreadPool::ShutdownShared();
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -249,8 +255,50 @@ BOOL CBlackHole_RealTimeRenderPlugIn::SaveRenderedImage(ON_wString filename)
 	// 参数：
 	//   filename [输入] 要保存的文件名。
 
-	// TODO：在这里添加保存文件代码。
-	return FALSE;
+	const std::shared_ptr<const RenderedFrame> frame = LastFrame();
+	if (!frame)
+	{
+		RhinoApp().Print(L"BlackHole: nothing to save, render first\n");
+		return FALSE;
+	}
+
+	// 不认识的扩展名交回 Rhino 处理
+	ImageFileFormat format;
+	if (!CBlackHole_ImageWriter::FormatFromPath(static_cast<const wchar_t*>(filename), format))
+		return FALSE;
+
+	return WriteFrame(*frame, static_cast<const wchar_t*>(filename), GetImageOutput().write) ? TRUE : FALSE;
+}
+
+bool CBlackHole_RealTimeRenderPlugIn::WriteFrame(const RenderedFrame& frame, const std::wstring& path, const ImageWriteSettings& settings)
+{
+	ImageFileFormat format;
+	std::wstring error = L"unsupported file type (use .exr, .pfm or .png)";
+	bool ok = CBlackHole_ImageWriter::FormatFromPath(path, format);
+
+	const auto start = std::chrono::high_resolution_clock::now();
+	CBlackHole_ImageWriter writer(CBlackHole_ThreadPool::Shared());
+	ok = ok && writer.Begin(path, format, frame.width, frame.height, frame.Channels(format, settings), settings, error);
+	if (ok)
+	{
+		writer.RowsReady(0, frame.height);
+		ok = writer.Finish(error);
+	}
+
+	ON_wString str;
+	if (ok)
+	{
+		const ImageWriteStats& stats = writer.Stats();
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		str.Format(L"BlackHole: saved \"%s\" (%.1f MB from %.1f MB of pixel data) in %.0f ms\n",
+			path.c_str(), stats.fileBytes / 1048576.0, stats.rawBytes / 1048576.0, ms);
+	}
+	else
+	{
+		str.Format(L"BlackHole: cannot save \"%s\" (%s)\n", path.c_str(), error.c_str());
+	}
+	RhinoApp().Print(str);
+	return ok;
 }
 
 BOOL CBlackHole_RealTimeRenderPlugIn::CloseRenderWindow()
@@ -260,6 +308,8 @@ BOOL CBlackHole_RealTimeRenderPlugIn::CloseRenderWindow()
 	//   当渲染完成并且渲染窗口不再是模态窗口时调用。
 	//   （如果你在 RenderCommand 返回后仍然保留窗口）
 
+	// 窗口关了就没有可保存的渲染，整帧结果不再常驻内存
+	SetLastFrame(nullptr);
 	return FALSE;
 }
 
@@ -272,21 +322,103 @@ UINT CBlackHole_RealTimeRenderPlugIn::MainFrameResourceID() const
 
 BOOL CBlackHole_RealTimeRenderPlugIn::SceneChanged() const
 {
-	return m_event_watcher.RenderSceneModified();
+	// 在读取位置的副本上读，不取走
+	uint64_t cursor = m_sceneCursor;
+	std::vector<SceneChange> changes;
+	if (!m_event_watcher.Journal().Drain(cursor, changes))
+		return TRUE;
+
+	for (const SceneChange& change : changes)
+	{
+		if (change.IsGeometry())
+			return TRUE;
+	}
+	return FALSE;
 }
 
-void CBlackHole_RealTimeRenderPlugIn::SetSceneChanged(BOOL bChanged)
+BOOL CBlackHole_RealTimeRenderPlugIn::TakeSceneChanges(ObjectIdSet& changed)
 {
-	m_event_watcher.SetRenderMeshFlags(bChanged);
-	m_event_watcher.SetMaterialFlags(bChanged);
+	uint64_t cursor = m_sceneCursor;
+	std::vector<SceneChange> changes;
+	bool bTracked = m_event_watcher.Journal().Drain(cursor, changes);
+	m_sceneCursor = cursor;
+
+	// 材质表、图层材质的变化不逐物体记录，增量更新时所有物体都会刷新颜色
+	changed.clear();
+	for (const SceneChange& change : changes)
+	{
+		if (SceneChangeKind::Rebuild == change.kind)
+			bTracked = false;
+		else if (ON_UuidIsNotNil(change.object))
+			changed.insert(change.object);
+	}
+	return bTracked ? TRUE : FALSE;
 }
 
 BOOL CBlackHole_RealTimeRenderPlugIn::LightingChanged() const
 {
-	return m_event_watcher.RenderLightingModified();
+	uint64_t cursor = m_lightCursor;
+	std::vector<SceneChange> changes;
+	if (!m_event_watcher.Journal().Drain(cursor, changes))
+		return TRUE;
+
+	for (const SceneChange& change : changes)
+	{
+		if (change.IsLighting())
+			return TRUE;
+	}
+	return FALSE;
 }
 
 void CBlackHole_RealTimeRenderPlugIn::SetLightingChanged(BOOL bChanged)
 {
-	m_event_watcher.SetLightFlags(bChanged);
+	if (bChanged)
+	{
+		SceneChange change;
+		change.kind = SceneChangeKind::LightModified;
+		m_event_watcher.Journal().Push(change);
+	}
+	else
+	{
+		m_lightCursor = m_event_watcher.Journal().Head();
+	}
+}
+
+SkySettings CBlackHole_RealTimeRenderPlugIn::GetSkySettings() const
+{
+	std::lock_guard<std::mutex> lock(m_skyMutex);
+	return m_skySettings;
+}
+
+void CBlackHole_RealTimeRenderPlugIn::SetSkySettings(const SkySettings& sky)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_skyMutex);
+		m_skySettings = sky;
+	}
+	++m_skyRevision;
+}
+
+ImageOutputSettings CBlackHole_RealTimeRenderPlugIn::GetImageOutput() const
+{
+	std::lock_guard<std::mutex> lock(m_outputMutex);
+	return m_imageOutput;
+}
+
+void CBlackHole_RealTimeRenderPlugIn::SetImageOutput(const ImageOutputSettings& output)
+{
+	std::lock_guard<std::mutex> lock(m_outputMutex);
+	m_imageOutput = output;
+}
+
+std::shared_ptr<const RenderedFrame> CBlackHole_RealTimeRenderPlugIn::LastFrame() const
+{
+	std::lock_guard<std::mutex> lock(m_outputMutex);
+	return m_lastFrame;
+}
+
+void CBlackHole_RealTimeRenderPlugIn::SetLastFrame(const std::shared_ptr<const RenderedFrame>& frame)
+{
+	std::lock_guard<std::mutex> lock(m_outputMutex);
+	m_lastFrame = frame;
 }
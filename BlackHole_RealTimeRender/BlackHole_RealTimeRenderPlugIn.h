@@ -1,6 +1,12 @@
 // BlackHole_RealTimeRenderPlugIn.h : BlackHole_RealTimeRender Ҫͷļ
 #pragma once
+#include <mutex>
+#include <atomic>
 #include "BlackHole_RealTimeRenderEventWatcher.h"
+#include "CBlackHole_Common.h"
+#include "CBlackHole_EnvironmentCache.h"
+#include "CBlackHole_SceneLoader.h"
+#include "CBlackHole_ImageWriter.h"
 
 class CBlackHole_RealTimeRenderRdkPlugIn;
 
@@ -62,8 +68,8 @@ public:
 
     // Ⱦ
     CRhinoCommand::result RenderQuiet(const CRhinoCommandContext& context, bool bPreview);
-    BOOL SceneChanged() const;
-    void SetSceneChanged(BOOL bChanged);
+    BOOL SceneChanged() const;                      // ϴȡӰʵı仯ֻȡ
+    BOOL TakeSceneChanges(ObjectIdSet& changed);    // ȡ仯壻й鲻ı仯־ʱ FALSEҪؽ
     BOOL LightingChanged() const;
     void SetLightingChanged(BOOL bChanged);
     UINT MainFrameResourceID() const;
@@ -72,13 +78,46 @@ public:
     // ǿ (Ҫ)    дʱRhino ʱͲȥȡʾģʽ
     CRhinoPlugIn::plugin_load_time PlugInLoadTime();
 
+    // ã UI ߳޸ģȾ̰߳汾ŷֱ仯ػ
+    SkySettings GetSkySettings() const;
+    void SetSkySettings(const SkySettings& sky);
+    unsigned int SkySettingsRevision() const { return m_skyRevision; }
+
+    // 決棬ʵʱȾ
+    CBlackHole_EnvironmentCache& EnvironmentCache() { return m_envCache; }
+
+    // Ⱦγ̨أȾ´Ⱦֻ±仯
+    CBlackHole_SceneLoader& SceneLoader() { return m_sceneLoader; }
+
+    // ͼȾȾдļʽѡSaveRenderedImage дһɵȾ
+    // ֡һȾʼȾڹرʱͷ
+    ImageOutputSettings GetImageOutput() const;
+    void SetImageOutput(const ImageOutputSettings& output);
+    std::shared_ptr<const RenderedFrame> LastFrame() const;
+    void SetLastFrame(const std::shared_ptr<const RenderedFrame>& frame);
+
+    // һ֡д .exr / .pfm / .pngѹ̳߳ϲУӡ
+    static bool WriteFrame(const RenderedFrame& frame, const std::wstring& path, const ImageWriteSettings& settings);
+
     // ==========================  ҵĴ롿  =============================
 
 private:
     ON_wString m_plugin_version;
     CBlackHole_RealTimeRenderEventWatcher m_event_watcher;
+    std::atomic<uint64_t> m_sceneCursor{ 0 };      // 仯־ȡλãڲɼʱȡƹڿʼȾʱȷ
+    std::atomic<uint64_t> m_lightCursor{ 0 };
     CBlackHole_RealTimeRenderRdkPlugIn* m_pRdkPlugIn;
 
+    mutable std::mutex m_skyMutex;
+    SkySettings m_skySettings;
+    std::atomic<unsigned int> m_skyRevision{ 0 };
+    CBlackHole_EnvironmentCache m_envCache;
+    CBlackHole_SceneLoader m_sceneLoader;
+
+    mutable std::mutex m_outputMutex;
+    ImageOutputSettings m_imageOutput;
+    std::shared_ptr<const RenderedFrame> m_lastFrame;
+
     // TODOӶϢ
 };
 
@@ -11,6 +11,10 @@
 #include "stdafx.h"
 #include "BlackHole_RealTimeRenderSdkRender.h"
 #include "BlackHole_RealTimeRenderPlugIn.h"
+#include "CBlackHole_AovBuffer.h"
+#include "CBlackHole_StripRender.h"
+#include "CBlackHole_RenderJob.h"
+#include "CBlackHole_Log.h"
 
 CBlackHole_RealTimeRenderSdkRender::CBlackHole_RealTimeRenderSdkRender(
 	const CRhinoCommandContext& context,
@@ -20,6 +24,7 @@ CBlackHole_RealTimeRenderSdkRender::CBlackHole_RealTimeRenderSdkRender(
 	bool bPreview
 )
 	: CRhRdkSdkRender(context, plugin, sCaption, id)
+	, m_sceneLoader(::BlackHole_RealTimeRenderPlugIn().SceneLoader())
 {
 	// ǷȾRhino СԤģʽ
 	m_bRenderQuick = bPreview;
@@ -38,6 +43,10 @@ CBlackHole_RealTimeRenderSdkRender::CBlackHole_RealTimeRenderSdkRender(
 	// Ⱦʼ֮ǰӶͨ
 	// ͨЧ / ȺҪ
 	GetRenderWindow().AddChannel(IRhRdkRenderWindow::chanDistanceFromCamera, sizeof(float));
+
+	// ״̬˳õĸ䳤ȡƫ۽ǡȦ
+	for (int c = 0; c < (int)AovChannel::Count; c++)
+		GetRenderWindow().AddChannel(CBlackHole_AovBuffer::ChannelId((AovChannel)c), sizeof(float));
 }
 
 CBlackHole_RealTimeRenderSdkRender::~CBlackHole_RealTimeRenderSdkRender()
@@ -63,20 +72,21 @@ CRhinoSdkRender::RenderReturnCodes CBlackHole_RealTimeRenderSdkRender::Render(co
 	// Rhino ڲNURBS / SubDնת Mesh Ⱦ
 	IRhRdkSdkRenderMeshIterator* pIterator = NewRenderMeshIterator(vp);
 	pIterator->EnsureRenderMeshesCreated();
+	CaptureScene(vp);
 
-	// е mesh
-	// ͨڣ
-	//  BVH
-	// ת mesh
-	// ϴ GPU
-	CRhRdkRenderMesh rm;
-	pIterator->Reset();
-	while (pIterator->Next(rm))
+	// е mesh̨תȾԼβ BVH
+	CollectMeshes(*pIterator);
+
+	// ȾʱֻʾСԤߴ
+	ON_2iSize sizeWindow = sizeRender;
+	const ImageOutputSettings output = ::BlackHole_RealTimeRenderPlugIn().GetImageOutput();
+	if (output.strips && !output.path.empty() && !m_bRenderQuick)
 	{
-		// TODO: ﴦ mesh
+		const CBlackHole_StripPreview preview(sizeRender.cx, sizeRender.cy);
+		sizeWindow = ON_2iSize(preview.Width(), preview.Height());
 	}
 
-	CRhinoSdkRender::RenderReturnCodes rc = CRhRdkSdkRender::Render(sizeRender);
+	CRhinoSdkRender::RenderReturnCodes rc = CRhRdkSdkRender::Render(sizeWindow);
 
 	delete pIterator;
 
@@ -102,15 +112,10 @@ CRhinoSdkRender::RenderReturnCodes CBlackHole_RealTimeRenderSdkRender::RenderWin
 	//  render mesh
 	IRhRdkSdkRenderMeshIterator* pIterator = NewRenderMeshIterator(vp);
 	pIterator->EnsureRenderMeshesCreated();
+	CaptureScene(vp);
 
-	CRhRdkRenderMesh rm;
-	pIterator->Reset();
-	while (pIterator->Next(rm))
-	{
-		// TODO
-		// ͨٽṹ BVH
-		// ע⣺̰߳ȫ
-	}
+	// ٽṹ BVH
+	CollectMeshes(*pIterator);
 
 	CRhinoSdkRender::RenderReturnCodes rc;
 
@@ -131,6 +136,180 @@ CRhinoSdkRender::RenderReturnCodes CBlackHole_RealTimeRenderSdkRender::RenderWin
 	return rc;
 }
 
+void CBlackHole_RealTimeRenderSdkRender::CaptureScene(const ON_Viewport& vp)
+{
+	// ʵʱȾ UpdateCamera ȡֵʽһ£֤߻Ե
+	double half_angle = 0;
+	vp.GetCameraAngle(&half_angle);
+
+	m_camera.pos = vp.CameraLocation();
+	m_camera.dir = vp.CameraDirection();
+	m_camera.up = vp.CameraUp();
+	m_camera.viewAngle = half_angle * 2.0;
+
+	m_sky = ::BlackHole_RealTimeRenderPlugIn().GetSkySettings();
+
+	// ̶ֻ߳ȡύ決лã
+	CRhinoDoc* pDocument = CommandContext().Document();
+	if (SkySource::Environment == m_sky.source && nullptr != pDocument)
+		::BlackHole_RealTimeRenderPlugIn().EnvironmentCache().Update(*pDocument, true);
+}
+
+// ֻȡʵɫûвʱǳ
+static ON_Color MeshAlbedo(const CRhRdkRenderMesh& rm)
+{
+	ON_Color albedo(204, 204, 204);
+	const CRhRdkMaterial* pMaterial = rm.Material();
+	if (nullptr != pMaterial)
+	{
+		ON_Material mat;
+		pMaterial->SimulateMaterial(mat, CRhRdkTexture::TextureGeneration::Disallow);
+		albedo = mat.Diffuse();
+	}
+	return albedo;
+}
+
+static ON_UUID MeshOwner(const CRhRdkRenderMesh& rm)
+{
+	const CRhinoObject* pObject = rm.Object();
+	return nullptr != pObject ? pObject->ModelObjectId() : ON_nil_uuid;
+}
+
+void CBlackHole_RealTimeRenderSdkRender::CollectMeshes(IRhRdkSdkRenderMeshIterator& iterator)
+{
+	// ϴεĳѼꡢұ仯¼˾ʱֻЩ壻ڼػ޷ʱ¼
+	// 仯־ȡ֮ı仯һȾ
+	// ڵǰĸϽУɹΪ¿շһȾžɿգӰ
+	// һκ̨µϢȴӡ
+	CBlackHole_Log::Flush();
+
+	// û仯ֻ˲ʣֻȾʱȱȶɫûõǰգ
+	ObjectIdSet changed;
+	if (::BlackHole_RealTimeRenderPlugIn().TakeSceneChanges(changed))
+	{
+		if (changed.empty() && AlbedosUnchanged(iterator))
+			return;
+
+		const std::shared_ptr<CBlackHole_Scene> pScene = m_sceneLoader.EditableCopy(0);
+		if (nullptr != pScene && UpdateMeshes(*pScene, iterator, changed))
+		{
+			m_sceneLoader.Replace(pScene);
+			return;
+		}
+	}
+
+	// ʵ render mesh ÿ鶨ֻǱ任ֶͬεʵ룬ֻһ
+	std::map<const ON_Mesh*, int> meshUses;
+	CRhRdkRenderMesh rm;
+	iterator.Reset();
+	while (iterator.Next(rm))
+	{
+		const ON_Mesh* pMesh = rm.Mesh();
+		if (nullptr != pMesh)
+			meshUses[pMesh]++;
+	}
+
+	// صֻ߳Чֻÿһݣת͹ں̨
+	std::map<const ON_Mesh*, std::shared_ptr<const ON_Mesh>> copies;
+	std::vector<SceneLoadRecord> records;
+	iterator.Reset();
+	while (iterator.Next(rm))
+	{
+		const ON_Mesh* pMesh = rm.Mesh();
+		if (nullptr == pMesh)
+			continue;
+
+		std::shared_ptr<const ON_Mesh>& copy = copies[pMesh];
+		if (!copy)
+			copy = std::make_shared<const ON_Mesh>(*pMesh);
+
+		SceneLoadRecord record;
+		record.mesh = copy;
+		record.xform = rm.XformInstance();
+		record.albedo = MeshAlbedo(rm);
+		record.owner = MeshOwner(rm);
+		record.bInstance = meshUses[pMesh] > 1;
+		records.push_back(record);
+	}
+
+	m_sceneLoader.Start(std::move(records));
+}
+
+bool CBlackHole_RealTimeRenderSdkRender::AlbedosUnchanged(IRhRdkSdkRenderMeshIterator& iterator) const
+{
+	// лȡĳ EditableCopy ж
+	bool bComplete = false;
+	const std::shared_ptr<const CBlackHole_Scene> pScene = m_sceneLoader.Current(&bComplete);
+	if (nullptr == pScene || !bComplete)
+		return false;
+
+	//  UpdateMeshes ͬĶӦʽͬһ񰴳˳Ӧ
+	std::map<ON_UUID, int, UuidLess> seen;
+	std::vector<int> objects;
+
+	CRhRdkRenderMesh rm;
+	iterator.Reset();
+	while (iterator.Next(rm))
+	{
+		if (nullptr == rm.Mesh())
+			continue;
+
+		const ON_UUID owner = MeshOwner(rm);
+		const int k = seen[owner]++;
+		if (pScene->FindObjects(owner, objects) <= k || !pScene->AlbedoEquals(objects[k], MeshAlbedo(rm)))
+			return false;
+	}
+	return true;
+}
+
+bool CBlackHole_RealTimeRenderSdkRender::UpdateMeshes(CBlackHole_Scene& scene, IRhRdkSdkRenderMeshIterator& iterator, const ObjectIdSet& changed)
+{
+	// ȫ render meshһж񣬰˳Ӧ
+	// δ仯ֻˢɫ޸Ĳ֪ͨҲ˵壬ֻؽ
+	std::map<ON_UUID, int, UuidLess> seen;
+	std::vector<int> objects;
+
+	CRhRdkRenderMesh rm;
+	iterator.Reset();
+	while (iterator.Next(rm))
+	{
+		const ON_Mesh* pMesh = rm.Mesh();
+		if (nullptr == pMesh)
+			continue;
+
+		const ON_UUID owner = MeshOwner(rm);
+		const int k = seen[owner]++;
+		if (scene.FindObjects(owner, objects) <= k)
+			return false;
+
+		if (changed.count(owner) > 0 && !scene.UpdateMesh(objects[k], *pMesh, rm.XformInstance()))
+			return false;
+		scene.SetAlbedo(objects[k], MeshAlbedo(rm));
+	}
+
+	// 仯ˣɾػ򻻳˸ٵ
+	for (const ON_UUID& owner : changed)
+	{
+		const auto it = seen.find(owner);
+		const int count = (it == seen.end()) ? 0 : it->second;
+		for (int i = scene.FindObjects(owner, objects) - 1; i >= count; i--)
+			scene.RemoveObject(objects[i]);
+	}
+
+	SceneUpdateStats stats;
+	if (!scene.Commit(&stats))
+		return false;
+
+	if (!changed.empty())
+	{
+		ON_wString str;
+		str.Format(L"BlackHole: scene updated in %.2f ms (%d objects moved, %d removed, %d nodes refit, %d triangles rebuilt)\n",
+			stats.updateMs, stats.objectsUpdated, stats.objectsRemoved, stats.nodesRefit, stats.trianglesRebuilt);
+		RhinoApp().Print(str);
+	}
+	return true;
+}
+
 BOOL CBlackHole_RealTimeRenderSdkRender::NeedToProcessGeometryTable()
 {
 	// ı䣬Ҫ¹
@@ -145,7 +324,7 @@ BOOL CBlackHole_RealTimeRenderSdkRender::NeedToProcessLightTable()
 
 BOOL CBlackHole_RealTimeRenderSdkRender::RenderPreCreateWindow()
 {
-	::BlackHole_RealTimeRenderPlugIn().SetSceneChanged(FALSE);
+	// 仯ڲɼʱȡֻȷϵƹ
 	::BlackHole_RealTimeRenderPlugIn().SetLightingChanged(FALSE);
 
 	return TRUE;
@@ -192,19 +371,9 @@ void CBlackHole_RealTimeRenderSdkRender::StopRendering()
 	}
 }
 
-static void CalculatePixel(
-	int x,
-	int y,
-	const ON_2iSize& sizeRender,
-	CRhRdkColor& colOut,
-	float& zOut,
-	bool bFast);
-
 int CBlackHole_RealTimeRenderSdkRender::ThreadedRender(void)
 {
-	// Ⱦڣģ
-	// δĺڶ׷پ
-
+	// Ⱦڣ׼滮׷ɫ CBlackHole_RenderJob ֻȡĵߴ
 	m_bCancel = false;
 
 	CRhinoDoc* pDocument = CommandContext().Document();
@@ -213,158 +382,19 @@ int CBlackHole_RealTimeRenderSdkRender::ThreadedRender(void)
 
 	const auto sizeRender = RenderSize(*pDocument, true);
 
-	ON_4iRect rect(0, 0, sizeRender.cx, sizeRender.cy);
-
-	IRhRdkRenderWindow& renderWnd = GetRenderWindow();
-
-	// Ⱦߴ
-	renderWnd.SetSize(sizeRender);
-
-	// ɫͨ
-	IRhRdkRenderWindow::IChannel* pChanRGBA =
-		renderWnd.OpenChannel(IRhRdkRenderWindow::chanRGBA);
-
-	if (nullptr != pChanRGBA)
-	{
-		// ͨ
-		IRhRdkRenderWindow::IChannel* pChanZ =
-			renderWnd.OpenChannel(IRhRdkRenderWindow::chanDistanceFromCamera);
+	// һε֡ͷţһεĻͬʱռڴ棻һȡȾʱûпɹ SaveRenderedImage дĽ
+	::BlackHole_RealTimeRenderPlugIn().SetLastFrame(nullptr);
 
-		if (nullptr != pChanZ)
-		{
-			float z = 0.0f;
-			CRhRdkColor col;
-
-			// ÿ
-			for (int y = 0; y < sizeRender.cy; y++)
-			{
-				for (int x = 0; x < sizeRender.cx; x++)
-				{
-					CalculatePixel(x, y, sizeRender, col, z, m_bRenderQuick);
-
-					if (m_bCancel)
-						break;
-
-					pChanRGBA->SetValue(x, y, ComponentOrder::RGBA, col.FloatArray());
-					pChanZ->SetValue(x, y, ComponentOrder::Irrelevant, &z);
-				}
-
-				// ˢһ
-				rect.top = y;
-				rect.bottom = y + 1;
-				renderWnd.InvalidateArea(rect);
-			}
-
-			pChanZ->Close();
-		}
+	CBlackHole_RenderJob job(GetRenderWindow(), m_camera, m_sky, m_sceneLoader,
+		::BlackHole_RealTimeRenderPlugIn().EnvironmentCache(), ::BlackHole_RealTimeRenderPlugIn().GetImageOutput(),
+		sizeRender.cx, sizeRender.cy, m_bRenderQuick, m_bCancel);
+	job.Run();
 
-		pChanRGBA->Close();
-	}
+	if (job.Frame())
+		::BlackHole_RealTimeRenderPlugIn().SetLastFrame(job.Frame());
 
 	// ֪ͨ Rhino Ⱦ
 	SetContinueModal(false);
 
 	return 0;
 }
-
-
-// ===============================
-// ʾɫٵȾ
-// ===============================
-
-void CalcCore(
-	int x,
-	int y,
-	float w,
-	float h,
-	double x1,
-	double y1,
-	float& r,
-	float& g,
-	float& b,
-	float& a,
-	float& z)
-{
-	const float k = min(w, h) * 0.5f;
-	const float radius = k * 0.8f;
-
-	float rr = 0.05f;
-	float gg = 0.25f;
-	float bb = 0.6f;
-	float aa = 0.0f;
-	float zz = 0.0f;
-
-	const float dist = (float)sqrt((double)(x1 * x1) + (double)(y1 * y1));
-
-	if (dist < radius)
-	{
-		bb = x / w;
-		bb *= bb;
-
-		rr = y / h;
-		rr *= rr;
-
-		zz = 1.0f - (dist / k);
-		aa = 1.0f;
-		gg = zz * 0.68f;
-	}
-
-	r += rr;
-	g += gg;
-	b += bb;
-	a += aa;
-	z += zz;
-}
-
-static void CalculatePixel(
-	int x,
-	int y,
-	const ON_2iSize& sizeRender,
-	CRhRdkColor& colOut,
-	float& zOut,
-	bool bFast)
-{
-	const float w = (float)sizeRender.cx;
-	const float h = (float)sizeRender.cy;
-
-	const double midX = w * 0.5f;
-	const double midY = h * 0.5f;
-
-	int samples = 0;
-
-	float r = 0.0f;
-	float g = 0.0f;
-	float b = 0.0f;
-	float a = 0.0f;
-	float z = 0.0f;
-
-	if (bFast)
-	{
-		const double x1 = midX - x;
-		const double y1 = midY - y;
-		CalcCore(x, y, w, h, x1, y1, r, g, b, a, z);
-		samples++;
-	}
-	else
-	{
-		// 
-		for (float s = -0.5f; s < 0.5001f; s += 0.0625f)
-		{
-			for (float t = -0.5f; t < 0.5001f; t += 0.0625f)
-			{
-				const double x1 = midX - x + s;
-				const double y1 = midY - y + t;
-				CalcCore(x, y, w, h, x1, y1, r, g, b, a, z);
-				samples++;
-			}
-		}
-	}
-
-	float* f = colOut.FloatArray();
-	f[0] = r / samples;
-	f[1] = g / samples;
-	f[2] = b / samples;
-	f[3] = a / samples;
-
-	zOut = z;
-}
\ No newline at end of file
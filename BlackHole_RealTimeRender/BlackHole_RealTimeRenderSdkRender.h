@@ -2,6 +2,9 @@
 //
 
 #pragma once
+#include <atomic>
+#include "CBlackHole_Common.h"
+#include "CBlackHole_SceneLoader.h"
 
 // CBlackHole_RealTimeRenderSdkRender
 // See BlackHole_RealTimeRenderSdkRender.cpp for the implementation of this class.
@@ -43,9 +46,24 @@ public:
 protected:
 	static void RenderThread(void* pv);
 
+	// ӿץȡã̵߳
+	void CaptureScene(const ON_Viewport& vp);
+
+	//  render mesh ̨أת BVH Ⱦ̰߳ȫģ̵߳
+	// ȾϴѼꡢ仯ܹ鵽ʱֱӸЩ
+	void CollectMeshes(IRhRdkSdkRenderMeshIterator& iterator);
+	bool UpdateMeshes(CBlackHole_Scene& scene, IRhRdkSdkRenderMeshIterator& iterator, const ObjectIdSet& changed);
+
+	// û仯ʱڵǰֻȶɫÿɫûʱ trueؿ
+	bool AlbedosUnchanged(IRhRdkSdkRenderMeshIterator& iterator) const;
+
 private:
 	HANDLE m_hRenderThread;
 	bool m_bContinueModal;
 	bool m_bRenderQuick;
-	bool m_bCancel;
+	std::atomic<bool> m_bCancel;	// StopRendering ߳λȾ̳߳߳ϵѯ
+
+	CameraParameters m_camera;	// Ⱦ߳ʹõ
+	SkySettings m_sky;			// Ⱦ߳ʹõÿ
+	CBlackHole_SceneLoader& m_sceneLoader;	// Ⱦ߳ʹõγɲУȾ;ܻɸĿ
 };
@@ -0,0 +1,80 @@
+﻿// CBlackHole_AdaptiveSampler.cpp
+#include "stdafx.h"
+#include <cmath>
+#include "CBlackHole_AdaptiveSampler.h"
+
+static double Luminance(const ON_3dVector& c) {
+    return 0.2126 * c.x + 0.7152 * c.y + 0.0722 * c.z;
+}
+
+CBlackHole_AdaptiveSampler::CBlackHole_AdaptiveSampler(const AdaptiveSamplingSettings& settings, uint32_t seed)
+    : m_settings(settings), m_sampler(seed) {
+    if (m_settings.minRounds < 2) m_settings.minRounds = 2;
+    if (m_settings.maxSamples < 4 * m_settings.minRounds) m_settings.maxSamples = 4 * m_settings.minRounds;
+    if (m_settings.initialSamples > 0) m_settings.initialSamples = (m_settings.initialSamples + 3) / 4 * 4;
+    if (m_settings.initialSamples > m_settings.maxSamples) m_settings.initialSamples = m_settings.maxSamples / 4 * 4;
+}
+
+bool CBlackHole_AdaptiveSampler::IsEdge(const PixelClass* classes, int width, int height, int x, int y) const {
+    const PixelClass& c = classes[(size_t)y * width + x];
+    const int nx[4] = { x - 1, x + 1, x, x };
+    const int ny[4] = { y, y, y - 1, y + 1 };
+    for (int k = 0; k < 4; ++k) {
+        if (nx[k] < 0 || nx[k] >= width || ny[k] < 0 || ny[k] >= height) continue;
+        const PixelClass& n = classes[(size_t)ny[k] * width + nx[k]];
+        if (n.id != c.id) return true;
+        if (c.id >= 0) {
+            const double cosAngle = (double)c.dir[0] * n.dir[0] + (double)c.dir[1] * n.dir[1] + (double)c.dir[2] * n.dir[2];
+            if (cosAngle < m_settings.creaseCos) return true;
+        }
+    }
+    return false;
+}
+
+void CBlackHole_AdaptiveSampler::Offset(int x, int y, int i, double& dx, double& dy) const {
+    double u, v;
+    m_sampler.Get2D(x, y, (uint32_t)i, CBlackHole_Sampler::PixelPosition, u, v);
+    dx = u - 0.5;
+    dy = v - 0.5;
+}
+
+ON_3dVector CBlackHole_AdaptiveSampler::Integrate(int x, int y, const ShadeFunction& shade, bool bEdge, int& samples) const {
+    ON_3dVector sum = ON_3dVector::ZeroVector;
+    double lumSum = 0.0, lumSq = 0.0;           // 各轮均值的亮度
+    double sampleSum = 0.0, sampleSq = 0.0;     // 单个样本的亮度，初始样本的判据用
+    const int maxRounds = m_settings.maxSamples / 4;
+    const int initialRounds = bEdge ? 0 : m_settings.initialSamples / 4;
+
+    // n 个值的均值的标准误差是否在阈值内
+    auto converged = [this](double valueSum, double valueSq, int n) {
+        const double mean = valueSum / n;
+        const double var = (valueSq - valueSum * mean) / (n - 1);
+        const double err = sqrt((var > 0.0 ? var : 0.0) / n);
+        return err <= m_settings.noiseThreshold * (mean > 0.1 ? mean : 0.1);
+    };
+
+    int rounds = 0;
+    while (rounds < maxRounds) {
+        ON_3dVector roundSum = ON_3dVector::ZeroVector;
+        for (int q = 0; q < 4; ++q) {
+            double dx, dy;
+            Offset(x, y, rounds * 4 + q, dx, dy);
+            const ON_3dVector c = shade(dx, dy);
+            const double l = Luminance(c);
+            sampleSum += l;
+            sampleSq += l * l;
+            roundSum += c;
+        }
+        sum += roundSum;
+        ++rounds;
+
+        const double l = Luminance(0.25 * roundSum);
+        lumSum += l;
+        lumSq += l * l;
+        if (rounds == initialRounds && converged(sampleSum, sampleSq, rounds * 4)) break;
+        if (rounds >= m_settings.minRounds && converged(lumSum, lumSq, rounds)) break;
+    }
+
+    samples = rounds * 4;
+    return sum / (double)samples;
+}
@@ -0,0 +1,57 @@
+﻿// CBlackHole_AdaptiveSampler.h
+// 离线渲染的自适应抗锯齿：每个像素先追踪一根中心光线，按与上下左右像素的类别（视界 / 天空 / 哪个物体）和法线判断是否处在边缘；
+// 边缘像素分轮追加样本，每轮 4 个分别落在像素的 4 个象限内，各轮均值之间的离散程度足够小时停止
+// 其余像素（视界内部除外）先取几个样本，它们的标准误差超过阈值时同样继续分轮取样，类别相同但亮度变化剧烈的像素（光子环附近的细像）也能被找到
+// 样本位置来自 CBlackHole_Sampler 的 Sobol 序列
+// 天空着色已按像素在天球上的覆盖范围预滤波，天空内部不需要超采样
+#pragma once
+#include "stdafx.h"
+#include <cstdint>
+#include <functional>
+#include "CBlackHole_Sampler.h"
+
+struct AdaptiveSamplingSettings {
+    int    maxSamples = 64;         // 每个像素的样本上限
+    int    initialSamples = 4;      // 非边缘像素先取的样本数（按 4 取整），0 表示只对边缘像素超采样
+    int    minRounds = 2;           // 至少两轮才能估计误差
+    double noiseThreshold = 0.02;   // 允许的均值标准误差，相对于 max(亮度, 0.1)
+    double creaseCos = 0.9;         // 同一物体上相邻像素法线夹角的余弦低于它视为边缘（约 25 度）
+};
+
+// 中心光线的分类：id 为物体编号，或下面两个负值；抗锯齿判断边缘用它
+struct PixelClass {
+    static const int Captured = -2;     // 落入视界或步数用完
+    static const int Sky = -1;
+
+    int   id = Sky;
+    float dir[3] = { 0.0f, 0.0f, 0.0f };    // 物体：法线；天空：出射方向
+    int   steps = 0;                        // 积分步数，反映光线绕黑洞弯曲的程度
+};
+
+class CBlackHole_AdaptiveSampler {
+public:
+    // 像素内偏移 (dx, dy) ∈ [-0.5, 0.5)^2 -> 该处的颜色
+    using ShadeFunction = std::function<ON_3dVector(double dx, double dy)>;
+
+    explicit CBlackHole_AdaptiveSampler(const AdaptiveSamplingSettings& settings, uint32_t seed = 0);
+
+    // 与相邻像素的类别不同，或同一物体上法线转折明显
+    bool IsEdge(const PixelClass* classes, int width, int height, int x, int y) const;
+
+    // 非边缘像素是否先取初始样本：视界内部恒为黑色，不取
+    bool Probes(const PixelClass& c) const { return m_settings.initialSamples > 0 && c.id != PixelClass::Captured; }
+    int  InitialSamples() const { return m_settings.initialSamples; }
+
+    // 第 i 个样本在像素内的偏移
+    void Offset(int x, int y, int i, double& dx, double& dy) const;
+
+    // 分轮取样直到收敛或达到上限，返回均值；samples 为实际样本数
+    // 每轮是 Sobol 序列中对齐的 4 个点，恰好每个象限一个；各轮之间互补而不是独立，
+    // 轮均值的方差因此高估最终均值的误差，停止判据偏保守
+    // 非边缘像素取完初始样本后，按单个样本估计的标准误差不超过阈值即停止
+    ON_3dVector Integrate(int x, int y, const ShadeFunction& shade, bool bEdge, int& samples) const;
+
+private:
+    AdaptiveSamplingSettings m_settings;
+    CBlackHole_Sampler       m_sampler;
+};
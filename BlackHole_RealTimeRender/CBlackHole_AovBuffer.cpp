@@ -0,0 +1,168 @@
+﻿// CBlackHole_AovBuffer.cpp
+#include "stdafx.h"
+#include <cstring>
+#include <immintrin.h>
+#include "CBlackHole_AovBuffer.h"
+#include "CBlackHole_CPUFeatures.h"
+
+void CBlackHole_AovBuffer::Resize(int width, int height) {
+    m_width = width;
+    m_height = height;
+    const size_t n = (size_t)width * height;
+    m_steps.assign(n, 0);
+    m_halfOrbits.assign(n, 0);
+    m_affine.assign(n, 0);
+    m_deflection.assign(n, 0);
+    m_redshift.assign(n, 0);
+}
+
+void CBlackHole_AovBuffer::Set(size_t pixel, const GeodesicResult& res) {
+    const int steps = (res.steps < 0xFFFF) ? res.steps : 0xFFFF;
+    const int halfOrbits = (res.halfOrbits < 0xFF) ? res.halfOrbits : 0xFF;
+    SetPacked(pixel, (uint16_t)steps, (uint8_t)halfOrbits,
+        FloatToHalf((float)res.affineLength), FloatToHalf((float)res.deflection), FloatToHalf((float)res.redshift));
+}
+
+void CBlackHole_AovBuffer::SetPacked(size_t pixel, uint16_t steps, uint8_t halfOrbits, uint16_t affineHalf, uint16_t deflectionHalf, uint16_t redshiftHalf) {
+    m_steps[pixel] = steps;
+    m_halfOrbits[pixel] = halfOrbits;
+    m_affine[pixel] = affineHalf;
+    m_deflection[pixel] = deflectionHalf;
+    m_redshift[pixel] = redshiftHalf;
+}
+
+void CBlackHole_AovBuffer::Expand(AovChannel channel, int y, int rows, float* out) const {
+    const size_t begin = (size_t)y * m_width;
+    const size_t n = (size_t)rows * m_width;
+
+    const std::vector<uint16_t>* pHalf = nullptr;
+    switch (channel) {
+    case AovChannel::Steps:
+        for (size_t i = 0; i < n; ++i) out[i] = (float)m_steps[begin + i];
+        return;
+    case AovChannel::HalfOrbits:
+        for (size_t i = 0; i < n; ++i) out[i] = (float)m_halfOrbits[begin + i];
+        return;
+    case AovChannel::AffineLength: pHalf = &m_affine; break;
+    case AovChannel::Deflection:   pHalf = &m_deflection; break;
+    case AovChannel::Redshift:     pHalf = &m_redshift; break;
+    default: return;
+    }
+
+    // 半精度一次展开 8 个
+    static const bool bF16C = CBlackHole_CPUFeatures::HasF16C();
+    const uint16_t* src = pHalf->data() + begin;
+    size_t i = 0;
+    if (bF16C) {
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(src + i))));
+    }
+    for (; i < n; ++i) out[i] = HalfToFloat(src[i]);
+}
+
+void CBlackHole_AovBuffer::PackRows(int y, int rows, uint8_t* out) const {
+    const size_t begin = (size_t)y * m_width;
+    const size_t n = (size_t)rows * m_width;
+    memcpy(out, &m_steps[begin], n * sizeof(uint16_t));
+    out += n * sizeof(uint16_t);
+    memcpy(out, &m_halfOrbits[begin], n);
+    out += n;
+    memcpy(out, &m_affine[begin], n * sizeof(uint16_t));
+    out += n * sizeof(uint16_t);
+    memcpy(out, &m_deflection[begin], n * sizeof(uint16_t));
+    out += n * sizeof(uint16_t);
+    memcpy(out, &m_redshift[begin], n * sizeof(uint16_t));
+}
+
+void CBlackHole_AovBuffer::UnpackRows(int y, int rows, const uint8_t* in) {
+    const size_t begin = (size_t)y * m_width;
+    const size_t n = (size_t)rows * m_width;
+    memcpy(&m_steps[begin], in, n * sizeof(uint16_t));
+    in += n * sizeof(uint16_t);
+    memcpy(&m_halfOrbits[begin], in, n);
+    in += n;
+    memcpy(&m_affine[begin], in, n * sizeof(uint16_t));
+    in += n * sizeof(uint16_t);
+    memcpy(&m_deflection[begin], in, n * sizeof(uint16_t));
+    in += n * sizeof(uint16_t);
+    memcpy(&m_redshift[begin], in, n * sizeof(uint16_t));
+}
+
+const UUID& CBlackHole_AovBuffer::ChannelId(AovChannel channel) {
+    static const GUID ids[(int)AovChannel::Count] = {
+        // {52CBAF1D-96EC-427B-A632-255983558FE3}
+        {0x52cbaf1d,0x96ec,0x427b,{0xa6,0x32,0x25,0x59,0x83,0x55,0x8f,0xe3}},
+        // {808B9F4C-0FEE-47FB-A5D8-61DDE6937EA2}
+        {0x808b9f4c,0x0fee,0x47fb,{0xa5,0xd8,0x61,0xdd,0xe6,0x93,0x7e,0xa2}},
+        // {6325B4CF-8B86-4C69-813E-F34A202137D2}
+        {0x6325b4cf,0x8b86,0x4c69,{0x81,0x3e,0xf3,0x4a,0x20,0x21,0x37,0xd2}},
+        // {3B6EF456-5820-41AE-8867-9025ABBEBC28}
+        {0x3b6ef456,0x5820,0x41ae,{0x88,0x67,0x90,0x25,0xab,0xbe,0xbc,0x28}},
+        // {AA89B931-AA7F-4CDF-A62E-85FA03EE1841}
+        {0xaa89b931,0xaa7f,0x4cdf,{0xa6,0x2e,0x85,0xfa,0x03,0xee,0x18,0x41}},
+    };
+    return ids[(int)channel];
+}
+
+// 按位转换：就近舍入到偶数，非规格化数逐位移出，NaN 保留尾数高位并置为 quiet
+static uint16_t FloatToHalfScalar(float f) {
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    const uint16_t sign = (uint16_t)((x >> 16) & 0x8000u);
+    x &= 0x7FFFFFFFu;
+
+    if (x >= 0x7F800000u)
+        return sign | 0x7C00u | (x > 0x7F800000u ? 0x200u | ((x >> 13) & 0x3FFu) : 0u);
+    if (x >= 0x477FF000u) return sign | 0x7C00u;     // 不小于 65520，舍入后超出半精度范围
+    if (x < 0x38800000u) {                          // 小于 2^-14：非规格化数或零
+        if (x < 0x33000000u) return sign;           // 不大于 2^-25 的舍入为零
+        const uint32_t shift = 126u - (x >> 23);
+        const uint32_t m = (x & 0x7FFFFFu) | 0x800000u;
+        uint32_t h = m >> shift;
+        const uint32_t rest = m & ((1u << shift) - 1u);
+        const uint32_t halfway = 1u << (shift - 1u);
+        if (rest > halfway || (rest == halfway && (h & 1u))) ++h;
+        return sign | (uint16_t)h;
+    }
+
+    // 规格化数：指数偏移从 127 换成 15，尾数进位可以直接进到指数
+    uint32_t r = x - 0x38000000u;
+    r += 0xFFFu + ((r >> 13) & 1u);
+    return sign | (uint16_t)(r >> 13);
+}
+
+static float HalfToFloatScalar(uint16_t h) {
+    const uint32_t sign = (uint32_t)(h & 0x8000u) << 16;
+    const uint32_t e = (h >> 10) & 0x1Fu;
+    uint32_t m = h & 0x3FFu;
+    uint32_t x;
+    if (0x1Fu == e)
+        x = sign | 0x7F800000u | (m << 13) | (m ? 0x400000u : 0u);
+    else if (e)
+        x = sign | ((e + 112u) << 23) | (m << 13);
+    else if (0 == m)
+        x = sign;
+    else {
+        // 非规格化数：移到最高位为隐含位
+        uint32_t shift = 0;
+        while (!(m & 0x400u)) {
+            m <<= 1;
+            ++shift;
+        }
+        x = sign | ((113u - shift) << 23) | ((m & 0x3FFu) << 13);
+    }
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+// 就近舍入到偶数，超出范围为无穷大，与 HLSL 的 f32tof16 一致
+uint16_t CBlackHole_AovBuffer::FloatToHalf(float f) {
+    static const bool bF16C = CBlackHole_CPUFeatures::HasF16C();
+    return bF16C ? (uint16_t)_cvtss_sh(f, 0) : FloatToHalfScalar(f);
+}
+
+float CBlackHole_AovBuffer::HalfToFloat(uint16_t h) {
+    static const bool bF16C = CBlackHole_CPUFeatures::HasF16C();
+    return bF16C ? _cvtsh_ss(h) : HalfToFloatScalar(h);
+}
@@ -0,0 +1,55 @@
+﻿// CBlackHole_AovBuffer.h
+// 逐像素辅助输出（AOV）：积分步数、仿射长度、偏折角、半圈数与引力红移，供合成、调试与自适应采样使用
+// 每个通道按紧凑格式单独存放：步数 16 位、半圈数 8 位（都饱和截断），连续量为半精度浮点；写入渲染窗口时再展开成 float
+#pragma once
+#include "stdafx.h"
+#include <cstdint>
+#include <vector>
+#include "CBlackHole_CPUTracer.h"
+
+enum class AovChannel : int {
+    Steps = 0,
+    AffineLength,
+    Deflection,
+    HalfOrbits,
+    Redshift,
+    Count
+};
+
+class CBlackHole_AovBuffer {
+public:
+    void Resize(int width, int height);
+
+    // 记录一个像素（中心光线）的结果；不同像素可在不同线程同时写入
+    void Set(size_t pixel, const GeodesicResult& res);
+
+    // GPU 读回的数据已经是同样的紧凑格式，原样存入
+    void SetPacked(size_t pixel, uint16_t steps, uint8_t halfOrbits, uint16_t affineHalf, uint16_t deflectionHalf, uint16_t redshiftHalf);
+
+    // 把第 y 行起 rows 行的一个通道展开成 float，out 需要 width * rows 个元素
+    void Expand(AovChannel channel, int y, int rows, float* out) const;
+
+    // 第 y 行起 rows 行按紧凑格式逐通道导出 / 导入，需要 width * rows * BytesPerPixel() 字节；检查点用
+    void PackRows(int y, int rows, uint8_t* out) const;
+    void UnpackRows(int y, int rows, const uint8_t* in);
+
+    int Width() const { return m_width; }
+    int Height() const { return m_height; }
+    static size_t BytesPerPixel() { return 4 * sizeof(uint16_t) + sizeof(uint8_t); }
+
+    // 渲染窗口中的自定义通道
+    static const UUID& ChannelId(AovChannel channel);
+
+    // 半精度转换：支持 F16C 的 CPU 上用硬件指令，否则按位转换，两者结果相同
+    static uint16_t FloatToHalf(float f);
+    static float HalfToFloat(uint16_t h);
+
+private:
+    int m_width = 0;
+    int m_height = 0;
+    std::vector<uint16_t> m_steps;
+    std::vector<uint8_t>  m_halfOrbits;
+    std::vector<uint16_t> m_affine;
+    std::vector<uint16_t> m_deflection;
+    std::vector<uint16_t> m_redshift;
+};
@@ -0,0 +1,447 @@
+﻿// CBlackHole_BVHBuilder.cpp
+#include "stdafx.h"
+#include <chrono>
+#include <cfloat>
+#include <numeric>
+#include <algorithm>
+#include "CBlackHole_ThreadPool.h"
+#include "CBlackHole_BVHBuilder.h"
+
+static const int kBins = 16;            // 每个轴的最大分箱数；小节点按图元数减少，节点的固定开销随之下降
+static const int kChunk = 1 << 15;      // 并行分箱/划分时每个任务处理的图元数
+
+// ==========================================
+// 包围盒与分箱
+
+struct BuildBox {
+    float mn[3], mx[3];
+
+    void Reset() {
+        mn[0] = mn[1] = mn[2] = FLT_MAX;
+        mx[0] = mx[1] = mx[2] = -FLT_MAX;
+    }
+    void Grow(const float lo[3], const float hi[3]) {
+        for (int k = 0; k < 3; ++k) {
+            if (lo[k] < mn[k]) mn[k] = lo[k];
+            if (hi[k] > mx[k]) mx[k] = hi[k];
+        }
+    }
+    void Grow(const BuildBox& b) { Grow(b.mn, b.mx); }
+    float Area() const {
+        if (mn[0] > mx[0]) return 0.0f;
+        const float dx = mx[0] - mn[0], dy = mx[1] - mn[1], dz = mx[2] - mn[2];
+        return 2.0f * (dx * dy + dy * dz + dz * dx);
+    }
+};
+
+struct BuildBins {
+    int      binCount = kBins;
+    BuildBox box[3][kBins];
+    int      count[3][kBins];
+
+    void Reset(int n) {
+        binCount = n;
+        for (int a = 0; a < 3; ++a) {
+            for (int b = 0; b < binCount; ++b) {
+                box[a][b].Reset();
+                count[a][b] = 0;
+            }
+        }
+    }
+    void Merge(const BuildBins& o) {
+        for (int a = 0; a < 3; ++a) {
+            for (int b = 0; b < binCount; ++b) {
+                box[a][b].Grow(o.box[a][b]);
+                count[a][b] += o.count[a][b];
+            }
+        }
+    }
+};
+
+struct BuildSplit {
+    int      axis = -1;         // -1 表示质心全部重合，无法按位置切分
+    int      bin = 0;           // 左侧为 [0, bin]
+    float    cost = FLT_MAX;    // sum(面积 * 图元数)，未除以父节点面积
+    float    cmin = 0.0f;       // 该轴的分箱参数，划分时复用
+    float    scale = 0.0f;
+    int      binCount = kBins;
+    BuildBox leftBox, rightBox; // 两侧图元的包围盒，直接由分箱合并得到
+};
+
+struct BuildContext {
+    const BVHPrimBounds* prims;
+    const float*         cent;      // 质心，3 个一组
+    int*                 order;
+    int*                 tmp;       // 并行划分的暂存区，与 order 等长
+};
+
+static inline int BinOf(float c, float cmin, float scale, int binCount) {
+    const int b = (int)((c - cmin) * scale);
+    return b < 0 ? 0 : (b >= binCount ? binCount - 1 : b);
+}
+
+static inline int BinCountFor(int primCount) {
+    return primCount < kBins ? (primCount > 2 ? primCount : 2) : kBins;
+}
+
+static void MeasureRange(const BuildContext& ctx, int first, int count, BuildBox& box, BuildBox& cbox) {
+    box.Reset();
+    cbox.Reset();
+    for (int i = first; i < first + count; ++i) {
+        const int p = ctx.order[i];
+        box.Grow(ctx.prims[p].bmin, ctx.prims[p].bmax);
+        cbox.Grow(&ctx.cent[3 * p], &ctx.cent[3 * p]);
+    }
+}
+
+static void BinRange(const BuildContext& ctx, int first, int count, const BuildBox& cbox, BuildBins& bins) {
+    float scale[3];
+    for (int a = 0; a < 3; ++a) {
+        const float extent = cbox.mx[a] - cbox.mn[a];
+        scale[a] = extent > 0.0f ? bins.binCount / extent : 0.0f;
+    }
+    for (int i = first; i < first + count; ++i) {
+        const int p = ctx.order[i];
+        for (int a = 0; a < 3; ++a) {
+            const int b = BinOf(ctx.cent[3 * p + a], cbox.mn[a], scale[a], bins.binCount);
+            bins.box[a][b].Grow(ctx.prims[p].bmin, ctx.prims[p].bmax);
+            bins.count[a][b]++;
+        }
+    }
+}
+
+// 扫描每个轴的 binCount - 1 个切分位置
+static BuildSplit FindSplit(const BuildBins& bins, const BuildBox& cbox) {
+    const int nb = bins.binCount;
+    BuildSplit best;
+    for (int a = 0; a < 3; ++a) {
+        if (cbox.mx[a] <= cbox.mn[a]) continue;
+
+        float rightArea[kBins];
+        int rightCount[kBins];
+        BuildBox acc;
+        acc.Reset();
+        int n = 0;
+        for (int b = nb - 1; b > 0; --b) {
+            acc.Grow(bins.box[a][b]);
+            n += bins.count[a][b];
+            rightArea[b] = acc.Area();
+            rightCount[b] = n;
+        }
+
+        acc.Reset();
+        n = 0;
+        for (int b = 0; b < nb - 1; ++b) {
+            acc.Grow(bins.box[a][b]);
+            n += bins.count[a][b];
+            if (n == 0 || rightCount[b + 1] == 0) continue;
+            const float cost = acc.Area() * n + rightArea[b + 1] * rightCount[b + 1];
+            if (cost < best.cost) {
+                best.axis = a;
+                best.bin = b;
+                best.cost = cost;
+            }
+        }
+    }
+
+    if (best.axis >= 0) {
+        const int a = best.axis;
+        best.cmin = cbox.mn[a];
+        best.scale = nb / (cbox.mx[a] - cbox.mn[a]);
+        best.binCount = nb;
+        best.leftBox.Reset();
+        best.rightBox.Reset();
+        for (int b = 0; b < nb; ++b) (b <= best.bin ? best.leftBox : best.rightBox).Grow(bins.box[a][b]);
+    }
+    return best;
+}
+
+static inline bool GoesLeft(const BuildContext& ctx, int p, const BuildSplit& split) {
+    return BinOf(ctx.cent[3 * p + split.axis], split.cmin, split.scale, split.binCount) <= split.bin;
+}
+
+// ==========================================
+// 串行子树构建
+
+// box 为本节点图元的包围盒，cbox 为质心包围盒，都由父节点在划分时顺带算出
+static void BuildSubtree(const BuildContext& ctx, std::vector<BVHNode>& nodes, int nodeIndex, int first, int count,
+    const BuildBox& box, const BuildBox& cbox, int depth, int& maxDepth) {
+    if (depth > maxDepth) maxDepth = depth;
+
+    for (int k = 0; k < 3; ++k) {
+        nodes[nodeIndex].bmin[k] = box.mn[k];
+        nodes[nodeIndex].bmax[k] = box.mx[k];
+    }
+
+    auto makeLeaf = [&]() {
+        nodes[nodeIndex].leftFirst = first;
+        nodes[nodeIndex].count = count;
+    };
+    if (count <= 1) {
+        makeLeaf();
+        return;
+    }
+
+    BuildBins bins;
+    bins.Reset(BinCountFor(count));
+    BinRange(ctx, first, count, cbox, bins);
+    const BuildSplit split = FindSplit(bins, cbox);
+
+    // 叶子代价 = 图元数；切分代价 = 1 次节点遍历 + 两侧按面积比例的图元数
+    const float area = box.Area();
+    const float splitCost = 1.0f + (area > 0.0f ? split.cost / area : 0.0f);
+    if (count <= CBlackHole_BVHBuilder::maxLeafSize && (split.axis < 0 || (float)count <= splitCost)) {
+        makeLeaf();
+        return;
+    }
+
+    int mid;
+    BuildBox leftBox, rightBox, leftCBox, rightCBox;
+    if (split.axis >= 0) {
+        // 原地划分，顺带统计两侧质心范围；换到 i 处的图元下一轮再判断
+        leftCBox.Reset();
+        rightCBox.Reset();
+        int i = first, j = first + count - 1;
+        while (i <= j) {
+            const int p = ctx.order[i];
+            const float* c = &ctx.cent[3 * p];
+            if (GoesLeft(ctx, p, split)) {
+                leftCBox.Grow(c, c);
+                i++;
+            }
+            else {
+                rightCBox.Grow(c, c);
+                ctx.order[i] = ctx.order[j];
+                ctx.order[j--] = p;
+            }
+        }
+        mid = i;
+        leftBox = split.leftBox;
+        rightBox = split.rightBox;
+    }
+    else {
+        // 质心全部重合，按下标对半分
+        mid = first + count / 2;
+        MeasureRange(ctx, first, mid - first, leftBox, leftCBox);
+        MeasureRange(ctx, mid, first + count - mid, rightBox, rightCBox);
+    }
+
+    const int left = (int)nodes.size();
+    nodes.emplace_back();
+    nodes.emplace_back();
+    nodes[nodeIndex].leftFirst = left;
+    nodes[nodeIndex].count = 0;
+    BuildSubtree(ctx, nodes, left, first, mid - first, leftBox, leftCBox, depth + 1, maxDepth);
+    BuildSubtree(ctx, nodes, left + 1, mid, first + count - mid, rightBox, rightCBox, depth + 1, maxDepth);
+}
+
+// ==========================================
+// 并行顶层
+
+struct BuildTask {
+    int node;
+    int first;
+    int count;
+    int depth;
+};
+
+// 一个大节点：并行量包围盒、并行分箱、并行稳定划分，返回切分位置
+static int SplitParallel(const BuildContext& ctx, CBlackHole_ThreadPool& pool, const BuildTask& t, BVHNode& node) {
+    const int chunks = (t.count + kChunk - 1) / kChunk;
+    auto chunkRange = [&](int c, int& first, int& count) {
+        first = t.first + c * kChunk;
+        count = (c == chunks - 1) ? t.first + t.count - first : kChunk;
+    };
+
+    // 1. 包围盒
+    std::vector<BuildBox> boxes(chunks), cboxes(chunks);
+    pool.ParallelFor(chunks, [&](int c) {
+        int first, count;
+        chunkRange(c, first, count);
+        MeasureRange(ctx, first, count, boxes[c], cboxes[c]);
+    });
+    BuildBox box, cbox;
+    box.Reset();
+    cbox.Reset();
+    for (int c = 0; c < chunks; ++c) {
+        box.Grow(boxes[c]);
+        cbox.Grow(cboxes[c]);
+    }
+    for (int k = 0; k < 3; ++k) {
+        node.bmin[k] = box.mn[k];
+        node.bmax[k] = box.mx[k];
+    }
+
+    // 2. 分箱
+    std::vector<BuildBins> bins(chunks);
+    pool.ParallelFor(chunks, [&](int c) {
+        int first, count;
+        chunkRange(c, first, count);
+        bins[c].Reset(kBins);
+        BinRange(ctx, first, count, cbox, bins[c]);
+    });
+    for (int c = 1; c < chunks; ++c) bins[0].Merge(bins[c]);
+    const BuildSplit split = FindSplit(bins[0], cbox);
+    if (split.axis < 0) return t.first + t.count / 2;
+
+    // 3. 稳定划分：各块先数左侧个数，前缀和确定写入位置，再分散写入暂存区并拷回
+    std::vector<int> leftCount(chunks);
+    pool.ParallelFor(chunks, [&](int c) {
+        int first, count;
+        chunkRange(c, first, count);
+        int n = 0;
+        for (int i = first; i < first + count; ++i) {
+            if (GoesLeft(ctx, ctx.order[i], split)) n++;
+        }
+        leftCount[c] = n;
+    });
+    std::vector<int> leftOffset(chunks), rightOffset(chunks);
+    int totalLeft = 0;
+    for (int c = 0; c < chunks; ++c) {
+        leftOffset[c] = totalLeft;
+        totalLeft += leftCount[c];
+    }
+    int right = totalLeft;
+    for (int c = 0; c < chunks; ++c) {
+        int first, count;
+        chunkRange(c, first, count);
+        rightOffset[c] = right;
+        right += count - leftCount[c];
+    }
+
+    pool.ParallelFor(chunks, [&](int c) {
+        int first, count;
+        chunkRange(c, first, count);
+        int l = t.first + leftOffset[c], r = t.first + rightOffset[c];
+        for (int i = first; i < first + count; ++i) {
+            const int p = ctx.order[i];
+            if (GoesLeft(ctx, p, split)) ctx.tmp[l++] = p;
+            else ctx.tmp[r++] = p;
+        }
+    });
+    pool.ParallelFor(chunks, [&](int c) {
+        int first, count;
+        chunkRange(c, first, count);
+        std::copy(ctx.tmp + first, ctx.tmp + first + count, ctx.order + first);
+    });
+
+    return t.first + totalLeft;
+}
+
+void CBlackHole_BVHBuilder::Build(const std::vector<BVHPrimBounds>& prims, std::vector<BVHNode>& nodes, std::vector<int>& order,
+    bool bParallel, BVHBuildStats* pStats) {
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    nodes.clear();
+    order.clear();
+
+    const int n = (int)prims.size();
+    if (n == 0) {
+        if (pStats) *pStats = BVHBuildStats();
+        return;
+    }
+
+    CBlackHole_ThreadPool& pool = CBlackHole_ThreadPool::Shared();
+    const int threads = bParallel ? pool.ThreadCount() : 1;
+    const int tasks = (n + kChunk - 1) / kChunk;
+
+    std::vector<float> cent((size_t)3 * n);
+    order.resize(n);
+    std::iota(order.begin(), order.end(), 0);
+    auto computeCentroids = [&](int c) {
+        const int end = (c + 1) * kChunk < n ? (c + 1) * kChunk : n;
+        for (int i = c * kChunk; i < end; ++i) {
+            for (int k = 0; k < 3; ++k) cent[3 * i + k] = 0.5f * (prims[i].bmin[k] + prims[i].bmax[k]);
+        }
+    };
+    if (bParallel) pool.ParallelFor(tasks, computeCentroids);
+    else for (int c = 0; c < tasks; ++c) computeCentroids(c);
+
+    std::vector<int> tmp(bParallel ? n : 0);
+    const BuildContext ctx = { prims.data(), cent.data(), order.data(), tmp.data() };
+
+    // 1. 顶层：比阈值大的节点逐层并行切分，小于阈值的留给子树任务
+    //    阈值让每个线程分到约 4 棵子树，大小不均时也能互相补位
+    int subtreeThreshold = n / (threads * 4);
+    if (subtreeThreshold < 4096) subtreeThreshold = 4096;
+
+    nodes.reserve((size_t)2 * n);
+    nodes.emplace_back();
+    std::vector<BuildTask> frontier = { { 0, 0, n, 0 } };
+    std::vector<BuildTask> subtrees;
+    while (!frontier.empty()) {
+        std::vector<BuildTask> next;
+        for (const BuildTask& t : frontier) {
+            if (!bParallel || t.count <= subtreeThreshold) {
+                subtrees.push_back(t);
+                continue;
+            }
+            const int mid = SplitParallel(ctx, pool, t, nodes[t.node]);
+            const int left = (int)nodes.size();
+            nodes.emplace_back();
+            nodes.emplace_back();
+            nodes[t.node].leftFirst = left;
+            nodes[t.node].count = 0;
+            next.push_back({ left, t.first, mid - t.first, t.depth + 1 });
+            next.push_back({ left + 1, mid, t.first + t.count - mid, t.depth + 1 });
+        }
+        frontier.swap(next);
+    }
+
+    // 2. 子树：大的先领，每棵写进自己的节点数组
+    std::sort(subtrees.begin(), subtrees.end(), [](const BuildTask& a, const BuildTask& b) { return a.count > b.count; });
+    std::vector<std::vector<BVHNode>> local(subtrees.size());
+    std::vector<int> depth(subtrees.size(), 0);
+    auto buildOne = [&](int i) {
+        const BuildTask& t = subtrees[i];
+        local[i].reserve((size_t)2 * t.count);
+        local[i].emplace_back();
+        BuildBox box, cbox;
+        MeasureRange(ctx, t.first, t.count, box, cbox);
+        BuildSubtree(ctx, local[i], 0, t.first, t.count, box, cbox, t.depth, depth[i]);
+    };
+    if (bParallel) pool.ParallelFor((int)subtrees.size(), buildOne);
+    else for (int i = 0; i < (int)subtrees.size(); ++i) buildOne(i);
+
+    // 3. 拼接：子树根写回顶层占位节点，其余节点接在数组末尾，内部节点的子节点下标整体平移
+    for (size_t i = 0; i < subtrees.size(); ++i) {
+        const int base = (int)nodes.size() - 1;
+        auto relocate = [base](BVHNode nd) {
+            if (nd.count == 0) nd.leftFirst += base;
+            return nd;
+        };
+        nodes[subtrees[i].node] = relocate(local[i][0]);
+        for (size_t j = 1; j < local[i].size(); ++j) nodes.push_back(relocate(local[i][j]));
+        std::vector<BVHNode>().swap(local[i]);
+    }
+    nodes.shrink_to_fit();
+
+    if (pStats) {
+        pStats->buildMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+        pStats->sahCost = SAHCost(nodes);
+        pStats->nodeCount = (int)nodes.size();
+        pStats->leafCount = 0;
+        for (const BVHNode& nd : nodes) {
+            if (nd.count > 0) pStats->leafCount++;
+        }
+        pStats->maxDepth = 0;
+        for (int d : depth) {
+            if (d > pStats->maxDepth) pStats->maxDepth = d;
+        }
+        pStats->subtreeTasks = (int)subtrees.size();
+    }
+}
+
+double CBlackHole_BVHBuilder::SAHCost(const std::vector<BVHNode>& nodes) {
+    if (nodes.empty()) return 0.0;
+
+    auto area = [](const BVHNode& nd) {
+        const double dx = nd.bmax[0] - nd.bmin[0], dy = nd.bmax[1] - nd.bmin[1], dz = nd.bmax[2] - nd.bmin[2];
+        return 2.0 * (dx * dy + dy * dz + dz * dx);
+    };
+    const double rootArea = area(nodes[0]);
+    if (rootArea <= 0.0) return 0.0;
+
+    double cost = 0.0;
+    for (const BVHNode& nd : nodes) cost += area(nd) * (nd.count > 0 ? nd.count : 1);
+    return cost / rootArea;
+}
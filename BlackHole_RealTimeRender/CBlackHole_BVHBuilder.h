@@ -0,0 +1,40 @@
+﻿// CBlackHole_BVHBuilder.h
+// 分箱 SAH 的 BVH 构建器：顶层节点在线程池上并行分箱与划分，其下的子树各自作为一个任务串行构建
+#pragma once
+#include "stdafx.h"
+#include <vector>
+
+// 二叉 BVH 节点，32 字节。count > 0 为叶子，图元为 [leftFirst, leftFirst + count)；
+// 否则为内部节点，左右子节点为 leftFirst 与 leftFirst + 1
+struct BVHNode {
+    float bmin[3];  int leftFirst;
+    float bmax[3];  int count;
+};
+
+// 构建输入：每个图元的包围盒
+struct BVHPrimBounds {
+    float bmin[3];
+    float bmax[3];
+};
+
+struct BVHBuildStats {
+    double buildMs = 0.0;
+    double sahCost = 0.0;       // 以根节点面积归一化，遍历与求交代价都取 1
+    int    nodeCount = 0;
+    int    leafCount = 0;
+    int    maxDepth = 0;
+    int    subtreeTasks = 0;    // 并行构建的子树个数
+};
+
+class CBlackHole_BVHBuilder {
+public:
+    // 输出的 order[i] 为第 i 个叶子位置上的原图元编号，调用者据此重排图元
+    // bParallel 为 true 时使用共享线程池，不能在池内线程中调用
+    static void Build(const std::vector<BVHPrimBounds>& prims, std::vector<BVHNode>& nodes, std::vector<int>& order,
+        bool bParallel, BVHBuildStats* pStats = nullptr);
+
+    // 树的 SAH 代价
+    static double SAHCost(const std::vector<BVHNode>& nodes);
+
+    static const int maxLeafSize = 4;
+};
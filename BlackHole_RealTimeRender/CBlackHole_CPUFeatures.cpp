@@ -0,0 +1,33 @@
+﻿// CBlackHole_CPUFeatures.cpp
+#include "stdafx.h"
+#include <intrin.h>
+#include "CBlackHole_CPUFeatures.h"
+
+// AVX 系列指令用 VEX 编码，需要 CPU 支持且操作系统保存 YMM 寄存器
+static bool HasAVX() {
+    int info[4];
+    __cpuid(info, 1);
+    const bool bOSXSave = (info[2] & (1 << 27)) != 0;
+    const bool bAVX = (info[2] & (1 << 28)) != 0;
+    return bOSXSave && bAVX && (_xgetbv(0) & 6) == 6;
+}
+
+bool CBlackHole_CPUFeatures::HasAVX2() {
+    static const bool bAVX2 = []() {
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7 || !HasAVX()) return false;
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+    }();
+    return bAVX2;
+}
+
+bool CBlackHole_CPUFeatures::HasF16C() {
+    static const bool bF16C = []() {
+        int info[4];
+        __cpuid(info, 1);
+        return HasAVX() && (info[2] & (1 << 29)) != 0;
+    }();
+    return bF16C;
+}
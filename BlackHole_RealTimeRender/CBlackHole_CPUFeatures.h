@@ -0,0 +1,11 @@
+﻿// CBlackHole_CPUFeatures.h
+// 运行时的 CPU 特性检测，SIMD 路径统一从这里分派：支持时走向量指令，否则走标量写法
+// 结果在第一次调用时检测一次并缓存
+#pragma once
+#include "stdafx.h"
+
+class CBlackHole_CPUFeatures {
+public:
+    static bool HasAVX2();      // AVX2（宽 BVH 求交、波前积分）
+    static bool HasF16C();      // F16C 半精度转换（辅助输出与 EXR 半精度写出）
+};
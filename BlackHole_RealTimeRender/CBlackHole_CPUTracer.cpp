@@ -0,0 +1,411 @@
+﻿// CBlackHole_CPUTracer.cpp
+#include "stdafx.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "CBlackHole_CPUTracer.h"
+
+CBlackHole_CPUTracer::CBlackHole_CPUTracer(const CameraParameters& cam, int width, int height, double mass)
+    : m_camPos(cam.pos), m_width(width > 0 ? width : 1), m_height(height > 0 ? height : 1), m_mass(mass) {
+    // 与着色器相同的相机正交基
+    m_forward = cam.dir;   m_forward.Unitize();
+    m_up = cam.up;         m_up.Unitize();
+    m_right = ON_CrossProduct(m_forward, m_up);
+    m_right.Unitize();
+    m_up = ON_CrossProduct(m_right, m_forward);
+
+    m_halfFovTan = tan(cam.viewAngle * 0.5);
+    m_aspect = (double)m_width / (double)m_height;
+
+    const double camDist = ON_3dVector(m_camPos).Length();
+    m_escapeRadius = camDist + 10.0 > 30.0 ? camDist + 10.0 : 30.0;
+    m_pixelAngle = 2.0 * m_halfFovTan / m_height;
+}
+
+ON_3dVector CBlackHole_CPUTracer::PrimaryRay(double px, double py) const {
+    const double u = px / m_width * 2.0 - 1.0;
+    const double v = -((py + m_rowOffset) / m_height * 2.0 - 1.0);
+    ON_3dVector dir = m_forward + m_right * (u * m_aspect * m_halfFovTan) + m_up * (v * m_halfFovTan);
+    dir.Unitize();
+    return dir;
+}
+
+ON_3dVector CBlackHole_CPUTracer::Acceleration(const ON_3dVector& pos, const ON_3dVector& vel, double mass) {
+    const double r2 = pos * pos;
+    const double r = sqrt(r2);
+    const double r5 = r2 * r2 * r;
+    if (r5 < 0.0001) return ON_3dVector::ZeroVector;
+
+    const ON_3dVector h = ON_CrossProduct(pos, vel);
+    return -(3.0 * mass * (h * h) / r5) * pos;
+}
+
+void CBlackHole_CPUTracer::StepRK4(ON_3dVector& pos, ON_3dVector& vel, double h, double mass) {
+    const ON_3dVector kr1 = vel;
+    const ON_3dVector kv1 = Acceleration(pos, vel, mass);
+
+    const ON_3dVector v2 = vel + 0.5 * h * kv1;
+    const ON_3dVector kv2 = Acceleration(pos + 0.5 * h * kr1, v2, mass);
+
+    const ON_3dVector v3 = vel + 0.5 * h * kv2;
+    const ON_3dVector kv3 = Acceleration(pos + 0.5 * h * v2, v3, mass);
+
+    const ON_3dVector v4 = vel + h * kv3;
+    const ON_3dVector kv4 = Acceleration(pos + h * v3, v4, mass);
+
+    pos += (h / 6.0) * (kr1 + 2.0 * v2 + 2.0 * v3 + v4);
+    vel += (h / 6.0) * (kv1 + 2.0 * kv2 + 2.0 * kv3 + kv4);
+}
+
+GeodesicResult CBlackHole_CPUTracer::Trace(const ON_3dVector& rayDir, SceneQueryStats* pStats) const {
+    return TraceFrom(m_camPos, rayDir, m_mass, maxSteps, stepSize, m_escapeRadius, m_pScene, pStats, straightPixels * m_pixelAngle, m_pixelAngle);
+}
+
+// 光线方向的变化率 |dθ/ds| = |a⊥| / |v|^2 <= 3M b^2 / r^4，b 为冲击参数；
+// 沿弦 [0, L] 取离黑洞最近的 r，偏差上界为 3M b^2 L / rmin^4，位置偏差不超过它的 L / 2 倍
+double CBlackHole_CPUTracer::StraightReach(const ON_3dVector& pos, const ON_3dVector& vel, double mass, double minLength, double maxLength, double tolerance) {
+    const double speed = vel.Length();
+    if (speed <= 0.0) return 0.0;
+    const ON_3dVector dir = vel / speed;
+    const double b2 = ON_CrossProduct(pos, dir).LengthSquared();
+    const double along = pos * dir;
+
+    auto bound = [&](double L) {
+        const double s = -along < 0.0 ? 0.0 : (-along > L ? L : -along);
+        const double rmin2 = b2 + (along + s) * (along + s);
+        return 3.0 * mass * b2 * L / (rmin2 * rmin2);
+    };
+
+    if (bound(minLength) > tolerance) return 0.0;
+    double L = minLength;
+    while (L < maxLength && bound(2.0 * L) <= tolerance) L *= 2.0;
+    return L < maxLength ? L : maxLength;
+}
+
+// 初始速度为单位向量时 1/b^2 = 1/(r sinθ)^2 - 2M/r^3，θ 为射线与指向黑洞方向的夹角
+// 令 b = 3√3M 得临界角；相机在光子球以内时临界射线朝外
+void CBlackHole_CPUTracer::BuildCostModel() {
+    m_costAngle.clear();
+    m_costSteps.clear();
+
+    const double r = ON_3dVector(m_camPos).Length();
+    if (r <= 2.0 * m_mass) return;
+    ON_3dVector toward = -ON_3dVector(m_camPos) / r;
+    ON_3dVector side;
+    side.PerpendicularTo(toward);
+    side.Unitize();
+
+    const double bc2 = 27.0 * m_mass * m_mass;
+    const double s = sqrt(1.0 / (r * r / bc2 + 2.0 * m_mass / r));
+    const double thetaC = (r > 3.0 * m_mass) ? asin(s) : ON_PI - asin(s);
+
+    const int uniform = 96, logSide = 32;
+    for (int i = 0; i <= uniform; ++i) m_costAngle.push_back(ON_PI * i / uniform);
+    for (int i = 0; i < logSide; ++i) {
+        const double d = pow(10.0, -7.0 + 6.5 * i / (logSide - 1));
+        if (thetaC - d > 0.0) m_costAngle.push_back(thetaC - d);
+        if (thetaC + d < ON_PI) m_costAngle.push_back(thetaC + d);
+    }
+    m_costAngle.push_back(thetaC);
+    std::sort(m_costAngle.begin(), m_costAngle.end());
+
+    m_costSteps.reserve(m_costAngle.size());
+    for (const double theta : m_costAngle) {
+        const ON_3dVector dir = cos(theta) * toward + sin(theta) * side;
+        m_costSteps.push_back(TraceFrom(m_camPos, dir, m_mass, maxSteps, stepSize, m_escapeRadius).steps);
+    }
+}
+
+double CBlackHole_CPUTracer::PredictSteps(const ON_3dVector& rayDir) const {
+    if (m_costAngle.empty()) return maxSteps;
+
+    const double r = ON_3dVector(m_camPos).Length();
+    double c = -(ON_3dVector(m_camPos) * rayDir) / r;
+    c = c < -1.0 ? -1.0 : (c > 1.0 ? 1.0 : c);
+    const double theta = acos(c);
+
+    const size_t i = std::upper_bound(m_costAngle.begin(), m_costAngle.end(), theta) - m_costAngle.begin();
+    if (i == 0) return m_costSteps.front();
+    if (i == m_costAngle.size()) return m_costSteps.back();
+    const double t = (theta - m_costAngle[i - 1]) / (m_costAngle[i] - m_costAngle[i - 1]);
+    return m_costSteps[i - 1] + t * (m_costSteps[i] - m_costSteps[i - 1]);
+}
+
+// 位置与速度的夹角 [0, π]，轨道平面的正向取角动量方向
+static double RadialAngle(const ON_3dVector& pos, const ON_3dVector& vel) {
+    return atan2(ON_CrossProduct(pos, vel).Length(), pos * vel);
+}
+
+void CBlackHole_CPUTracer::FinishAovs(GeodesicResult& res, double sweptAngle, const ON_3dVector& startPos, const ON_3dVector& startVel,
+    const ON_3dVector& endPos, const ON_3dVector& endVel, double mass) {
+    res.halfOrbits = (int)(sweptAngle / ON_PI);
+    res.deflection = sweptAngle + RadialAngle(endPos, endVel) - RadialAngle(startPos, startVel);
+
+    // 静止光源与静止观察者：1 + z = sqrt((1 - rs/r观察) / (1 - rs/r光源))，天空光源在无穷远
+    const double rs = 2.0 * mass;
+    const double rObs = startPos.Length();
+    res.redshift = 0.0;
+    if (res.captured || rObs <= rs) return;
+    const double rEmit = res.hitSurface ? endPos.Length() : 0.0;
+    if (res.hitSurface && rEmit <= rs) return;
+    res.redshift = sqrt((1.0 - rs / rObs) / (res.hitSurface ? 1.0 - rs / rEmit : 1.0)) - 1.0;
+}
+
+// 线段 a -> b 与场景求交，命中时填写结果；法线翻到线段来的一侧
+static bool HitScene(const CBlackHole_Scene& scene, const ON_3dPoint& a, const ON_3dPoint& b, GeodesicResult& res, SceneQueryStats* pStats, double footprint) {
+    SceneHit hit;
+    if (!scene.IntersectSegment(a, b, hit, pStats, footprint)) return false;
+
+    const ON_3dVector seg = b - a;
+    res.hitSurface = true;
+    res.hitPoint = a + hit.t * seg;
+    res.hitNormal = scene.Normal(hit);
+    if (res.hitNormal * seg > 0.0) res.hitNormal = -res.hitNormal;
+    res.hitObject = scene.Object(hit);
+    res.exitDir = ON_3dVector::ZeroVector;
+    return true;
+}
+
+GeodesicResult CBlackHole_CPUTracer::TraceFrom(const ON_3dPoint& origin, const ON_3dVector& dir, double mass,
+    int maxSteps, double stepSize, double escapeRadius, const CBlackHole_Scene* pScene, SceneQueryStats* pStats, double straightTolerance,
+    double footprintAngle) {
+    GeodesicResult res;
+    ON_3dVector pos(origin);
+    ON_3dVector vel = dir;
+    const double rs = 2.0 * mass;
+
+    // 相邻光线：方向朝远离黑洞的一侧偏开 footprintAngle，与主光线用同样的步长积分
+    // 偏折只发生在轨道平面内，这个方向上的压缩（次级像被压扁的方向）最强
+    bool bNeighbor = pScene && footprintAngle > 0.0 && pScene->HasLods();
+    ON_3dVector pos2(origin), vel2 = dir;
+    if (bNeighbor) {
+        ON_3dVector d = dir;
+        d.Unitize();
+        ON_3dVector side = pos - (pos * d) * d;
+        if (!side.Unitize()) {      // 径向光线不偏折，任取一个垂直方向
+            side.PerpendicularTo(d);
+            side.Unitize();
+        }
+        vel2 = (d + footprintAngle * side) * dir.Length();
+    }
+    // 相邻光线相对主光线的横向偏移，在两端点之间变号说明中途聚焦，按 0 处理
+    auto offset = [&]() {
+        ON_3dVector d = vel;
+        d.Unitize();
+        const ON_3dVector dp = pos2 - pos;
+        return dp - (dp * d) * d;
+    };
+    ON_3dVector side0 = ON_3dVector::ZeroVector;
+    auto footprint = [&](const ON_3dVector& side1) {
+        if (side0 * side1 <= 0.0) return 0.0;
+        const double l0 = side0.Length(), l1 = side1.Length();
+        return l0 < l1 ? l0 : l1;
+    };
+
+    // 辅助输出：仿射长度与扫过的角度。角动量 h = pos × vel 守恒，dφ/dλ = |h| / r^2 按梯形积分
+    const ON_3dVector startPos(pos), startVel(vel);
+    double affine = 0.0, swept = 0.0;
+    const double halfStepH = 0.5 * stepSize * ON_CrossProduct(pos, vel).Length();
+    double invR2 = 1.0 / (pos * pos);
+
+    for (int i = 0; i < maxSteps; ++i) {
+        const ON_3dPoint prev(pos);
+        const double affinePrev = affine, sweptPrev = swept;
+        res.steps = i + 1;
+        if (bNeighbor) side0 = offset();
+
+        // 离黑洞足够远时一次跳过至少 4 步，整段作为一条长线段求交；速度保持不变
+        const double reach = (pScene && straightTolerance > 0.0)
+            ? StraightReach(pos, vel, mass, 4.0 * stepSize, 2.0 * escapeRadius, straightTolerance) : 0.0;
+        if (reach > 0.0) {
+            ON_3dVector d = vel;
+            d.Unitize();
+            pos += reach * d;
+            if (bNeighbor) pos2 += (reach / vel.Length()) * vel2;
+            if (pStats) pStats->straightLength += reach;
+            affine += reach / vel.Length();
+            swept += atan2(ON_CrossProduct(ON_3dVector(prev), pos).Length(), ON_3dVector(prev) * pos);
+            invR2 = 1.0 / (pos * pos);
+        }
+        else {
+            StepRK4(pos, vel, stepSize, mass);
+            if (bNeighbor) StepRK4(pos2, vel2, stepSize, mass);
+            if (pStats) pStats->curvedLength += (ON_3dPoint(pos) - prev).Length();
+            affine += stepSize;
+            const double invR2Next = 1.0 / (pos * pos);
+            swept += halfStepH * (invR2 + invR2Next);
+            invR2 = invR2Next;
+        }
+        // 相邻光线落入视界后不再有意义，此后都用原始网格
+        if (bNeighbor && pos2.Length() < rs) bNeighbor = false;
+
+        // 这一步走过的线段先与场景求交，挡在视界前面的物体优先
+        if (pScene && HitScene(*pScene, prev, ON_3dPoint(pos), res, pStats, bNeighbor ? footprint(offset()) : 0.0)) {
+            const double segment = (ON_3dPoint(pos) - prev).Length();
+            const double t = segment > 0.0 ? (res.hitPoint - prev).Length() / segment : 0.0;
+            res.affineLength = affinePrev + t * (affine - affinePrev);
+            FinishAovs(res, sweptPrev + t * (swept - sweptPrev), startPos, startVel, ON_3dVector(res.hitPoint), vel, mass);
+            return res;
+        }
+
+        const double r = pos.Length();
+
+        // 条件 A：撞击视界
+        if (r < rs) {
+            res.captured = true;
+            res.exitDir = ON_3dVector::ZeroVector;
+            res.affineLength = affine;
+            FinishAovs(res, swept, startPos, startVel, pos, vel, mass);
+            return res;
+        }
+        // 条件 B：逃逸
+        if (r > escapeRadius) break;
+    }
+
+    res.exitDir = vel;
+    res.exitDir.Unitize();
+    res.affineLength = affine;
+
+    // 逃逸半径之外时空近似平直，剩下的路程用一条直线覆盖到场景包围盒之外
+    if (pScene) {
+        const ON_BoundingBox box = pScene->BoundingBox();
+        const double reach = (box.Center() - ON_3dPoint(pos)).Length() + box.Diagonal().Length();
+        if (pStats) pStats->straightLength += reach;
+        double width = 0.0;
+        if (bNeighbor) {
+            side0 = offset();
+            const ON_3dVector dp = pos2 + (reach / vel.Length()) * vel2 - (pos + reach * res.exitDir);
+            width = footprint(dp - (dp * res.exitDir) * res.exitDir);
+        }
+        if (HitScene(*pScene, ON_3dPoint(pos), ON_3dPoint(pos) + reach * res.exitDir, res, pStats, width)) {
+            const ON_3dVector hit(res.hitPoint);
+            res.affineLength += (hit - pos).Length() / vel.Length();
+            FinishAovs(res, swept + atan2(ON_CrossProduct(pos, hit).Length(), pos * hit), startPos, startVel, hit, vel, mass);
+            return res;
+        }
+    }
+    FinishAovs(res, swept, startPos, startVel, pos, vel, mass);
+    return res;
+}
+
+// ==========================================
+// 天空着色
+
+static uint32_t HashUint(uint32_t v) {
+    const uint32_t state = v * 747796405u + 2891336453u;
+    const uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+static double HashToFloat(uint32_t h) {
+    return (h & 0x00FFFFFF) / 16777216.0;
+}
+
+static void DirToCube(const ON_3dVector& d, uint32_t& face, double& s, double& t) {
+    const double ax = fabs(d.x), ay = fabs(d.y), az = fabs(d.z);
+    if (ax >= ay && ax >= az) { face = d.x > 0 ? 0 : 1; s = d.y / ax; t = d.z / ax; }
+    else if (ay >= az)        { face = d.y > 0 ? 2 : 3; s = d.x / ay; t = d.z / ay; }
+    else                      { face = d.z > 0 ? 4 : 5; s = d.x / az; t = d.y / az; }
+}
+
+static ON_3dVector CubeToDir(uint32_t face, double s, double t) {
+    const double sign = (face & 1) ? -1.0 : 1.0;
+    ON_3dVector d;
+    if (face < 2)      d.Set(sign, s, t);
+    else if (face < 4) d.Set(s, sign, t);
+    else               d.Set(s, t, sign);
+    d.Unitize();
+    return d;
+}
+
+ON_3dVector CBlackHole_CPUTracer::BlackbodyColor(double T) {
+    static const double lambda[3] = { 610e-9, 550e-9, 465e-9 };
+    const double c2 = 1.4388e-2;
+    double B[3];
+    for (int i = 0; i < 3; ++i) {
+        B[i] = 1.0 / (pow(lambda[i], 5.0) * (exp(c2 / (lambda[i] * T)) - 1.0));
+    }
+    double m = B[0];
+    if (B[1] > m) m = B[1];
+    if (B[2] > m) m = B[2];
+    return ON_3dVector(B[0] / m, B[1] / m, B[2] / m);
+}
+
+ON_3dVector CBlackHole_CPUTracer::SampleSkyImage(const SkyImage& image, const ON_3dVector& dir) {
+    if (image.width <= 0 || image.height <= 0) return ON_3dVector::ZeroVector;
+
+    double z = dir.z;
+    z = z > 1.0 ? 1.0 : (z < -1.0 ? -1.0 : z);
+    const double u = 0.5 + atan2(dir.y, dir.x) / (2.0 * ON_PI);
+    const double v = 0.5 - asin(z) / ON_PI;
+
+    // 纹素中心对齐，和 D3D 线性采样一致
+    const double fx = u * image.width - 0.5;
+    const double fy = v * image.height - 0.5;
+    const int x0 = (int)floor(fx), y0 = (int)floor(fy);
+    const double tx = fx - x0, ty = fy - y0;
+
+    auto texel = [&](int x, int y) {
+        x = ((x % image.width) + image.width) % image.width;
+        y = y < 0 ? 0 : (y >= image.height ? image.height - 1 : y);
+        const float* p = &image.rgba[((size_t)y * image.width + x) * 4];
+        return ON_3dVector(p[0], p[1], p[2]);
+    };
+
+    const ON_3dVector c = (1.0 - ty) * ((1.0 - tx) * texel(x0, y0) + tx * texel(x0 + 1, y0)) +
+        ty * ((1.0 - tx) * texel(x0, y0 + 1) + tx * texel(x0 + 1, y0 + 1));
+    return 1.2 * c;     // 与着色器中贴图天空的增益一致
+}
+
+double CBlackHole_CPUTracer::Footprint(const ON_3dVector& dir, const ON_3dVector& nx, const ON_3dVector& ny, double pixelAngle) {
+    const double dx = (nx * nx) > 0.5 ? (dir - nx).Length() : pixelAngle;
+    const double dy = (ny * ny) > 0.5 ? (dir - ny).Length() : pixelAngle;
+    return 0.5 * (dx > dy ? dx : dy);
+}
+
+ON_3dVector CBlackHole_CPUTracer::ProceduralStars(const ON_3dVector& dir, double footprint, double pixelAngle, const SkySettings& sky) {
+    uint32_t face;
+    double s, t;
+    DirToCube(dir, face, s, t);
+
+    const double grid = sky.starGrid;
+    const int cx = (int)floor((s * 0.5 + 0.5) * grid);
+    const int cy = (int)floor((t * 0.5 + 0.5) * grid);
+    const int gridInt = (int)grid;
+    const double cellAngle = 2.0 / grid;
+
+    const double sigma = footprint > 1e-6 ? footprint : 1e-6;
+    double gain = (pixelAngle * pixelAngle) / (sigma * sigma);
+    gain = gain < 1.0 ? 1.0 : (gain > 256.0 ? 256.0 : gain);
+
+    const double baseFlux = 0.002;
+    ON_3dVector sum = ON_3dVector::ZeroVector;
+    for (int j = -1; j <= 1; ++j) {
+        for (int i = -1; i <= 1; ++i) {
+            const int x = cx + i, y = cy + j;
+            if (x < 0 || y < 0 || x >= gridInt || y >= gridInt) continue;
+
+            const uint32_t h = HashUint(sky.starSeed ^ HashUint(face * 0x9E3779B9u ^ HashUint((uint32_t)x + ((uint32_t)y << 16))));
+            double u0 = HashToFloat(h);
+            if (u0 < 1e-4) u0 = 1e-4;
+            const double u1 = HashToFloat(HashUint(h + 1));
+            const double u2 = HashToFloat(HashUint(h + 2));
+            const double u3 = HashToFloat(HashUint(h + 3));
+
+            const double ss = ((x + 0.1 + 0.8 * u1) / grid) * 2.0 - 1.0;
+            const double st = ((y + 0.1 + 0.8 * u2) / grid) * 2.0 - 1.0;
+            const ON_3dVector starDir = CubeToDir(face, ss, st);
+
+            const double theta = (dir - starDir).Length();
+            const double w = exp(-0.5 * theta * theta / (sigma * sigma));
+            const double flux = baseFlux * pow(u0, -0.8);
+            sum += (flux * w) * BlackbodyColor(2500.0 + 27500.0 * u3 * u3 * u3);
+        }
+    }
+
+    const double meanScale = baseFlux * 5.0 * 2.0 * ON_PI * (pixelAngle * pixelAngle) / (cellAngle * cellAngle);
+    const ON_3dVector mean(0.9 * meanScale, 0.9 * meanScale, meanScale);
+    double blend = sigma / cellAngle - 0.5;
+    blend = blend < 0.0 ? 0.0 : (blend > 1.0 ? 1.0 : blend);
+    return sky.starBrightness * ((1.0 - blend) * gain * sum + blend * mean);
+}
@@ -0,0 +1,110 @@
+﻿// CBlackHole_CPUTracer.h
+// CPU 端测地线追踪器：与 BlackHole_Kernel.hlsl 使用同一套相机模型与 RK4 积分，供离线渲染使用
+#pragma once
+#include "stdafx.h"
+#include <vector>
+#include "CBlackHole_Common.h"
+#include "CBlackHole_Scene.h"
+
+// 一根光线的追踪结果
+struct GeodesicResult {
+    bool        captured = false;   // 落入视界
+    ON_3dVector exitDir;            // 逃逸后的出射方向（单位向量），被吞噬时为零向量
+    int         steps = 0;          // 实际积分步数
+
+    // 命中场景网格（弯曲路径上的任意一段，因此也包括绕过黑洞的次级像）
+    bool        hitSurface = false;
+    ON_3dPoint  hitPoint;
+    ON_3dVector hitNormal;          // 朝向入射光线一侧
+    int         hitObject = -1;
+
+    // 辅助输出（AOV），由积分状态顺带算出，终点为命中点、视界或逃逸半径
+    double      affineLength = 0.0; // 仿射参数长度：RK4 步长之和加上直线段按速度折算的长度
+    double      deflection = 0.0;   // 传播方向总共转过的角度（弧度），绕圈的光线可超过 π
+    int         halfOrbits = 0;     // 位置矢量在轨道平面内扫过的半圈数
+    double      redshift = 0.0;     // 静止光源到相机处静止观察者的引力红移 z，天空为负（蓝移），被吞噬时为 0
+};
+
+class CBlackHole_CPUTracer {
+public:
+    CBlackHole_CPUTracer(const CameraParameters& cam, int width, int height, double mass);
+
+    // ==========================================
+    // 1. 光线生成与积分
+
+    // 像素坐标 (可带小数偏移) -> 相机射线方向，和着色器的 uv 约定一致
+    ON_3dVector PrimaryRay(double px, double py) const;
+
+    // 分条渲染时 py 从这一条的第一行算起，这里给出它在整幅图中的行号
+    void SetRowOffset(int rows) { m_rowOffset = rows; }
+
+    // 从相机出发积分到逃逸、被吞噬或命中场景
+    GeodesicResult Trace(const ON_3dVector& rayDir, SceneQueryStats* pStats = nullptr) const;
+
+    // 从任意点出发积分（光照探针等使用），escapeRadius 之外视为逃逸
+    // pScene 非空时每个 RK4 步作为线段与场景求交，逃逸后沿出射方向再做一次直线求交
+    // straightTolerance > 0 时，方向偏差上界不超过它（弧度）的一段路程直接按一条直线求交，不再逐步积分
+    // footprintAngle > 0 且场景有简化级别时，同时积分一根在轨道平面内偏开这个角度的相邻光线，
+    // 两者的横向间距即光线在该处覆盖的宽度；次级像被压缩时间距变大，改在简化网格上求交
+    static GeodesicResult TraceFrom(const ON_3dPoint& origin, const ON_3dVector& dir, double mass,
+        int maxSteps, double stepSize, double escapeRadius,
+        const CBlackHole_Scene* pScene = nullptr, SceneQueryStats* pStats = nullptr, double straightTolerance = 0.0,
+        double footprintAngle = 0.0);
+
+    // 沿当前方向直线前进多远时弯曲仍可忽略：返回方向偏差上界不超过 tolerance 的最大距离，不值得跳过时返回 0
+    static double StraightReach(const ON_3dVector& pos, const ON_3dVector& vel, double mass, double minLength, double maxLength, double tolerance);
+
+    // 场景为空或未设置时只追踪天空
+    void SetScene(const CBlackHole_Scene* pScene) { m_pScene = (pScene && !pScene->IsEmpty()) ? pScene : nullptr; }
+
+    // 由扫过的角度与起止状态补全偏折角、半圈数与红移；res 的 captured / hitSurface 须已确定
+    // 平面运动中方向角 = 位置角 + 速度与径向的夹角，所以偏折角 = 扫过的角度 + 终点夹角 - 起点夹角
+    static void FinishAovs(GeodesicResult& res, double sweptAngle, const ON_3dVector& startPos, const ON_3dVector& startVel,
+        const ON_3dVector& endPos, const ON_3dVector& endVel, double mass);
+
+    static ON_3dVector Acceleration(const ON_3dVector& pos, const ON_3dVector& vel, double mass);
+    static void StepRK4(ON_3dVector& pos, ON_3dVector& vel, double h, double mass);
+
+    // 无透镜时相邻像素的夹角（弧度）
+    double PixelAngle() const { return m_pixelAngle; }
+
+    const ON_3dPoint& CameraPosition() const { return m_camPos; }
+    double Mass() const { return m_mass; }
+    double EscapeRadius() const { return m_escapeRadius; }
+
+    // 代价预测：不计场景时，相机射线的积分步数只取决于它与黑洞方向的夹角
+    // 按夹角追踪一组光线建表，临界角（冲击参数等于光子球临界值 3√3M）两侧按对数加密；改过步长后重建
+    void BuildCostModel();
+    double PredictSteps(const ON_3dVector& rayDir) const;   // 未建表时返回 maxSteps
+
+    // ==========================================
+    // 2. 天空着色
+
+    // 程序星空的 CPU 版本，与着色器中的 SampleStars 逐项对应
+    static ON_3dVector ProceduralStars(const ON_3dVector& dir, double footprint, double pixelAngle, const SkySettings& sky);
+    static ON_3dVector BlackbodyColor(double T);
+
+    // 等距柱状天空图的双线性采样，uv 约定与着色器相同（经度环绕，纬度夹紧）
+    static ON_3dVector SampleSkyImage(const SkyImage& image, const ON_3dVector& dir);
+
+    // 由相邻像素的出射方向估计本像素在天球上的覆盖半径；邻居无效（零向量）时退回无透镜尺度
+    static double Footprint(const ON_3dVector& dir, const ON_3dVector& nx, const ON_3dVector& ny, double pixelAngle);
+
+    int    maxSteps = 2000;
+    double stepSize = 0.1;
+    double straightPixels = 0.25;   // 有场景时允许直线近似的方向偏差（像素），0 表示全程逐步积分
+
+private:
+    ON_3dPoint  m_camPos;
+    ON_3dVector m_forward, m_right, m_up;
+    double      m_halfFovTan = 0.0;
+    double      m_aspect = 1.0;
+    int         m_width = 1, m_height = 1;
+    int         m_rowOffset = 0;
+    double      m_mass = 1.0;
+    double      m_escapeRadius = 30.0;
+    double      m_pixelAngle = 0.0;
+    const CBlackHole_Scene* m_pScene = nullptr;
+
+    std::vector<double> m_costAngle, m_costSteps;   // 按夹角升序
+};
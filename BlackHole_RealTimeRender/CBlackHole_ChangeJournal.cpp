@@ -0,0 +1,85 @@
+﻿// CBlackHole_ChangeJournal.cpp
+#include "stdafx.h"
+#include <cstring>
+#include <thread>
+#include "CBlackHole_ChangeJournal.h"
+
+CBlackHole_ChangeJournal::CBlackHole_ChangeJournal(int capacityLog2)
+    : m_slots(new Slot[(size_t)1 << capacityLog2]), m_mask(((uint64_t)1 << capacityLog2) - 1) {
+    for (uint64_t i = 0; i <= m_mask; ++i) {
+        for (auto& w : m_slots[i].words) w.store(0, std::memory_order_relaxed);
+    }
+}
+
+static void Pack(const SceneChange& change, uint64_t words[4]) {
+    memcpy(words, &change.object, sizeof(ON_UUID));
+    words[2] = (uint64_t)(uint32_t)change.index | (uint64_t)change.kind << 32;
+    words[3] = (uint64_t)(uint32_t)change.oldValue | (uint64_t)(uint32_t)change.newValue << 32;
+}
+
+static SceneChange Unpack(const uint64_t words[4]) {
+    SceneChange change;
+    memcpy(&change.object, words, sizeof(ON_UUID));
+    change.index = (int)(uint32_t)words[2];
+    change.kind = (SceneChangeKind)(words[2] >> 32);
+    change.oldValue = (int)(uint32_t)words[3];
+    change.newValue = (int)(uint32_t)(words[3] >> 32);
+    return change;
+}
+
+void CBlackHole_ChangeJournal::Push(const SceneChange& change) {
+    uint64_t words[4];
+    Pack(change, words);
+
+    const uint64_t p = m_head.fetch_add(1, std::memory_order_acq_rel);
+    Slot& slot = m_slots[p & m_mask];
+
+    // 占住槽位：更新的写入者已经占过时放弃（读者会发现这条丢了）；一圈之前的写入者没写完时等它
+    uint64_t s = slot.seq.load(std::memory_order_acquire);
+    for (;;) {
+        if (s >= 2 * p + 1) return;
+        if (s & 1) {
+            std::this_thread::yield();
+            s = slot.seq.load(std::memory_order_acquire);
+            continue;
+        }
+        if (slot.seq.compare_exchange_weak(s, 2 * p + 1, std::memory_order_acq_rel)) break;
+    }
+
+    std::atomic_thread_fence(std::memory_order_release);
+    for (int k = 0; k < 4; ++k) slot.words[k].store(words[k], std::memory_order_relaxed);
+    slot.seq.store(2 * p + 2, std::memory_order_release);
+}
+
+void CBlackHole_ChangeJournal::PushRebuild() {
+    Push(SceneChange());
+}
+
+bool CBlackHole_ChangeJournal::Drain(uint64_t& cursor, std::vector<SceneChange>& out) const {
+    const uint64_t head = Head();
+    if (head - cursor > m_mask + 1) {
+        cursor = head;
+        m_overwritten++;
+        return false;
+    }
+
+    for (; cursor < head; ++cursor) {
+        const Slot& slot = m_slots[cursor & m_mask];
+        const uint64_t s = slot.seq.load(std::memory_order_acquire);
+        if (s < 2 * cursor + 2) break;        // 还没写完，下次再读
+        if (s == 2 * cursor + 2) {
+            uint64_t words[4];
+            for (int k = 0; k < 4; ++k) words[k] = slot.words[k].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) == s) {
+                out.push_back(Unpack(words));
+                continue;
+            }
+        }
+        // 读之前或读的过程中被下一圈覆盖了
+        cursor = Head();
+        m_overwritten++;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,82 @@
+﻿// CBlackHole_ChangeJournal.h
+// 场景变化日志：事件回调把每个变化写成一条带类型的记录，渲染端各自记住读到的位置，按需增量取出
+// 有界环形缓冲，写入与读取都不加锁；读者落后超过容量时记录被覆盖，读者据此改为整体重建
+#pragma once
+#include "stdafx.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+enum class SceneChangeKind : unsigned char {
+    Rebuild = 0,        // 无法归到具体物体的变化（新文档、图层显隐、块定义修改等），消费者应整体重建
+
+    // 物体记录：object 为物体 id
+    MeshAdded,
+    MeshDeleted,
+    MeshModified,
+    ObjectMaterial,     // oldValue / newValue 为物体的材质编号
+    ObjectLayer,        // oldValue / newValue 为物体的图层编号
+    ObjectAttributes,   // 其他属性（显示模式等），物体的网格需要重新确认
+
+    // 表记录：index 为表中的编号
+    MaterialAdded,
+    MaterialDeleted,
+    MaterialModified,
+    LayerMaterial,      // 图层的渲染材质改变，oldValue / newValue 为材质编号
+    LightAdded,
+    LightDeleted,
+    LightModified,
+};
+
+struct SceneChange {
+    SceneChangeKind kind = SceneChangeKind::Rebuild;
+    ON_UUID         object = ON_nil_uuid;
+    int             index = -1;
+    int             oldValue = -1;
+    int             newValue = -1;
+
+    bool IsLighting() const { return kind == SceneChangeKind::Rebuild || kind >= SceneChangeKind::LightAdded; }
+    bool IsGeometry() const { return kind < SceneChangeKind::LightAdded; }     // 含材质与图层
+};
+
+class CBlackHole_ChangeJournal {
+public:
+    // 容量为 2 的 capacityLog2 次方条记录
+    explicit CBlackHole_ChangeJournal(int capacityLog2 = 12);
+
+    CBlackHole_ChangeJournal(const CBlackHole_ChangeJournal&) = delete;
+    CBlackHole_ChangeJournal& operator=(const CBlackHole_ChangeJournal&) = delete;
+
+    // ==========================================
+    // 1. 写入（任意线程）
+
+    // 写满后覆盖最旧的记录；只有在一整圈之前的写入者还没写完时才会短暂等待它
+    void Push(const SceneChange& change);
+    void PushRebuild();
+
+    // ==========================================
+    // 2. 读取（任意线程，每个消费者一个位置）
+
+    // 下一条记录的序号；新消费者从这里开始读
+    uint64_t Head() const { return m_head.load(std::memory_order_acquire); }
+
+    // 把 cursor 之后已写完的记录追加到 out，cursor 前进到第一条还没写完的记录
+    // 需要的记录已被覆盖时返回 false，cursor 跳到 Head()，消费者应按整体重建处理
+    bool Drain(uint64_t& cursor, std::vector<SceneChange>& out) const;
+
+    uint64_t Overwritten() const { return m_overwritten; }     // 被读者发现已覆盖的次数
+
+private:
+    // 每条记录打包成 4 个原子字，读者按序号校验后再确认一次，读到一半被覆盖也能发现
+    // seq：2p + 1 表示第 p 条正在写，2p + 2 表示已写完
+    struct Slot {
+        std::atomic<uint64_t> seq{ 0 };
+        std::atomic<uint64_t> words[4];
+    };
+
+    std::unique_ptr<Slot[]>       m_slots;
+    uint64_t                      m_mask;
+    std::atomic<uint64_t>         m_head{ 0 };
+    mutable std::atomic<uint64_t> m_overwritten{ 0 };
+};
@@ -0,0 +1,373 @@
+﻿// CBlackHole_Checkpoint.cpp
+#include "stdafx.h"
+#include <cstring>
+#include <io.h>
+#include "CBlackHole_Checkpoint.h"
+#include "CBlackHole_AdaptiveSampler.h"
+#include "CBlackHole_ImageWriter.h"
+#include "CBlackHole_ThreadPool.h"
+
+namespace {
+
+const char     kMagic[8] = { 'B', 'H', 'C', 'K', 'P', 'T', '0', '1' };
+const uint32_t kVersion = 2;                // 记录布局变化时加一，旧文件作废
+const uint32_t kRecordMagic = 0x52434842;   // "BHCR"
+const size_t   kMaxQueued = 2;
+const unsigned long long kStaleTime = 7ull * 24 * 3600 * 10000000;    // 一周，FILETIME 以 100 ns 为单位
+
+// 文件头之后是一条条记录：记录头 + 压缩数据
+struct FileHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t bytesPerPixel;
+    uint64_t key;
+    int32_t  width;
+    int32_t  height;
+};
+
+struct RecordHeader {
+    uint32_t magic;
+    int32_t  y;
+    int32_t  rows;
+    uint32_t bytes;     // 压缩后的字节数
+    uint32_t crc;       // 记录头（crc 记为 0）连同压缩数据的 CRC32
+};
+
+uint32_t RecordCrc(RecordHeader header, const uint8_t* data) {
+    header.crc = 0;
+    return ON_CRC32(ON_CRC32(0, sizeof(header), &header), header.bytes, data);
+}
+
+// 原始数据补齐到 4 字节的整数倍，按字节平面重排
+size_t RawBytes(int width, int rows) {
+    const size_t bytes = (size_t)width * rows * CBlackHole_Checkpoint::BytesPerPixel();
+    return (bytes + 3) & ~(size_t)3;
+}
+
+// 按 4 字节字内的位置拆成四个字节平面：浮点数的符号与指数字节集中在一起，zlib 压得小得多
+void Shuffle(const uint8_t* in, size_t bytes, uint8_t* out) {
+    const size_t words = bytes / 4;
+    for (size_t i = 0; i < words; ++i) {
+        for (int b = 0; b < 4; ++b) out[b * words + i] = in[i * 4 + b];
+    }
+}
+
+void Unshuffle(const uint8_t* in, size_t bytes, uint8_t* out) {
+    const size_t words = bytes / 4;
+    for (size_t i = 0; i < words; ++i) {
+        for (int b = 0; b < 4; ++b) out[i * 4 + b] = in[b * words + i];
+    }
+}
+
+bool Deflate(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    out.clear();
+    ON_CompressStream stream;
+    stream.SetCallback([](void* context, ON__UINT32 n, const void* p) -> bool {
+        std::vector<uint8_t>* pOut = (std::vector<uint8_t>*)context;
+        pOut->insert(pOut->end(), (const uint8_t*)p, (const uint8_t*)p + n);
+        return true;
+    }, &out);
+    return stream.Begin() && stream.In(size, data) && stream.End();
+}
+
+bool Inflate(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    out.clear();
+    ON_UncompressStream stream;
+    stream.SetCallback([](void* context, ON__UINT32 n, const void* p) -> bool {
+        std::vector<uint8_t>* pOut = (std::vector<uint8_t>*)context;
+        pOut->insert(pOut->end(), (const uint8_t*)p, (const uint8_t*)p + n);
+        return true;
+    }, &out);
+    return stream.Begin() && stream.In(size, data) && stream.End();
+}
+
+}  // namespace
+
+CBlackHole_Checkpoint::CBlackHole_Checkpoint(CBlackHole_ThreadPool& pool) : m_pool(pool) {
+}
+
+CBlackHole_Checkpoint::~CBlackHole_Checkpoint() {
+    Close();
+}
+
+uint64_t CBlackHole_Checkpoint::BytesPerPixel() {
+    return 4 * sizeof(float) + sizeof(float) + sizeof(PixelClass) + CBlackHole_AovBuffer::BytesPerPixel();
+}
+
+// ==========================================
+// 打开与读回
+
+std::wstring CBlackHole_Checkpoint::Directory() {
+    wchar_t temp[MAX_PATH + 1] = {};
+    if (0 == ::GetTempPathW(MAX_PATH + 1, temp)) return std::wstring();
+
+    std::wstring dir = std::wstring(temp) + L"BlackHole_RealTimeRender\\";
+    ::CreateDirectoryW(dir.c_str(), nullptr);
+    dir += L"Checkpoints\\";
+    ::CreateDirectoryW(dir.c_str(), nullptr);
+    return dir;
+}
+
+void CBlackHole_Checkpoint::RemoveStale(const std::wstring& dir, const std::wstring& keep) {
+    FILETIME now;
+    ::GetSystemTimeAsFileTime(&now);
+    const unsigned long long nowTime = ((unsigned long long)now.dwHighDateTime << 32) | now.dwLowDateTime;
+
+    WIN32_FIND_DATAW fd;
+    HANDLE hFind = ::FindFirstFileW((dir + L"*.bhckpt").c_str(), &fd);
+    if (INVALID_HANDLE_VALUE == hFind) return;
+    do {
+        const unsigned long long time = ((unsigned long long)fd.ftLastWriteTime.dwHighDateTime << 32) | fd.ftLastWriteTime.dwLowDateTime;
+        if (keep != fd.cFileName && time + kStaleTime < nowTime) ::DeleteFileW((dir + fd.cFileName).c_str());
+    } while (::FindNextFileW(hFind, &fd));
+    ::FindClose(hFind);
+}
+
+bool CBlackHole_Checkpoint::Open(uint64_t key, int width, int height, int rowAlign, std::wstring& errorOut) {
+    Close();
+    m_records.clear();
+    m_restoredRows = 0;
+    m_fileBytes = 0;
+    m_bFailed = false;
+    m_width = width;
+    m_height = height;
+    if (width <= 0 || height <= 0 || rowAlign <= 0) {
+        errorOut = L"nothing to save";
+        return false;
+    }
+
+    const std::wstring dir = Directory();
+    if (dir.empty()) {
+        errorOut = L"no temporary directory";
+        return false;
+    }
+    wchar_t name[32];
+    swprintf_s(name, L"%016llx.bhckpt", (unsigned long long)key);
+    m_path = dir + name;
+    RemoveStale(dir, name);
+
+    FileHeader header = {};
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.bytesPerPixel = (uint32_t)BytesPerPixel();
+    header.key = key;
+    header.width = width;
+    header.height = height;
+
+    // 1. 已有文件且文件头一致：逐条校验记录，只认从第 0 行起连续的部分，停在最后一个对齐的位置
+    int64_t validEnd = 0;
+    if (0 == _wfopen_s(&m_fp, m_path.c_str(), L"r+b") && nullptr != m_fp) {
+        FileHeader existing;
+        if (1 == fread(&existing, sizeof(existing), 1, m_fp) && 0 == memcmp(&existing, &header, sizeof(header))) {
+            validEnd = sizeof(header);
+            int64_t pos = validEnd;
+            int next = 0;
+            size_t kept = 0;
+            std::vector<uint8_t> data;
+            RecordHeader record;
+            while (next < height && 1 == fread(&record, sizeof(record), 1, m_fp)) {
+                if (kRecordMagic != record.magic || next != record.y || record.rows <= 0 || record.rows > height - next ||
+                    (uint64_t)record.bytes > 2 * (uint64_t)RawBytes(width, record.rows) + 1024)
+                    break;
+                data.resize(record.bytes);
+                if (record.bytes != fread(data.data(), 1, record.bytes, m_fp) || record.crc != RecordCrc(record, data.data()))
+                    break;
+
+                Record r;
+                r.y = record.y;
+                r.rows = record.rows;
+                r.offset = pos + (int64_t)sizeof(record);
+                r.bytes = record.bytes;
+                m_records.push_back(r);
+                pos = r.offset + record.bytes;
+                next += record.rows;
+                if (0 == next % rowAlign || next == height) {
+                    validEnd = pos;
+                    kept = m_records.size();
+                    m_restoredRows = next;
+                }
+            }
+            m_records.resize(kept);
+        }
+
+        // 截掉崩溃时写了一半的记录，以及没对齐的尾巴
+        if (validEnd > 0 && (0 != _chsize_s(_fileno(m_fp), validEnd) || 0 != _fseeki64(m_fp, validEnd, SEEK_SET)))
+            validEnd = 0;
+        if (0 == validEnd) {
+            fclose(m_fp);
+            m_fp = nullptr;
+            m_records.clear();
+            m_restoredRows = 0;
+        }
+    }
+
+    // 2. 新文件：写好文件头并落盘
+    if (nullptr == m_fp) {
+        if (0 != _wfopen_s(&m_fp, m_path.c_str(), L"w+b") || nullptr == m_fp) {
+            m_fp = nullptr;
+            errorOut = L"cannot create file";
+            return false;
+        }
+        if (1 != fwrite(&header, sizeof(header), 1, m_fp) || 0 != fflush(m_fp) || 0 != _commit(_fileno(m_fp))) {
+            fclose(m_fp);
+            m_fp = nullptr;
+            ::DeleteFileW(m_path.c_str());
+            errorOut = L"write failed (disk full?)";
+            return false;
+        }
+        validEnd = sizeof(header);
+    }
+
+    m_fileBytes = (uint64_t)validEnd;
+    m_nextRow = m_restoredRows;
+    m_savedRows = m_restoredRows;
+    return true;
+}
+
+bool CBlackHole_Checkpoint::Read(int y, int rows, const CheckpointRows& dst) {
+    if (!IsOpen() || y < 0 || rows <= 0 || y + rows > m_restoredRows) return false;
+
+    // 只能按整条记录读回
+    std::vector<uint8_t> data, planes, raw;
+    int next = y;
+    for (const Record& r : m_records) {
+        if (r.y + r.rows <= y || r.y >= y + rows) continue;
+        if (r.y != next || r.y + r.rows > y + rows) return false;
+
+        data.resize(r.bytes);
+        {
+            std::lock_guard<std::mutex> lock(m_fileMutex);
+            const bool ok = 0 == _fseeki64(m_fp, r.offset, SEEK_SET) && r.bytes == fread(data.data(), 1, r.bytes, m_fp);
+            _fseeki64(m_fp, 0, SEEK_END);
+            if (!ok) return false;
+        }
+        const size_t bytes = RawBytes(m_width, r.rows);
+        if (!Inflate(data.data(), data.size(), planes) || planes.size() != bytes) return false;
+        raw.resize(bytes);
+        Unshuffle(planes.data(), bytes, raw.data());
+
+        CheckpointRows at = dst;
+        at.row = dst.row + (r.y - y);
+        Unpack(r.rows, raw.data(), at);
+        next = r.y + r.rows;
+    }
+    return next == y + rows;
+}
+
+// 原始数据按字段分成平面：RGBA、深度、分类、辅助输出（其中再按通道分开），每个平面 rows * width 个像素
+void CBlackHole_Checkpoint::Pack(int rows, const CheckpointRows& src, std::vector<uint8_t>& raw) const {
+    const size_t n = (size_t)rows * m_width;
+    const size_t first = (size_t)src.row * m_width;
+    raw.assign(RawBytes(m_width, rows), 0);
+    uint8_t* p = raw.data();
+    memcpy(p, &src.frame->rgba[first * 4], n * 4 * sizeof(float));
+    p += n * 4 * sizeof(float);
+    memcpy(p, &src.frame->depth[first], n * sizeof(float));
+    p += n * sizeof(float);
+    memcpy(p, src.pixelClass + first, n * sizeof(PixelClass));
+    p += n * sizeof(PixelClass);
+    src.frame->aov.PackRows(src.row, rows, p);
+}
+
+void CBlackHole_Checkpoint::Unpack(int rows, const uint8_t* raw, const CheckpointRows& dst) const {
+    const size_t n = (size_t)rows * m_width;
+    const size_t first = (size_t)dst.row * m_width;
+    memcpy(&dst.frame->rgba[first * 4], raw, n * 4 * sizeof(float));
+    raw += n * 4 * sizeof(float);
+    memcpy(&dst.frame->depth[first], raw, n * sizeof(float));
+    raw += n * sizeof(float);
+    memcpy(dst.pixelClass + first, raw, n * sizeof(PixelClass));
+    raw += n * sizeof(PixelClass);
+    dst.frame->aov.UnpackRows(dst.row, rows, raw);
+}
+
+// ==========================================
+// 追加
+
+void CBlackHole_Checkpoint::Append(int y, int rows, const CheckpointRows& src) {
+    if (!IsOpen() || m_bFailed || rows <= 0) return;
+    if (y != m_nextRow) {
+        m_bFailed = true;
+        return;
+    }
+
+    Pending pending;
+    pending.y = y;
+    pending.rows = rows;
+    Pack(rows, src, pending.raw);
+    m_nextRow = y + rows;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this] { return m_queue.size() < kMaxQueued || m_bFailed; });
+    if (m_bFailed) return;
+    m_queue.push_back(std::move(pending));
+    if (!m_bWriting) {
+        m_bWriting = true;
+        m_pool.Submit([this] { WriteQueued(); });
+    }
+}
+
+void CBlackHole_Checkpoint::WriteQueued() {
+    std::vector<uint8_t> planes, data;
+    for (;;) {
+        const Pending* pPending;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_queue.empty() || m_bFailed) {
+                m_queue.clear();
+                m_bWriting = false;
+                m_cv.notify_all();
+                return;
+            }
+            pPending = &m_queue.front();    // 只有本任务会取走队首，其他线程只往队尾加
+        }
+
+        // 压缩与写盘都不持队列的锁，渲染线程随时可以排入下一条
+        planes.resize(pPending->raw.size());
+        Shuffle(pPending->raw.data(), planes.size(), planes.data());
+        bool ok = Deflate(planes.data(), planes.size(), data) && data.size() <= 0xFFFFFFFFull;
+
+        RecordHeader record;
+        record.magic = kRecordMagic;
+        record.y = pPending->y;
+        record.rows = pPending->rows;
+        record.bytes = (uint32_t)data.size();
+        record.crc = ok ? RecordCrc(record, data.data()) : 0;
+
+        {
+            std::lock_guard<std::mutex> fileLock(m_fileMutex);
+            ok = ok && 1 == fwrite(&record, sizeof(record), 1, m_fp) && data.size() == fwrite(data.data(), 1, data.size(), m_fp) &&
+                0 == fflush(m_fp) && 0 == _commit(_fileno(m_fp));
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (ok) {
+            m_savedRows = pPending->y + pPending->rows;
+            m_fileBytes += sizeof(record) + data.size();
+        } else {
+            m_bFailed = true;   // 写了一半的记录留在文件末尾，下次打开时截掉
+        }
+        m_queue.pop_front();
+        m_cv.notify_all();
+    }
+}
+
+int CBlackHole_Checkpoint::Flush() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this] { return !m_bWriting; });
+    return m_savedRows;
+}
+
+void CBlackHole_Checkpoint::Close() {
+    Flush();
+    if (nullptr != m_fp) {
+        fclose(m_fp);
+        m_fp = nullptr;
+    }
+}
+
+void CBlackHole_Checkpoint::Discard() {
+    Close();
+    if (!m_path.empty()) ::DeleteFileW(m_path.c_str());
+    m_path.clear();
+}
@@ -0,0 +1,106 @@
+﻿// CBlackHole_Checkpoint.h
+// 离线渲染的检查点：定稿的行连同分类、深度与辅助输出追加到 %TEMP% 下按键命名的文件，压缩与写盘在线程池上进行
+// 文件只追加、每条记录带 CRC，崩溃时写了一半的记录下次打开时截掉；键相同的渲染再次开始时读回已有的行，从下一行接着渲染
+#pragma once
+#include "stdafx.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class CBlackHole_ThreadPool;
+struct RenderedFrame;
+struct PixelClass;
+
+// 一段行所在的缓冲：frame 的颜色、深度与辅助输出，连同同样大小的分类；row 为缓冲中的行号
+struct CheckpointRows {
+    RenderedFrame* frame = nullptr;
+    PixelClass*    pixelClass = nullptr;
+    int            row = 0;
+};
+
+class CBlackHole_Checkpoint {
+public:
+    explicit CBlackHole_Checkpoint(CBlackHole_ThreadPool& pool);
+    ~CBlackHole_Checkpoint();       // 等排队的记录写完后关闭，文件保留
+
+    CBlackHole_Checkpoint(const CBlackHole_Checkpoint&) = delete;
+    CBlackHole_Checkpoint& operator=(const CBlackHole_Checkpoint&) = delete;
+
+    // 一个像素在记录中的字节数（压缩前），排队的记录按它估计内存
+    static uint64_t BytesPerPixel();
+
+    // ==========================================
+    // 1. 打开与读回（渲染线程）
+
+    // 打开键对应的文件：读出从第 0 行起连续、在 rowAlign 的整数倍（或最后一行）处结束的有效记录，其后的内容截掉；没有文件时新建
+    // 顺带删除超过一周没有写过的其他检查点
+    bool Open(uint64_t key, int width, int height, int rowAlign, std::wstring& errorOut);
+
+    // 读回的行数，新文件为 0
+    int RestoredRows() const { return m_restoredRows; }
+
+    // 把 [y, y + rows) 解压到 dst；这些行须在 RestoredRows 之内，且由整条记录组成（按同样的 rowAlign 追加的行总是如此）
+    bool Read(int y, int rows, const CheckpointRows& dst);
+
+    // ==========================================
+    // 2. 追加（渲染线程）
+
+    // [y, y + rows) 必须紧接着已有的行；数据在调用时拷出，压缩与写盘在后台按顺序进行
+    // 已有两条记录在排队时等待，只有写盘跟不上渲染时才会阻塞
+    void Append(int y, int rows, const CheckpointRows& src);
+
+    // 等排队的记录都写完并落盘，返回已落盘的行数
+    int Flush();
+
+    // 渲染完成后删除文件；取消或崩溃时保留，下次接着渲染
+    void Discard();
+
+    bool IsOpen() const { return nullptr != m_fp; }
+    bool Failed() const { return m_bFailed; }
+    const std::wstring& Path() const { return m_path; }
+    uint64_t FileBytes() const { return m_fileBytes; }
+
+private:
+    struct Record {
+        int      y = 0;
+        int      rows = 0;
+        int64_t  offset = 0;    // 压缩数据在文件中的位置
+        uint32_t bytes = 0;
+    };
+    struct Pending {
+        int                  y = 0;
+        int                  rows = 0;
+        std::vector<uint8_t> raw;
+    };
+
+    void Pack(int rows, const CheckpointRows& src, std::vector<uint8_t>& raw) const;
+    void Unpack(int rows, const uint8_t* raw, const CheckpointRows& dst) const;
+    void WriteQueued();
+    void Close();
+    static std::wstring Directory();    // %TEMP%\BlackHole_RealTimeRender\Checkpoints\，第一次使用时创建
+    static void RemoveStale(const std::wstring& dir, const std::wstring& keep);
+
+    CBlackHole_ThreadPool&  m_pool;
+    std::wstring            m_path;
+    FILE*                   m_fp = nullptr;
+    int                     m_width = 0;
+    int                     m_height = 0;
+    int                     m_restoredRows = 0;
+    std::vector<Record>     m_records;      // 读回的记录，Read 按它定位
+    std::atomic<uint64_t>   m_fileBytes{ 0 };
+    std::mutex              m_fileMutex;    // 后台写盘与 Read 的定位互斥，不挡住 Append 排队
+
+    // 追加：m_nextRow 为下一条记录应当开始的行；排队的记录由一个后台任务依次压缩、写盘
+    int                     m_nextRow = 0;
+    std::deque<Pending>     m_queue;
+    bool                    m_bWriting = false;
+    int                     m_savedRows = 0;
+    std::atomic<bool>       m_bFailed{ false };
+    std::mutex              m_mutex;
+    std::condition_variable m_cv;
+};
@@ -1,5 +1,8 @@
 #pragma once
 #include "stdafx.h"
+#include <vector>
+#include <string>
+#include <set>
 
 // רԿĽṹ壬16 ֽڶ
 struct GPU_Buffer_Data {
@@ -7,6 +10,8 @@ struct GPU_Buffer_Data {
     float camDir[3];    float pad2;      // 泯16ֽ
     float camUp[3];     float fov;       // Ϸ + fov16ֽ
     float width;        float height;    float mass;  float spin; 
+    unsigned int skySource;  float starGrid;  float starBrightness;  unsigned int starSeed;  // Դǿղ16ֽ
+    unsigned int frameIndex; float pad3[3];  // ۻ֡ţ0 Ϊĵһ֡16ֽ
 };
 
 // ̨߼ʹõ
@@ -15,4 +20,34 @@ struct CameraParameters {
     ON_3dVector dir;
     ON_3dVector up;
     double      viewAngle;
-};
\ No newline at end of file
+};
+
+// Դֵ HLSL  skySource һ
+enum class SkySource : unsigned int {
+    Texture         = 0,    // HDR Ⱦ״ͼ
+    ProceduralStars = 1,    // ǿգռԴ桢޼ʱ
+    Catalog         = 2,    // ڴӳǱȾʹãʵʱԤԳǿմ
+    Environment     = 3     // ĵǰ RDK 決ͼûлʱ˻سǿ
+};
+
+// ûɵãɲУȾ߳ÿ֡һ
+struct SkySettings {
+    SkySource    source         = SkySource::Environment;
+    float        starGrid       = 400.0f;   // ÿÿߵÿһ
+    float        starBrightness = 1.0f;     // ȱ
+    unsigned int starSeed       = 1;        // ӣӵõһƬǿ
+    std::wstring catalogPath;               // Ǳļ (.bhstars)
+};
+
+// ͼ CPU ˸ʽRGBA32F Ⱦ״ͶӰ 0 Ӧ춥 (+Z)
+struct SkyImage {
+    int                width = 0;
+    int                height = 0;
+    std::vector<float> rgba;
+};
+
+// ON_UUID Ϊ std::map / std::set ʱıȽ
+struct UuidLess {
+    bool operator()(const ON_UUID& a, const ON_UUID& b) const { return ON_UuidCompare(a, b) < 0; }
+};
+using ObjectIdSet = std::set<ON_UUID, UuidLess>;
@@ -0,0 +1,225 @@
+﻿// CBlackHole_DeepZoom.cpp
+#include "stdafx.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include "CBlackHole_DeepZoom.h"
+#include "CBlackHole_ImageWriter.h"
+#include "CBlackHole_ThreadPool.h"
+
+namespace {
+
+const int kChunkPixels = 4096;      // 一行按这么多像素一段分给线程池，须为偶数
+
+std::wstring StripExtension(const std::wstring& path) {
+    const size_t slash = path.find_last_of(L"\\/");
+    const size_t dot = path.find_last_of(L'.');
+    if (std::wstring::npos == dot || (std::wstring::npos != slash && dot < slash)) return path;
+    return path.substr(0, dot);
+}
+
+// 源像素 [x0, x1) 两行（b 为空时只有一行）按 2x2 平均，写到 out 的 [x0 / 2, (x1 + 1) / 2)；宽度为奇数时最后一列只有一个像素
+void Downsample(const float* a, const float* b, int width, int x0, int x1, float* out) {
+    for (int x = x0; x < x1; x += 2) {
+        const int n = (x + 1 < width) ? 2 : 1;
+        const float scale = 1.0f / (float)(b ? 2 * n : n);
+        float* dst = &out[(size_t)(x / 2) * 4];
+        for (int c = 0; c < 4; ++c) {
+            float sum = a[(size_t)x * 4 + c];
+            if (n > 1) sum += a[(size_t)(x + 1) * 4 + c];
+            if (b) {
+                sum += b[(size_t)x * 4 + c];
+                if (n > 1) sum += b[(size_t)(x + 1) * 4 + c];
+            }
+            dst[c] = sum * scale;
+        }
+    }
+}
+
+}  // namespace
+
+CBlackHole_DeepZoom::CBlackHole_DeepZoom(CBlackHole_ThreadPool& pool) : m_pool(pool) {
+}
+
+std::wstring CBlackHole_DeepZoom::PathFor(const std::wstring& imagePath) {
+    return StripExtension(imagePath) + L".dzi";
+}
+
+uint64_t CBlackHole_DeepZoom::MemoryBytes(int width) {
+    uint64_t bytes = 0;
+    for (int w = (width > 1) ? width : 1; ; w = (w + 1) / 2) {
+        bytes += (uint64_t)w * TileSize * 4 + (uint64_t)w * 4 * sizeof(float) + (uint64_t)((w + 1) / 2) * 4 * sizeof(float);
+        if (w <= 1) break;
+    }
+    return bytes;
+}
+
+bool CBlackHole_DeepZoom::Begin(const std::wstring& dziPath, int width, int height, std::wstring& errorOut) {
+    m_levels.clear();
+    m_tiles = 0;
+    m_error.clear();
+    if (width <= 0 || height <= 0) {
+        errorOut = L"nothing to write";
+        return false;
+    }
+
+    // 1. 各级尺寸：每级宽高减半向上取整，直到 1x1；Deep Zoom 的第 0 级是最小的一级
+    std::vector<Level> levels;
+    for (int w = width, h = height; ; w = (w + 1) / 2, h = (h + 1) / 2) {
+        Level level;
+        level.width = w;
+        level.height = h;
+        levels.push_back(std::move(level));
+        if (w <= 1 && h <= 1) break;
+    }
+    std::reverse(levels.begin(), levels.end());
+
+    // 2. 目录：name_files\<级别>
+    const std::wstring filesDir = StripExtension(dziPath) + L"_files";
+    ::CreateDirectoryW(filesDir.c_str(), nullptr);
+    for (size_t i = 0; i < levels.size(); ++i) {
+        const std::wstring dir = filesDir + L"\\" + std::to_wstring(i);
+        if (!::CreateDirectoryW(dir.c_str(), nullptr) && ERROR_ALREADY_EXISTS != ::GetLastError()) {
+            errorOut = L"cannot create tile directory";
+            return false;
+        }
+    }
+
+    for (Level& level : levels) {
+        level.tiles.assign((size_t)level.width * TileSize * 4, 0);
+        level.pending.assign((size_t)level.width * 4, 0.0f);
+        level.half.assign((size_t)((level.width + 1) / 2) * 4, 0.0f);
+    }
+    m_levels = std::move(levels);
+    m_dziPath = dziPath;
+    m_filesDir = filesDir;
+    m_width = width;
+    m_height = height;
+    return true;
+}
+
+bool CBlackHole_DeepZoom::AddRows(const float* rgba, int rows, std::wstring& errorOut) {
+    if (!IsOpen()) {
+        errorOut = L"no pyramid open";
+        return false;
+    }
+    const int top = LevelCount() - 1;
+    for (int r = 0; r < rows; ++r) {
+        if (m_levels[top].rowsIn >= m_height || !AddRow(top, rgba + (size_t)r * m_width * 4)) {
+            errorOut = m_error.empty() ? L"too many rows" : m_error;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CBlackHole_DeepZoom::AddRow(int index, const float* row) {
+    Level& level = m_levels[index];
+    const int w = level.width;
+
+    // 1. 转成 8 位 sRGB 放进这一行瓦片；已有待配对的上一行时顺带缩小到下一级
+    uint8_t* dst = &level.tiles[(size_t)(level.rowsIn % TileSize) * w * 4];
+    const float* prev = (index > 0 && level.bPending) ? level.pending.data() : nullptr;
+    auto convert = [&](int chunk) {
+        const int x0 = chunk * kChunkPixels;
+        const int x1 = (x0 + kChunkPixels < w) ? x0 + kChunkPixels : w;
+        for (int i = x0 * 4; i < x1 * 4; ++i) {
+            const float v = row[i];
+            dst[i] = (3 == (i & 3)) ? (uint8_t)(((v > 0.0f) ? ((v < 1.0f) ? v : 1.0f) : 0.0f) * 255.0f + 0.5f)
+                : CBlackHole_ImageWriter::LinearToSrgb8(v);
+        }
+        if (prev)
+            Downsample(prev, row, w, x0, x1, level.half.data());
+    };
+    const int chunks = (w + kChunkPixels - 1) / kChunkPixels;
+    if (chunks > 1)
+        m_pool.ParallelFor(chunks, convert);
+    else
+        convert(0);
+
+    level.rowsIn++;
+    if ((0 == level.rowsIn % TileSize || level.rowsIn == level.height) && !FlushTiles(index))
+        return false;
+
+    // 2. 两行凑齐后交给下一级
+    if (0 == index)
+        return true;
+    if (!prev) {
+        memcpy(level.pending.data(), row, (size_t)w * 4 * sizeof(float));
+        level.bPending = true;
+        return true;
+    }
+    level.bPending = false;
+    return AddRow(index - 1, level.half.data());
+}
+
+bool CBlackHole_DeepZoom::FlushTiles(int index) {
+    Level& level = m_levels[index];
+    const int tileRow = (level.rowsIn - 1) / TileSize;
+    const int rows = level.rowsIn - tileRow * TileSize;
+    const int cols = (level.width + TileSize - 1) / TileSize;
+
+    std::atomic<bool> ok{ true };
+    auto writeTile = [&](int col) {
+        const int x0 = col * TileSize;
+        const int tw = (x0 + TileSize < level.width) ? TileSize : level.width - x0;
+        wchar_t name[64];
+        swprintf_s(name, L"\\%d\\%d_%d.png", index, col, tileRow);
+        std::wstring error;
+        if (!CBlackHole_ImageWriter::WritePng8(m_filesDir + name, tw, rows, &level.tiles[(size_t)x0 * 4], (size_t)level.width * 4, error))
+            ok = false;
+    };
+    if (cols > 1)
+        m_pool.ParallelFor(cols, writeTile);
+    else
+        writeTile(0);
+
+    m_tiles += cols;
+    if (!ok)
+        m_error = L"cannot write tiles (disk full?)";
+    return ok;
+}
+
+bool CBlackHole_DeepZoom::Finish(std::wstring& errorOut) {
+    if (!IsOpen()) {
+        errorOut = L"no pyramid open";
+        return false;
+    }
+
+    // 1. 高度为奇数的级别还剩一行没配对，单独缩小交给下一级
+    bool ok = true;
+    for (int i = LevelCount() - 1; i > 0 && ok; --i) {
+        Level& level = m_levels[i];
+        if (!level.bPending)
+            continue;
+        Downsample(level.pending.data(), nullptr, level.width, 0, level.width, level.half.data());
+        level.bPending = false;
+        ok = AddRow(i - 1, level.half.data());
+    }
+    for (const Level& level : m_levels)
+        ok = ok && level.rowsIn == level.height;
+    if (!ok) {
+        errorOut = m_error.empty() ? L"not all rows were rendered" : m_error;
+        m_levels.clear();
+        return false;
+    }
+
+    // 2. 描述文件
+    FILE* fp = nullptr;
+    if (0 != _wfopen_s(&fp, m_dziPath.c_str(), L"wb") || nullptr == fp) {
+        errorOut = L"cannot create file";
+        m_levels.clear();
+        return false;
+    }
+    const int n = fprintf(fp,
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" Format=\"png\" Overlap=\"0\" TileSize=\"%d\">\n"
+        "  <Size Width=\"%d\" Height=\"%d\"/>\n"
+        "</Image>\n", TileSize, m_width, m_height);
+    ok = (0 == fclose(fp)) && n > 0;
+    if (!ok)
+        errorOut = L"write failed (disk full?)";
+    m_levels.clear();
+    return ok;
+}
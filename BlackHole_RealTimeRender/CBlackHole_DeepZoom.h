@@ -0,0 +1,60 @@
+﻿// CBlackHole_DeepZoom.h
+// Deep Zoom（.dzi）瓦片金字塔：整幅图的行从上到下依次交入，每一级只缓存一行瓦片，凑满即写出 256x256 的 PNG 瓦片
+// 下一级由这一级每 2x2 个像素的线性平均得到，一直缩到 1x1；内存约为图像宽度乘 2 KB，与高度无关
+#pragma once
+#include "stdafx.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class CBlackHole_ThreadPool;
+
+class CBlackHole_DeepZoom {
+public:
+    static const int TileSize = 256;
+
+    explicit CBlackHole_DeepZoom(CBlackHole_ThreadPool& pool);
+
+    // 输出文件旁边的 .dzi 路径（换掉扩展名），瓦片放在同名的 "_files" 目录
+    static std::wstring PathFor(const std::wstring& imagePath);
+
+    // 宽度为 width 时各级缓冲的总字节数
+    static uint64_t MemoryBytes(int width);
+
+    // 建好各级目录；不从渲染线程池的线程调用（内部用 ParallelFor 写瓦片）
+    bool Begin(const std::wstring& dziPath, int width, int height, std::wstring& errorOut);
+
+    // rows 行线性 RGBA，行宽为 width，必须按从上到下的顺序交入
+    bool AddRows(const float* rgba, int rows, std::wstring& errorOut);
+
+    // 交出各级剩下的奇数行，写出 .dzi 描述文件；行没交齐时失败
+    bool Finish(std::wstring& errorOut);
+    void Abort() { m_levels.clear(); }      // 已写出的瓦片保留
+
+    bool IsOpen() const { return !m_levels.empty(); }
+    int  LevelCount() const { return (int)m_levels.size(); }
+    uint64_t TileCount() const { return m_tiles; }
+
+private:
+    struct Level {
+        int width = 0;
+        int height = 0;
+        int rowsIn = 0;                 // 已交入的行数
+        std::vector<uint8_t> tiles;     // 当前这一行瓦片的 8 位 sRGB 像素，TileSize 行
+        std::vector<float>   pending;   // 等着和下一行配对的线性行，缩小到下一级用
+        bool                 bPending = false;
+        std::vector<float>   half;      // 两行平均并横向减半后的结果，即下一级的一行
+    };
+
+    bool AddRow(int level, const float* row);
+    bool FlushTiles(int level);
+
+    CBlackHole_ThreadPool& m_pool;
+    std::wstring           m_dziPath;
+    std::wstring           m_filesDir;
+    int                    m_width = 0;
+    int                    m_height = 0;
+    std::vector<Level>     m_levels;    // 下标即 Deep Zoom 的级别，最后一级为原始分辨率
+    uint64_t               m_tiles = 0;
+    std::wstring           m_error;
+};
@@ -0,0 +1,182 @@
+﻿// CBlackHole_EnvironmentCache.cpp
+#include "stdafx.h"
+#include <chrono>
+#include <cmath>
+#include "CBlackHole_ThreadPool.h"
+#include "CBlackHole_Log.h"
+#include "CBlackHole_EnvironmentCache.h"
+
+static const size_t kMaxCacheBytes = 512ull * 1024 * 1024;   // 缓存上限，2048x1024 的图约 32 MB
+
+static size_t ImageBytes(const SkyImage& image) {
+    return image.rgba.size() * sizeof(float);
+}
+
+void CBlackHole_EnvironmentCache::Update(const CRhinoDoc& doc, bool bForce) {
+    // 1. 节流：显示管线每帧都会调用
+    const DWORD now = ::GetTickCount();
+    if (!bForce && now - m_lastCheckTick < 250) return;
+    m_lastCheckTick = now;
+
+    const CRhRdkEnvironment* pEnv = doc.CurrentEnvironment().GetEnv(IRhRdkCurrentEnvironment::Usage::Background, IRhRdkCurrentEnvironment::Purpose::Render);
+    if (nullptr == pEnv) return;
+
+    // 2. 内容 CRC 覆盖了环境及其子纹理的全部参数，编辑任何一项都会改变
+    const unsigned int crc = pEnv->RenderCRC(CRhRdkContent::CRenderCRCFlags());
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_bHasWanted && crc == m_wantedCrc) return;
+        m_wantedCrc = crc;
+        m_bHasWanted = true;
+
+        // 命中缓存：切回以前用过的环境不需要重新烘焙
+        for (auto& e : m_entries) {
+            if (e.crc == crc) {
+                e.lastUse = ++m_useCounter;
+                m_current = e.image;
+                m_currentCrc = crc;
+                ++m_revision;
+
+                ON_wString str;
+                str.Format(L"BlackHole: environment %08X loaded from cache\n", crc);
+                RhinoApp().Print(str);
+                return;
+            }
+        }
+
+        // 同一个 CRC 已经在烘焙，完成后会自动切换
+        for (unsigned int c : m_inFlight) {
+            if (c == crc) return;
+        }
+        m_inFlight.push_back(crc);
+    }
+
+    // 3. 在主线程取出模拟参数并创建求值器，后台任务只调用求值器
+    CRhRdkSimulatedEnvironment sim;
+    pEnv->SimulateEnvironment(sim, CRhRdkTexture::TextureGeneration::Disallow);
+
+    const CRhRdkTexture* pTex = dynamic_cast<const CRhRdkTexture*>(pEnv->GetTextureForUsage(CRhRdkEnvironment::ChildSlotUsage::Background));
+    IRhRdkTextureEvaluator* pEval = pTex ? pTex->NewTextureEvaluator(IRhRdkTextureEvaluator::CEvalFlags()) : nullptr;
+    if (pEval && !pEval->Initialize()) {
+        pEval->DeleteThis();
+        pEval = nullptr;
+    }
+
+    auto proj = sim.BackgroundProjection();
+    if (proj == CRhRdkSimulatedEnvironment::BackgroundProjections::Automatic) {
+        proj = CRhRdkSimulatedEnvironment::AutomaticProjectionFromChildTexture(pTex);
+    }
+    if (proj == CRhRdkSimulatedEnvironment::BackgroundProjections::Planar) {
+        proj = CRhRdkSimulatedEnvironment::BackgroundProjections::Spherical;   // 平面投影只对屏幕有意义，按球面处理
+    }
+    const ON_Color bg = sim.BackgroundColor();
+    const int width = bakeWidth;
+
+    // 4. 后台烘焙：对每个像素反推方向，按环境原本的投影求 uv 再取色
+    CBlackHole_ThreadPool::Shared().Submit([this, crc, pEval, proj, bg, width]() {
+        const auto t0 = std::chrono::high_resolution_clock::now();
+
+        auto pImage = std::make_shared<SkyImage>();
+        pImage->width = width;
+        pImage->height = width / 2;
+        pImage->rgba.resize((size_t)pImage->width * pImage->height * 4);
+
+        const ON_3dVector zero = ON_3dVector::ZeroVector;
+        for (int y = 0; y < pImage->height; ++y) {
+            // 与着色器采样一致：v = 0.5 - asin(z) / PI，u = 0.5 + atan2(y, x) / (2 PI)
+            const double elev = (0.5 - (y + 0.5) / pImage->height) * ON_PI;
+            for (int x = 0; x < pImage->width; ++x) {
+                const double phi = ((x + 0.5) / pImage->width - 0.5) * 2.0 * ON_PI;
+                const ON_3dVector dir(cos(elev) * cos(phi), cos(elev) * sin(phi), sin(elev));
+
+                CRhRdkColor col(bg);
+                float a = 0.0f, b = 0.0f;
+                if (pEval && CRhRdkEnvironment::ComputeProjectionUV(proj, dir, a, b)) {
+                    pEval->GetColor(ON_3dPoint(a, b, 0.0), zero, zero, col);
+                }
+
+                float* p = &pImage->rgba[((size_t)y * pImage->width + x) * 4];
+                p[0] = col.FRed();
+                p[1] = col.FGreen();
+                p[2] = col.FBlue();
+                p[3] = 1.0f;
+            }
+        }
+        if (pEval) pEval->DeleteThis();
+
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+        OnBaked(crc, pImage, ms);
+    });
+}
+
+void CBlackHole_EnvironmentCache::OnBaked(unsigned int crc, std::shared_ptr<const SkyImage> image, double bakeMs) {
+    size_t totalBytes = 0;
+    int entryCount = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < m_inFlight.size(); ++i) {
+            if (m_inFlight[i] == crc) {
+                m_inFlight.erase(m_inFlight.begin() + i);
+                break;
+            }
+        }
+
+        // 过时的结果也留在缓存里，撤销编辑时可以直接用
+        Entry e;
+        e.crc = crc;
+        e.image = image;
+        e.lastUse = ++m_useCounter;
+        m_entries.push_back(e);
+
+        if (m_bHasWanted && crc == m_wantedCrc) {
+            m_current = image;
+            m_currentCrc = crc;
+            ++m_revision;
+        }
+        Evict();
+
+        for (const auto& entry : m_entries) totalBytes += ImageBytes(*entry.image);
+        entryCount = (int)m_entries.size();
+    }
+    m_cvIdle.notify_all();
+
+    ON_wString str;
+    str.Format(L"BlackHole: environment %08X baked %dx%d in %.1f ms (cache %d entries, %.0f MB)\n",
+        crc, image->width, image->height, bakeMs, entryCount, totalBytes / 1048576.0);
+    CBlackHole_Log::Post(str);
+}
+
+void CBlackHole_EnvironmentCache::Evict() {
+    size_t totalBytes = 0;
+    for (const auto& e : m_entries) totalBytes += ImageBytes(*e.image);
+
+    while (totalBytes > kMaxCacheBytes && m_entries.size() > 1) {
+        size_t oldest = m_entries.size();
+        for (size_t i = 0; i < m_entries.size(); ++i) {
+            if (m_entries[i].image == m_current) continue;
+            if (oldest == m_entries.size() || m_entries[i].lastUse < m_entries[oldest].lastUse) oldest = i;
+        }
+        if (oldest == m_entries.size()) break;
+
+        totalBytes -= ImageBytes(*m_entries[oldest].image);
+        m_entries.erase(m_entries.begin() + oldest);
+    }
+}
+
+std::shared_ptr<const SkyImage> CBlackHole_EnvironmentCache::Current() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_current;
+}
+
+bool CBlackHole_EnvironmentCache::WaitIdle(int timeoutMs) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_cvIdle.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] { return m_inFlight.empty(); });
+}
+
+void CBlackHole_EnvironmentCache::Clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_current.reset();
+    m_bHasWanted = false;
+    ++m_revision;
+}
@@ -0,0 +1,64 @@
+﻿// CBlackHole_EnvironmentCache.h
+// RDK 环境缓存：把文档当前背景环境烘焙成渲染器自己的等距柱状天空图，按环境内容 CRC 缓存
+#pragma once
+#include "stdafx.h"
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <condition_variable>
+#include "CBlackHole_Common.h"
+
+class CBlackHole_EnvironmentCache {
+public:
+    CBlackHole_EnvironmentCache() = default;
+
+    CBlackHole_EnvironmentCache(const CBlackHole_EnvironmentCache&) = delete;
+    CBlackHole_EnvironmentCache& operator=(const CBlackHole_EnvironmentCache&) = delete;
+
+    // ==========================================
+    // 1. UI 线程接口
+
+    // 检查文档当前背景环境：CRC 未变直接返回，命中缓存立即切换，否则提交后台烘焙
+    // 环境内容只能在主线程访问，纹理求值器也在这里创建；默认每 250 ms 最多检查一次
+    void Update(const CRhinoDoc& doc, bool bForce = false);
+
+    // ==========================================
+    // 2. 任意线程接口
+
+    // 当前环境的天空图，首次烘焙尚未完成时为空
+    std::shared_ptr<const SkyImage> Current() const;
+
+    // 每次 Current() 指向新的图像时加一，渲染线程据此判断是否需要重画
+    unsigned int Revision() const { return m_revision; }
+
+    // 等待进行中的烘焙完成（离线渲染用），超时返回 false
+    bool WaitIdle(int timeoutMs);
+
+    void Clear();
+
+    int bakeWidth = 2048;   // 烘焙分辨率，高度为宽度的一半
+
+private:
+    struct Entry {
+        unsigned int                    crc = 0;
+        std::shared_ptr<const SkyImage> image;
+        unsigned long long              lastUse = 0;
+    };
+
+    // 烘焙完成后由线程池回调
+    void OnBaked(unsigned int crc, std::shared_ptr<const SkyImage> image, double bakeMs);
+    void Evict();   // 超出内存预算时按最久未用淘汰，当前图像不淘汰
+
+    mutable std::mutex              m_mutex;
+    std::condition_variable         m_cvIdle;
+    std::vector<Entry>              m_entries;
+    std::vector<unsigned int>       m_inFlight;         // 正在烘焙的 CRC
+    std::shared_ptr<const SkyImage> m_current;
+    unsigned int                    m_currentCrc = 0;
+    unsigned int                    m_wantedCrc = 0;    // 最近一次 Update 看到的 CRC
+    bool                            m_bHasWanted = false;
+    unsigned long long              m_useCounter = 0;
+    std::atomic<unsigned int>       m_revision{ 0 };
+    DWORD                           m_lastCheckTick = 0;
+};
@@ -1,9 +1,12 @@
 // CBlackHole_GPUManager.cpp
 #include "stdafx.h"
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
-#include "BlackHole_Kernel.h"
+#include "BlackHole_Kernel.h"     // ʱ FxCompile  BlackHole_Kernel.hlsl ɣ
 #include "CBlackHole_GPUManager.h"
+#include "CBlackHole_Sampler.h"
+
+// ʱ롿 HDR ǿͼ
+static const wchar_t* kDefaultSkyboxPath =
+    L"D:\\Code\\CPP\\SJU RhinoBlackHole\\BlackHoleRealTimeRender\\BlackHole_RealTimeRender\\BlackHole_RealTimeRender\\res\\nebula-1.hdr";
 
 bool CBlackHole_GPUManager::Initialize(int w, int h) {
     // 1. ҪԴǷڣҪߴǷ仯
@@ -29,31 +32,8 @@ bool CBlackHole_GPUManager::Initialize(int w, int h) {
         D3D11_BUFFER_DESC cbDesc = { sizeof(GPU_Buffer_Data), D3D11_USAGE_DYNAMIC, D3D11_BIND_CONSTANT_BUFFER, D3D11_CPU_ACCESS_WRITE, 0, 0 };
         if (FAILED(m_pDevice->CreateBuffer(&cbDesc, nullptr, &m_pConstantBuffer))) return false;
 
-        // ʱ롿رHDRǿͼ 
-        int width, height, channels;
-        float* data = stbi_loadf("D:\\Code\\CPP\\SJU RhinoBlackHole\\BlackHoleRealTimeRender\\BlackHole_RealTimeRender\\BlackHole_RealTimeRender\\res\\nebula-1.hdr", 
-            & width, &height, &channels, 4);    // ǿת RGBA ͨ
-        if (data) {
-            D3D11_TEXTURE2D_DESC texDescHDR = {};
-            texDescHDR.Width = width;
-            texDescHDR.Height = height;
-            texDescHDR.MipLevels = 1;   // ԭʼͼͼ
-            texDescHDR.ArraySize = 1;
-            texDescHDR.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-            texDescHDR.SampleDesc.Count = 1;
-            texDescHDR.Usage = D3D11_USAGE_IMMUTABLE;   // 󲻿޸
-            texDescHDR.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-
-            D3D11_SUBRESOURCE_DATA initData = {};
-            initData.pSysMem = data;
-            initData.SysMemPitch = width * 4 * sizeof(float);
-
-            ComPtr<ID3D11Texture2D> pHDRTex;
-            m_pDevice->CreateTexture2D(&texDescHDR, &initData, &pHDRTex);
-            m_pDevice->CreateShaderResourceView(pHDRTex.Get(), nullptr, &m_pSkyboxSRV);
-
-            stbi_image_free(data); // Դͷ CPU ڴ
-        }
+        // ȹϵͷֱռλգһ֡ٵȴ룻ͼ̨񣬾 UpdateParams л
+        CBlackHole_SkyboxLoader::CreatePlaceholder(m_pDevice.Get(), m_pSkyboxSRV);
 
         // Բ (β WRAP)
         D3D11_SAMPLER_DESC sampDesc = {};
@@ -63,6 +43,15 @@ bool CBlackHole_GPUManager::Initialize(int w, int h) {
         sampDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
         sampDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
         m_pDevice->CreateSamplerState(&sampDesc, &m_pSkyboxSampler);
+
+        // ͼֻһ
+        const std::vector<float>& mask = CBlackHole_Sampler::BlueNoiseMask();
+        const UINT n = (UINT)CBlackHole_Sampler::kBlueNoiseSize;
+        D3D11_TEXTURE2D_DESC noiseDesc = { n, n, 1, 1, DXGI_FORMAT_R32_FLOAT, {1,0}, D3D11_USAGE_IMMUTABLE, D3D11_BIND_SHADER_RESOURCE, 0, 0 };
+        D3D11_SUBRESOURCE_DATA noiseData = { mask.data(), n * sizeof(float), 0 };
+        ComPtr<ID3D11Texture2D> pNoiseTex;
+        if (SUCCEEDED(m_pDevice->CreateTexture2D(&noiseDesc, &noiseData, &pNoiseTex)))
+            m_pDevice->CreateShaderResourceView(pNoiseTex.Get(), nullptr, &m_pBlueNoiseSRV);
         // =========================================================
     }
 
@@ -70,6 +59,15 @@ bool CBlackHole_GPUManager::Initialize(int w, int h) {
     m_pOutputTex.Reset();
     m_pUAV.Reset();
     m_pStagingTex.Reset();
+    m_pAovTex.Reset();
+    m_pAovUAV.Reset();
+    m_pAovStagingTex.Reset();
+    m_pRedshiftTex.Reset();
+    m_pRedshiftUAV.Reset();
+    m_pRedshiftStagingTex.Reset();
+    m_pAccumBuffer.Reset();
+    m_pAccumUAV.Reset();
+    m_bAccumValid = false;
 
     // 4. µĿ(w)͸(h)Դ
     D3D11_TEXTURE2D_DESC texDesc = { (UINT)w, (UINT)h, 1, 1, DXGI_FORMAT_R32G32B32A32_FLOAT,
@@ -82,14 +80,47 @@ bool CBlackHole_GPUManager::Initialize(int w, int h) {
     texDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
     m_pDevice->CreateTexture2D(&texDesc, nullptr, &m_pStagingTex);
 
+    // 5. ǵݴ
+    D3D11_TEXTURE2D_DESC aovDesc = { (UINT)w, (UINT)h, 1, 1, DXGI_FORMAT_R32G32_UINT,
+        {1,0}, D3D11_USAGE_DEFAULT, D3D11_BIND_UNORDERED_ACCESS, 0, 0 };
+    m_pDevice->CreateTexture2D(&aovDesc, nullptr, &m_pAovTex);
+    m_pDevice->CreateUnorderedAccessView(m_pAovTex.Get(), nullptr, &m_pAovUAV);
+    aovDesc.Format = DXGI_FORMAT_R16_FLOAT;
+    m_pDevice->CreateTexture2D(&aovDesc, nullptr, &m_pRedshiftTex);
+    m_pDevice->CreateUnorderedAccessView(m_pRedshiftTex.Get(), nullptr, &m_pRedshiftUAV);
+
+    aovDesc.Usage = D3D11_USAGE_STAGING;
+    aovDesc.BindFlags = 0;
+    aovDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+    m_pDevice->CreateTexture2D(&aovDesc, nullptr, &m_pRedshiftStagingTex);
+    aovDesc.Format = DXGI_FORMAT_R32G32_UINT;
+    m_pDevice->CreateTexture2D(&aovDesc, nullptr, &m_pAovStagingTex);
+
+    // 6. ݵۼӻ
+    D3D11_BUFFER_DESC accumDesc = { (UINT)w * (UINT)h * 4 * sizeof(float), D3D11_USAGE_DEFAULT, D3D11_BIND_UNORDERED_ACCESS, 0,
+        D3D11_RESOURCE_MISC_BUFFER_STRUCTURED, 4 * sizeof(float) };
+    m_pDevice->CreateBuffer(&accumDesc, nullptr, &m_pAccumBuffer);
+    D3D11_UNORDERED_ACCESS_VIEW_DESC accumUavDesc = {};
+    accumUavDesc.Format = DXGI_FORMAT_UNKNOWN;
+    accumUavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+    accumUavDesc.Buffer.NumElements = (UINT)w * (UINT)h;
+    if (m_pAccumBuffer) m_pDevice->CreateUnorderedAccessView(m_pAccumBuffer.Get(), &accumUavDesc, &m_pAccumUAV);
+
     return true;
 }
 
 //  CPU ʵʱ̬ݣͬ GPU 㵥Ԫ
-void CBlackHole_GPUManager::UpdateParams(const CameraParameters& cam, int w, int h) {
+void CBlackHole_GPUManager::UpdateParams(const CameraParameters& cam, int w, int h, unsigned int frameIndex) {
     // 1. ȫ
     if (!m_pConstantBuffer || !m_pContext) return;
 
+    // ۼӻؽʱûе 0 ֻܴ֡ͷʼûжͼʱۻ
+    m_frameIndex = (m_bAccumValid && m_pBlueNoiseSRV) ? frameIndex : 0;
+    m_bAccumValid = true;
+
+    // ̨غõպУд֮ǰʧܻ˲ͬһ֡Ч
+    PollSkybox();
+
     // 2. ӳԴṹ壺ڽԴַָ뼰ŲϢ
     D3D11_MAPPED_SUBRESOURCE ms;
 
@@ -111,30 +142,120 @@ void CBlackHole_GPUManager::UpdateParams(const CameraParameters& cam, int w, int
         p->mass = m_theBlackHole.getMass();
         p->spin = m_theBlackHole.getSpin();
 
+        // дղͼʧʱ˻سǿգһֱʾռλͼ
+        const bool bTextureFailed = !m_skyboxMetrics.failReason.empty();
+        // ɫֻͼ (0) ͳǿ (1)ͼ·ǱʵʱԤóǿ
+        // ĵûбû決ãʱ m_pEnvSRV Ϊգͬ˻سǿգȥռλͼ
+        const bool bStars = (m_skySettings.source == SkySource::ProceduralStars) || (m_skySettings.source == SkySource::Catalog) ||
+            (m_skySettings.source == SkySource::Texture && bTextureFailed) ||
+            (m_skySettings.source == SkySource::Environment && !m_pEnvSRV);
+        p->skySource = bStars ? 1u : 0u;
+        p->starGrid = m_skySettings.starGrid;
+        p->starBrightness = m_skySettings.starBrightness;
+        p->starSeed = m_skySettings.starSeed;
+        p->frameIndex = m_frameIndex;
+
         // 6. ӳ䣺֪ GPU ݸϣ½ķȨԿ 
         m_pContext->Unmap(m_pConstantBuffer.Get(), 0);
     }
 }
 
 
+void CBlackHole_GPUManager::SetEnvironment(const std::shared_ptr<const SkyImage>& image) {
+    // ͬһͼظϴлʱֻǻһָ룬ϴһԼ 32 MB
+    if (image == m_envImage || !m_pDevice) return;
+    m_envImage = image;
+    m_pEnvSRV.Reset();
+    if (image) CBlackHole_SkyboxLoader::CreateTexture(m_pDevice.Get(), *image, m_pEnvSRV);
+}
+
+bool CBlackHole_GPUManager::SkyboxSwapPending() const {
+    const SkyboxLoadState state = m_skyboxLoader.State();
+    return state == SkyboxLoadState::Ready || state == SkyboxLoadState::Failed;
+}
+
+void CBlackHole_GPUManager::PollSkybox() {
+    // һеͼʱύ
+    if (m_skySettings.source == SkySource::Texture && !m_bSkyboxRequested && m_pDevice) {
+        m_bSkyboxRequested = true;
+        m_skyboxLoader.RequestLoad(kDefaultSkyboxPath, m_pDevice.Get());
+    }
+
+    ComPtr<ID3D11ShaderResourceView> srv;
+    SkyboxLoadMetrics metrics;
+    const SkyboxLoadState state = m_skyboxLoader.Poll(srv, metrics);
+    if (state == SkyboxLoadState::Idle || state == SkyboxLoadState::Pending) return;
+
+    m_skyboxMetrics = metrics;
+    ON_wString str;
+    if (state == SkyboxLoadState::Ready && srv) {
+        m_pSkyboxSRV = srv;     // ָֻ뽻Ῠסһ֡
+        str.Format(L"BlackHole: skybox %dx%d ready in %.1f ms (queue %.1f, decode %.1f, upload %.1f)\n",
+            metrics.width, metrics.height, metrics.totalMs, metrics.queueMs, metrics.decodeMs, metrics.uploadMs);
+    }
+    else {
+        // ʧʱռλգԭ򱨸ǾĬ¿Դ
+        str.Format(L"BlackHole: skybox load failed after %.1f ms (%S), falling back to procedural stars\n",
+            metrics.totalMs, metrics.failReason.c_str());
+    }
+    RhinoApp().Print(str);
+}
+
 void CBlackHole_GPUManager::Dispatch(int w, int h) {
     // 1. ״̬
     m_pContext->CSSetShader(m_pShader.Get(), nullptr, 0);
     m_pContext->CSSetConstantBuffers(0, 1, m_pConstantBuffer.GetAddressOf());
 
-    if (m_pSkyboxSRV && m_pSkyboxSampler) {
-        m_pContext->CSSetShaderResources(0, 1, m_pSkyboxSRV.GetAddressOf());
+    // ģʽʹú決õĻͼδʱռλ
+    ID3D11ShaderResourceView* pSkySRV = (m_skySettings.source == SkySource::Environment && m_pEnvSRV) ? m_pEnvSRV.Get() : m_pSkyboxSRV.Get();
+    if (pSkySRV && m_pSkyboxSampler) {
+        m_pContext->CSSetShaderResources(0, 1, &pSkySRV);
         m_pContext->CSSetSamplers(0, 1, m_pSkyboxSampler.GetAddressOf());
     }
 
+    if (m_pBlueNoiseSRV)
+        m_pContext->CSSetShaderResources(1, 1, m_pBlueNoiseSRV.GetAddressOf());
+
     // 2. ͨ
-    m_pContext->CSSetUnorderedAccessViews(0, 1, m_pUAV.GetAddressOf(), nullptr);
+    ID3D11UnorderedAccessView* uavs[4] = { m_pUAV.Get(), m_pAovUAV.Get(), m_pRedshiftUAV.Get(), m_pAccumUAV.Get() };
+    m_pContext->CSSetUnorderedAccessViews(0, 4, uavs, nullptr);
 
     // 3. 
     m_pContext->Dispatch((w + 15) / 16, (h + 15) / 16, 1);
 
     // 4. ɹͬ
     m_pContext->CopyResource(m_pStagingTex.Get(), m_pOutputTex.Get());
+    if (m_bAovReadback && 0 == m_frameIndex) {
+        m_pContext->CopyResource(m_pAovStagingTex.Get(), m_pAovTex.Get());
+        m_pContext->CopyResource(m_pRedshiftStagingTex.Get(), m_pRedshiftTex.Get());
+    }
+}
+
+bool CBlackHole_GPUManager::ReadAovs(CBlackHole_AovBuffer& out) {
+    if (!m_bAovReadback || 0 != m_frameIndex || !m_pAovStagingTex || !m_pRedshiftStagingTex) return false;
+    if (out.Width() != m_currentWidth || out.Height() != m_currentHeight) out.Resize(m_currentWidth, m_currentHeight);
+
+    D3D11_MAPPED_SUBRESOURCE aov, redshift;
+    if (FAILED(m_pContext->Map(m_pAovStagingTex.Get(), 0, D3D11_MAP_READ, 0, &aov))) return false;
+    if (FAILED(m_pContext->Map(m_pRedshiftStagingTex.Get(), 0, D3D11_MAP_READ, 0, &redshift))) {
+        m_pContext->Unmap(m_pAovStagingTex.Get(), 0);
+        return false;
+    }
+
+    // Ѿǽոʽֻ
+    for (int y = 0; y < m_currentHeight; ++y) {
+        const uint32_t* pAov = (const uint32_t*)((const char*)aov.pData + (size_t)y * aov.RowPitch);
+        const uint16_t* pRedshift = (const uint16_t*)((const char*)redshift.pData + (size_t)y * redshift.RowPitch);
+        for (int x = 0; x < m_currentWidth; ++x) {
+            const uint32_t a = pAov[2 * x], b = pAov[2 * x + 1];
+            out.SetPacked((size_t)y * m_currentWidth + x, (uint16_t)(a & 0xFFFF), (uint8_t)(a >> 16),
+                (uint16_t)(b & 0xFFFF), (uint16_t)(b >> 16), pRedshift[x]);
+        }
+    }
+
+    m_pContext->Unmap(m_pRedshiftStagingTex.Get(), 0);
+    m_pContext->Unmap(m_pAovStagingTex.Get(), 0);
+    return true;
 }
 
 void* CBlackHole_GPUManager::MapResult(UINT& pitch) {
@@ -4,23 +4,48 @@
 #include <d3dcompiler.h>
 #include "CBlackHole_Common.h"
 #include "CBlackHole_TheBlackHole.h"
+#include "CBlackHole_SkyboxLoader.h"
+#include "CBlackHole_AovBuffer.h"
 
 using Microsoft::WRL::ComPtr;
 
 class CBlackHole_GPUManager {
 public:
     bool Initialize(int w, int h);
-    void UpdateParams(const CameraParameters& cam, int w, int h);
+    // frameIndex Ϊݵ֡ţ0 ¿ʼ֮ۼӣߴ仯ۼӻؽǴ 0 ʼ
+    void UpdateParams(const CameraParameters& cam, int w, int h, unsigned int frameIndex = 0);
+    unsigned int FrameIndex() const { return m_frameIndex; }   // һ UpdateParams ʵʹõ֡
     void Dispatch(int w, int h);
     void* MapResult(UINT& rowPitch);
     void UnmapResult();
+
+    // ɫڵ 0 ֡д򿪶غ Dispatch ͬʱǿݴReadAovs չ out봰ͬߴ磩֡ false
+    void SetAovReadback(bool bReadback) { m_bAovReadback = bReadback; }
+    bool ReadAovs(CBlackHole_AovBuffer& out);
     void Release();
+    void SetSkySettings(const SkySettings& sky) { m_skySettings = sky; }
+    void SetEnvironment(const std::shared_ptr<const SkyImage>& image);  //  Initialize ֮
+
+    // ̨պɵû룬Ҫٻһ֡
+    bool SkyboxSwapPending() const;
+
+    // һպмصͳƣδʱ totalMs Ϊ 0
+    SkyboxLoadMetrics SkyboxMetrics() const { return m_skyboxMetrics; }
 
 private:
+    void PollSkybox();  // ̨ɵպ
+
     TheBlackHole m_theBlackHole;
 
     ComPtr<ID3D11ShaderResourceView> m_pSkyboxSRV;   // HDR Դͼ
     ComPtr<ID3D11SamplerState>       m_pSkyboxSampler; // 
+    CBlackHole_SkyboxLoader          m_skyboxLoader;   // ̨ͼǰռλ
+    SkyboxLoadMetrics                m_skyboxMetrics;  // غʱͳ
+    bool                             m_bSkyboxRequested = false;   // ͼֻڵһҪʱأǿղ
+    SkySettings                      m_skySettings;    // ǰ֡ʹõ
+    std::shared_ptr<const SkyImage>  m_envImage;       // ǰϴĻͼжǷҪϴ
+    ComPtr<ID3D11ShaderResourceView> m_pEnvSRV;        // 決 RDK ͼ
+    ComPtr<ID3D11ShaderResourceView> m_pBlueNoiseSRV;  // ֡õͼ
 
     //  ǰӴߣжǷҪؽ
     int m_currentWidth = 0;
@@ -33,4 +58,19 @@ private:
     ComPtr<ID3D11Texture2D>         m_pOutputTex;   // άԴ
     ComPtr<ID3D11UnorderedAccessView> m_pUAV;   // ͼ
     ComPtr<ID3D11Texture2D>         m_pStagingTex;  // ݴԴ
+
+    //  / Ȧ / 䳤 / ƫ۽ǴΪ R32G32_UINTƵһ R16_FLOAT
+    ComPtr<ID3D11Texture2D>         m_pAovTex;
+    ComPtr<ID3D11UnorderedAccessView> m_pAovUAV;
+    ComPtr<ID3D11Texture2D>         m_pAovStagingTex;
+    ComPtr<ID3D11Texture2D>         m_pRedshiftTex;
+    ComPtr<ID3D11UnorderedAccessView> m_pRedshiftUAV;
+    ComPtr<ID3D11Texture2D>         m_pRedshiftStagingTex;
+    bool                            m_bAovReadback = false;   // ʵʱӿֻʾɫĬϲ
+
+    // ݵɫۼӣÿһ float4
+    ComPtr<ID3D11Buffer>            m_pAccumBuffer;
+    ComPtr<ID3D11UnorderedAccessView> m_pAccumUAV;
+    unsigned int                    m_frameIndex = 0;
+    bool                            m_bAccumValid = false;    // ۼӻǷߴĵ 0 ֡
 };
\ No newline at end of file
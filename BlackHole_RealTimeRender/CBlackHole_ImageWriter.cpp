@@ -0,0 +1,682 @@
+﻿// CBlackHole_ImageWriter.cpp
+#include "stdafx.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <cwctype>
+#include <immintrin.h>
+#include "CBlackHole_CPUFeatures.h"
+#include "CBlackHole_ImageWriter.h"
+#include "CBlackHole_ThreadPool.h"
+
+namespace {
+
+const int kExrScanlineRows = 16;    // ZIP 压缩每块 16 行
+const int kExrTileSize = 64;
+const int kBandRows = 16;           // PNG / PFM 的行组
+const size_t kIdatSize = 1 << 20;   // 攒够这么多压缩数据写一个 IDAT 块
+
+// EXR 内部都是小端
+void PutU32(std::vector<uint8_t>& b, uint32_t v) {
+    for (int k = 0; k < 4; ++k) b.push_back((uint8_t)(v >> (8 * k)));
+}
+
+void PutF32(std::vector<uint8_t>& b, float f) {
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    PutU32(b, u);
+}
+
+void PutStr(std::vector<uint8_t>& b, const char* s) {
+    while (*s) b.push_back((uint8_t)*s++);
+    b.push_back(0);
+}
+
+void PutAttr(std::vector<uint8_t>& b, const char* name, const char* type, const std::vector<uint8_t>& value) {
+    PutStr(b, name);
+    PutStr(b, type);
+    PutU32(b, (uint32_t)value.size());
+    b.insert(b.end(), value.begin(), value.end());
+}
+
+// PNG 是大端
+void PutBE32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+// 长度、类型、数据与 CRC
+bool WritePngChunk(FILE* fp, const char type[4], const uint8_t* data, size_t size) {
+    uint8_t head[8];
+    PutBE32(head, (uint32_t)size);
+    memcpy(head + 4, type, 4);
+    ON__UINT32 crc = ON_CRC32(0, 4, type);
+    if (size > 0) crc = ON_CRC32(crc, size, data);
+    uint8_t tail[4];
+    PutBE32(tail, crc);
+    return 8 == fwrite(head, 1, 8, fp) && size == fwrite(data, 1, size, fp) && 4 == fwrite(tail, 1, 4, fp);
+}
+
+void PngHeader(int width, int height, int bits, uint8_t ihdr[13]) {
+    PutBE32(ihdr, (uint32_t)width);
+    PutBE32(ihdr + 4, (uint32_t)height);
+    ihdr[8] = (uint8_t)bits;
+    ihdr[9] = 6;                        // RGBA
+    ihdr[10] = ihdr[11] = ihdr[12] = 0;
+}
+
+size_t SampleBytes(ExrPixelType type) {
+    return (ExrPixelType::Half == type) ? 2 : 4;
+}
+
+// n 个 float 按存储类型写到 dst（小端）
+void PackSamples(ExrPixelType type, const float* src, int n, uint8_t* dst) {
+    switch (type) {
+    case ExrPixelType::Half: {
+        // 支持 F16C 时一次转换 8 个，其余的（或不支持时全部）逐个按位转换
+        static const bool bF16C = CBlackHole_CPUFeatures::HasF16C();
+        int i = 0;
+        if (bF16C) {
+            for (; i + 8 <= n; i += 8)
+                _mm_storeu_si128((__m128i*)(dst + 2 * i), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), 0));
+        }
+        for (; i < n; ++i) {
+            const uint16_t h = CBlackHole_AovBuffer::FloatToHalf(src[i]);
+            memcpy(dst + 2 * i, &h, 2);
+        }
+        break;
+    }
+    case ExrPixelType::Float:
+        memcpy(dst, src, (size_t)n * 4);
+        break;
+    case ExrPixelType::Uint:
+        for (int i = 0; i < n; ++i) {
+            const float f = src[i];
+            const uint32_t u = (f > 0.0f) ? ((f < 4294967040.0f) ? (uint32_t)f : 0xFFFFFFFFu) : 0u;
+            memcpy(dst + 4 * (size_t)i, &u, 4);
+        }
+        break;
+    }
+}
+
+// 整段数据压成一个 zlib 流
+bool Deflate(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    out.clear();
+    ON_CompressStream stream;
+    stream.SetCallback([](void* context, ON__UINT32 n, const void* p) -> bool {
+        std::vector<uint8_t>* pOut = (std::vector<uint8_t>*)context;
+        pOut->insert(pOut->end(), (const uint8_t*)p, (const uint8_t*)p + n);
+        return true;
+    }, &out);
+    return stream.Begin() && stream.In(size, data) && stream.End();
+}
+
+// EXR 的 ZIP：字节按奇偶位置拆成前后两半，再做一阶差分，最后 zlib 压缩；压不小时原样存放（读者按大小判断）
+void ExrZip(const std::vector<uint8_t>& raw, std::vector<uint8_t>& out) {
+    const size_t n = raw.size();
+    std::vector<uint8_t> tmp(n);
+    uint8_t* t1 = tmp.data();
+    uint8_t* t2 = tmp.data() + (n + 1) / 2;
+    for (size_t i = 0; i < n; ++i) {
+        if (i & 1) *t2++ = raw[i];
+        else *t1++ = raw[i];
+    }
+    for (size_t i = n; i-- > 1;) tmp[i] = (uint8_t)(tmp[i] - tmp[i - 1] + 128);
+
+    if (!Deflate(tmp.data(), n, out) || out.size() >= n) out = raw;
+}
+
+float LinearToSrgb(float v) {
+    v = (v > 0.0f) ? ((v < 1.0f) ? v : 1.0f) : 0.0f;
+    return (v <= 0.0031308f) ? 12.92f * v : 1.055f * powf(v, 1.0f / 2.4f) - 0.055f;
+}
+
+uint8_t Paeth(uint8_t a, uint8_t b, uint8_t c) {
+    const int p = (int)a + b - c;
+    const int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    return (pa <= pb && pa <= pc) ? a : ((pb <= pc) ? b : c);
+}
+
+// 一行选和最小的滤波器（按有符号字节的绝对值）；行组的第一行不能引用上一组，只在 None / Sub 中选
+void FilterPngRow(const uint8_t* row, const uint8_t* prev, size_t n, int bpp, uint8_t* out) {
+    uint8_t* best = out;
+    std::vector<uint8_t> trial(n + 1);
+    uint64_t bestSum = UINT64_MAX;
+    const int filterCount = prev ? 5 : 2;
+    for (int f = 0; f < filterCount; ++f) {
+        trial[0] = (uint8_t)f;
+        uint64_t sum = 0;
+        for (size_t i = 0; i < n; ++i) {
+            const uint8_t a = (i >= (size_t)bpp) ? row[i - bpp] : 0;
+            const uint8_t b = prev ? prev[i] : 0;
+            const uint8_t c = (prev && i >= (size_t)bpp) ? prev[i - bpp] : 0;
+            uint8_t v = row[i];
+            switch (f) {
+            case 1: v = (uint8_t)(v - a); break;
+            case 2: v = (uint8_t)(v - b); break;
+            case 3: v = (uint8_t)(v - ((a + b) >> 1)); break;
+            case 4: v = (uint8_t)(v - Paeth(a, b, c)); break;
+            }
+            trial[i + 1] = v;
+            sum += (v < 128) ? v : 256 - v;
+        }
+        if (sum < bestSum) {
+            bestSum = sum;
+            memcpy(best, trial.data(), n + 1);
+        }
+    }
+}
+
+}  // namespace
+
+// ==========================================
+// 1. 帧数据
+
+void RenderedFrame::Resize(int w, int h) {
+    width = w;
+    height = h;
+    rgba.assign((size_t)w * h * 4, 0.0f);
+    depth.assign((size_t)w * h, FLT_MAX);
+    aov.Resize(w, h);
+}
+
+std::vector<ImageChannel> RenderedFrame::Channels(ImageFileFormat format, const ImageWriteSettings& settings) const {
+    std::vector<ImageChannel> channels;
+    const ExrPixelType colorType = settings.exrHalf ? ExrPixelType::Half : ExrPixelType::Float;
+
+    const int colorCount = (ImageFileFormat::Pfm == format) ? 3 : 4;
+    const char* colorNames[4] = { "R", "G", "B", "A" };
+    for (int c = 0; c < colorCount; ++c) {
+        channels.push_back({ colorNames[c], colorType, [this, c](int y, int rows, float* out) {
+            const float* src = &rgba[(size_t)y * width * 4 + c];
+            const size_t n = (size_t)width * rows;
+            for (size_t i = 0; i < n; ++i) out[i] = src[4 * i];
+        } });
+    }
+    if (ImageFileFormat::Exr != format)
+        return channels;
+
+    channels.push_back({ "Z", ExrPixelType::Float, [this](int y, int rows, float* out) {
+        memcpy(out, &depth[(size_t)y * width], (size_t)width * rows * sizeof(float));
+    } });
+
+    // 辅助输出放在 aov 层下，计数为整数，连续量跟颜色同精度
+    struct { const char* name; AovChannel channel; bool bCount; } aovs[] = {
+        { "aov.steps", AovChannel::Steps, true },
+        { "aov.affineLength", AovChannel::AffineLength, false },
+        { "aov.deflection", AovChannel::Deflection, false },
+        { "aov.halfOrbits", AovChannel::HalfOrbits, true },
+        { "aov.redshift", AovChannel::Redshift, false },
+    };
+    for (const auto& a : aovs) {
+        const AovChannel channel = a.channel;
+        channels.push_back({ a.name, a.bCount ? ExrPixelType::Uint : colorType, [this, channel](int y, int rows, float* out) {
+            aov.Expand(channel, y, rows, out);
+        } });
+    }
+    return channels;
+}
+
+// ==========================================
+// 2. 写入器
+
+CBlackHole_ImageWriter::CBlackHole_ImageWriter(CBlackHole_ThreadPool& pool) : m_pool(pool) {
+}
+
+CBlackHole_ImageWriter::~CBlackHole_ImageWriter() {
+    Abort();
+}
+
+bool CBlackHole_ImageWriter::FormatFromPath(const std::wstring& path, ImageFileFormat& format) {
+    const size_t dot = path.find_last_of(L'.');
+    if (std::wstring::npos == dot) return false;
+    std::wstring ext = path.substr(dot + 1);
+    for (wchar_t& c : ext) c = (wchar_t)towlower(c);
+    if (L"exr" == ext) format = ImageFileFormat::Exr;
+    else if (L"pfm" == ext) format = ImageFileFormat::Pfm;
+    else if (L"png" == ext) format = ImageFileFormat::Png;
+    else return false;
+    return true;
+}
+
+uint8_t CBlackHole_ImageWriter::LinearToSrgb8(float v) {
+    return (uint8_t)(LinearToSrgb(v) * 255.0f + 0.5f);
+}
+
+bool CBlackHole_ImageWriter::WritePng8(const std::wstring& path, int width, int height, const uint8_t* rgba, size_t stride, std::wstring& errorOut) {
+    // 整幅滤波后压成一个 IDAT
+    const size_t rowBytes = (size_t)width * 4;
+    std::vector<uint8_t> filtered((rowBytes + 1) * height), packed;
+    for (int y = 0; y < height; ++y)
+        FilterPngRow(rgba + y * stride, y > 0 ? rgba + (y - 1) * stride : nullptr, rowBytes, 4, &filtered[(rowBytes + 1) * y]);
+    if (!Deflate(filtered.data(), filtered.size(), packed)) {
+        errorOut = L"compression failed";
+        return false;
+    }
+
+    FILE* fp = nullptr;
+    if (0 != _wfopen_s(&fp, path.c_str(), L"wb") || nullptr == fp) {
+        errorOut = L"cannot create file";
+        return false;
+    }
+    static const uint8_t signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+    uint8_t ihdr[13];
+    PngHeader(width, height, 8, ihdr);
+    const uint8_t srgb = 0;
+    bool ok = 8 == fwrite(signature, 1, 8, fp) && WritePngChunk(fp, "IHDR", ihdr, sizeof(ihdr)) && WritePngChunk(fp, "sRGB", &srgb, 1) &&
+        WritePngChunk(fp, "IDAT", packed.data(), packed.size()) && WritePngChunk(fp, "IEND", nullptr, 0);
+    ok = (0 == fclose(fp)) && ok;
+    if (!ok) {
+        errorOut = L"write failed (disk full?)";
+        _wremove(path.c_str());
+    }
+    return ok;
+}
+
+int CBlackHole_ImageWriter::BandRows(ImageFileFormat format, const ImageWriteSettings& settings) {
+    if (ImageFileFormat::Exr == format) return settings.exrTiled ? kExrTileSize : kExrScanlineRows;
+    return kBandRows;
+}
+
+uint64_t CBlackHole_ImageWriter::BandBytes(ImageFileFormat format, int width, const std::vector<ImageChannel>& channels, const ImageWriteSettings& settings) {
+    const uint64_t rows = (uint64_t)BandRows(format, settings);
+    uint64_t planeBytes = 0, packedBytes = 0, blockPixels = rows * width;
+    if (ImageFileFormat::Exr == format) {
+        planeBytes = channels.size() * sizeof(float);
+        for (const ImageChannel& c : channels) packedBytes += SampleBytes(c.type);
+        if (settings.exrTiled) blockPixels = (uint64_t)kExrTileSize * kExrTileSize;
+    }
+    else if (ImageFileFormat::Pfm == format) {
+        planeBytes = packedBytes = 3 * sizeof(float);
+    }
+    else {
+        planeBytes = 4 * sizeof(float);
+        packedBytes = 4 * (uint64_t)((16 == settings.pngBits) ? 2 : 1);
+    }
+    return rows * width * (planeBytes + packedBytes) + 2 * blockPixels * packedBytes;
+}
+
+bool CBlackHole_ImageWriter::Begin(const std::wstring& path, ImageFileFormat format, int width, int height,
+    std::vector<ImageChannel> channels, const ImageWriteSettings& settings, std::wstring& errorOut) {
+    Abort();
+
+    const size_t minChannels = (ImageFileFormat::Png == format) ? 4 : ((ImageFileFormat::Pfm == format) ? 3 : 1);
+    if (width <= 0 || height <= 0 || channels.size() < minChannels) {
+        errorOut = L"nothing to write";
+        return false;
+    }
+
+    m_format = format;
+    m_width = width;
+    m_height = height;
+    m_settings = settings;
+    m_settings.pngBits = (16 == settings.pngBits) ? 16 : 8;
+    m_channels = std::move(channels);
+    m_channels.resize((ImageFileFormat::Exr == format) ? m_channels.size() : minChannels);
+    m_stats = ImageWriteStats();
+
+    // 1. 文件头
+    std::vector<uint8_t> header;
+    if (ImageFileFormat::Exr == format) {
+        std::sort(m_channels.begin(), m_channels.end(), [](const ImageChannel& a, const ImageChannel& b) { return a.name < b.name; });
+
+        size_t pixelBytes = 0;
+        std::vector<uint8_t> chlist;
+        for (const ImageChannel& c : m_channels) {
+            if (c.name.empty() || c.name.size() > 31) {
+                errorOut = L"channel name must be 1-31 characters";
+                return false;
+            }
+            PutStr(chlist, c.name.c_str());
+            PutU32(chlist, (uint32_t)c.type);
+            PutU32(chlist, 0);              // pLinear 与 3 个保留字节
+            PutU32(chlist, 1);              // x / y 采样间隔
+            PutU32(chlist, 1);
+            pixelBytes += SampleBytes(c.type);
+        }
+        chlist.push_back(0);
+        m_stats.rawBytes = (uint64_t)pixelBytes * width * height;
+
+        std::vector<uint8_t> box;
+        PutU32(box, 0);
+        PutU32(box, 0);
+        PutU32(box, (uint32_t)(width - 1));
+        PutU32(box, (uint32_t)(height - 1));
+        std::vector<uint8_t> v2f, one;
+        PutF32(v2f, 0.0f);
+        PutF32(v2f, 0.0f);
+        PutF32(one, 1.0f);
+
+        PutU32(header, 20000630);           // 魔数 76 2f 31 01
+        PutU32(header, 2 | (settings.exrTiled ? 0x200 : 0));
+        PutAttr(header, "channels", "chlist", chlist);
+        PutAttr(header, "compression", "compression", { 3 });   // ZIP
+        PutAttr(header, "dataWindow", "box2i", box);
+        PutAttr(header, "displayWindow", "box2i", box);
+        PutAttr(header, "lineOrder", "lineOrder", { 0 });       // INCREASING_Y
+        PutAttr(header, "pixelAspectRatio", "float", one);
+        PutAttr(header, "screenWindowCenter", "v2f", v2f);
+        PutAttr(header, "screenWindowWidth", "float", one);
+        size_t blockCount = ((size_t)height + kExrScanlineRows - 1) / kExrScanlineRows;
+        if (settings.exrTiled) {
+            std::vector<uint8_t> tiles;
+            PutU32(tiles, kExrTileSize);
+            PutU32(tiles, kExrTileSize);
+            tiles.push_back(0);             // ONE_LEVEL，向下取整
+            PutAttr(header, "tiles", "tiledesc", tiles);
+            blockCount = (((size_t)width + kExrTileSize - 1) / kExrTileSize) * (((size_t)height + kExrTileSize - 1) / kExrTileSize);
+        }
+        header.push_back(0);
+
+        // 偏移表先占位，写完再回填
+        m_offsetTablePos = (int64_t)header.size();
+        m_offsets.assign(blockCount, 0);
+        m_nextBlock = 0;
+        header.resize(header.size() + blockCount * sizeof(uint64_t), 0);
+    }
+    else if (ImageFileFormat::Pfm == format) {
+        char text[64];
+        const int n = snprintf(text, sizeof(text), "PF\n%d %d\n-1.0\n", width, height);   // 负比例表示小端
+        header.assign(text, text + n);
+        m_dataStart = (int64_t)header.size();
+        m_stats.rawBytes = (uint64_t)width * height * 3 * sizeof(float);
+    }
+    else {
+        static const uint8_t signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+        header.assign(signature, signature + 8);
+        m_stats.rawBytes = (uint64_t)height * (1 + (uint64_t)width * 4 * (m_settings.pngBits / 8));
+    }
+
+    FILE* fp = nullptr;
+    if (0 != _wfopen_s(&fp, path.c_str(), L"wb") || nullptr == fp) {
+        errorOut = L"cannot create file";
+        return false;
+    }
+    m_fp = fp;
+    m_path = path;
+
+    bool ok = header.size() == fwrite(header.data(), 1, header.size(), m_fp);
+    if (ImageFileFormat::Png == format) {
+        uint8_t ihdr[13];
+        PngHeader(width, height, m_settings.pngBits, ihdr);
+        const uint8_t srgb = 0;             // 感知意图
+        ok = ok && WritePngChunk(m_fp, "IHDR", ihdr, sizeof(ihdr)) && WritePngChunk(m_fp, "sRGB", &srgb, 1);
+
+        m_idat.clear();
+        m_pPngStream.reset(new ON_CompressStream());
+        m_pPngStream->SetCallback([](void* context, ON__UINT32 n, const void* p) -> bool {
+            CBlackHole_ImageWriter* pWriter = (CBlackHole_ImageWriter*)context;
+            pWriter->m_idat.insert(pWriter->m_idat.end(), (const uint8_t*)p, (const uint8_t*)p + n);
+            if (pWriter->m_idat.size() < kIdatSize) return true;
+            const bool bWritten = WritePngChunk(pWriter->m_fp, "IDAT", pWriter->m_idat.data(), pWriter->m_idat.size());
+            pWriter->m_idat.clear();
+            return bWritten;
+        }, this);
+        ok = ok && m_pPngStream->Begin();
+    }
+    if (!ok) {
+        errorOut = L"write failed (disk full?)";
+        Abort();
+        return false;
+    }
+
+    // 2. 行组
+    const int bandRows = BandRows(m_format, m_settings);
+    const int bandCount = (height + bandRows - 1) / bandRows;
+    m_rowReady.assign(height, 0);
+    m_bandMissing.assign(bandCount, bandRows);
+    m_bandMissing[bandCount - 1] = height - (bandCount - 1) * bandRows;
+    m_bands.assign(bandCount, Band());
+    m_queued.clear();
+    m_running = 0;
+    m_nextBand = 0;
+    m_bWriting = false;
+    m_inFlight = 0;
+    m_bFailed = false;
+    m_lastReady = std::chrono::high_resolution_clock::now();
+    return true;
+}
+
+void CBlackHole_ImageWriter::RowsReady(int y0, int y1) {
+    if (!m_fp) return;
+    y0 = (y0 > 0) ? y0 : 0;
+    y1 = (y1 < m_height) ? y1 : m_height;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const int bandRows = BandRows(m_format, m_settings);
+    for (int y = y0; y < y1; ++y) {
+        if (m_rowReady[y]) continue;
+        m_rowReady[y] = 1;
+        const int band = y / bandRows;
+        if (0 != --m_bandMissing[band]) continue;
+
+        ++m_inFlight;
+        m_queued.push_back(band);
+    }
+    SubmitQueued();
+    m_lastReady = std::chrono::high_resolution_clock::now();
+}
+
+// 持锁调用；写盘已经失败时排队的行组不再编码
+void CBlackHole_ImageWriter::SubmitQueued() {
+    if (m_bFailed) {
+        m_inFlight -= (int)m_queued.size();
+        m_queued.clear();
+    }
+    while (!m_queued.empty() && (m_maxRunning <= 0 || m_running < m_maxRunning)) {
+        const int band = m_queued.front();
+        m_queued.pop_front();
+        ++m_running;
+        m_pool.Submit([this, band]() {
+            const auto start = std::chrono::high_resolution_clock::now();
+            Band data = EncodeBand(band);
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            OnBandEncoded(band, std::move(data), ms);
+        });
+    }
+}
+
+void CBlackHole_ImageWriter::WaitWritten(int y) {
+    if (!m_fp) return;
+    y = (y < m_height) ? y : m_height;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    const int bandRows = BandRows(m_format, m_settings);
+    m_cvDone.wait(lock, [&]() { return m_nextBand * bandRows >= y || (m_bFailed && 0 == m_running); });
+}
+
+CBlackHole_ImageWriter::Band CBlackHole_ImageWriter::EncodeBand(int band) const {
+    Band out;
+    out.done = true;
+
+    const int bandRows = BandRows(m_format, m_settings);
+    const int y0 = band * bandRows;
+    const int rows = (y0 + bandRows < m_height) ? bandRows : m_height - y0;
+    const size_t planeSize = (size_t)m_width * rows;
+
+    // 1. 取出这一组行的各通道
+    std::vector<float> planes(m_channels.size() * planeSize);
+    for (size_t c = 0; c < m_channels.size(); ++c)
+        m_channels[c].fetch(y0, rows, &planes[c * planeSize]);
+
+    if (ImageFileFormat::Exr == m_format) {
+        // 2. EXR：每块（扫描线块或一个瓦片）内逐行、每行内逐通道存放
+        const int blockWidth = m_settings.exrTiled ? kExrTileSize : m_width;
+        const int blocksX = (m_width + blockWidth - 1) / blockWidth;
+        std::vector<uint8_t> raw, packed;
+        for (int bx = 0; bx < blocksX; ++bx) {
+            const int x0 = bx * blockWidth;
+            const int bw = (x0 + blockWidth < m_width) ? blockWidth : m_width - x0;
+            raw.clear();
+            for (int r = 0; r < rows; ++r) {
+                for (size_t c = 0; c < m_channels.size(); ++c) {
+                    const size_t at = raw.size();
+                    raw.resize(at + SampleBytes(m_channels[c].type) * bw);
+                    PackSamples(m_channels[c].type, &planes[c * planeSize + (size_t)r * m_width + x0], bw, &raw[at]);
+                }
+            }
+            ExrZip(raw, packed);
+
+            std::vector<uint8_t> block;
+            block.reserve(packed.size() + 20);
+            if (m_settings.exrTiled) {
+                PutU32(block, (uint32_t)bx);
+                PutU32(block, (uint32_t)band);
+                PutU32(block, 0);           // 级别
+                PutU32(block, 0);
+            }
+            else {
+                PutU32(block, (uint32_t)y0);
+            }
+            PutU32(block, (uint32_t)packed.size());
+            block.insert(block.end(), packed.begin(), packed.end());
+            out.blocks.push_back(std::move(block));
+        }
+    }
+    else if (ImageFileFormat::Pfm == m_format) {
+        // 3. PFM：RGB 交错，行从下往上，所以组内倒序
+        std::vector<uint8_t> block(planeSize * 3 * sizeof(float));
+        float* dst = (float*)block.data();
+        for (int r = rows - 1; r >= 0; --r) {
+            for (int x = 0; x < m_width; ++x) {
+                for (int c = 0; c < 3; ++c) *dst++ = planes[c * planeSize + (size_t)r * m_width + x];
+            }
+        }
+        out.blocks.push_back(std::move(block));
+    }
+    else {
+        // 4. PNG：颜色转 sRGB，透明度保持线性，大端；每行前面是滤波类型
+        const int bytes = m_settings.pngBits / 8;
+        const size_t rowBytes = (size_t)m_width * 4 * bytes;
+        const float maxValue = (16 == m_settings.pngBits) ? 65535.0f : 255.0f;
+        std::vector<uint8_t> row(rowBytes), prev(rowBytes);
+        std::vector<uint8_t> block((rowBytes + 1) * rows);
+        for (int r = 0; r < rows; ++r) {
+            for (int x = 0; x < m_width; ++x) {
+                for (int c = 0; c < 4; ++c) {
+                    float v = planes[c * planeSize + (size_t)r * m_width + x];
+                    v = (c < 3) ? LinearToSrgb(v) : ((v > 0.0f) ? ((v < 1.0f) ? v : 1.0f) : 0.0f);
+                    const uint32_t q = (uint32_t)(v * maxValue + 0.5f);
+                    uint8_t* p = &row[((size_t)x * 4 + c) * bytes];
+                    if (2 == bytes) {
+                        p[0] = (uint8_t)(q >> 8);
+                        p[1] = (uint8_t)q;
+                    }
+                    else {
+                        p[0] = (uint8_t)q;
+                    }
+                }
+            }
+            FilterPngRow(row.data(), r > 0 ? prev.data() : nullptr, rowBytes, 4 * bytes, &block[(rowBytes + 1) * r]);
+            std::swap(row, prev);
+        }
+        out.blocks.push_back(std::move(block));
+    }
+    return out;
+}
+
+bool CBlackHole_ImageWriter::WriteBand(int band, const Band& data) {
+    bool ok = true;
+    for (const std::vector<uint8_t>& block : data.blocks) {
+        if (ImageFileFormat::Exr == m_format) {
+            m_offsets[m_nextBlock++] = (uint64_t)_ftelli64(m_fp);
+            ok = ok && block.size() == fwrite(block.data(), 1, block.size(), m_fp);
+        }
+        else if (ImageFileFormat::Pfm == m_format) {
+            const int y1 = (band + 1) * kBandRows < m_height ? (band + 1) * kBandRows : m_height;
+            const int64_t at = m_dataStart + (int64_t)(m_height - y1) * m_width * 3 * sizeof(float);
+            ok = ok && 0 == _fseeki64(m_fp, at, SEEK_SET) && block.size() == fwrite(block.data(), 1, block.size(), m_fp);
+        }
+        else {
+            ok = ok && m_pPngStream->In(block.size(), block.data());
+        }
+        m_stats.blocks++;
+    }
+    return ok;
+}
+
+void CBlackHole_ImageWriter::OnBandEncoded(int band, Band&& data, double ms) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_bands[band] = std::move(data);
+    m_stats.encodeMs += ms;
+    --m_running;
+
+    // 按文件顺序写出已编码的行组；别的线程在写时它写完会接着检查
+    while (!m_bWriting && m_nextBand < (int)m_bands.size() && m_bands[m_nextBand].done) {
+        m_bWriting = true;
+        const int next = m_nextBand;
+        const bool bSkip = m_bFailed;
+        Band ready = std::move(m_bands[next]);
+        m_bands[next].blocks.clear();
+        lock.unlock();
+        const bool ok = bSkip || WriteBand(next, ready);
+        lock.lock();
+        m_bFailed = m_bFailed || !ok;
+        m_nextBand++;
+        m_bWriting = false;
+    }
+    SubmitQueued();
+
+    // 持锁通知：Finish 看到没有在途任务就会返回，之后不能再访问成员
+    --m_inFlight;
+    m_cvDone.notify_all();
+}
+
+void CBlackHole_ImageWriter::WaitInFlight(std::unique_lock<std::mutex>& lock) {
+    m_cvDone.wait(lock, [this]() { return 0 == m_inFlight; });
+}
+
+bool CBlackHole_ImageWriter::Finish(std::wstring& errorOut) {
+    if (!m_fp) {
+        errorOut = L"no file open";
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    WaitInFlight(lock);
+    const bool bComplete = m_nextBand == (int)m_bands.size();
+    bool ok = bComplete && !m_bFailed;
+    lock.unlock();
+
+    // 收尾：EXR 回填偏移表，PNG 结束 zlib 流并写 IEND
+    if (ok && ImageFileFormat::Exr == m_format) {
+        ok = 0 == _fseeki64(m_fp, m_offsetTablePos, SEEK_SET) &&
+            m_offsets.size() == fwrite(m_offsets.data(), sizeof(uint64_t), m_offsets.size(), m_fp);
+    }
+    if (ok && ImageFileFormat::Png == m_format) {
+        ok = m_pPngStream->End();
+        if (ok && !m_idat.empty()) ok = WritePngChunk(m_fp, "IDAT", m_idat.data(), m_idat.size());
+        ok = ok && WritePngChunk(m_fp, "IEND", nullptr, 0);
+    }
+    if (ok) {
+        _fseeki64(m_fp, 0, SEEK_END);
+        m_stats.fileBytes = (uint64_t)_ftelli64(m_fp);
+    }
+    ok = (0 == fclose(m_fp)) && ok;
+    m_fp = nullptr;
+    m_pPngStream.reset();
+    m_stats.tailMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - m_lastReady).count();
+
+    if (!ok) {
+        errorOut = bComplete ? L"write failed (disk full?)" : L"not all rows were rendered";
+        _wremove(m_path.c_str());
+    }
+    return ok;
+}
+
+void CBlackHole_ImageWriter::Abort() {
+    if (!m_fp) return;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_bFailed = true;           // 还没写的行组直接跳过，排队的不再编码
+        SubmitQueued();
+        WaitInFlight(lock);
+    }
+    fclose(m_fp);
+    m_fp = nullptr;
+    m_pPngStream.reset();
+    _wremove(m_path.c_str());
+}
@@ -0,0 +1,175 @@
+﻿// CBlackHole_ImageWriter.h
+// 渲染结果导出：OpenEXR（扫描线或瓦片，半精度 / 单精度，含 AOV 的多通道）、PFM 与 8 / 16 位 PNG
+// 边渲染边写：行定稿后按块交给线程池转换与压缩，写盘仍按文件顺序进行，渲染结束时只剩最后几块没写
+#pragma once
+#include "stdafx.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "CBlackHole_AovBuffer.h"
+
+class CBlackHole_ThreadPool;
+
+enum class ImageFileFormat : int {
+    Exr = 0,
+    Pfm,
+    Png
+};
+
+// EXR 通道的存储类型，取值即文件中的 pixel_type
+enum class ExrPixelType : int {
+    Uint = 0,
+    Half = 1,
+    Float = 2
+};
+
+struct ImageWriteSettings {
+    bool exrHalf = true;        // 颜色与连续量的 AOV 存半精度；深度总是单精度，步数与半圈数为整数
+    bool exrTiled = false;      // 64x64 瓦片，否则每 16 行一块的扫描线；两者都是 ZIP 压缩
+    int  pngBits = 8;           // 8 或 16，颜色按 sRGB 编码
+};
+
+// 渲染时边渲染边写的文件，path 为空表示不写
+// 分条渲染：超过窗口能容纳的尺寸时每次只追踪整幅宽的一条，定稿的行直接写盘，内存只与宽度有关，不超过 memoryBudgetMB
+struct ImageOutputSettings {
+    std::wstring       path;
+    ImageWriteSettings write;
+    bool               strips = false;
+    int                memoryBudgetMB = 2048;
+    bool               deepZoom = false;    // 同时在 path 旁边生成 Deep Zoom 瓦片金字塔（.dzi 与 _files 目录）
+    int                checkpointSeconds = 0;   // 离线渲染每隔这么多秒把定稿的行存入检查点，崩溃或取消后再次渲染同一场景时接着渲染；0 为不存
+    bool               viewportAovs = false;    // 实时显示模式也把辅助输出写入渲染窗口，每帧多一次读回；下次启动实时显示时生效
+    bool               reorderRays = false;     // 离线渲染的纯天空波前先按冲击参数重排光线；屏幕顺序的通道利用率已在 99% 以上，重排只多出 1-10% 的排序开销，默认关闭
+};
+
+// 一个输出通道：fetch 取第 y 行起 rows 行，共 width * rows 个 float
+struct ImageChannel {
+    std::string  name;
+    ExrPixelType type = ExrPixelType::Float;
+    std::function<void(int y, int rows, float* out)> fetch;
+};
+
+// 一帧完整的渲染结果：线性 RGBA、深度与辅助输出
+struct RenderedFrame {
+    int                  width = 0;
+    int                  height = 0;
+    std::vector<float>   rgba;
+    std::vector<float>   depth;     // 天空为 FLT_MAX
+    CBlackHole_AovBuffer aov;
+
+    void Resize(int w, int h);
+
+    // 按格式列出通道：EXR 为全部通道，PNG 为 RGBA，PFM 为 RGB；fetch 引用本对象，写完之前须保持存活
+    std::vector<ImageChannel> Channels(ImageFileFormat format, const ImageWriteSettings& settings) const;
+};
+
+struct ImageWriteStats {
+    uint64_t rawBytes = 0;      // 按存储类型展开后的像素数据
+    uint64_t fileBytes = 0;
+    int      blocks = 0;        // EXR 的块或瓦片、PNG / PFM 的行组
+    double   encodeMs = 0.0;    // 各线程转换与压缩耗时之和
+    double   tailMs = 0.0;      // 最后一批行就绪到文件关闭
+};
+
+class CBlackHole_ImageWriter {
+public:
+    explicit CBlackHole_ImageWriter(CBlackHole_ThreadPool& pool);
+    ~CBlackHole_ImageWriter();      // 没有 Finish 时放弃并删除写了一半的文件
+
+    CBlackHole_ImageWriter(const CBlackHole_ImageWriter&) = delete;
+    CBlackHole_ImageWriter& operator=(const CBlackHole_ImageWriter&) = delete;
+
+    // 按扩展名（.exr / .pfm / .png，不分大小写）判断格式
+    static bool FormatFromPath(const std::wstring& path, ImageFileFormat& format);
+
+    // 线性值 -> 8 位 sRGB；已编码好的 8 位 RGBA 同步写成一个小 PNG（Deep Zoom 的瓦片）
+    static uint8_t LinearToSrgb8(float v);
+    static bool WritePng8(const std::wstring& path, int width, int height, const uint8_t* rgba, size_t stride, std::wstring& errorOut);
+
+    // 行组的高度与编码一个行组时的峰值内存（按通道取出的 float、打包后的数据、ZIP 的交错缓冲与压缩结果）
+    static int BandRows(ImageFileFormat format, const ImageWriteSettings& settings);
+    static uint64_t BandBytes(ImageFileFormat format, int width, const std::vector<ImageChannel>& channels, const ImageWriteSettings& settings);
+
+    // 同时编码的行组数上限，0 为不限；超大宽度时一个行组就有几十 MB，限制它才能控制内存
+    void SetMaxInFlight(int bands) { m_maxRunning = bands; }
+
+    // 创建文件并写出文件头；PNG 用前 4 个通道，PFM 用前 3 个
+    bool Begin(const std::wstring& path, ImageFileFormat format, int width, int height,
+        std::vector<ImageChannel> channels, const ImageWriteSettings& settings, std::wstring& errorOut);
+
+    // [y0, y1) 行已经定稿，之后不会再变；可以乱序、分多次给，重复的行忽略
+    // 一个块的行全部就绪后立即提交编码，不等前面的块
+    void RowsReady(int y0, int y1);
+
+    // 等到 y 之前的行都已写盘，之后不会再读取这些行的数据；这些行必须都已交出
+    void WaitWritten(int y);
+
+    // 等全部块写完并补上偏移表等收尾数据；还有行没就绪时失败
+    bool Finish(std::wstring& errorOut);
+    void Abort();
+
+    bool IsOpen() const { return nullptr != m_fp; }
+    const ImageWriteStats& Stats() const { return m_stats; }
+
+private:
+    struct Band {
+        std::vector<std::vector<uint8_t>> blocks;   // 按文件顺序
+        bool done = false;
+    };
+
+    Band EncodeBand(int band) const;
+    bool WriteBand(int band, const Band& data);
+    void OnBandEncoded(int band, Band&& data, double ms);
+    void SubmitQueued();
+    void WaitInFlight(std::unique_lock<std::mutex>& lock);
+
+    CBlackHole_ThreadPool&    m_pool;
+
+    ImageFileFormat           m_format = ImageFileFormat::Exr;
+    int                       m_width = 0;
+    int                       m_height = 0;
+    std::vector<ImageChannel> m_channels;       // EXR 按名字排序，即文件中的通道顺序
+    ImageWriteSettings        m_settings;
+    std::wstring              m_path;
+    FILE*                     m_fp = nullptr;
+
+    // 行就绪情况与每个行组还缺的行数
+    std::vector<char>         m_rowReady;
+    std::vector<int>          m_bandMissing;
+
+    // 就绪的行组先排队，同时编码的不超过 m_maxRunning 个
+    std::deque<int>           m_queued;
+    int                       m_maxRunning = 0;
+    int                       m_running = 0;
+
+    // 编码好的行组按顺序写盘；同一时刻只有一个线程在写
+    std::vector<Band>         m_bands;
+    int                       m_nextBand = 0;
+    bool                      m_bWriting = false;
+    int                       m_inFlight = 0;     // 排队与编码中的行组
+    bool                      m_bFailed = false;
+    std::mutex                m_mutex;
+    std::condition_variable   m_cvDone;
+
+    // EXR：偏移表的位置与内容
+    int64_t                   m_offsetTablePos = 0;
+    std::vector<uint64_t>     m_offsets;
+    size_t                    m_nextBlock = 0;
+
+    // PNG：整幅图是一个 zlib 流，按顺序喂给压缩器，输出攒成 IDAT 块
+    std::unique_ptr<ON_CompressStream> m_pPngStream;
+    std::vector<uint8_t>      m_idat;
+
+    // PFM：像素区的起点，行从下往上存
+    int64_t                   m_dataStart = 0;
+
+    ImageWriteStats           m_stats;
+    std::chrono::high_resolution_clock::time_point m_lastReady;
+};
@@ -0,0 +1,310 @@
+﻿// CBlackHole_LensedIBL.cpp
+#include "stdafx.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "CBlackHole_CPUTracer.h"
+#include "CBlackHole_ThreadPool.h"
+#include "CBlackHole_LensedIBL.h"
+
+// ==========================================
+// SH 基函数（实数形式，l <= 2）
+
+static void EvalSH9(const ON_3dVector& d, double Y[9]) {
+    Y[0] = 0.282095;
+    Y[1] = 0.488603 * d.y;
+    Y[2] = 0.488603 * d.z;
+    Y[3] = 0.488603 * d.x;
+    Y[4] = 1.092548 * d.x * d.y;
+    Y[5] = 1.092548 * d.y * d.z;
+    Y[6] = 0.315392 * (3.0 * d.z * d.z - 1.0);
+    Y[7] = 1.092548 * d.x * d.z;
+    Y[8] = 0.546274 * (d.x * d.x - d.y * d.y);
+}
+
+static double Luminance(const ON_3dVector& c) {
+    return 0.2126 * c.x + 0.7152 * c.y + 0.0722 * c.z;
+}
+
+// 等面积柱面网格：s 沿经度，t 沿 z，取值范围均为 [0, 格数)
+static ON_3dVector GridDir(double s, double t, int w, int h) {
+    const double phi = -ON_PI + 2.0 * ON_PI * s / w;
+    const double z = 1.0 - 2.0 * t / h;
+    double r = 1.0 - z * z;
+    r = r > 0.0 ? sqrt(r) : 0.0;
+    return ON_3dVector(r * cos(phi), r * sin(phi), z);
+}
+
+// ==========================================
+// 探针
+
+ON_3dVector LensedLightProbe::Irradiance(const ON_3dVector& n) const {
+    double Y[9];
+    EvalSH9(n, Y);
+    ON_3dVector e = ON_3dVector::ZeroVector;
+    for (int k = 0; k < 9; ++k) e += Y[k] * shIrradiance[k];
+
+    // 二阶 SH 在强对比的环境下会有负的振铃
+    return ON_3dVector(e.x > 0.0 ? e.x : 0.0, e.y > 0.0 ? e.y : 0.0, e.z > 0.0 ? e.z : 0.0);
+}
+
+int LensedLightProbe::CellIndex(const ON_3dVector& dir) const {
+    int i = (int)((atan2(dir.y, dir.x) + ON_PI) / (2.0 * ON_PI) * gridW);
+    int j = (int)((1.0 - dir.z) * 0.5 * gridH);
+    i = i < 0 ? 0 : (i >= gridW ? gridW - 1 : i);
+    j = j < 0 ? 0 : (j >= gridH ? gridH - 1 : j);
+    return j * gridW + i;
+}
+
+bool LensedLightProbe::Sample(double u0, double u1, double u2, ON_3dVector& dir, ON_3dVector& L, double& pdf) const {
+    if (totalPower <= 0.0) return false;
+
+    // 别名表：u0 的整数部分选格子，小数部分决定是否跳到别名
+    const int n = gridW * gridH;
+    const double scaled = u0 * n;
+    int cell = (int)scaled;
+    if (cell >= n) cell = n - 1;
+    if (scaled - cell >= aliasProb[cell]) cell = aliasIndex[cell];
+
+    // 格子内均匀抖动；等面积网格上 (phi, z) 均匀即立体角均匀
+    dir = GridDir((cell % gridW) + u1, (cell / gridW) + u2, gridW, gridH);
+    const float* c = &radiance[(size_t)cell * 3];
+    L.Set(c[0], c[1], c[2]);
+    pdf = cellProb[cell] * n / (4.0 * ON_PI);
+    return true;
+}
+
+double LensedLightProbe::Pdf(const ON_3dVector& dir) const {
+    if (totalPower <= 0.0) return 0.0;
+    const int n = gridW * gridH;
+    return cellProb[CellIndex(dir)] * n / (4.0 * ON_PI);
+}
+
+// ==========================================
+// 构建
+
+std::shared_ptr<LensedLightProbe> CBlackHole_LensedIBL::Build(const ON_3dPoint& pos, double mass, const SkyFunction& sky,
+    int gridW, int maxSteps, double stepSize) {
+    auto probe = std::make_shared<LensedLightProbe>();
+    probe->position = pos;
+    probe->gridW = gridW >= 4 ? gridW : 4;
+    probe->gridH = probe->gridW / 2;
+    const int w = probe->gridW, h = probe->gridH;
+    const int n = w * h;
+    const double cellSolidAngle = 4.0 * ON_PI / n;
+    const double cellAngle = sqrt(cellSolidAngle);
+
+    probe->radiance.assign((size_t)n * 3, 0.0f);
+    probe->aliasProb.assign(n, 1.0f);
+    probe->aliasIndex.resize(n);
+    probe->cellProb.assign(n, 0.0f);
+    for (int k = 0; k < 9; ++k) probe->shIrradiance[k] = ON_3dVector::ZeroVector;
+
+    // 视界内部没有光
+    const double r0 = ON_3dVector(pos).Length();
+    if (r0 <= 2.0 * mass) {
+        probe->capturedFraction = 1.0;
+        return probe;
+    }
+
+    // 1. 向每个格子中心追踪测地线
+    const double escapeRadius = r0 + 10.0 > 30.0 ? r0 + 10.0 : 30.0;
+    std::vector<ON_3dVector> exitDir(n);
+    int captured = 0;
+    for (int j = 0; j < h; ++j) {
+        for (int i = 0; i < w; ++i) {
+            const GeodesicResult res = CBlackHole_CPUTracer::TraceFrom(pos, GridDir(i + 0.5, j + 0.5, w, h), mass, maxSteps, stepSize, escapeRadius);
+            exitDir[(size_t)j * w + i] = res.exitDir;
+            if (res.captured) captured++;
+        }
+    }
+    probe->capturedFraction = (double)captured / n;
+
+    // 2. 天空着色，覆盖范围由相邻格子的出射方向估计（与图像路径相同）；同时投影到 SH
+    ON_3dVector shL[9];
+    for (int k = 0; k < 9; ++k) shL[k] = ON_3dVector::ZeroVector;
+    std::vector<double> weight(n, 0.0);
+    double total = 0.0;
+
+    for (int j = 0; j < h; ++j) {
+        const int jn = (j + 1 < h) ? j + 1 : j - 1;
+        for (int i = 0; i < w; ++i) {
+            const int cell = j * w + i;
+            const ON_3dVector& d = exitDir[cell];
+            if (d.IsZero()) continue;
+
+            const ON_3dVector& nx = exitDir[(size_t)j * w + (i + 1) % w];
+            const ON_3dVector& ny = exitDir[(size_t)jn * w + i];
+            const ON_3dVector L = sky(d, CBlackHole_CPUTracer::Footprint(d, nx, ny, cellAngle), cellAngle);
+
+            float* c = &probe->radiance[(size_t)cell * 3];
+            c[0] = (float)L.x;
+            c[1] = (float)L.y;
+            c[2] = (float)L.z;
+
+            double Y[9];
+            EvalSH9(GridDir(i + 0.5, j + 0.5, w, h), Y);
+            for (int k = 0; k < 9; ++k) shL[k] += (Y[k] * cellSolidAngle) * L;
+
+            const double lum = Luminance(L);
+            weight[cell] = lum > 0.0 ? lum : 0.0;
+            total += weight[cell];
+        }
+    }
+
+    // 余弦瓣卷积 (Ramamoorthi & Hanrahan)：A0 = pi, A1 = 2pi/3, A2 = pi/4
+    static const double A[9] = { ON_PI, 2.0 * ON_PI / 3.0, 2.0 * ON_PI / 3.0, 2.0 * ON_PI / 3.0,
+        ON_PI / 4.0, ON_PI / 4.0, ON_PI / 4.0, ON_PI / 4.0, ON_PI / 4.0 };
+    for (int k = 0; k < 9; ++k) probe->shIrradiance[k] = A[k] * shL[k];
+
+    // 3. Vose 别名表
+    probe->totalPower = total * cellSolidAngle;
+    if (total <= 0.0) return probe;
+
+    std::vector<double> scaled(n);
+    std::vector<int> small, large;
+    small.reserve(n);
+    large.reserve(n);
+    for (int k = 0; k < n; ++k) {
+        probe->cellProb[k] = (float)(weight[k] / total);
+        scaled[k] = weight[k] / total * n;
+        probe->aliasIndex[k] = k;
+        (scaled[k] < 1.0 ? small : large).push_back(k);
+    }
+    while (!small.empty() && !large.empty()) {
+        const int s = small.back(); small.pop_back();
+        const int l = large.back();
+        probe->aliasProb[s] = (float)scaled[s];
+        probe->aliasIndex[s] = l;
+        scaled[l] -= 1.0 - scaled[s];
+        if (scaled[l] < 1.0) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    // 剩下的只差浮点误差，概率记为 1
+    for (int k : small) probe->aliasProb[k] = 1.0f;
+    for (int k : large) probe->aliasProb[k] = 1.0f;
+
+    return probe;
+}
+
+// ==========================================
+// 缓存
+
+CBlackHole_LensedIBL::CBlackHole_LensedIBL(double mass, SkyFunction sky, double cellSize)
+    : m_mass(mass), m_sky(std::move(sky)), m_cellSize(cellSize > 1e-6 ? cellSize : 1e-6) {
+}
+
+ON_3dPoint CBlackHole_LensedIBL::KeyPosition(const Key& key) const {
+    return ON_3dPoint(key.x * m_cellSize, key.y * m_cellSize, key.z * m_cellSize);
+}
+
+std::shared_ptr<const LensedLightProbe> CBlackHole_LensedIBL::Get(const Key& key) {
+    std::promise<std::shared_ptr<const LensedLightProbe>> promise;
+    ProbeFuture future;
+    bool bBuild = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_probes.find(key);
+        if (it != m_probes.end()) {
+            future = it->second.probe;
+            it->second.lastUse = ++m_useCounter;
+        }
+        else {
+            future = promise.get_future().share();
+            m_probes.emplace(key, Entry{ future, ++m_useCounter });
+            bBuild = true;
+            if ((int)m_probes.size() > maxProbes) Evict();
+        }
+    }
+
+    if (bBuild) {
+        const auto t0 = std::chrono::high_resolution_clock::now();
+        try {
+            promise.set_value(Build(KeyPosition(key), m_mass, m_sky, gridWidth, maxSteps, stepSize));
+        }
+        catch (...) {
+            // 先移出缓存再交出异常：等待的线程收到异常，之后的请求重新构建；构建中的格点不会被淘汰，这一项一定是自己的
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_probes.erase(key);
+            }
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+        m_buildUs += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - t0).count();
+        m_probesBuilt++;
+    }
+    return future.get();
+}
+
+void CBlackHole_LensedIBL::Evict() {
+    // 一次淘汰到上限的 7/8，避免每构建一个探针就扫一遍
+    const size_t target = (size_t)(maxProbes > 8 ? maxProbes - maxProbes / 8 : 1);
+    if (m_probes.size() <= target) return;
+
+    std::vector<std::pair<unsigned long long, Key>> ready;
+    ready.reserve(m_probes.size());
+    for (const auto& kv : m_probes) {
+        if (kv.second.probe.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+            ready.emplace_back(kv.second.lastUse, kv.first);
+    }
+    size_t count = m_probes.size() - target;
+    if (count > ready.size()) count = ready.size();
+    if (0 == count) return;
+
+    std::nth_element(ready.begin(), ready.begin() + (count - 1), ready.end(),
+        [](const std::pair<unsigned long long, Key>& a, const std::pair<unsigned long long, Key>& b) { return a.first < b.first; });
+    for (size_t i = 0; i < count; ++i) m_probes.erase(ready[i].second);
+}
+
+std::shared_ptr<const LensedLightProbe> CBlackHole_LensedIBL::Probe(const ON_3dPoint& pos) {
+    const Key key = { (int)floor(pos.x / m_cellSize + 0.5), (int)floor(pos.y / m_cellSize + 0.5), (int)floor(pos.z / m_cellSize + 0.5) };
+    return Get(key);
+}
+
+ON_3dVector CBlackHole_LensedIBL::Irradiance(const ON_3dPoint& pos, const ON_3dVector& n) {
+    const double gx = pos.x / m_cellSize, gy = pos.y / m_cellSize, gz = pos.z / m_cellSize;
+    const int x0 = (int)floor(gx), y0 = (int)floor(gy), z0 = (int)floor(gz);
+    const double fx = gx - x0, fy = gy - y0, fz = gz - z0;
+
+    ON_3dVector e = ON_3dVector::ZeroVector;
+    for (int c = 0; c < 8; ++c) {
+        const int dx = c & 1, dy = (c >> 1) & 1, dz = (c >> 2) & 1;
+        const double wgt = (dx ? fx : 1.0 - fx) * (dy ? fy : 1.0 - fy) * (dz ? fz : 1.0 - fz);
+        if (wgt <= 0.0) continue;
+        e += wgt * Get({ x0 + dx, y0 + dy, z0 + dz })->Irradiance(n);
+    }
+    return e;
+}
+
+void CBlackHole_LensedIBL::Prefetch(const std::vector<ON_3dPoint>& positions, bool bTrilinear) {
+    // 1. 收集尚未构建的格点
+    std::unordered_map<Key, bool, KeyHash> wanted;
+    for (const ON_3dPoint& p : positions) {
+        const double gx = p.x / m_cellSize, gy = p.y / m_cellSize, gz = p.z / m_cellSize;
+        if (bTrilinear) {
+            const int x0 = (int)floor(gx), y0 = (int)floor(gy), z0 = (int)floor(gz);
+            for (int c = 0; c < 8; ++c)
+                wanted[{ x0 + (c & 1), y0 + ((c >> 1) & 1), z0 + ((c >> 2) & 1) }] = true;
+        }
+        else {
+            wanted[{ (int)floor(gx + 0.5), (int)floor(gy + 0.5), (int)floor(gz + 0.5) }] = true;
+        }
+    }
+
+    std::vector<Key> missing;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& kv : wanted) {
+            if (m_probes.find(kv.first) == m_probes.end()) missing.push_back(kv.first);
+        }
+    }
+    if (missing.empty()) return;
+
+    // 2. 每个探针一个任务
+    CBlackHole_ThreadPool::Shared().ParallelFor((int)missing.size(), [&](int i) {
+        Get(missing[i]);
+    });
+}
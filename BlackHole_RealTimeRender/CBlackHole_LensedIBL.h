@@ -0,0 +1,107 @@
+﻿// CBlackHole_LensedIBL.h
+// 透镜化环境光照：在场景中某一点向四周追踪测地线，得到该点"看到"的被黑洞弯曲后的天空，
+// 预计算成 SH 辐照度与别名表，网格着色只需几次 SH 求值和 O(1) 采样。结果按量化位置缓存
+#pragma once
+#include "stdafx.h"
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <future>
+#include <functional>
+#include <unordered_map>
+#include "CBlackHole_Common.h"
+
+// 一个位置上的光照探针
+// 入射方向按等面积柱面网格划分（经度均分、z 均分），每格立体角相同，均为 4 pi / (W H)
+struct LensedLightProbe {
+    ON_3dPoint  position;
+    ON_3dVector shIrradiance[9];        // 已与余弦瓣卷积的 SH 系数，直接求值即为辐照度
+    double      capturedFraction = 0;   // 落入视界的入射方向比例
+    double      totalPower = 0;         // sum(亮度 * 立体角)，为 0 时不能采样
+
+    int                gridW = 0, gridH = 0;
+    std::vector<float> radiance;        // 每格 RGB
+    std::vector<float> aliasProb;       // 别名表：留在本格的概率
+    std::vector<int>   aliasIndex;      // 别名表：否则跳到的格子
+    std::vector<float> cellProb;        // 每格被选中的离散概率
+
+    // 法线 n 处的漫反射辐照度（未除以 pi）
+    ON_3dVector Irradiance(const ON_3dVector& n) const;
+
+    // 按亮度重要性采样一个入射方向，u0..u2 为 [0,1) 均匀数；返回 false 表示探针全黑
+    bool Sample(double u0, double u1, double u2, ON_3dVector& dir, ON_3dVector& L, double& pdf) const;
+
+    // 某方向的立体角 pdf，与 Sample 一致（多重重要性采样用）
+    double Pdf(const ON_3dVector& dir) const;
+
+    int CellIndex(const ON_3dVector& dir) const;
+};
+
+// 探针缓存：位置按 cellSize 量化到格点，同一格点只构建一次；超过 maxProbes 时按最久未用淘汰
+class CBlackHole_LensedIBL {
+public:
+    // 逃逸方向 -> 天空亮度；footprint 为该方向在天球上的覆盖半径，pixelAngle 为无透镜时的格子尺度，与 ShadeSky 约定相同
+    using SkyFunction = std::function<ON_3dVector(const ON_3dVector& dir, double footprint, double pixelAngle)>;
+
+    CBlackHole_LensedIBL(double mass, SkyFunction sky, double cellSize);
+
+    CBlackHole_LensedIBL(const CBlackHole_LensedIBL&) = delete;
+    CBlackHole_LensedIBL& operator=(const CBlackHole_LensedIBL&) = delete;
+
+    // ==========================================
+    // 1. 查询（任意线程）
+    // 缺失的探针在调用线程上串行构建，其他线程请求同一格点时等待而不是重复构建
+
+    // 最近格点的探针；构建抛出的异常传给所有等待这一格点的线程，格点不留在缓存里，下次请求重新构建
+    std::shared_ptr<const LensedLightProbe> Probe(const ON_3dPoint& pos);
+
+    // 周围 8 个格点的 SH 三线性插值，避免格子边界处的光照跳变
+    ON_3dVector Irradiance(const ON_3dPoint& pos, const ON_3dVector& n);
+
+    // 批量预构建（在线程池上并行），必须在池外线程调用
+    void Prefetch(const std::vector<ON_3dPoint>& positions, bool bTrilinear);
+
+    // ==========================================
+    // 2. 构建
+
+    static std::shared_ptr<LensedLightProbe> Build(const ON_3dPoint& pos, double mass, const SkyFunction& sky,
+        int gridW, int maxSteps, double stepSize);
+
+    int    gridWidth = 64;      // 方向网格宽度，高度为一半；SH 只有 9 项，不需要很高的分辨率
+    int    maxProbes = 1024;    // 缓存的探针数上限，64 格宽时每个约 48 KB
+    int    maxSteps = 2000;
+    double stepSize = 0.1;
+
+    int    ProbeCount() const { return m_probesBuilt; }
+    double BuildMs() const { return m_buildUs / 1000.0; }
+
+private:
+    struct Key {
+        int x, y, z;
+        bool operator==(const Key& o) const { return x == o.x && y == o.y && z == o.z; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            return ((size_t)(unsigned)k.x * 73856093u) ^ ((size_t)(unsigned)k.y * 19349663u) ^ ((size_t)(unsigned)k.z * 83492791u);
+        }
+    };
+    using ProbeFuture = std::shared_future<std::shared_ptr<const LensedLightProbe>>;
+    struct Entry {
+        ProbeFuture        probe;
+        unsigned long long lastUse = 0;
+    };
+
+    std::shared_ptr<const LensedLightProbe> Get(const Key& key);
+    ON_3dPoint KeyPosition(const Key& key) const;
+    void Evict();   // 调用时持有 m_mutex；构建中的格点不淘汰
+
+    double                                        m_mass;
+    SkyFunction                                   m_sky;
+    double                                        m_cellSize;
+    std::mutex                                    m_mutex;
+    std::unordered_map<Key, Entry, KeyHash>       m_probes;
+    unsigned long long                            m_useCounter = 0;
+    std::atomic<int>                              m_probesBuilt{ 0 };
+    std::atomic<long long>                        m_buildUs{ 0 };
+};
@@ -0,0 +1,31 @@
+﻿// CBlackHole_Log.cpp
+#include "stdafx.h"
+#include <mutex>
+#include <vector>
+#include "CBlackHole_Log.h"
+
+static std::mutex& LogMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+static std::vector<ON_wString>& LogQueue() {
+    static std::vector<ON_wString> queue;
+    return queue;
+}
+
+void CBlackHole_Log::Post(const ON_wString& message) {
+    std::lock_guard<std::mutex> lock(LogMutex());
+    LogQueue().push_back(message);
+}
+
+void CBlackHole_Log::Flush() {
+    // 在锁外打印，Print 慢的时候工作线程不必等
+    std::vector<ON_wString> pending;
+    {
+        std::lock_guard<std::mutex> lock(LogMutex());
+        if (LogQueue().empty()) return;
+        pending.swap(LogQueue());
+    }
+    for (const ON_wString& message : pending) RhinoApp().Print(message);
+}
@@ -0,0 +1,11 @@
+﻿// CBlackHole_Log.h
+// 命令行消息队列：RhinoApp().Print 只在主线程或渲染线程调用，线程池上的任务（场景加载、环境烘焙）把消息放进队列
+// 由离线渲染的每一块、实时渲染的每一轮循环，以及主线程采集场景时按提交顺序取出打印
+#pragma once
+#include "stdafx.h"
+
+class CBlackHole_Log {
+public:
+    static void Post(const ON_wString& message);    // 任意线程
+    static void Flush();                            // 主线程或渲染线程
+};
@@ -0,0 +1,163 @@
+﻿// CBlackHole_MeshCache.cpp
+#include "stdafx.h"
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include "CBlackHole_MeshCache.h"
+
+// ==========================================
+// 键
+
+static uint64_t Mix(uint64_t h, uint64_t v) {
+    h ^= v;
+    h *= 0x9E3779B97F4A7C15ull;
+    return h ^ (h >> 29);
+}
+
+static uint64_t DoubleBits(double d) {
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    return bits;
+}
+
+uint64_t CBlackHole_MeshCache::Combine(uint64_t key, uint64_t value) {
+    return Mix(key, value);
+}
+
+uint64_t CBlackHole_MeshCache::CombineBytes(uint64_t key, const void* data, size_t bytes) {
+    const uint8_t* p = (const uint8_t*)data;
+    uint64_t h = Mix(key, (uint64_t)bytes);
+    size_t i = 0;
+    for (; i + 8 <= bytes; i += 8) {
+        uint64_t v;
+        memcpy(&v, p + i, sizeof(v));
+        h = Mix(h, v);
+    }
+    if (i < bytes) {
+        uint64_t v = 0;
+        memcpy(&v, p + i, bytes - i);
+        h = Mix(h, v);
+    }
+    return h;
+}
+
+uint64_t CBlackHole_MeshCache::MeshKey(const ON_Mesh& mesh, const ON_Xform& xform) {
+    // 与 CBlackHole_Scene 转换网格时读取的数据一致：双精度顶点、面的四个顶点编号、变换
+    uint64_t h = Mix(0xCBF29CE484222325ull, (uint64_t)mesh.VertexCount());
+    h = Mix(h, (uint64_t)mesh.FaceCount());
+    for (int i = 0; i < mesh.VertexCount(); ++i) {
+        const ON_3dPoint v = mesh.Vertex(i);
+        h = Mix(h, DoubleBits(v.x));
+        h = Mix(h, DoubleBits(v.y));
+        h = Mix(h, DoubleBits(v.z));
+    }
+    for (int fi = 0; fi < mesh.FaceCount(); ++fi) {
+        const ON_MeshFace& f = mesh.m_F[fi];
+        h = Mix(h, (uint64_t)(uint32_t)f.vi[0] | ((uint64_t)(uint32_t)f.vi[1] << 32));
+        h = Mix(h, (uint64_t)(uint32_t)f.vi[2] | ((uint64_t)(uint32_t)f.vi[3] << 32));
+    }
+    for (int r = 0; r < 4; ++r) {
+        for (int c = 0; c < 4; ++c) h = Mix(h, DoubleBits(xform.m_xform[r][c]));
+    }
+    return h;
+}
+
+// ==========================================
+// 读写
+
+const std::wstring& CBlackHole_MeshCache::Directory() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_directory.empty()) {
+        wchar_t temp[MAX_PATH + 1] = {};
+        if (0 == ::GetTempPathW(MAX_PATH + 1, temp)) return m_directory;
+
+        std::wstring dir = std::wstring(temp) + L"BlackHole_RealTimeRender\\";
+        ::CreateDirectoryW(dir.c_str(), nullptr);
+        dir += L"MeshCache\\";
+        ::CreateDirectoryW(dir.c_str(), nullptr);
+        m_directory = dir;
+    }
+    return m_directory;
+}
+
+std::wstring CBlackHole_MeshCache::Path(uint64_t key) {
+    wchar_t name[32];
+    swprintf_s(name, L"%016llx.bhmesh", (unsigned long long)key);
+    return Directory() + name;
+}
+
+bool CBlackHole_MeshCache::Load(uint64_t key, CBlackHole_Scene& scene) {
+    if (!bEnabled || Directory().empty()) return false;
+
+    const std::wstring path = Path(key);
+    unsigned long long bytes = 0;
+    if (!scene.ReadCache(path, &bytes)) {
+        ++m_misses;
+        return false;
+    }
+    ++m_hits;
+    m_bytesRead += bytes;
+
+    // 刷新修改时间作为最近使用时间，Trim 据此淘汰
+    HANDLE hFile = ::CreateFileW(path.c_str(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, 0, nullptr);
+    if (INVALID_HANDLE_VALUE != hFile) {
+        FILETIME now;
+        ::GetSystemTimeAsFileTime(&now);
+        ::SetFileTime(hFile, nullptr, nullptr, &now);
+        ::CloseHandle(hFile);
+    }
+    return true;
+}
+
+void CBlackHole_MeshCache::Store(uint64_t key, const CBlackHole_Scene& scene) {
+    if (!bEnabled || Directory().empty()) return;
+
+    const std::wstring path = Path(key);
+    const std::wstring temp = path + L"." + std::to_wstring(::GetCurrentThreadId()) + L".tmp";
+    WIN32_FILE_ATTRIBUTE_DATA data = {};
+    if (!scene.WriteCache(temp) || !::GetFileAttributesExW(temp.c_str(), GetFileExInfoStandard, &data) ||
+        !::MoveFileExW(temp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+        ::DeleteFileW(temp.c_str());
+        return;
+    }
+    m_bytesWritten += ((unsigned long long)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+}
+
+void CBlackHole_MeshCache::Trim() {
+    struct File {
+        std::wstring       name;
+        unsigned long long bytes;
+        unsigned long long time;
+    };
+    std::vector<File> files;
+    unsigned long long totalBytes = 0;
+
+    const std::wstring dir = Directory();
+    if (dir.empty()) return;
+    WIN32_FIND_DATAW fd;
+    HANDLE hFind = ::FindFirstFileW((dir + L"*.bhmesh").c_str(), &fd);
+    if (INVALID_HANDLE_VALUE == hFind) return;
+    do {
+        File f;
+        f.name = fd.cFileName;
+        f.bytes = ((unsigned long long)fd.nFileSizeHigh << 32) | fd.nFileSizeLow;
+        f.time = ((unsigned long long)fd.ftLastWriteTime.dwHighDateTime << 32) | fd.ftLastWriteTime.dwLowDateTime;
+        files.push_back(f);
+        totalBytes += f.bytes;
+    } while (::FindNextFileW(hFind, &fd));
+    ::FindClose(hFind);
+
+    if (totalBytes <= maxBytes) return;
+    std::sort(files.begin(), files.end(), [](const File& a, const File& b) { return a.time < b.time; });
+    for (size_t i = 0; i < files.size() && totalBytes > maxBytes; ++i) {
+        if (::DeleteFileW((dir + files[i].name).c_str())) totalBytes -= files[i].bytes;
+    }
+}
+
+void CBlackHole_MeshCache::ResetStats() {
+    m_hits = 0;
+    m_misses = 0;
+    m_bytesRead = 0;
+    m_bytesWritten = 0;
+}
@@ -0,0 +1,62 @@
+﻿// CBlackHole_MeshCache.h
+// 按内容寻址的磁盘缓存：网格转换与 BVH 构建的结果按网格数据与变换的哈希存成文件，
+// 重新打开同一模型时直接映射读回，不再转换和构建
+#pragma once
+#include "stdafx.h"
+#include <cstdint>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include "CBlackHole_Scene.h"
+
+class CBlackHole_MeshCache {
+public:
+    CBlackHole_MeshCache() = default;
+
+    CBlackHole_MeshCache(const CBlackHole_MeshCache&) = delete;
+    CBlackHole_MeshCache& operator=(const CBlackHole_MeshCache&) = delete;
+
+    // ==========================================
+    // 1. 键
+
+    // 网格顶点、面与变换的 64 位哈希；同样的输入在不同会话中得到同样的键
+    static uint64_t MeshKey(const ON_Mesh& mesh, const ON_Xform& xform);
+    static uint64_t Combine(uint64_t key, uint64_t value);
+    static uint64_t CombineBytes(uint64_t key, const void* data, size_t bytes);    // 逐 8 字节混入，末尾不足 8 字节补零
+
+    // ==========================================
+    // 2. 读写（任意线程）
+
+    // 命中时 scene 等同于 AddMesh + Build 的结果（见 CBlackHole_Scene::ReadCache）
+    bool Load(uint64_t key, CBlackHole_Scene& scene);
+
+    // 先写临时文件再改名，其他线程或进程不会读到写了一半的文件
+    void Store(uint64_t key, const CBlackHole_Scene& scene);
+
+    // 缓存总量超过 maxBytes 时按最近使用时间淘汰，命中会刷新文件时间
+    void Trim();
+
+    // ==========================================
+    // 3. 统计（自上次 ResetStats 起）
+
+    void ResetStats();
+    unsigned long long Hits() const { return m_hits; }
+    unsigned long long Misses() const { return m_misses; }
+    unsigned long long BytesRead() const { return m_bytesRead; }
+    unsigned long long BytesWritten() const { return m_bytesWritten; }
+
+    bool               bEnabled = true;
+    int                minTriangles = 512;                     // 更小的网格直接构建比打开文件快
+    unsigned long long maxBytes = 8ull * 1024 * 1024 * 1024;
+
+private:
+    const std::wstring& Directory();    // %TEMP%\BlackHole_RealTimeRender\MeshCache\，第一次使用时创建
+    std::wstring Path(uint64_t key);
+
+    std::mutex                      m_mutex;
+    std::wstring                    m_directory;
+    std::atomic<unsigned long long> m_hits{ 0 };
+    std::atomic<unsigned long long> m_misses{ 0 };
+    std::atomic<unsigned long long> m_bytesRead{ 0 };
+    std::atomic<unsigned long long> m_bytesWritten{ 0 };
+};
@@ -2,6 +2,7 @@
 // ʵʱȾʾģʽʵ֣Խ Rhino ͼصƺ̨Ⱦ뻭潻
 #include "stdafx.h"
 #include "CBlackHole_RealTimeDisplayMode.h"
+#include "BlackHole_RealTimeRenderPlugIn.h"
 
 // 캯ͨѶ·
 //  (this) Ϊ ISignalUpdate ӿڴȾɡл
@@ -13,7 +14,9 @@ CBlackHole_RealTimeDisplayMode::~CBlackHole_RealTimeDisplayMode() { ShutdownRend
 // Ⱦ
 bool CBlackHole_RealTimeDisplayMode::StartRenderer
 (const ON_2iSize& sz, const CRhinoDoc& d, const ON_3dmView& v, const ON_Viewport& vp, const DisplayMode* pP) {
+    m_docSerial = d.RuntimeSerialNumber();
     m_Renderer.UpdateCamera(vp);             // ʼͬ
+    m_Renderer.SetAovOutput(BlackHole_RealTimeRenderPlugIn().GetImageOutput().viewportAovs);
     return m_Renderer.StartRenderProcess(sz); // ̨ѭ߳
 }
 
@@ -21,6 +24,7 @@ bool CBlackHole_RealTimeDisplayMode::StartRenderer
 bool CBlackHole_RealTimeDisplayMode::OnRenderSizeChanged(const ON_2iSize& sz) {
     // ȷ GPU Խ
     m_Renderer.StopRenderProcess();
+    m_Renderer.SetAovOutput(BlackHole_RealTimeRenderPlugIn().GetImageOutput().viewportAovs);
     return m_Renderer.StartRenderProcess(sz);
 }
 
@@ -31,6 +35,13 @@ bool CBlackHole_RealTimeDisplayMode::DrawOrLockRendererFrameBuffer(const FRAME_B
     // ʵʱÿһ֡ˢʱͬµλ
     if (i.pipeline) m_Renderer.UpdateCamera(i.pipeline->VP());
 
+    // ֻ UI ̶߳ȡ鱳Ƿ仯決̨
+    auto& plugIn = BlackHole_RealTimeRenderPlugIn();
+    if (SkySource::Environment == plugIn.GetSkySettings().source) {
+        const CRhinoDoc* pDoc = CRhinoDoc::FromRuntimeSerialNumber(m_docSerial);
+        if (pDoc) plugIn.EnvironmentCache().Update(*pDoc);
+    }
+
     auto* pRW = m_Renderer.RenderWindow();
     if (!pRW) return false;
 
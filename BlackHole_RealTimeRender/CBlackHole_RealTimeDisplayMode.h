@@ -49,6 +49,7 @@ private:
     // 4. ڲȾ
 
     CBlackHole_RealTimeRenderer m_Renderer; // DisplayModeȾ
+    unsigned int m_docSerial = 0;           // ĵʱţڶȡǰ
 };
 
 // ʾģʽࣺ Rhino עᲢʾģʽʵ
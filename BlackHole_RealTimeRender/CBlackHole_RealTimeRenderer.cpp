@@ -2,6 +2,8 @@
 #include "stdafx.h"
 #include <chrono>
 #include "CBlackHole_RealTimeRenderer.h"
+#include "BlackHole_RealTimeRenderPlugIn.h"
+#include "CBlackHole_Log.h"
 
 
 // 构造函数
@@ -26,10 +28,16 @@ bool CBlackHole_RealTimeRenderer::StartRenderProcess(const ON_2iSize& frameSize)
     if (m_pRenderWnd) {
         m_pRenderWnd->SetSize(frameSize);
         m_pRenderWnd->EnsureDib();  // 申请内存上一片屏幕大小的空间存储DIB（设备无关位图），这个方案已经废弃，实际上没用
+        if (m_bAovOutput) {
+            for (int c = 0; c < (int)AovChannel::Count; c++)
+                m_pRenderWnd->AddChannel(CBlackHole_AovBuffer::ChannelId((AovChannel)c), sizeof(float));
+        }
     }
     // 建立一个CwinThread负责协调CPU和GPU
     if (nullptr == m_pRenderThread) {
         m_bRunning = true;
+        m_bFirstFrameReported = false;
+        m_startTime = std::chrono::high_resolution_clock::now();
         // 分配静态线程函数入口，将本身内存地址传给线程指针，因为CwinThread是C的线程，只接受一个指针，具体可以看博客笔记
         m_pRenderThread = AfxBeginThread(RenderProcess, (void*)this, THREAD_PRIORITY_NORMAL, 0, CREATE_SUSPENDED, 0);
         m_pRenderThread->m_bAutoDelete = FALSE;
@@ -91,7 +99,20 @@ unsigned int CBlackHole_RealTimeRenderer::RenderProcess(void* pData) {
     const int frameTimeMs = 1000 / targetFPS;
 
     while (pR->m_bRunning) {
-        if (pR->m_bIsDirty) {
+        // 后台加载与烘焙的消息在渲染线程打印
+        CBlackHole_Log::Flush();
+
+        // 天空设置被修改、环境烘焙完成，或后台天空盒刚加载完，即使相机没动也要重画
+        const unsigned int skyRevision = BlackHole_RealTimeRenderPlugIn().SkySettingsRevision();
+        const unsigned int envRevision = BlackHole_RealTimeRenderPlugIn().EnvironmentCache().Revision();
+        if (skyRevision != pR->m_skyRevision || envRevision != pR->m_envRevision || pR->m_gpu.SkyboxSwapPending()) {
+            pR->m_skyRevision = skyRevision;
+            pR->m_envRevision = envRevision;
+            pR->m_bIsDirty = true;
+        }
+
+        // 有改动时从头画，否则在累积满之前继续画抖动后的帧
+        if (pR->m_bIsDirty || pR->m_accumFrames < kAccumFrames) {
             auto now = high_resolution_clock::now();
             auto duration = duration_cast<milliseconds>(now - lastRenderTime).count();
 
@@ -101,7 +122,7 @@ unsigned int CBlackHole_RealTimeRenderer::RenderProcess(void* pData) {
                 continue;
             }
             lastRenderTime = high_resolution_clock::now();
-            pR->m_bIsDirty = false;
+            const unsigned int frameIndex = pR->m_bIsDirty.exchange(false) ? 0 : pR->m_accumFrames;
             // 实时获取当前 Rhino 渲染窗口的物理像素尺寸
             const ON_2iSize sz = pR->m_pRenderWnd->Size();
 
@@ -114,9 +135,16 @@ unsigned int CBlackHole_RealTimeRenderer::RenderProcess(void* pData) {
             }
 
             // 2. GPU 渲染管线
+            const SkySettings sky = BlackHole_RealTimeRenderPlugIn().GetSkySettings();
+            pR->m_gpu.SetSkySettings(sky);
             if (pR->m_gpu.Initialize(sz.cx, sz.cy)) {
-                pR->m_gpu.UpdateParams(safeCam, sz.cx, sz.cy);
+                if (SkySource::Environment == sky.source) {
+                    pR->m_gpu.SetEnvironment(BlackHole_RealTimeRenderPlugIn().EnvironmentCache().Current());
+                }
+                pR->m_gpu.UpdateParams(safeCam, sz.cx, sz.cy, frameIndex);
+                pR->m_gpu.SetAovReadback(pR->m_bAovOutput);
                 pR->m_gpu.Dispatch(sz.cx, sz.cy);
+                pR->m_accumFrames = pR->m_gpu.FrameIndex() + 1;
 
                 // 3. 映射结果给 Rhino
                 UINT pitch = 0;
@@ -131,9 +159,37 @@ unsigned int CBlackHole_RealTimeRenderer::RenderProcess(void* pData) {
                         pCh->Close();
                     }
                     pR->m_gpu.UnmapResult();
+
+                    // 辅助输出按通道展开成 float 写入
+                    if (pR->m_bAovOutput && pR->m_gpu.ReadAovs(pR->m_aov)) {
+                        pR->m_aovExpand.resize((size_t)sz.cx * sz.cy);
+                        for (int c = 0; c < (int)AovChannel::Count; c++) {
+                            auto* pAovCh = pR->m_pRenderWnd->OpenChannel(CBlackHole_AovBuffer::ChannelId((AovChannel)c));
+                            if (pAovCh) {
+                                pR->m_aov.Expand((AovChannel)c, 0, sz.cy, pR->m_aovExpand.data());
+                                pAovCh->SetValueRect(0, 0, sz.cx, sz.cy, sz.cx * sizeof(float), ComponentOrder::Irrelevant, pR->m_aovExpand.data());
+                                pAovCh->Close();
+                            }
+                        }
+                    }
                 }
             }
+            else {
+                pR->m_accumFrames = kAccumFrames;   // 设备不可用时不反复重试，等下一次改动
+            }
             pR->m_pSignalUpdateInterface->SignalUpdate();
+
+            // 4. 统计首帧耗时（此时天空盒可能仍是占位图，完整贴图在后台加载）
+            if (!pR->m_bFirstFrameReported) {
+                pR->m_bFirstFrameReported = true;
+                const double firstFrameMs = duration<double, std::milli>(high_resolution_clock::now() - pR->m_startTime).count();
+                const SkyboxLoadMetrics sky = pR->m_gpu.SkyboxMetrics();
+                const bool bSkyboxReady = sky.totalMs > 0.0 && sky.failReason.empty();
+                ON_wString str;
+                str.Format(L"BlackHole: first frame %dx%d in %.1f ms (%s)\n", sz.cx, sz.cy, firstFrameMs,
+                    bSkyboxReady ? L"full skybox" : L"placeholder sky");
+                RhinoApp().Print(str);
+            }
         }
         else {
             Sleep(5); // 没有任务，睡大觉😴
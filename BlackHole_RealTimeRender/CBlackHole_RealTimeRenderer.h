@@ -4,6 +4,8 @@
 #include "stdafx.h"
 #include <mutex>
 #include <atomic>
+#include <chrono>
+#include <vector>
 #include "CBlackHole_GPUManager.h"
 
 
@@ -26,6 +28,10 @@ public:
     void UpdateCamera(const ON_Viewport& vp);
     IRhRdkRenderWindow* RenderWindow() const { return m_pRenderWnd; }    // ȡ Rhino ṩȾ
 
+    // Ѹ䳤ȡƫ۽ǡȦƣҲдȾڣÿ֡һζأ StartRenderProcess ֮ǰ
+    // ʾģʽ BlackHoleImageOutput  ViewportAovs ѡ
+    void SetAovOutput(bool bOutput) { m_bAovOutput = bOutput; }
+
     // ==========================================
     // 3. ߳ͬ
 
@@ -37,6 +43,15 @@ private:
 
     std::atomic<bool> m_bRunning{ false };  // Ⱦ̵߳ѭԭ
     std::atomic<bool> m_bIsDirty{ false };      // ƶӽλ
+    bool              m_bFirstFrameReported = false;    // ֡ʱֻһ
+    std::chrono::high_resolution_clock::time_point m_startTime;    // ʱ̣ͳ֡ʱ
+    unsigned int      m_skyRevision = 0;    // Ӧõð汾
+    unsigned int      m_envRevision = 0;    // ӦõĻ決汾
+    bool              m_bAovOutput = false;   // ӿֻʾɫĬϲͨ
+
+    // ݣֹۻ kAccumFrames ֡ΪֹκθĶӵ 0 ֡¿ʼ
+    static const unsigned int kAccumFrames = 16;
+    unsigned int      m_accumFrames = kAccumFrames;   // ۻ֡ʱȵһθĶٻ
 
     // ==========================================
     // 5. Ⱦ
@@ -53,4 +68,6 @@ private:
     IRhRdkRenderWindow* m_pRenderWnd = nullptr; // Rhino Ⱦڶ
     RhRdk::Realtime::ISignalUpdate* m_pSignalUpdateInterface = nullptr; // Rhino źŽӿ
     CBlackHole_GPUManager m_gpu;    // GPU 
+    CBlackHole_AovBuffer  m_aov;    // صĸ
+    std::vector<float>    m_aovExpand;  // ͨչ float Ļ壬֡
 };
\ No newline at end of file
@@ -0,0 +1,826 @@
+﻿// CBlackHole_RenderJob.cpp
+#include "stdafx.h"
+#include <cfloat>
+#include <cmath>
+#include "CBlackHole_RenderJob.h"
+#include "CBlackHole_SceneLoader.h"
+#include "CBlackHole_EnvironmentCache.h"
+#include "CBlackHole_Log.h"
+
+CBlackHole_RenderJob::CBlackHole_RenderJob(IRhRdkRenderWindow& renderWnd, const CameraParameters& camera, const SkySettings& sky,
+    CBlackHole_SceneLoader& sceneLoader, CBlackHole_EnvironmentCache& envCache, const ImageOutputSettings& output,
+    int width, int height, bool bPreview, const std::atomic<bool>& bCancel)
+    : m_renderWnd(renderWnd), m_camera(camera), m_sky(sky), m_sceneLoader(sceneLoader), m_envCache(envCache), m_output(output),
+      m_width(width), m_height(height), m_bPreview(bPreview), m_bAntialias(!bPreview), m_bCancel(bCancel),
+      m_tracer(camera, width, height, m_blackHole.getMass()),
+      m_ibl(m_blackHole.getMass(), [this](const ON_3dVector& d, double footprint, double pixelAngle) {
+          return ShadeSky(d, footprint, pixelAngle, m_sky, Catalog(), nullptr, m_envImage.get());
+      }, 1.0),
+      m_sampler(AdaptiveSamplingSettings()),
+      m_pool(CBlackHole_ThreadPool::Shared()), m_scheduler(m_pool),
+      m_preview(width, height), m_writer(m_pool), m_deepZoom(m_pool), m_checkpoint(m_pool) {
+    if (m_bPreview) {
+        // 预览：步长加倍、步数减半，积分距离不变
+        m_tracer.stepSize *= 2.0;
+        m_tracer.maxSteps /= 2;
+    }
+    // 按夹角预测每根相机射线的步数，追踪调度用
+    m_tracer.BuildCostModel();
+    m_ibl.stepSize = m_tracer.stepSize;
+    m_ibl.maxSteps = m_tracer.maxSteps;
+
+    // 深度为相机到命中点的直线距离，视界取相机到视界的距离，天空为无穷远
+    m_horizonDepth = (float)(ON_3dVector(m_tracer.CameraPosition()).Length() - 2.0 * m_tracer.Mass());
+    m_channelRows.resize((size_t)width * kChunkRows);
+}
+
+void CBlackHole_RenderJob::Run() {
+    PrepareSky();
+    PlanOutput();
+
+    if (OpenChannels()) {
+        OpenOutputs();
+
+        // 分条渲染不回头重画缺物体的行，检查点的键要按完整场景计算，先等场景加载完
+        if (m_bStrips || m_bCheckpoint)
+            WaitForScene();
+        OpenCheckpoint();
+
+        for (int s0 = 0; s0 < m_height && !m_bCancel; s0 += m_plan.stripRows)
+            RenderStrip(s0);
+
+        FinishOutputs();
+        CloseChannels();
+    }
+
+    ReportStats();
+}
+
+// ==========================================
+// 准备
+
+void CBlackHole_RenderJob::PrepareSky() {
+    if (SkySource::Catalog == m_sky.source) {
+        std::wstring error;
+        if (!m_catalog.Open(m_sky.catalogPath, error)) {
+            ON_wString str;
+            str.Format(L"BlackHole: cannot open star catalogue \"%s\" (%s), using procedural stars\n",
+                m_sky.catalogPath.c_str(), error.c_str());
+            RhinoApp().Print(str);
+        }
+    }
+
+    // 环境在 CaptureScene 中已提交烘焙，这里等待结果：最多 60 s，与场景一样每 100 ms 检查一次取消
+    if (SkySource::Environment == m_sky.source) {
+        int waitedMs = 0;
+        while (!m_bCancel && !m_envCache.WaitIdle(100) && (waitedMs += 100) < 60000) {
+        }
+        if (!m_bCancel && waitedMs >= 60000)
+            RhinoApp().Print(L"BlackHole: environment bake timed out, using procedural stars\n");
+        m_envImage = m_envCache.Current();
+    }
+}
+
+void CBlackHole_RenderJob::PlanOutput() {
+    // 设置了输出文件时边渲染边写（预览不写）
+    m_bOutputFile = !m_output.path.empty() && !m_bPreview && CBlackHole_ImageWriter::FormatFromPath(m_output.path, m_format);
+    if (!m_output.path.empty() && !m_bPreview && !m_bOutputFile) {
+        ON_wString str;
+        str.Format(L"BlackHole: cannot write \"%s\" (unsupported file type, use .exr, .pfm or .png)\n", m_output.path.c_str());
+        RhinoApp().Print(str);
+    }
+    m_bStrips = m_output.strips && m_bOutputFile;
+    m_bCheckpoint = m_output.checkpointSeconds > 0 && !m_bPreview;
+
+    // 整帧结果：颜色、深度与中心光线的辅助输出，渲染完成后交给插件，SaveRenderedImage 从这里写文件
+    // 分条渲染时两份轮流装相邻的两条：写入器还在压缩上一条时，这一条已经开始追踪
+    m_frames[0] = std::make_shared<RenderedFrame>();
+    if (m_bStrips)
+        m_frames[1] = std::make_shared<RenderedFrame>();
+    if (m_bOutputFile)
+        m_channels = m_frames[0]->Channels(m_format, m_output.write);
+
+    // 分条：边距为着色与边缘判断用到的上下一行
+    // 条高取 64（EXR 瓦片高度，也是其他格式行组高度的倍数）的整数倍，写入器的行组不会跨条
+    m_apron = m_bStrips ? 1 : 0;
+    m_plan.stripRows = m_plan.frameRows = m_height;
+    if (m_bStrips) {
+        // 追踪用的缓冲（出射方向、分类、代价）一份，输出缓冲两份；写入器最多同时编码两个行组
+        // 检查点最多有两条记录在排队、一条在压缩
+        const uint64_t pixelBytes = sizeof(ON_3dVector) + sizeof(PixelClass) + sizeof(float) +
+            2 * (5 * sizeof(float) + CBlackHole_AovBuffer::BytesPerPixel()) +
+            (m_bCheckpoint ? 3 * CBlackHole_Checkpoint::BytesPerPixel() : 0);
+        uint64_t fixedBytes = kStripEncodeBands * CBlackHole_ImageWriter::BandBytes(m_format, m_width, m_channels, m_output.write);
+        if (m_output.deepZoom)
+            fixedBytes += CBlackHole_DeepZoom::MemoryBytes(m_width);
+        const uint64_t budget = (uint64_t)(m_output.memoryBudgetMB > 0 ? m_output.memoryBudgetMB : 1) << 20;
+        ON_wString str;
+        if (!CBlackHole_StripRender::Plan(m_width, m_height, m_apron, 64, pixelBytes, fixedBytes, budget, m_plan)) {
+            str.Format(L"BlackHole: even a %d-row strip needs %.0f MB, over the %d MB budget\n",
+                m_plan.stripRows, m_plan.bytes / 1048576.0, m_output.memoryBudgetMB);
+            RhinoApp().Print(str);
+        }
+        str.Format(L"BlackHole: rendering %d x %d in %d strips of %d rows, about %.0f MB\n",
+            m_width, m_height, (m_height + m_plan.stripRows - 1) / m_plan.stripRows, m_plan.stripRows, m_plan.bytes / 1048576.0);
+        RhinoApp().Print(str);
+
+        // 写入器按行号取数据：一个行组整个落在第 y / stripRows 条里，这一条在哪份缓冲、从哪一行开始都由行号决定
+        const std::vector<ImageChannel> second = m_frames[1]->Channels(m_format, m_output.write);
+        const int stripRows = m_plan.stripRows;
+        const int apron = m_apron;
+        for (size_t c = 0; c < m_channels.size(); c++) {
+            m_channels[c].fetch = [first = m_channels[c].fetch, next = second[c].fetch, stripRows, apron](int y, int rows, float* out) {
+                const int strip = y / stripRows;
+                const int top = (strip * stripRows > apron) ? strip * stripRows - apron : 0;
+                ((strip & 1) ? next : first)(y - top, rows, out);
+            };
+        }
+    }
+    else if (m_output.strips && !m_output.path.empty() && !m_bPreview) {
+        RhinoApp().Print(L"BlackHole: strip rendering needs an output file, rendering the whole frame\n");
+    }
+}
+
+bool CBlackHole_RenderJob::OpenChannels() {
+    // 设置渲染尺寸：分条渲染时为缩小的预览
+    if (m_bStrips)
+        m_renderWnd.SetSize(ON_2iSize(m_preview.Width(), m_preview.Height()));
+    else
+        m_renderWnd.SetSize(ON_2iSize(m_width, m_height));
+
+    m_pChanRGBA = m_renderWnd.OpenChannel(IRhRdkRenderWindow::chanRGBA);
+    if (nullptr == m_pChanRGBA)
+        return false;
+
+    m_pChanZ = m_renderWnd.OpenChannel(IRhRdkRenderWindow::chanDistanceFromCamera);
+    if (nullptr == m_pChanZ) {
+        m_pChanRGBA->Close();
+        m_pChanRGBA = nullptr;
+        return false;
+    }
+
+    // 辅助输出通道，窗口没有某个通道时跳过
+    for (int c = 0; c < (int)AovChannel::Count; c++)
+        m_pChanAov[c] = m_bStrips ? nullptr : m_renderWnd.OpenChannel(CBlackHole_AovBuffer::ChannelId((AovChannel)c));
+    return true;
+}
+
+void CBlackHole_RenderJob::CloseChannels() {
+    for (int c = 0; c < (int)AovChannel::Count; c++) {
+        if (nullptr != m_pChanAov[c])
+            m_pChanAov[c]->Close();
+        m_pChanAov[c] = nullptr;
+    }
+    m_pChanZ->Close();
+    m_pChanRGBA->Close();
+    m_pChanZ = m_pChanRGBA = nullptr;
+}
+
+void CBlackHole_RenderJob::OpenOutputs() {
+    if (m_bOutputFile) {
+        std::wstring error;
+        m_writer.SetMaxInFlight(m_bStrips ? kStripEncodeBands : 0);
+        if (!m_writer.Begin(m_output.path, m_format, m_width, m_height, m_channels, m_output.write, error)) {
+            ON_wString str;
+            str.Format(L"BlackHole: cannot write \"%s\" (%s)\n", m_output.path.c_str(), error.c_str());
+            RhinoApp().Print(str);
+        }
+    }
+    m_bStreamRows = m_writer.IsOpen() && !m_bStrips;
+
+    // Deep Zoom 金字塔放在输出文件旁边，定稿的行按顺序交入
+    m_dziPath = CBlackHole_DeepZoom::PathFor(m_output.path);
+    if (m_bOutputFile && m_output.deepZoom) {
+        std::wstring error;
+        if (!m_deepZoom.Begin(m_dziPath, m_width, m_height, error)) {
+            ON_wString str;
+            str.Format(L"BlackHole: cannot write \"%s\" (%s)\n", m_dziPath.c_str(), error.c_str());
+            RhinoApp().Print(str);
+        }
+    }
+}
+
+void CBlackHole_RenderJob::OpenCheckpoint() {
+    m_lastCheckpoint = std::chrono::high_resolution_clock::now();
+    if (!m_bCheckpoint || m_bCancel)
+        return;
+
+    // 键由场景内容、图像尺寸、相机、天空与影响像素的渲染设置组成，任何一项变了都从头渲染
+    const std::shared_ptr<const CBlackHole_Scene> pKeyScene = m_sceneLoader.Current();
+    const AdaptiveSamplingSettings sampling;
+    const double view[] = {
+        m_camera.pos.x, m_camera.pos.y, m_camera.pos.z, m_camera.dir.x, m_camera.dir.y, m_camera.dir.z,
+        m_camera.up.x, m_camera.up.y, m_camera.up.z, m_camera.viewAngle,
+        m_blackHole.getMass(), m_tracer.stepSize, m_tracer.straightPixels, m_sky.starGrid, m_sky.starBrightness,
+        sampling.noiseThreshold, sampling.creaseCos };
+    const int options[] = {
+        m_width, m_height, m_tracer.maxSteps, (int)m_sky.source, (int)m_sky.starSeed,
+        m_bAntialias ? sampling.maxSamples : 0, sampling.minRounds, sampling.initialSamples, m_plan.stripRows, m_apron };
+    uint64_t key = CBlackHole_MeshCache::Combine(0x424843484B505431ull, pKeyScene ? pKeyScene->ContentKey() : 0);
+    key = CBlackHole_MeshCache::CombineBytes(key, view, sizeof(view));
+    key = CBlackHole_MeshCache::CombineBytes(key, options, sizeof(options));
+    key = CBlackHole_MeshCache::CombineBytes(key, m_sky.catalogPath.data(), m_sky.catalogPath.size() * sizeof(wchar_t));
+    if (m_envImage) {
+        key = CBlackHole_MeshCache::Combine(key, ((uint64_t)m_envImage->width << 32) | (uint32_t)m_envImage->height);
+        key = CBlackHole_MeshCache::CombineBytes(key, m_envImage->rgba.data(), m_envImage->rgba.size() * sizeof(float));
+    }
+
+    std::wstring error;
+    ON_wString str;
+    if (!m_checkpoint.Open(key, m_width, m_height, m_bStrips ? m_plan.stripRows : 1, error)) {
+        str.Format(L"BlackHole: cannot open checkpoint (%s), rendering without it\n", error.c_str());
+    }
+    else if (m_checkpoint.RestoredRows() > 0) {
+        m_restoredRows = m_checkpoint.RestoredRows();
+        str.Format(L"BlackHole: resuming from checkpoint \"%s\", rows 0-%d of %d already rendered\n",
+            m_checkpoint.Path().c_str(), m_restoredRows - 1, m_height);
+    }
+    else {
+        str.Format(L"BlackHole: saving a checkpoint to \"%s\" every %d s\n", m_checkpoint.Path().c_str(), m_output.checkpointSeconds);
+    }
+    RhinoApp().Print(str);
+    m_checkpointRows = m_finalRows = m_restoredRows;
+}
+
+bool CBlackHole_RenderJob::WaitForScene() {
+    while (!m_bCancel) {
+        if (m_sceneLoader.WaitComplete(100))
+            return true;
+        if (!m_sceneLoader.IsLoading())
+            return false;
+    }
+    return false;
+}
+
+// ==========================================
+// 渲染
+
+void CBlackHole_RenderJob::RenderStrip(int s0) {
+    Strip strip;
+    strip.s0 = s0;
+    strip.s1 = (s0 + m_plan.stripRows < m_height) ? s0 + m_plan.stripRows : m_height;
+    strip.frameTop = (s0 > m_apron) ? s0 - m_apron : 0;
+    strip.h = ((strip.s1 + m_apron < m_height) ? strip.s1 + m_apron : m_height) - strip.frameTop;
+    m_tracer.SetRowOffset(strip.frameTop);
+
+    // 轮到的缓冲还装着前两条，等写入器把它读完
+    if (s0 >= 2 * m_plan.stripRows)
+        m_writer.WaitWritten(s0 - m_plan.stripRows);
+    strip.frame = m_frames[(s0 / m_plan.stripRows) & 1].get();
+    strip.frame->Resize(m_width, strip.h);
+
+    // 着色需要下一行，所以追踪总比着色多走一行
+    const size_t pixels = (size_t)m_width * strip.h;
+    strip.exitDir.assign(pixels, ON_3dVector::ZeroVector);
+    strip.pixelClass.resize(pixels);
+    strip.traceCost.assign(pixels, 0.0f);
+    strip.aaCost.assign((size_t)m_width * kChunkRows, 0.0f);
+    strip.edge.assign((size_t)m_width * kChunkRows, 0);
+    strip.rowHits.resize(strip.h);
+    strip.rowScene.resize(strip.h);
+    strip.incompleteBegin = strip.h;
+    strip.incompleteEnd = 0;
+    strip.tracedComplete.assign(strip.h, 0);
+
+    // 分条渲染时检查点的记录总是整条的，读回的条不再追踪
+    const int resumeRow = RestoreStrip(strip);
+    const bool bRestored = m_bStrips && resumeRow > 0;
+    if (!bRestored)
+        RenderRows(strip, resumeRow, strip.h);
+
+    // 等场景加载完成，重画追踪时还缺物体的行；上一行的覆盖范围用到了这些行，一并重画
+    if (strip.incompleteBegin < strip.incompleteEnd && !m_bCancel && WaitForScene()) {
+        const int yBegin = (strip.incompleteBegin > 0) ? strip.incompleteBegin - 1 : 0;
+        ON_wString str;
+        str.Format(L"BlackHole: scene finished loading, re-rendering rows %d-%d\n",
+            strip.frameTop + yBegin, strip.frameTop + strip.incompleteEnd - 1);
+        RhinoApp().Print(str);
+        RenderRows(strip, yBegin, strip.incompleteEnd);
+    }
+
+    // 整帧渲染：上次存盘之后定稿的行补进检查点，取消时也一样
+    if (m_checkpoint.IsOpen() && !m_bStrips && m_finalRows > m_checkpointRows) {
+        m_checkpoint.Append(m_checkpointRows, m_finalRows - m_checkpointRows, { strip.frame, strip.pixelClass.data(), m_checkpointRows });
+        m_checkpointRows = m_finalRows;
+    }
+
+    if (!m_bCancel)
+        CommitStrip(strip, bRestored);
+}
+
+int CBlackHole_RenderJob::RestoreStrip(Strip& strip) {
+    // 检查点里已有的行直接读回：整帧渲染时显示出来并从下一行接着渲染
+    if (m_restoredRows <= strip.s0)
+        return 0;
+
+    const int rows = ((m_restoredRows < strip.s1) ? m_restoredRows : strip.s1) - strip.s0;
+    if (!m_checkpoint.Read(strip.s0, rows, { strip.frame, strip.pixelClass.data(), strip.s0 - strip.frameTop })) {
+        RhinoApp().Print(L"BlackHole: cannot read checkpoint, rendering the remaining rows again\n");
+        m_checkpoint.Discard();
+        m_restoredRows = 0;
+        return 0;
+    }
+
+    const int resumeRow = strip.s0 - strip.frameTop + rows;
+    for (int y = strip.s0 - strip.frameTop; y < resumeRow; y++)
+        strip.tracedComplete[y] = 1;
+    if (!m_bStrips) {
+        ShowRows(strip, 0, resumeRow);
+        if (m_bStreamRows)
+            m_writer.RowsReady(0, resumeRow);
+    }
+    return resumeRow;
+}
+
+void CBlackHole_RenderJob::RenderRows(Strip& strip, int yBegin, int yEnd) {
+    int tracedRows = yBegin;
+    for (int y0 = yBegin; y0 < yEnd && !m_bCancel; y0 += kChunkRows) {
+        const int y1 = (y0 + kChunkRows < yEnd) ? y0 + kChunkRows : yEnd;
+
+        // 1. 追踪：场景在后台加载，每块取最新的快照，用了不完整快照的行记下来，加载完成后重画
+        bool bComplete = false;
+        const std::shared_ptr<const CBlackHole_Scene> pScene = m_sceneLoader.Current(&bComplete);
+        m_tracer.SetScene(pScene.get());
+
+        const int traceEnd = (y1 + 1 < strip.h) ? y1 + 1 : strip.h;
+        const int traceBegin = tracedRows;
+        if (!bComplete && traceBegin < traceEnd) {
+            strip.incompleteBegin = (traceBegin < strip.incompleteBegin) ? traceBegin : strip.incompleteBegin;
+            strip.incompleteEnd = (traceEnd > strip.incompleteEnd) ? traceEnd : strip.incompleteEnd;
+        }
+        for (int y = traceBegin; y < traceEnd; y++)
+            strip.tracedComplete[y] = bComplete ? 1 : 0;
+        TraceRows(strip, traceBegin, traceEnd, pScene);
+        tracedRows = traceEnd;
+
+        // 2. 着色
+        ShadeRows(strip, y0, y1);
+
+        // 3. 边缘像素超采样
+        if (m_bAntialias && !m_bCancel)
+            AntialiasRows(strip, y0, y1, pScene.get());
+
+        if (m_bCancel)
+            break;
+
+        // 后台加载与烘焙的消息在这里打印
+        CBlackHole_Log::Flush();
+
+        // 4. 整帧渲染：写入渲染窗口并刷新这一块；分条渲染时整条完成后才更新预览
+        if (!m_bStrips) {
+            ShowRows(strip, y0, y1);
+            CommitRows(strip, y0, y1);
+        }
+    }
+}
+
+void CBlackHole_RenderJob::TraceRows(Strip& strip, int traceBegin, int traceEnd, const std::shared_ptr<const CBlackHole_Scene>& pScene) {
+    const int w = m_width;
+    m_pool.ParallelFor(traceEnd - traceBegin, [&](int i) {
+        const int y = traceBegin + i;
+        strip.rowHits[y].clear();
+        strip.rowScene[y] = pScene;
+        for (int x = 0; x < w; x++) {
+            float& cost = strip.traceCost[(size_t)y * w + x];
+            if (cost <= 0.0f)
+                cost = (float)m_tracer.PredictSteps(m_tracer.PrimaryRay(x, y));
+        }
+    });
+
+    if (nullptr == pScene || pScene->IsEmpty()) {
+        // 只有天空：每个工作线程一个波前，从按代价排好的瓦片里连续取光线，结束的光线随时被新光线替换
+        m_scheduler.RunStream(&strip.traceCost[(size_t)traceBegin * w], w, traceBegin, traceEnd, [&](const CBlackHole_TileScheduler::TileQueue& next) {
+            CBlackHole_Wavefront wave;
+            CBlackHole_RayBinner binner(m_tracer.CameraPosition());
+            RenderTile tile;
+            int x = 0;
+            bool bTile = false;
+            const CBlackHole_Wavefront::RaySource fromTiles = [&](int& id, ON_3dVector& dir) {
+                while (!bTile || x >= tile.x1) {
+                    if (m_bCancel || !next(tile))
+                        return false;
+                    bTile = true;
+                    x = tile.x0;
+                }
+                id = tile.y * w + x;
+                dir = m_tracer.PrimaryRay(x, tile.y);
+                x++;
+                return true;
+            };
+            // 打开重排时先按冲击参数分批排序再交给波前
+            const CBlackHole_Wavefront::RaySource binned = [&](int& id, ON_3dVector& dir) {
+                return binner.Next(fromTiles, id, dir);
+            };
+            wave.Run(m_tracer, m_output.reorderRays ? binned : fromTiles, [&](int id, const GeodesicResult& res) {
+                RecordPixel(strip, (size_t)id, res);
+            });
+
+            std::lock_guard<std::mutex> lock(m_statsMutex);
+            m_waveStats.Merge(wave.Stats());
+        });
+        return;
+    }
+
+    // 有场景时每一步都要与网格求交，逐根光线追踪
+    m_scheduler.Run(&strip.traceCost[(size_t)traceBegin * w], w, traceBegin, traceEnd, [&](const RenderTile& tile) {
+        const int y = tile.y;
+        std::vector<PixelHit> hits;
+        SceneQueryStats tileStats;
+        for (int x = tile.x0; x < tile.x1 && !m_bCancel; x++) {
+            const GeodesicResult res = m_tracer.Trace(m_tracer.PrimaryRay(x, y), &tileStats);
+            RecordPixel(strip, (size_t)y * w + x, res);
+            if (res.hitSurface)
+                hits.push_back({ x, res.hitPoint, res.hitNormal, res.hitObject });
+        }
+
+        // 同一行的几段可能并行，命中记录在锁内合并
+        {
+            std::lock_guard<std::mutex> lock(m_statsMutex);
+            strip.rowHits[y].insert(strip.rowHits[y].end(), hits.begin(), hits.end());
+        }
+        MergeSceneStats(tileStats);
+    });
+}
+
+void CBlackHole_RenderJob::ShadeRows(Strip& strip, int y0, int y1) {
+    const int w = m_width;
+    std::vector<float>& image = strip.frame->rgba;
+
+    // 先并行构建这一块用到的光照探针，着色时只查表
+    std::vector<ON_3dPoint> hitPoints;
+    for (int y = y0; y < y1; y++) {
+        for (const PixelHit& hit : strip.rowHits[y])
+            hitPoints.push_back(hit.p);
+    }
+    if (!hitPoints.empty())
+        m_ibl.Prefetch(hitPoints, true);
+
+    const CBlackHole_StarCatalog* pCatalog = Catalog();
+    m_pool.ParallelFor(y1 - y0, [&](int i) {
+        const int y = y0 + i;
+        const int yn = (y + 1 < strip.h) ? y + 1 : y - 1;
+        for (int x = 0; x < w; x++) {
+            float* out = &image[((size_t)y * w + x) * 4];
+            const ON_3dVector& d = strip.exitDir[(size_t)y * w + x];
+            out[3] = 1.0f;
+            if (d.IsZero()) {
+                out[0] = out[1] = out[2] = 0.0f;
+                continue;
+            }
+
+            const int xn = (x + 1 < w) ? x + 1 : x - 1;
+            const ON_3dVector& nx = strip.exitDir[(size_t)y * w + xn];
+            const ON_3dVector& ny = strip.exitDir[(size_t)yn * w + x];
+            const double footprint = CBlackHole_CPUTracer::Footprint(d, nx, ny, m_tracer.PixelAngle());
+
+            const ON_3dVector c = ShadeSky(d, footprint, m_tracer.PixelAngle(), m_sky, pCatalog, &m_catalogStats, m_envImage.get());
+            out[0] = (float)c.x;
+            out[1] = (float)c.y;
+            out[2] = (float)c.z;
+        }
+
+        // 网格：朗伯漫反射，辐照度来自透镜化的环境
+        for (const PixelHit& hit : strip.rowHits[y]) {
+            const ON_3dVector a = strip.rowScene[y]->Albedo(hit.object);
+            const ON_3dVector e = m_ibl.Irradiance(hit.p, hit.n);
+            float* out = &image[((size_t)y * w + hit.x) * 4];
+            out[0] = (float)(a.x * e.x / ON_PI);
+            out[1] = (float)(a.y * e.y / ON_PI);
+            out[2] = (float)(a.z * e.z / ON_PI);
+        }
+        std::vector<PixelHit>().swap(strip.rowHits[y]);
+        strip.rowScene[y].reset();
+
+        if (!m_bAntialias)
+            return;
+
+        // 标出边缘像素与要先取初始样本的像素，之后按代价切块超采样
+        float* rowCost = &strip.aaCost[(size_t)i * w];
+        char* rowEdge = &strip.edge[(size_t)i * w];
+        for (int x = 0; x < w; x++) {
+            rowEdge[x] = m_sampler.IsEdge(strip.pixelClass.data(), w, strip.h, x, y) ? 1 : 0;
+            rowCost[x] = (rowEdge[x] || m_sampler.Probes(strip.pixelClass[(size_t)y * w + x]))
+                ? strip.traceCost[(size_t)y * w + x] : 0.0f;
+        }
+    });
+}
+
+void CBlackHole_RenderJob::AntialiasRows(Strip& strip, int y0, int y1, const CBlackHole_Scene* pScene) {
+    // 子样本用这一块的场景快照追踪，天空覆盖范围仍按本像素的邻居估计
+    const int w = m_width;
+    std::vector<float>& image = strip.frame->rgba;
+    const CBlackHole_StarCatalog* pCatalog = Catalog();
+    m_scheduler.Run(strip.aaCost.data(), w, y0, y1, [&](const RenderTile& tile) {
+        const int y = tile.y;
+        const int yn = (y + 1 < strip.h) ? y + 1 : y - 1;
+        const float* rowCost = &strip.aaCost[(size_t)(y - y0) * w];
+        const char* rowEdge = &strip.edge[(size_t)(y - y0) * w];
+        SceneQueryStats tileStats;
+        unsigned long long tilePixels = 0, tileSamples = 0, tileRefined = 0;
+        for (int x = tile.x0; x < tile.x1 && !m_bCancel; x++) {
+            if (rowCost[x] <= 0.0f)
+                continue;
+
+            const int xn = (x + 1 < w) ? x + 1 : x - 1;
+            const ON_3dVector& nx = strip.exitDir[(size_t)y * w + xn];
+            const ON_3dVector& ny = strip.exitDir[(size_t)yn * w + x];
+            int samples = 0;
+            const ON_3dVector c = m_sampler.Integrate(x, strip.frameTop + y, [&](double dx, double dy) {
+                const GeodesicResult res = m_tracer.Trace(m_tracer.PrimaryRay(x + dx, y + dy), &tileStats);
+                if (res.hitSurface) {
+                    const ON_3dVector a = pScene->Albedo(res.hitObject);
+                    const ON_3dVector e = m_ibl.Irradiance(res.hitPoint, res.hitNormal);
+                    return ON_3dVector(a.x * e.x / ON_PI, a.y * e.y / ON_PI, a.z * e.z / ON_PI);
+                }
+                if (res.exitDir.IsZero())
+                    return ON_3dVector::ZeroVector;
+
+                const double footprint = CBlackHole_CPUTracer::Footprint(res.exitDir, nx, ny, m_tracer.PixelAngle());
+                return ShadeSky(res.exitDir, footprint, m_tracer.PixelAngle(), m_sky, pCatalog, &m_catalogStats, m_envImage.get());
+            }, rowEdge[x] != 0, samples);
+
+            float* out = &image[((size_t)y * w + x) * 4];
+            out[0] = (float)c.x;
+            out[1] = (float)c.y;
+            out[2] = (float)c.z;
+            tilePixels++;
+            tileSamples += samples;
+            if (rowEdge[x] || samples > m_sampler.InitialSamples())
+                tileRefined++;
+        }
+        m_aaPixels += tilePixels;
+        m_aaSamples += tileSamples;
+        m_aaRefined += tileRefined;
+        MergeSceneStats(tileStats);
+    });
+}
+
+// 中心光线的结果：出射方向、实际步数、辅助输出，以及判断边缘用的分类
+void CBlackHole_RenderJob::RecordPixel(Strip& strip, size_t i, const GeodesicResult& res) {
+    strip.exitDir[i] = res.exitDir;
+    strip.traceCost[i] = (float)(res.steps > 0 ? res.steps : 1);
+    strip.frame->aov.Set(i, res);
+    strip.frame->depth[i] = res.hitSurface ? (float)m_tracer.CameraPosition().DistanceTo(res.hitPoint)
+        : (res.captured ? m_horizonDepth : FLT_MAX);
+    PixelClass& cls = strip.pixelClass[i];
+    cls.id = res.hitSurface ? res.hitObject : (res.exitDir.IsZero() ? PixelClass::Captured : PixelClass::Sky);
+    cls.steps = res.steps;
+    const ON_3dVector& guide = res.hitSurface ? res.hitNormal : res.exitDir;
+    cls.dir[0] = (float)guide.x;
+    cls.dir[1] = (float)guide.y;
+    cls.dir[2] = (float)guide.z;
+}
+
+void CBlackHole_RenderJob::MergeSceneStats(const SceneQueryStats& stats) {
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    m_sceneStats.segments += stats.segments;
+    m_sceneStats.nodesVisited += stats.nodesVisited;
+    m_sceneStats.trianglesTested += stats.trianglesTested;
+    m_sceneStats.curvedLength += stats.curvedLength;
+    m_sceneStats.straightLength += stats.straightLength;
+    m_sceneStats.lodTests += stats.lodTests;
+}
+
+// ==========================================
+// 交付
+
+void CBlackHole_RenderJob::ShowRows(Strip& strip, int yBegin, int yEnd) {
+    // 辅助输出按块展开
+    const int w = m_width;
+    const RenderedFrame& frame = *strip.frame;
+    for (int y0 = yBegin; y0 < yEnd; y0 += kChunkRows) {
+        const int y1 = (y0 + kChunkRows < yEnd) ? y0 + kChunkRows : yEnd;
+        m_pChanRGBA->SetValueRect(0, y0, w, y1 - y0, w * 4 * sizeof(float), ComponentOrder::RGBA, &frame.rgba[(size_t)y0 * w * 4]);
+        m_pChanZ->SetValueRect(0, y0, w, y1 - y0, w * sizeof(float), ComponentOrder::Irrelevant, &frame.depth[(size_t)y0 * w]);
+        for (int c = 0; c < (int)AovChannel::Count; c++) {
+            if (nullptr == m_pChanAov[c])
+                continue;
+            frame.aov.Expand((AovChannel)c, y0, y1 - y0, m_channelRows.data());
+            m_pChanAov[c]->SetValueRect(0, y0, w, y1 - y0, w * sizeof(float), ComponentOrder::Irrelevant, m_channelRows.data());
+        }
+    }
+
+    const ON_4iRect area(0, yBegin, w, yEnd);
+    m_renderWnd.InvalidateArea(area);
+}
+
+void CBlackHole_RenderJob::CommitRows(Strip& strip, int y0, int y1) {
+    // 一行的颜色只取决于本行与下一行的追踪，两行都用完整场景追踪过即已定稿，交给写入器，压缩与后面的块的渲染同时进行
+    if (m_bStreamRows) {
+        for (int y = y0; y < y1; y++) {
+            if (strip.tracedComplete[y] && (y + 1 >= strip.h || strip.tracedComplete[y + 1]))
+                m_writer.RowsReady(y, y + 1);
+        }
+    }
+
+    // 紧接着已定稿部分的块交给检查点，到了间隔才存一次；加载完成后重画的行不在这里
+    if (m_checkpoint.IsOpen()) {
+        if (y0 == m_finalRows)
+            m_finalRows = y1;
+        const auto now = std::chrono::high_resolution_clock::now();
+        if (m_finalRows > m_checkpointRows && now - m_lastCheckpoint >= std::chrono::seconds(m_output.checkpointSeconds)) {
+            m_checkpoint.Append(m_checkpointRows, m_finalRows - m_checkpointRows, { strip.frame, strip.pixelClass.data(), m_checkpointRows });
+            m_checkpointRows = m_finalRows;
+            m_lastCheckpoint = now;
+        }
+    }
+}
+
+void CBlackHole_RenderJob::CommitStrip(Strip& strip, bool bRestored) {
+    const int rows = strip.s1 - strip.s0;
+
+    // 分条渲染：这一条存入检查点，读回的条已经在里面
+    if (m_checkpoint.IsOpen() && m_bStrips && !bRestored)
+        m_checkpoint.Append(strip.s0, rows, { strip.frame, strip.pixelClass.data(), strip.s0 - strip.frameTop });
+
+    // 交给 Deep Zoom 金字塔；分条渲染时同时交给写入器，并按方块平均更新预览
+    const float* stripRgba = &strip.frame->rgba[(size_t)(strip.s0 - strip.frameTop) * m_width * 4];
+    if (m_deepZoom.IsOpen()) {
+        std::wstring error;
+        if (!m_deepZoom.AddRows(stripRgba, rows, error)) {
+            ON_wString str;
+            str.Format(L"BlackHole: cannot write \"%s\" (%s)\n", m_dziPath.c_str(), error.c_str());
+            RhinoApp().Print(str);
+            m_deepZoom.Abort();
+        }
+    }
+    if (!m_bStrips)
+        return;
+
+    m_writer.RowsReady(strip.s0, strip.s1);
+
+    int previewTop = -1, previewBottom = -1;
+    m_preview.AddRows(stripRgba, rows, [&](int y, const float* row) {
+        m_pChanRGBA->SetValueRect(0, y, m_preview.Width(), 1, m_preview.Width() * 4 * sizeof(float), ComponentOrder::RGBA, row);
+        previewTop = (previewTop < 0) ? y : previewTop;
+        previewBottom = y + 1;
+    });
+    if (previewTop >= 0) {
+        const ON_4iRect area(0, previewTop, m_preview.Width(), previewBottom);
+        m_renderWnd.InvalidateArea(area);
+    }
+}
+
+void CBlackHole_RenderJob::FinishOutputs() {
+    // 写完输出文件：没等到完整场景的行在这里一并交出，通常只剩最后几块
+    if (m_writer.IsOpen()) {
+        if (m_bCancel) {
+            m_writer.Abort();
+        }
+        else {
+            m_writer.RowsReady(0, m_height);
+            std::wstring error;
+            ON_wString str;
+            if (m_writer.Finish(error)) {
+                const ImageWriteStats& stats = m_writer.Stats();
+                str.Format(L"BlackHole: wrote \"%s\" (%.1f MB) while rendering, done %.0f ms after the last rows; encoding took %.0f ms of thread time\n",
+                    m_output.path.c_str(), stats.fileBytes / 1048576.0, stats.tailMs, stats.encodeMs);
+            }
+            else {
+                str.Format(L"BlackHole: cannot write \"%s\" (%s)\n", m_output.path.c_str(), error.c_str());
+            }
+            RhinoApp().Print(str);
+        }
+    }
+
+    // Deep Zoom：各级剩下的行缩小交出，写描述文件
+    if (m_deepZoom.IsOpen()) {
+        if (m_bCancel) {
+            m_deepZoom.Abort();
+        }
+        else {
+            const int levels = m_deepZoom.LevelCount();
+            std::wstring error;
+            ON_wString str;
+            if (m_deepZoom.Finish(error))
+                str.Format(L"BlackHole: wrote Deep Zoom pyramid \"%s\" (%d levels, %I64u tiles)\n",
+                    m_dziPath.c_str(), levels, (unsigned __int64)m_deepZoom.TileCount());
+            else
+                str.Format(L"BlackHole: cannot write \"%s\" (%s)\n", m_dziPath.c_str(), error.c_str());
+            RhinoApp().Print(str);
+        }
+    }
+
+    // 检查点：渲染完成后删除；取消时等最后的记录落盘后保留，再次渲染同一场景时从这里接着渲染
+    if (m_checkpoint.IsOpen()) {
+        const int savedRows = m_checkpoint.Flush();
+        if (m_checkpoint.Failed())
+            RhinoApp().Print(L"BlackHole: cannot write checkpoint (disk full?), later rows were not saved\n");
+        if (m_bCancel) {
+            ON_wString str;
+            str.Format(L"BlackHole: render cancelled, %d of %d rows kept in checkpoint \"%s\" (%.1f MB)\n",
+                savedRows, m_height, m_checkpoint.Path().c_str(), m_checkpoint.FileBytes() / 1048576.0);
+            RhinoApp().Print(str);
+        }
+        else {
+            m_checkpoint.Discard();
+        }
+    }
+
+    // 分条渲染时整帧从未在内存中，不交给插件
+    if (!m_bCancel && !m_bStrips)
+        m_frame = m_frames[0];
+}
+
+void CBlackHole_RenderJob::ReportStats() {
+    CBlackHole_Log::Flush();
+
+    // 负载均衡：各线程在调度的瓦片上的忙碌时间，与每批的墙钟时间比较
+    const TileScheduleStats& schedule = m_scheduler.Stats();
+    if (schedule.tiles > 0 && !schedule.busyMs.empty()) {
+        double busyMin = schedule.busyMs[0], busyMax = schedule.busyMs[0];
+        for (const double ms : schedule.busyMs) {
+            busyMin = (ms < busyMin) ? ms : busyMin;
+            busyMax = (ms > busyMax) ? ms : busyMax;
+        }
+        ON_wString str;
+        str.Format(L"BlackHole: %d tiles in %d batches scheduled by predicted cost; thread busy %.0f-%.0f ms of %.0f ms, balance %.1f%%\n",
+            schedule.tiles, schedule.batches, busyMin, busyMax, schedule.wallMs, 100.0 * schedule.Balance());
+        RhinoApp().Print(str);
+    }
+
+    // 抗锯齿统计：初始样本之外的光线只花在边缘与噪声大的像素上
+    if (m_bAntialias && m_aaPixels > 0) {
+        ON_wString str;
+        str.Format(L"BlackHole: anti-aliased %I64u pixels (%.1f%% of the image), %.1f samples each; %I64u edge or noisy pixels refined\n",
+            (unsigned __int64)m_aaPixels, 100.0 * m_aaPixels / ((double)m_width * m_height), (double)m_aaSamples / m_aaPixels,
+            (unsigned __int64)m_aaRefined);
+        RhinoApp().Print(str);
+    }
+
+    // 波前积分的通道利用率：结束的光线在每批之间被替换，应接近 100%
+    if (m_waveStats.rays > 0) {
+        ON_wString str;
+        str.Format(L"BlackHole: wavefront traced %I64u sky rays, %.1f steps each, SIMD lane utilisation %.1f%%\n",
+            (unsigned __int64)m_waveStats.rays, (double)m_waveStats.raySteps / m_waveStats.rays, 100.0 * m_waveStats.Utilisation());
+        RhinoApp().Print(str);
+    }
+
+    // 网格求交与光照探针统计
+    const std::shared_ptr<const CBlackHole_Scene> pScene = m_sceneLoader.Current();
+    if (pScene && !pScene->IsEmpty()) {
+        ON_wString str;
+        str.Format(L"BlackHole: %I64u segments tested, %.1f nodes and %.1f triangles per segment; %d light probes built in %.1f ms\n",
+            (unsigned __int64)m_sceneStats.segments,
+            m_sceneStats.segments ? (double)m_sceneStats.nodesVisited / m_sceneStats.segments : 0.0,
+            m_sceneStats.segments ? (double)m_sceneStats.trianglesTested / m_sceneStats.segments : 0.0,
+            m_ibl.ProbeCount(), m_ibl.BuildMs());
+        RhinoApp().Print(str);
+
+        const double length = m_sceneStats.curvedLength + m_sceneStats.straightLength;
+        str.Format(L"BlackHole: ray length %.1f%% stepped along the curve, %.1f%% tested as straight segments\n",
+            length > 0.0 ? 100.0 * m_sceneStats.curvedLength / length : 0.0,
+            length > 0.0 ? 100.0 * m_sceneStats.straightLength / length : 0.0);
+        RhinoApp().Print(str);
+
+        // 被透镜压缩的次级像改在简化网格上求交
+        if (pScene->HasLods()) {
+            str.Format(L"BlackHole: %I64u mesh tests on simplified levels (%I64u simplified triangles)\n",
+                (unsigned __int64)m_sceneStats.lodTests, (unsigned __int64)pScene->LodTriangleCount());
+            RhinoApp().Print(str);
+        }
+    }
+
+    // 星表访问统计：读取的数据量取决于画面覆盖的天区，而不是星表大小
+    if (m_catalog.IsOpen()) {
+        ON_wString str;
+        str.Format(L"BlackHole: catalogue %I64u stars (%.1f MB), %I64u queries, %I64u cells, %.1f MB of star records read\n",
+            m_catalog.StarCount(), m_catalog.FileBytes() / 1048576.0,
+            (unsigned __int64)m_catalogStats.queries, (unsigned __int64)m_catalogStats.cellsVisited,
+            m_catalogStats.starsTested * sizeof(CatalogStar) / 1048576.0);
+        RhinoApp().Print(str);
+    }
+}
+
+// ==========================================
+// 天空着色
+
+ON_3dVector CBlackHole_RenderJob::ShadeSky(const ON_3dVector& dir, double footprint, double pixelAngle, const SkySettings& sky,
+    const CBlackHole_StarCatalog* pCatalog, CatalogQueryStats* pStats, const SkyImage* pEnvImage) {
+    if (nullptr != pEnvImage)
+        return CBlackHole_CPUTracer::SampleSkyImage(*pEnvImage, dir);
+
+    if (nullptr == pCatalog)
+        return CBlackHole_CPUTracer::ProceduralStars(dir, footprint, pixelAngle, sky);
+
+    // 星表中的点光源按覆盖范围画成高斯点，再乘透镜放大率 mu = (无透镜像素尺度 / 实际覆盖尺度)^2
+    // 高斯核在像素网格上的总和为 pi/2，除掉后一颗星的总亮度与其 flux 一致
+    const double sigma0 = 0.5 * pixelAngle;
+    const double sigma = footprint > 1e-7 ? footprint : 1e-7;
+    double mu = (sigma0 * sigma0) / (sigma * sigma);
+    if (mu > 1e4) mu = 1e4;     // 焦散线附近放大率发散，截断
+
+    // 查询半径 3 sigma；强烈缩小的像素覆盖范围很大，限制半径避免一次读入整片天区
+    double radius = 3.0 * sigma;
+    if (radius > 0.02) radius = 0.02;
+
+    ON_3dVector sum = ON_3dVector::ZeroVector;
+    pCatalog->QueryDisc(dir, radius, [&](const CatalogStar& s) {
+        const ON_3dVector sd(s.dir[0], s.dir[1], s.dir[2]);
+        const double theta = (dir - sd).Length();
+        const double w = exp(-0.5 * theta * theta / (sigma * sigma));
+        sum += (s.flux * w) * CBlackHole_CPUTracer::BlackbodyColor(s.temperature);
+    }, pStats);
+
+    return (sky.starBrightness * mu / (0.5 * ON_PI)) * sum;
+}
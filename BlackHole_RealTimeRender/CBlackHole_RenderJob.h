@@ -0,0 +1,172 @@
+﻿// CBlackHole_RenderJob.h
+// 一次离线渲染：天空准备、分条规划、检查点、逐块的追踪 / 着色 / 超采样，以及输出文件与预览的交付
+// 由 CBlackHole_RealTimeRenderSdkRender 在渲染线程上创建并运行一次；相机、天空与网格已在主线程取好
+// 每一块行先在线程池上追踪测地线，再根据相邻像素的出射方向计算天空覆盖范围并着色
+// 追踪与超采样按预测代价切块调度：光子环附近的像素比纯天空贵两个数量级，贵的段先发、切得更细
+// 没有场景时中心光线按波前方式积分，四条 SIMD 通道之间不等最长的那根光线
+// 正式渲染时再自适应超采样：边缘像素，以及初始样本的标准误差超过阈值的像素
+// 输出文件超出整帧缓冲的内存时分条渲染：每次只追踪整幅宽的一条，定稿的行直接写盘，窗口只显示缩小的预览
+// 打开检查点时定稿的行定期存盘，同一场景再次渲染时读回，从中断处接着渲染
+#pragma once
+#include "stdafx.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "CBlackHole_Common.h"
+#include "CBlackHole_TheBlackHole.h"
+#include "CBlackHole_CPUTracer.h"
+#include "CBlackHole_StarCatalog.h"
+#include "CBlackHole_ThreadPool.h"
+#include "CBlackHole_TileScheduler.h"
+#include "CBlackHole_Wavefront.h"
+#include "CBlackHole_ImageWriter.h"
+#include "CBlackHole_StripRender.h"
+#include "CBlackHole_DeepZoom.h"
+#include "CBlackHole_Checkpoint.h"
+#include "CBlackHole_LensedIBL.h"
+#include "CBlackHole_AdaptiveSampler.h"
+
+class CBlackHole_SceneLoader;
+class CBlackHole_EnvironmentCache;
+
+class CBlackHole_RenderJob {
+public:
+    // bCancel 由 StopRendering 在主线程置位，渲染各阶段轮询
+    CBlackHole_RenderJob(IRhRdkRenderWindow& renderWnd, const CameraParameters& camera, const SkySettings& sky,
+        CBlackHole_SceneLoader& sceneLoader, CBlackHole_EnvironmentCache& envCache, const ImageOutputSettings& output,
+        int width, int height, bool bPreview, const std::atomic<bool>& bCancel);
+
+    CBlackHole_RenderJob(const CBlackHole_RenderJob&) = delete;
+    CBlackHole_RenderJob& operator=(const CBlackHole_RenderJob&) = delete;
+
+    void Run();
+
+    // 完整渲染的整帧结果，交给插件供 SaveRenderedImage 使用；取消或分条渲染时为空
+    std::shared_ptr<RenderedFrame> Frame() const { return m_frame; }
+
+    // 逃逸光线的天空颜色：环境图 > 星表 > 程序星空
+    static ON_3dVector ShadeSky(const ON_3dVector& dir, double footprint, double pixelAngle, const SkySettings& sky,
+        const CBlackHole_StarCatalog* pCatalog, CatalogQueryStats* pStats, const SkyImage* pEnvImage);
+
+private:
+    // 命中网格的像素，连同追踪时用的场景快照按行存放，着色完即释放
+    struct PixelHit { int x; ON_3dPoint p; ON_3dVector n; int object; };
+
+    // 一条的追踪缓冲：定稿的行为 [s0, s1)，连同上下边距一起追踪，缓冲里的行号与追踪器的行号都从 frameTop 算起
+    struct Strip {
+        int            s0 = 0, s1 = 0;
+        int            frameTop = 0;
+        int            h = 0;                   // 追踪的行数
+        RenderedFrame* frame = nullptr;
+
+        std::vector<ON_3dVector> exitDir;       // 出射方向，被吞噬或命中网格的像素为零向量
+        std::vector<PixelClass>  pixelClass;    // 中心光线的分类，判断边缘用
+        std::vector<float>       traceCost;     // 先用预测步数，追踪后换成实际步数
+        std::vector<float>       aaCost;        // 这一块要超采样的像素（边缘，及先取初始样本的像素）的代价，其余为 0
+        std::vector<char>        edge;          // 这一块的像素是否处在边缘
+        std::vector<std::vector<PixelHit>>                    rowHits;
+        std::vector<std::shared_ptr<const CBlackHole_Scene>>  rowScene;
+
+        int               incompleteBegin = 0, incompleteEnd = 0;     // 用不完整场景追踪过的行
+        std::vector<char> tracedComplete;                            // 每行是否用完整场景追踪
+    };
+
+    // ==========================================
+    // 1. 准备
+
+    void PrepareSky();          // 打开星表，等环境烘焙
+    void PlanOutput();          // 输出文件格式、分条规划与写入器的取数
+    bool OpenChannels();
+    void CloseChannels();
+    void OpenOutputs();         // 写入器与 Deep Zoom 金字塔
+    void OpenCheckpoint();      // 按场景与设置计算键，读出已有的行
+    bool WaitForScene();        // 等后台加载结束，每 100 ms 检查一次取消；返回场景是否完整
+
+    // ==========================================
+    // 2. 渲染
+
+    void RenderStrip(int s0);
+    int  RestoreStrip(Strip& strip);                    // 从检查点读回这一条已有的行，返回接着渲染的行
+    void RenderRows(Strip& strip, int yBegin, int yEnd);
+    void TraceRows(Strip& strip, int traceBegin, int traceEnd, const std::shared_ptr<const CBlackHole_Scene>& pScene);
+    void ShadeRows(Strip& strip, int y0, int y1);
+    void AntialiasRows(Strip& strip, int y0, int y1, const CBlackHole_Scene* pScene);
+    void RecordPixel(Strip& strip, size_t i, const GeodesicResult& res);
+    void MergeSceneStats(const SceneQueryStats& stats);
+
+    // ==========================================
+    // 3. 交付
+
+    void ShowRows(Strip& strip, int yBegin, int yEnd);     // 整帧渲染：写入渲染窗口并刷新
+    void CommitRows(Strip& strip, int y0, int y1);          // 整帧渲染：定稿的行交给写入器与检查点
+    void CommitStrip(Strip& strip, bool bRestored);         // 这一条定稿：检查点、Deep Zoom、分条写出与预览
+    void FinishOutputs();
+    void ReportStats();
+
+    const CBlackHole_StarCatalog* Catalog() const { return m_catalog.IsOpen() ? &m_catalog : nullptr; }
+
+    IRhRdkRenderWindow&          m_renderWnd;
+    const CameraParameters       m_camera;
+    const SkySettings            m_sky;
+    CBlackHole_SceneLoader&      m_sceneLoader;
+    CBlackHole_EnvironmentCache& m_envCache;
+    const ImageOutputSettings    m_output;
+    const int                    m_width;
+    const int                    m_height;
+    const bool                   m_bPreview;
+    const bool                   m_bAntialias;          // 预览不做抗锯齿
+    const std::atomic<bool>&     m_bCancel;
+
+    // 追踪器与天空来源
+    TheBlackHole                    m_blackHole;
+    CBlackHole_CPUTracer            m_tracer;
+    CBlackHole_StarCatalog          m_catalog;
+    CatalogQueryStats               m_catalogStats;
+    std::shared_ptr<const SkyImage> m_envImage;
+    CBlackHole_LensedIBL            m_ibl;              // 网格的环境光来自被透镜化的天空：按位置缓存的光照探针
+    const CBlackHole_AdaptiveSampler m_sampler;
+
+    // 统计
+    SceneQueryStats                 m_sceneStats;
+    std::mutex                      m_statsMutex;
+    std::atomic<unsigned long long> m_aaPixels{ 0 }, m_aaSamples{ 0 }, m_aaRefined{ 0 };
+    WavefrontStats                  m_waveStats;
+
+    // 输出与分条
+    CBlackHole_ThreadPool&          m_pool;
+    CBlackHole_TileScheduler        m_scheduler;
+    ImageFileFormat                 m_format = ImageFileFormat::Exr;
+    bool                            m_bOutputFile = false;
+    bool                            m_bStrips = false;
+    bool                            m_bCheckpoint = false;
+    bool                            m_bStreamRows = false;  // 整帧渲染时定稿的行边渲染边交给写入器
+    std::shared_ptr<RenderedFrame>  m_frames[2];            // 分条渲染时两份轮流装相邻的两条
+    std::shared_ptr<RenderedFrame>  m_frame;
+    std::vector<ImageChannel>       m_channels;
+    int                             m_apron = 0;
+    StripPlan                       m_plan;
+    CBlackHole_StripPreview         m_preview;
+    CBlackHole_ImageWriter          m_writer;
+    CBlackHole_DeepZoom             m_deepZoom;
+    std::wstring                    m_dziPath;
+
+    // 检查点：整帧渲染时按间隔存定稿的行，分条渲染时每条存一条记录
+    CBlackHole_Checkpoint           m_checkpoint;
+    int                             m_restoredRows = 0;
+    int                             m_checkpointRows = 0;   // 整帧渲染：已交给检查点的行
+    int                             m_finalRows = 0;        // 整帧渲染：从第 0 行起连续定稿的行
+    std::chrono::high_resolution_clock::time_point m_lastCheckpoint;
+
+    // 渲染窗口通道；分条渲染时窗口里只有预览，不写深度与辅助输出
+    IRhRdkRenderWindow::IChannel*   m_pChanRGBA = nullptr;
+    IRhRdkRenderWindow::IChannel*   m_pChanZ = nullptr;
+    IRhRdkRenderWindow::IChannel*   m_pChanAov[(int)AovChannel::Count] = {};
+    std::vector<float>              m_channelRows;          // 辅助输出按块展开的缓冲
+    float                           m_horizonDepth = 0.0f;
+
+    static const int kChunkRows = 16;
+    static const int kStripEncodeBands = 2;
+};
@@ -0,0 +1,163 @@
+﻿// CBlackHole_Sampler.cpp
+#include "stdafx.h"
+#include <cmath>
+#include <vector>
+#include "CBlackHole_Sampler.h"
+
+// 32 位整数哈希（lowbias32）
+static uint32_t Hash(uint32_t v) {
+    v ^= v >> 16;
+    v *= 0x7feb352du;
+    v ^= v >> 15;
+    v *= 0x846ca68bu;
+    v ^= v >> 16;
+    return v;
+}
+
+static uint32_t ReverseBits(uint32_t v) {
+    v = ((v >> 1) & 0x55555555u) | ((v & 0x55555555u) << 1);
+    v = ((v >> 2) & 0x33333333u) | ((v & 0x33333333u) << 2);
+    v = ((v >> 4) & 0x0f0f0f0fu) | ((v & 0x0f0f0f0fu) << 4);
+    v = ((v >> 8) & 0x00ff00ffu) | ((v & 0x00ff00ffu) << 8);
+    return (v >> 16) | (v << 16);
+}
+
+// ===============================
+// Sobol
+// ===============================
+
+uint32_t CBlackHole_Sampler::SobolBits(uint32_t index, int dim) {
+    // 第 0 维是 van der Corput 序列；第 1 维的方向数 v_k = v_{k-1} ^ (v_{k-1} >> 1)
+    if (0 == dim) return ReverseBits(index);
+
+    uint32_t result = 0;
+    uint32_t v = 0x80000000u;
+    for (; index; index >>= 1) {
+        if (index & 1) result ^= v;
+        v ^= v >> 1;
+    }
+    return result;
+}
+
+// Laine-Karras 置换：每一位只受更低位影响；在位反转后的值上做，等价于从高位开始的嵌套均匀置乱
+static uint32_t LaineKarras(uint32_t x, uint32_t seed) {
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+uint32_t CBlackHole_Sampler::OwenScramble(uint32_t bits, uint32_t seed) {
+    return ReverseBits(LaineKarras(ReverseBits(bits), seed));
+}
+
+void CBlackHole_Sampler::Get2D(int x, int y, uint32_t index, int pair, double& u, double& v) const {
+    const uint32_t pixel = Hash((uint32_t)x * 0x8da6b343u ^ (uint32_t)y * 0xd8163841u);
+    const uint32_t seed = Hash(m_seed ^ pixel ^ Hash((uint32_t)pair * 0x9e3779b9u + 1u));
+
+    // 样本序号也做嵌套置乱：对齐的 2^k 块仍映射到对齐的 2^k 块，前缀的分层性质不变，取点的顺序却各不相同
+    const uint32_t shuffled = OwenScramble(index, seed);
+
+    const uint32_t s0 = OwenScramble(SobolBits(shuffled, 0), Hash(seed + 0x51ed270bu));
+    const uint32_t s1 = OwenScramble(SobolBits(shuffled, 1), Hash(seed + 0x68e31da4u));
+    u = s0 * (1.0 / 4294967296.0);
+    v = s1 * (1.0 / 4294967296.0);
+}
+
+// ===============================
+// 蓝噪声
+// ===============================
+
+// void-and-cluster（Ulichney 1993）：在环绕的 N x N 格子上用高斯核衡量疏密，
+// 从稀疏的初始点集开始，依次去掉最密集的点、填入最空的位置，去掉与填入的顺序就是排名
+static std::vector<float> GenerateBlueNoise(int n, double sigma) {
+    const int count = n * n;
+
+    // 环绕距离的高斯核
+    std::vector<double> kernel(count);
+    for (int dy = 0; dy < n; ++dy) {
+        for (int dx = 0; dx < n; ++dx) {
+            const int ax = dx < n - dx ? dx : n - dx;
+            const int ay = dy < n - dy ? dy : n - dy;
+            kernel[dy * n + dx] = exp(-(ax * ax + ay * ay) / (2.0 * sigma * sigma));
+        }
+    }
+
+    std::vector<char> pattern(count, 0);
+    std::vector<double> energy(count, 0.0);
+    auto toggle = [&](int p, double sign) {
+        const int px = p % n, py = p / n;
+        for (int qy = 0; qy < n; ++qy) {
+            const double* row = &kernel[((qy - py + n) % n) * n];
+            double* e = &energy[qy * n];
+            for (int qx = 0; qx < n; ++qx) e[qx] += sign * row[(qx - px + n) % n];
+        }
+        pattern[p] = sign > 0.0 ? 1 : 0;
+    };
+    auto tightestCluster = [&](const std::vector<char>& pat) {
+        int best = -1;
+        for (int p = 0; p < count; ++p) {
+            if (pat[p] && (best < 0 || energy[p] > energy[best])) best = p;
+        }
+        return best;
+    };
+    auto largestVoid = [&](const std::vector<char>& pat) {
+        int best = -1;
+        for (int p = 0; p < count; ++p) {
+            if (!pat[p] && (best < 0 || energy[p] < energy[best])) best = p;
+        }
+        return best;
+    };
+
+    // 1. 初始点集：约 1/10 的格子，固定种子；再反复把最密集的点移到最空的位置，直到稳定
+    const int initial = count / 10;
+    for (int k = 0, placed = 0; placed < initial; ++k) {
+        const int p = (int)(Hash((uint32_t)k ^ 0xb1e5eedu) % (uint32_t)count);
+        if (!pattern[p]) {
+            toggle(p, 1.0);
+            placed++;
+        }
+    }
+    for (int iter = 0; iter < count; ++iter) {
+        const int cluster = tightestCluster(pattern);
+        toggle(cluster, -1.0);
+        const int hole = largestVoid(pattern);
+        if (hole == cluster) {
+            toggle(cluster, 1.0);
+            break;
+        }
+        toggle(hole, 1.0);
+    }
+
+    std::vector<int> rank(count, -1);
+    const std::vector<char> start = pattern;
+    const std::vector<double> startEnergy = energy;
+
+    // 2. 初始点集内部的排名：依次去掉最密集的点
+    for (int r = initial - 1; r >= 0; --r) {
+        const int p = tightestCluster(pattern);
+        toggle(p, -1.0);
+        rank[p] = r;
+    }
+
+    // 3. 其余位置：从初始点集出发依次填入最空的位置
+    // 核函数的总和是常数，"零的最密集处"与"一的最空处"是同一个位置，所以后半段不需要反转
+    pattern = start;
+    energy = startEnergy;
+    for (int r = initial; r < count; ++r) {
+        const int p = largestVoid(pattern);
+        toggle(p, 1.0);
+        rank[p] = r;
+    }
+
+    std::vector<float> mask(count);
+    for (int p = 0; p < count; ++p) mask[p] = (float)((rank[p] + 0.5) / count);
+    return mask;
+}
+
+const std::vector<float>& CBlackHole_Sampler::BlueNoiseMask() {
+    static const std::vector<float> mask = GenerateBlueNoise(kBlueNoiseSize, 1.5);
+    return mask;
+}
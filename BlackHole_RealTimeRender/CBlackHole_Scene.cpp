@@ -0,0 +1,1278 @@
+﻿// CBlackHole_Scene.cpp
+#include "stdafx.h"
+#include <chrono>
+#include <cmath>
+#include <cfloat>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <array>
+#include <algorithm>
+#include <unordered_map>
+#include <intrin.h>
+#include "CBlackHole_ThreadPool.h"
+#include "CBlackHole_Scene.h"
+#include "CBlackHole_MeshCache.h"
+
+static const double kRebuildSAHRatio = 1.3;     // SAH 代价超过上次整体构建的这个倍数时重建受影响的子树
+static const int    kParallelSubtree = 1 << 16; // 部分重建的子树超过这个三角形数时并行构建
+
+static const int    kLodMinTriangles = 4096;  // 更小的网格不建简化级别
+static const int    kLodMinKept = 256;         // 某一级剩下的三角形少于这个数时不再继续简化
+static const int    kMaxLods = 6;
+
+static const char     kCacheMagic[8] = { 'B', 'H', 'S', 'C', 'E', 'N', 'E', '1' };
+static const uint32_t kCacheVersion = 2;  // 三角形、节点格式或转换规则变化时加一，旧文件自动失效
+
+// 缓存记录头，后接 (objectCount + 1) 个物体起始编号、三角形、三角形所属物体、原始编号、8 叉节点，
+// 再接简化级别数、各级的格子尺寸与各级自己的记录
+struct SceneCacheHeader {
+    char     magic[8];      // "BHSCENE1"
+    uint32_t version;
+    uint32_t objectCount;
+    uint64_t triCount;
+    uint64_t nodeCount;
+    double   sahCost;
+    int32_t  maxDepth;
+    int32_t  leafCount;
+};
+
+// ==========================================
+// 构建
+
+void CBlackHole_Scene::Clear() {
+    m_tris.clear();
+    m_triObject.clear();
+    m_albedo.clear();
+    m_nodes.clear();
+    m_wide.clear();
+    m_buildStats = BVHBuildStats();
+    m_bBuilt = false;
+    m_bRebuildRequired = false;
+    DropLods();
+    m_bHasLods = false;
+    m_bLodsStale = false;
+
+    m_objectFirst.clear();
+    m_objectInstance.clear();
+    m_prototypes.clear();
+    m_prototypeKeyed.clear();
+    m_meshPrototype.clear();
+    m_instances.clear();
+    m_topNodes.clear();
+    m_topOrder.clear();
+    m_bTopDirty = false;
+    m_objectOwner.clear();
+    m_ownerObjects.clear();
+    m_triSource.clear();
+    m_triPosition.clear();
+    m_triLeaf.clear();
+    m_parent.clear();
+    m_nodeMark.clear();
+    m_dirtyLeaves.clear();
+    m_deadTris = 0;
+    m_garbageNodes = 0;
+    m_pending = SceneUpdateStats();
+}
+
+// 材质颜色是 sRGB，着色在线性空间进行
+static ON_3fVector LinearAlbedo(const ON_Color& c) {
+    return ON_3fVector((float)pow(c.FractionRed(), 2.2), (float)pow(c.FractionGreen(), 2.2), (float)pow(c.FractionBlue(), 2.2));
+}
+
+// 网格转成三角形追加到 tris 末尾，退化三角形丢弃；AddMesh 与 UpdateMesh 共用，同一网格总得到同样的三角形序列
+static void MeshTriangles(const ON_Mesh& mesh, const ON_Xform& xform, std::vector<SceneTriangle>& tris) {
+    const int vertexCount = mesh.VertexCount();
+    std::vector<ON_3dPoint> v(vertexCount);
+    for (int i = 0; i < vertexCount; ++i) v[i] = xform * mesh.Vertex(i);
+
+    auto addTriangle = [&](const ON_3dPoint& a, const ON_3dPoint& b, const ON_3dPoint& c) {
+        const ON_3dVector e1 = b - a, e2 = c - a;
+        if (ON_CrossProduct(e1, e2).IsZero()) return;   // 退化三角形
+        SceneTriangle t;
+        t.v0[0] = (float)a.x;  t.v0[1] = (float)a.y;  t.v0[2] = (float)a.z;
+        t.e1[0] = (float)e1.x; t.e1[1] = (float)e1.y; t.e1[2] = (float)e1.z;
+        t.e2[0] = (float)e2.x; t.e2[1] = (float)e2.y; t.e2[2] = (float)e2.z;
+        tris.push_back(t);
+    };
+
+    for (int fi = 0; fi < mesh.FaceCount(); ++fi) {
+        const ON_MeshFace& f = mesh.m_F[fi];
+        if (!f.IsValid(vertexCount)) continue;
+        addTriangle(v[f.vi[0]], v[f.vi[1]], v[f.vi[2]]);
+        if (f.IsQuad()) addTriangle(v[f.vi[0]], v[f.vi[2]], v[f.vi[3]]);
+    }
+}
+
+int CBlackHole_Scene::AddMesh(const ON_Mesh& mesh, const ON_Xform& xform, const ON_Color& albedo, const ON_UUID& owner) {
+    const int object = (int)m_albedo.size();
+    m_albedo.push_back(LinearAlbedo(albedo));
+    m_objectOwner.push_back(owner);
+    if (ON_UuidIsNotNil(owner)) m_ownerObjects[owner].push_back(object);
+
+    if (m_objectFirst.empty()) m_objectFirst.push_back(0);
+    MeshTriangles(mesh, xform, m_tris);
+    m_triObject.resize(m_tris.size(), object);
+    m_objectFirst.push_back((int)m_tris.size());
+    m_objectInstance.push_back(-1);
+    return object;
+}
+
+int CBlackHole_Scene::AddInstance(const ON_Mesh& mesh, const ON_Xform& xform, const ON_Color& albedo, const ON_UUID& owner) {
+    const uint64_t key = CBlackHole_MeshCache::MeshKey(mesh, ON_Xform::IdentityTransformation);
+    std::shared_ptr<CBlackHole_Scene> pPrototype;
+    if (m_meshPrototype.count(key) == 0) {
+        pPrototype = std::make_shared<CBlackHole_Scene>();
+        pPrototype->AddMesh(mesh, ON_Xform::IdentityTransformation, albedo);
+    }
+    return AddInstance(pPrototype, key, xform, albedo, owner);
+}
+
+// 变换 3x3 部分的最大奇异值（对 A^T A 做幂迭代），局部长度至少是世界长度的它分之一
+static float LodScale(const ON_Xform& xform) {
+    double a[3][3];
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) {
+            a[r][c] = 0.0;
+            for (int k = 0; k < 3; ++k) a[r][c] += xform.m_xform[k][r] * xform.m_xform[k][c];
+        }
+    }
+    double v[3] = { 0.57, 0.59, 0.57 }, lambda = 0.0;
+    for (int it = 0; it < 32; ++it) {
+        const double w[3] = { a[0][0] * v[0] + a[0][1] * v[1] + a[0][2] * v[2],
+                              a[1][0] * v[0] + a[1][1] * v[1] + a[1][2] * v[2],
+                              a[2][0] * v[0] + a[2][1] * v[1] + a[2][2] * v[2] };
+        lambda = sqrt(w[0] * w[0] + w[1] * w[1] + w[2] * w[2]);
+        if (lambda <= 0.0) return 0.0f;
+        for (int k = 0; k < 3; ++k) v[k] = w[k] / lambda;
+    }
+    // 幂迭代从下方逼近最大特征值，放大一点保证不低估
+    return (float)(1.0 / (1.01 * sqrt(lambda)));
+}
+
+int CBlackHole_Scene::AddInstance(std::shared_ptr<CBlackHole_Scene> pPrototype, uint64_t key, const ON_Xform& xform, const ON_Color& albedo, const ON_UUID& owner) {
+    int prototype;
+    auto it = key ? m_meshPrototype.find(key) : m_meshPrototype.end();
+    if (it != m_meshPrototype.end()) {
+        prototype = it->second;
+    }
+    else {
+        prototype = (int)m_prototypes.size();
+        m_prototypes.push_back(std::move(pPrototype));
+        m_prototypeKeyed.push_back(key != 0);
+        if (key) m_meshPrototype[key] = prototype;
+    }
+
+    // 物体编号与普通网格共用，不占三角形
+    const int object = (int)m_albedo.size();
+    m_albedo.push_back(LinearAlbedo(albedo));
+    m_objectOwner.push_back(owner);
+    if (ON_UuidIsNotNil(owner)) m_ownerObjects[owner].push_back(object);
+    if (m_objectFirst.empty()) m_objectFirst.push_back(0);
+    m_objectFirst.push_back(m_objectFirst.back());
+    m_objectInstance.push_back((int)m_instances.size());
+
+    SceneInstance instance;
+    instance.xform = xform;
+    instance.inverse = xform.Inverse();
+    instance.prototype = prototype;
+    instance.object = object;
+    instance.bAlive = true;
+    instance.lodScale = LodScale(xform);
+    m_instances.push_back(instance);
+    m_bTopDirty = true;
+    return object;
+}
+
+int CBlackHole_Scene::AddPart(const CBlackHole_Scene& part, const ON_Color& albedo, const ON_UUID& owner) {
+    const int object = (int)m_albedo.size();
+    m_albedo.push_back(LinearAlbedo(albedo));
+    m_objectOwner.push_back(owner);
+    if (ON_UuidIsNotNil(owner)) m_ownerObjects[owner].push_back(object);
+
+    // 构建过的部件三角形已按叶子重排，还原成 AddMesh 时的顺序，UpdateMesh 才能按原始编号对应
+    if (m_objectFirst.empty()) m_objectFirst.push_back(0);
+    const size_t first = m_tris.size();
+    m_tris.resize(first + part.m_tris.size());
+    for (size_t i = 0; i < part.m_tris.size(); ++i)
+        m_tris[first + (part.m_triSource.empty() ? (int)i : part.m_triSource[i])] = part.m_tris[i];
+    m_triObject.resize(m_tris.size(), object);
+    m_objectFirst.push_back((int)m_tris.size());
+    m_objectInstance.push_back(-1);
+    return object;
+}
+
+static void GrowBounds(float bmin[3], float bmax[3], const SceneTriangle& t) {
+    for (int k = 0; k < 3; ++k) {
+        const float a = t.v0[k], b = t.v0[k] + t.e1[k], c = t.v0[k] + t.e2[k];
+        const float lo = a < b ? (a < c ? a : c) : (b < c ? b : c);
+        const float hi = a > b ? (a > c ? a : c) : (b > c ? b : c);
+        if (lo < bmin[k]) bmin[k] = lo;
+        if (hi > bmax[k]) bmax[k] = hi;
+    }
+}
+
+void CBlackHole_Scene::BeginBuild(bool bParallel, SceneLayout layout) {
+    m_nodes.clear();
+    m_wide.clear();
+    m_layout = layout;
+    m_bBuilt = true;
+    m_bRebuildRequired = false;
+    m_triPosition.clear();
+    m_triLeaf.clear();
+    m_parent.clear();
+    m_nodeMark.clear();
+    m_dirtyLeaves.clear();
+    m_sahSum = m_sahBuilt = 0.0;
+    m_garbageNodes = 0;
+
+    // 原型在多次 Build 之间不变，只建新加入的：大的逐个并行构建，小的各自串行、彼此并行
+    std::vector<CBlackHole_Scene*> small;
+    for (const auto& pPrototype : m_prototypes) {
+        if (pPrototype->IsBuilt()) continue;
+        if (bParallel && (int)pPrototype->TriangleCount() > kParallelSubtree) pPrototype->Build(true);
+        else small.push_back(pPrototype.get());
+    }
+    if (bParallel) CBlackHole_ThreadPool::Shared().ParallelFor((int)small.size(), [&](int i) { small[i]->Build(false); });
+    else for (CBlackHole_Scene* pPrototype : small) pPrototype->Build(false);
+    BuildTopLevel();
+
+    m_bHasLods = !m_lods.empty();
+    for (const auto& pPrototype : m_prototypes) m_bHasLods = m_bHasLods || pPrototype->HasLods();
+}
+
+void CBlackHole_Scene::Build(bool bParallel, SceneLayout layout) {
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    BeginBuild(bParallel, layout);
+
+    const int n = (int)m_tris.size();
+    if (n == 0) return;
+
+    // 按块处理，大场景在线程池上并行
+    const int chunk = 1 << 16;
+    const int chunks = (n + chunk - 1) / chunk;
+    auto forChunks = [&](const std::function<void(int, int)>& body) {
+        auto run = [&](int c) { body(c * chunk, (c + 1) * chunk < n ? (c + 1) * chunk : n); };
+        if (bParallel) CBlackHole_ThreadPool::Shared().ParallelFor(chunks, run);
+        else for (int c = 0; c < chunks; ++c) run(c);
+    };
+
+    std::vector<BVHPrimBounds> bounds(n);
+    forChunks([&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            bounds[i].bmin[0] = bounds[i].bmin[1] = bounds[i].bmin[2] = FLT_MAX;
+            bounds[i].bmax[0] = bounds[i].bmax[1] = bounds[i].bmax[2] = -FLT_MAX;
+            GrowBounds(bounds[i].bmin, bounds[i].bmax, m_tris[i]);
+        }
+    });
+
+    std::vector<int> order;
+    CBlackHole_BVHBuilder::Build(bounds, m_nodes, order, bParallel, &m_buildStats);
+    std::vector<BVHPrimBounds>().swap(bounds);
+
+    if (layout == SceneLayout::Wide8) {
+        // 折叠会按槽位重新排列图元，与二叉树的顺序复合后只重排一次三角形
+        std::vector<int> wideOrder;
+        CBlackHole_WideBVH::Collapse(m_nodes, m_wide, wideOrder, bParallel);
+        std::vector<BVHNode>().swap(m_nodes);
+        forChunks([&](int begin, int end) {
+            for (int i = begin; i < end; ++i) wideOrder[i] = order[wideOrder[i]];
+        });
+        order.swap(wideOrder);
+    }
+
+    // 三角形按叶子顺序重排
+    std::vector<SceneTriangle> tris(n);
+    std::vector<int> triObject(n);
+    forChunks([&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            tris[i] = m_tris[order[i]];
+            triObject[i] = m_triObject[order[i]];
+        }
+    });
+    m_tris.swap(tris);
+    m_triObject.swap(triObject);
+
+    // 重复构建时 order 相对上一次的顺序，与旧映射复合后仍指向 AddMesh 时的编号
+    if (!m_triSource.empty()) {
+        forChunks([&](int begin, int end) {
+            for (int i = begin; i < end; ++i) order[i] = m_triSource[order[i]];
+        });
+    }
+    m_triSource.swap(order);
+
+    // 总时间包含包围盒计算与重排
+    m_buildStats.buildMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+}
+
+// ==========================================
+// 简化级别
+
+void CBlackHole_Scene::BuildLods() {
+    DropLods();
+    const int n = (int)m_tris.size();
+    if (n >= kLodMinTriangles && m_bBuilt && m_layout == SceneLayout::Wide8) {
+        // 1. 第一级格子取边长中位数的两倍，大约每 4 个三角形并成 1 个；抽样估计即可
+        std::vector<float> edges;
+        const int stride = n / 4096 > 1 ? n / 4096 : 1;
+        for (int i = 0; i < n; i += stride) {
+            const SceneTriangle& t = m_tris[i];
+            if (m_triObject[i] < 0) continue;
+            const float d[3] = { t.e2[0] - t.e1[0], t.e2[1] - t.e1[1], t.e2[2] - t.e1[2] };
+            edges.push_back(sqrtf(t.e1[0] * t.e1[0] + t.e1[1] * t.e1[1] + t.e1[2] * t.e1[2]));
+            edges.push_back(sqrtf(t.e2[0] * t.e2[0] + t.e2[1] * t.e2[1] + t.e2[2] * t.e2[2]));
+            edges.push_back(sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]));
+        }
+        float cell = 0.0f;
+        if (!edges.empty()) {
+            std::nth_element(edges.begin(), edges.begin() + edges.size() / 2, edges.end());
+            cell = 2.0f * edges[edges.size() / 2];
+        }
+
+        // 2. 每一级都从原始网格聚类，误差不逐级累积；简化效果不明显或几乎塌缩时停止
+        size_t prev = n;
+        while ((int)m_lods.size() < kMaxLods && cell > 0.0f) {
+            auto pLod = std::make_shared<CBlackHole_Scene>();
+            Cluster(cell, *pLod);
+            const size_t count = pLod->m_tris.size();
+            if (count == 0 || count * 5 > prev * 4) break;
+
+            pLod->Build(false);
+            m_lods.push_back(pLod);
+            m_lodSize.push_back(cell);
+            if ((int)count < kLodMinKept) break;
+            prev = count;
+            cell *= 2.0f;
+        }
+    }
+    m_bHasLods = !m_lods.empty();
+    m_bLodsStale = false;
+    for (const auto& pPrototype : m_prototypes) m_bHasLods = m_bHasLods || pPrototype->HasLods();
+}
+
+bool CBlackHole_Scene::LodsStale() const {
+    if (m_bLodsStale) return true;
+    for (const auto& pPrototype : m_prototypes) {
+        if (pPrototype->m_bLodsStale) return true;
+    }
+    return false;
+}
+
+std::shared_ptr<CBlackHole_Scene> CBlackHole_Scene::RebuildLods(const std::atomic<bool>& bCancel) const {
+    // 各级简化网格串行构建，可以在池内线程上运行
+    std::shared_ptr<CBlackHole_Scene> pScene = Clone();
+    if (pScene->m_bLodsStale) pScene->BuildLods();
+    for (auto& pPrototype : pScene->m_prototypes) {
+        if (bCancel) return nullptr;
+        if (!pPrototype->m_bLodsStale) continue;
+        std::shared_ptr<CBlackHole_Scene> pCopy = pPrototype->Clone();
+        pCopy->BuildLods();
+        pPrototype = pCopy;
+    }
+    pScene->m_bHasLods = !pScene->m_lods.empty();
+    for (const auto& pPrototype : pScene->m_prototypes) pScene->m_bHasLods = pScene->m_bHasLods || pPrototype->HasLods();
+    return bCancel ? nullptr : pScene;
+}
+
+// 顶点聚类：同一物体落在同一格子里的顶点合并到它们的平均位置，三个顶点落在不同格子的三角形保留
+// 物体编号与本场景一致，命中简化网格时仍能取到原来的物体
+void CBlackHole_Scene::Cluster(float cell, CBlackHole_Scene& out) const {
+    const int n = (int)m_tris.size();
+    const int objectCount = (int)m_albedo.size();
+    float bmin[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, bmax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (int i = 0; i < n; ++i) {
+        if (m_triObject[i] >= 0) GrowBounds(bmin, bmax, m_tris[i]);
+    }
+
+    // 三角形按物体分组
+    std::vector<int> objectStart(objectCount + 1, 0);
+    for (int i = 0; i < n; ++i) {
+        if (m_triObject[i] >= 0) objectStart[m_triObject[i] + 1]++;
+    }
+    for (int k = 0; k < objectCount; ++k) objectStart[k + 1] += objectStart[k];
+    std::vector<int> byObject(objectStart.back());
+    {
+        std::vector<int> cursor(objectStart.begin(), objectStart.end() - 1);
+        for (int i = 0; i < n; ++i) {
+            if (m_triObject[i] >= 0) byObject[cursor[m_triObject[i]]++] = i;
+        }
+    }
+
+    out.m_albedo = m_albedo;
+    out.m_objectOwner.assign(objectCount, ON_nil_uuid);
+    out.m_objectInstance.assign(objectCount, -1);
+    out.m_objectFirst.assign(1, 0);
+
+    const float inv = 1.0f / cell;
+    std::unordered_map<uint64_t, int> cellIndex;
+    std::vector<double> sum;                            // 每个格子：坐标和与顶点数
+    std::vector<std::array<int, 3>> faces, keys;
+    std::vector<int> keyFace;
+    for (int object = 0; object < objectCount; ++object) {
+        cellIndex.clear();
+        sum.clear();
+        faces.clear();
+        for (int j = objectStart[object]; j < objectStart[object + 1]; ++j) {
+            const SceneTriangle& t = m_tris[byObject[j]];
+            int c[3];
+            for (int k = 0; k < 3; ++k) {
+                const float* e = k == 1 ? t.e1 : t.e2;
+                const float p[3] = { t.v0[0] + (k ? e[0] : 0.0f), t.v0[1] + (k ? e[1] : 0.0f), t.v0[2] + (k ? e[2] : 0.0f) };
+                uint64_t key = 0;
+                for (int a = 0; a < 3; ++a) {
+                    uint64_t g = (uint64_t)((p[a] - bmin[a]) * inv);
+                    if (g > 0x1FFFFF) g = 0x1FFFFF;
+                    key |= g << (21 * a);
+                }
+                const auto r = cellIndex.emplace(key, (int)cellIndex.size());
+                if (r.second) sum.resize(sum.size() + 4, 0.0);
+                c[k] = r.first->second;
+                double* s = &sum[4 * c[k]];
+                s[0] += p[0]; s[1] += p[1]; s[2] += p[2]; s[3] += 1.0;
+            }
+            if (c[0] != c[1] && c[1] != c[2] && c[0] != c[2]) faces.push_back({ c[0], c[1], c[2] });
+        }
+
+        // 落在同一组格子里的三角形只留第一个
+        keys.resize(faces.size());
+        keyFace.resize(faces.size());
+        for (size_t f = 0; f < faces.size(); ++f) {
+            keys[f] = faces[f];
+            std::sort(keys[f].begin(), keys[f].end());
+            keyFace[f] = (int)f;
+        }
+        std::sort(keyFace.begin(), keyFace.end(), [&](int a, int b) { return keys[a] != keys[b] ? keys[a] < keys[b] : a < b; });
+
+        for (size_t f = 0; f < keyFace.size(); ++f) {
+            if (f > 0 && keys[keyFace[f]] == keys[keyFace[f - 1]]) continue;
+            const std::array<int, 3>& c = faces[keyFace[f]];
+            double p[3][3];
+            for (int k = 0; k < 3; ++k) {
+                const double* s = &sum[4 * c[k]];
+                for (int a = 0; a < 3; ++a) p[k][a] = s[a] / s[3];
+            }
+            const ON_3dVector e1(p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2]);
+            const ON_3dVector e2(p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2]);
+            if (ON_CrossProduct(e1, e2).IsZero()) continue;
+            SceneTriangle t;
+            for (int a = 0; a < 3; ++a) {
+                t.v0[a] = (float)p[0][a];
+                t.e1[a] = (float)e1[a];
+                t.e2[a] = (float)e2[a];
+            }
+            out.m_tris.push_back(t);
+        }
+        out.m_triObject.resize(out.m_tris.size(), object);
+        out.m_objectFirst.push_back((int)out.m_tris.size());
+    }
+}
+
+int CBlackHole_Scene::SelectLod(double footprint) const {
+    int level = 0;
+    while (level < (int)m_lodSize.size() && m_lodSize[level] <= footprint) ++level;
+    return level;
+}
+
+size_t CBlackHole_Scene::LodTriangleCount() const {
+    size_t count = 0;
+    for (const auto& pLod : m_lods) count += pLod->TriangleCount();
+    for (const auto& pPrototype : m_prototypes) count += pPrototype->LodTriangleCount();
+    return count;
+}
+
+// ==========================================
+// 查询
+
+// 线段与包围盒的进入参数，未命中或比 tMax 远时返回 FLT_MAX
+static inline float SlabEntry(const BVHNode& n, const float o[3], const float invD[3], float tMax) {
+    float t0 = 0.0f, t1 = tMax;
+    for (int k = 0; k < 3; ++k) {
+        float tn = (n.bmin[k] - o[k]) * invD[k];
+        float tf = (n.bmax[k] - o[k]) * invD[k];
+        if (tn > tf) { const float tmp = tn; tn = tf; tf = tmp; }
+        t0 = tn > t0 ? tn : t0;
+        t1 = tf < t1 ? tf : t1;
+    }
+    return t0 <= t1 ? t0 : FLT_MAX;
+}
+
+static inline int CountTrailingZeros(int mask) {
+    unsigned long index;
+    _BitScanForward(&index, (unsigned long)mask);
+    return (int)index;
+}
+
+// Moller-Trumbore
+static inline bool HitTriangle(const SceneTriangle& tri, const float o[3], const float d[3], float& tBest, float& u, float& v) {
+    const float p[3] = { d[1] * tri.e2[2] - d[2] * tri.e2[1], d[2] * tri.e2[0] - d[0] * tri.e2[2], d[0] * tri.e2[1] - d[1] * tri.e2[0] };
+    const float det = tri.e1[0] * p[0] + tri.e1[1] * p[1] + tri.e1[2] * p[2];
+    if (fabsf(det) < 1e-20f) return false;
+    const float inv = 1.0f / det;
+
+    const float s[3] = { o[0] - tri.v0[0], o[1] - tri.v0[1], o[2] - tri.v0[2] };
+    const float bu = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inv;
+    if (bu < 0.0f || bu > 1.0f) return false;
+
+    const float q[3] = { s[1] * tri.e1[2] - s[2] * tri.e1[1], s[2] * tri.e1[0] - s[0] * tri.e1[2], s[0] * tri.e1[1] - s[1] * tri.e1[0] };
+    const float bv = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * inv;
+    if (bv < 0.0f || bu + bv > 1.0f) return false;
+
+    const float t = (tri.e2[0] * q[0] + tri.e2[1] * q[1] + tri.e2[2] * q[2]) * inv;
+    if (t < 0.0f || t >= tBest) return false;
+
+    tBest = t;
+    u = bu;
+    v = bv;
+    return true;
+}
+
+bool CBlackHole_Scene::IntersectSegment(const ON_3dPoint& a, const ON_3dPoint& b, SceneHit& hit, SceneQueryStats* pStats, double footprint) const {
+    if (IsEmpty()) return false;
+    if (pStats) pStats->segments++;
+
+    const float o[3] = { (float)a.x, (float)a.y, (float)a.z };
+    const float d[3] = { (float)(b.x - a.x), (float)(b.y - a.y), (float)(b.z - a.z) };
+    const float invD[3] = { 1.0f / d[0], 1.0f / d[1], 1.0f / d[2] };
+
+    bool bHit = false;
+    if (m_layout == SceneLayout::Wide8 ? !m_wide.empty() : !m_nodes.empty()) {
+        // 简化级别只有 Wide8
+        const int level = m_layout == SceneLayout::Wide8 ? SelectLod(footprint) : 0;
+        if (level > 0 && pStats) pStats->lodTests++;
+        bHit = m_layout == SceneLayout::Wide8 ? Lod(level).IntersectWide(o, d, invD, hit, pStats) : IntersectBinary(o, d, invD, hit, pStats);
+        if (bHit) {
+            hit.instance = -1;
+            hit.lod = level;
+        }
+    }
+    // 实例只接受比已有交点更近的
+    if (!m_topNodes.empty() && IntersectInstances(a, b, hit, pStats, footprint)) bHit = true;
+    return bHit;
+}
+
+// 顶层：线段在世界坐标中遍历实例包围盒，命中的实例把线段变换到局部坐标后查原型；仿射变换不改变线段参数
+bool CBlackHole_Scene::IntersectInstances(const ON_3dPoint& a, const ON_3dPoint& b, SceneHit& hit, SceneQueryStats* pStats, double footprint) const {
+    const float o[3] = { (float)a.x, (float)a.y, (float)a.z };
+    const float invD[3] = { 1.0f / (float)(b.x - a.x), 1.0f / (float)(b.y - a.y), 1.0f / (float)(b.z - a.z) };
+
+    bool bHit = false;
+    if (SlabEntry(m_topNodes[0], o, invD, hit.t) == FLT_MAX) return false;
+
+    int stack[64];
+    int sp = 0;
+    int nodeIndex = 0;
+    for (;;) {
+        const BVHNode& node = m_topNodes[nodeIndex];
+        if (pStats) pStats->nodesVisited++;
+
+        if (node.count > 0) {
+            for (int i = node.leftFirst; i < node.leftFirst + node.count; ++i) {
+                const SceneInstance& instance = m_instances[m_topOrder[i]];
+                const CBlackHole_Scene& prototype = *m_prototypes[instance.prototype];
+                const ON_3dPoint la = instance.inverse * a, lb = instance.inverse * b;
+                const float lo[3] = { (float)la.x, (float)la.y, (float)la.z };
+                const float ld[3] = { (float)(lb.x - la.x), (float)(lb.y - la.y), (float)(lb.z - la.z) };
+                const float lInvD[3] = { 1.0f / ld[0], 1.0f / ld[1], 1.0f / ld[2] };
+
+                // 覆盖范围按实例的缩放换算到局部坐标再选级别
+                const int level = prototype.SelectLod(footprint * instance.lodScale);
+                if (level > 0 && pStats) pStats->lodTests++;
+
+                SceneHit local;
+                local.t = hit.t;
+                if (prototype.Lod(level).IntersectWide(lo, ld, lInvD, local, pStats)) {
+                    hit = local;
+                    hit.instance = m_topOrder[i];
+                    hit.lod = level;
+                    bHit = true;
+                }
+            }
+            if (sp == 0) break;
+            nodeIndex = stack[--sp];
+            continue;
+        }
+
+        int nearChild = node.leftFirst, farChild = node.leftFirst + 1;
+        float tNear = SlabEntry(m_topNodes[nearChild], o, invD, hit.t);
+        float tFar = SlabEntry(m_topNodes[farChild], o, invD, hit.t);
+        if (tFar < tNear) {
+            const int ci = nearChild; nearChild = farChild; farChild = ci;
+            const float ct = tNear; tNear = tFar; tFar = ct;
+        }
+
+        if (tNear == FLT_MAX) {
+            if (sp == 0) break;
+            nodeIndex = stack[--sp];
+            continue;
+        }
+        if (tFar != FLT_MAX) stack[sp++] = farChild;
+        nodeIndex = nearChild;
+    }
+    return bHit;
+}
+
+bool CBlackHole_Scene::IntersectBinary(const float o[3], const float d[3], const float invD[3], SceneHit& hit, SceneQueryStats* pStats) const {
+    float tBest = hit.t;
+    bool bHit = false;
+    if (SlabEntry(m_nodes[0], o, invD, tBest) == FLT_MAX) return false;
+
+    int stack[128];     // SAH 树可能比中位数切分深
+    int sp = 0;
+    int nodeIndex = 0;
+    for (;;) {
+        const BVHNode& node = m_nodes[nodeIndex];
+        if (pStats) pStats->nodesVisited++;
+
+        if (node.count > 0) {
+            for (int i = node.leftFirst; i < node.leftFirst + node.count; ++i) {
+                if (HitTriangle(m_tris[i], o, d, tBest, hit.u, hit.v)) {
+                    hit.prim = i;
+                    bHit = true;
+                }
+            }
+            if (pStats) pStats->trianglesTested += node.count;
+            if (sp == 0) break;
+            nodeIndex = stack[--sp];
+            continue;
+        }
+
+        // 先走近的子节点，远的压栈
+        int nearChild = node.leftFirst, farChild = node.leftFirst + 1;
+        float tNear = SlabEntry(m_nodes[nearChild], o, invD, tBest);
+        float tFar = SlabEntry(m_nodes[farChild], o, invD, tBest);
+        if (tFar < tNear) {
+            const int ci = nearChild; nearChild = farChild; farChild = ci;
+            const float ct = tNear; tNear = tFar; tFar = ct;
+        }
+
+        if (tNear == FLT_MAX) {
+            if (sp == 0) break;
+            nodeIndex = stack[--sp];
+            continue;
+        }
+        if (tFar != FLT_MAX) stack[sp++] = farChild;
+        nodeIndex = nearChild;
+    }
+
+    if (bHit) hit.t = tBest;
+    return bHit;
+}
+
+bool CBlackHole_Scene::IntersectWide(const float o[3], const float d[3], const float invD[3], SceneHit& hit, SceneQueryStats* pStats) const {
+    float tBest = hit.t;
+    bool bHit = false;
+
+    struct Entry { int node; float t; };
+    Entry stack[512];   // 每层最多压 7 个
+    int sp = 0;
+    int nodeIndex = 0;
+    for (;;) {
+        const WideBVHNode& node = m_wide[nodeIndex];
+        if (pStats) pStats->nodesVisited++;
+
+        float tEnter[8];
+        const int mask = CBlackHole_WideBVH::IntersectSlots(node, o, invD, tBest, tEnter);
+
+        // 先测叶子槽位，命中后 tBest 缩短，可以少压几个子节点
+        for (int leaves = mask & ~node.imask; leaves; leaves &= leaves - 1) {
+            const int slot = CountTrailingZeros(leaves);
+            const int first = node.triBase + (node.meta[slot] & 31), count = node.meta[slot] >> 5;
+            for (int i = first; i < first + count; ++i) {
+                if (HitTriangle(m_tris[i], o, d, tBest, hit.u, hit.v)) {
+                    hit.prim = i;
+                    bHit = true;
+                }
+            }
+            if (pStats) pStats->trianglesTested += count;
+        }
+
+        // 内部子节点按进入参数从远到近压栈，最近的最先弹出
+        Entry children[8];
+        int n = 0;
+        for (int inner = mask & node.imask; inner; inner &= inner - 1) {
+            const int slot = CountTrailingZeros(inner);
+            if (tEnter[slot] > tBest) continue;
+            Entry e = { CBlackHole_WideBVH::ChildIndex(node, slot), tEnter[slot] };
+            int j = n++;
+            for (; j > 0 && children[j - 1].t < e.t; --j) children[j] = children[j - 1];
+            children[j] = e;
+        }
+        for (int j = 0; j < n; ++j) stack[sp++] = children[j];
+
+        nodeIndex = -1;
+        while (sp > 0) {
+            const Entry& e = stack[--sp];
+            if (e.t <= tBest) {
+                nodeIndex = e.node;
+                break;
+            }
+        }
+        if (nodeIndex < 0) break;
+    }
+
+    if (bHit) hit.t = tBest;
+    return bHit;
+}
+
+ON_3dVector CBlackHole_Scene::Normal(const SceneHit& hit) const {
+    if (hit.instance >= 0) {
+        // 法线按逆变换的转置变换回世界坐标
+        const SceneInstance& instance = m_instances[hit.instance];
+        const CBlackHole_Scene& prototype = m_prototypes[instance.prototype]->Lod(hit.lod);
+        const ON_3dVector l = prototype.Normal(SceneHit{ hit.t, hit.prim });
+        const ON_Xform& m = instance.inverse;
+        ON_3dVector n(m.m_xform[0][0] * l.x + m.m_xform[1][0] * l.y + m.m_xform[2][0] * l.z,
+                      m.m_xform[0][1] * l.x + m.m_xform[1][1] * l.y + m.m_xform[2][1] * l.z,
+                      m.m_xform[0][2] * l.x + m.m_xform[1][2] * l.y + m.m_xform[2][2] * l.z);
+        n.Unitize();
+        return n;
+    }
+    const SceneTriangle& t = Lod(hit.lod).m_tris[hit.prim];
+    ON_3dVector n = ON_CrossProduct(ON_3dVector(t.e1[0], t.e1[1], t.e1[2]), ON_3dVector(t.e2[0], t.e2[1], t.e2[2]));
+    n.Unitize();
+    return n;
+}
+
+ON_3dVector CBlackHole_Scene::Albedo(int object) const {
+    const ON_3fVector& c = m_albedo[object];
+    return ON_3dVector(c.x, c.y, c.z);
+}
+
+bool CBlackHole_Scene::AlbedoEquals(int object, const ON_Color& albedo) const {
+    const ON_3fVector c = LinearAlbedo(albedo);
+    const ON_3fVector& a = m_albedo[object];
+    return a.x == c.x && a.y == c.y && a.z == c.z;
+}
+
+size_t CBlackHole_Scene::MemoryBytes() const {
+    size_t bytes = m_tris.size() * sizeof(SceneTriangle) + m_triObject.size() * sizeof(int) +
+        m_albedo.size() * sizeof(ON_3fVector) + NodeBytes() +
+        (m_triSource.size() + m_triPosition.size() + m_triLeaf.size() + m_parent.size()) * sizeof(int) +
+        m_instances.size() * sizeof(SceneInstance) + m_topNodes.size() * sizeof(BVHNode) + m_topOrder.size() * sizeof(int);
+    for (const auto& pPrototype : m_prototypes) bytes += pPrototype->MemoryBytes();
+    for (const auto& pLod : m_lods) bytes += pLod->MemoryBytes();
+    return bytes;
+}
+
+size_t CBlackHole_Scene::InstancedTriangleCount() const {
+    size_t count = 0;
+    for (const SceneInstance& instance : m_instances) {
+        if (instance.bAlive) count += m_prototypes[instance.prototype]->TriangleCount();
+    }
+    return count;
+}
+
+uint64_t CBlackHole_Scene::ContentKey() const {
+    // 三角形的顺序取决于 BVH 构建，各三角形连同原始编号单独哈希后相加
+    uint64_t triSum = 0;
+    for (size_t i = 0; i < m_tris.size(); ++i) {
+        const uint64_t source = (i < m_triSource.size()) ? (uint64_t)m_triSource[i] : (uint64_t)i;
+        const uint64_t h = CBlackHole_MeshCache::CombineBytes(source, &m_tris[i], sizeof(SceneTriangle));
+        triSum += CBlackHole_MeshCache::Combine(h, (uint64_t)(uint32_t)m_triObject[i]);
+    }
+    uint64_t key = CBlackHole_MeshCache::Combine(0, (uint64_t)m_tris.size());
+    key = CBlackHole_MeshCache::Combine(key, triSum);
+    key = CBlackHole_MeshCache::CombineBytes(key, m_albedo.data(), m_albedo.size() * sizeof(ON_3fVector));
+    key = CBlackHole_MeshCache::CombineBytes(key, m_lodSize.data(), m_lodSize.size() * sizeof(float));
+
+    for (const auto& pPrototype : m_prototypes) key = CBlackHole_MeshCache::Combine(key, pPrototype->ContentKey());
+    for (const SceneInstance& instance : m_instances) {
+        if (!instance.bAlive) continue;
+        key = CBlackHole_MeshCache::Combine(key, ((uint64_t)(uint32_t)instance.prototype << 32) | (uint32_t)instance.object);
+        key = CBlackHole_MeshCache::CombineBytes(key, &instance.xform.m_xform[0][0], sizeof(instance.xform.m_xform));
+    }
+    return key;
+}
+
+ON_BoundingBox CBlackHole_Scene::BoundingBox() const {
+    ON_BoundingBox box = ON_BoundingBox::EmptyBoundingBox;
+    if (m_layout == SceneLayout::Wide8 && !m_wide.empty()) {
+        float bmin[3], bmax[3];
+        CBlackHole_WideBVH::NodeBounds(m_wide[0], bmin, bmax);
+        box = ON_BoundingBox(ON_3dPoint(bmin[0], bmin[1], bmin[2]), ON_3dPoint(bmax[0], bmax[1], bmax[2]));
+    }
+    else if (m_layout == SceneLayout::Binary && !m_nodes.empty()) {
+        const BVHNode& r = m_nodes[0];
+        box = ON_BoundingBox(ON_3dPoint(r.bmin[0], r.bmin[1], r.bmin[2]), ON_3dPoint(r.bmax[0], r.bmax[1], r.bmax[2]));
+    }
+    if (!m_topNodes.empty()) {
+        const BVHNode& r = m_topNodes[0];
+        box.Union(ON_BoundingBox(ON_3dPoint(r.bmin[0], r.bmin[1], r.bmin[2]), ON_3dPoint(r.bmax[0], r.bmax[1], r.bmax[2])));
+    }
+    return box;
+}
+
+void CBlackHole_Scene::BuildTopLevel() {
+    m_topNodes.clear();
+    m_topOrder.clear();
+    m_bTopDirty = false;
+
+    // 原型包围盒的 8 个角变换到世界坐标；空原型（全是退化三角形）不进顶层
+    std::vector<BVHPrimBounds> bounds;
+    for (int i = 0; i < (int)m_instances.size(); ++i) {
+        const SceneInstance& instance = m_instances[i];
+        const CBlackHole_Scene& prototype = *m_prototypes[instance.prototype];
+        if (!instance.bAlive || prototype.IsEmpty()) continue;
+
+        ON_BoundingBox box = prototype.BoundingBox();
+        box.Transform(instance.xform);
+        BVHPrimBounds b;
+        for (int k = 0; k < 3; ++k) {
+            b.bmin[k] = nextafterf((float)box.m_min[k], -FLT_MAX);    // 转成 float 时向外取整
+            b.bmax[k] = nextafterf((float)box.m_max[k], FLT_MAX);
+        }
+        bounds.push_back(b);
+        m_topOrder.push_back(i);
+    }
+    if (bounds.empty()) return;
+
+    std::vector<int> order;
+    CBlackHole_BVHBuilder::Build(bounds, m_topNodes, order, false);
+    std::vector<int> topOrder(order.size());
+    for (size_t i = 0; i < order.size(); ++i) topOrder[i] = m_topOrder[order[i]];
+    m_topOrder.swap(topOrder);
+}
+
+// ==========================================
+// 增量更新
+
+std::shared_ptr<CBlackHole_Scene> CBlackHole_Scene::Clone() const {
+    return std::shared_ptr<CBlackHole_Scene>(new CBlackHole_Scene(*this));
+}
+
+int CBlackHole_Scene::FindObjects(const ON_UUID& owner, std::vector<int>& objects) const {
+    const auto it = m_ownerObjects.find(owner);
+    if (it == m_ownerObjects.end()) objects.clear();
+    else objects = it->second;
+    return (int)objects.size();
+}
+
+void CBlackHole_Scene::EnsureRefitTables() {
+    if (!m_parent.empty() || m_wide.empty()) return;
+
+    const int n = (int)m_tris.size();
+    m_triPosition.resize(n);
+    for (int i = 0; i < n; ++i) m_triPosition[m_triSource[i]] = i;
+
+    m_triLeaf.resize(n);
+    m_parent.assign(m_wide.size(), -1);
+    m_nodeMark.assign(m_wide.size(), 0);
+    m_sahSum = 0.0;
+    for (int i = 0; i < (int)m_wide.size(); ++i) {
+        const WideBVHNode& nd = m_wide[i];
+        m_sahSum += CBlackHole_WideBVH::Cost(nd);
+        for (int slot = 0; slot < 8; ++slot) {
+            if (nd.imask >> slot & 1) {
+                m_parent[CBlackHole_WideBVH::ChildIndex(nd, slot)] = i;
+            }
+            else {
+                const int first = nd.triBase + (nd.meta[slot] & 31);
+                for (int p = first; p < first + (nd.meta[slot] >> 5); ++p) m_triLeaf[p] = i;
+            }
+        }
+    }
+    m_sahBuilt = m_sahSum;
+}
+
+bool CBlackHole_Scene::UpdateMesh(int object, const ON_Mesh& mesh, const ON_Xform& xform) {
+    // 实例：网格内容与原型相同时只换变换，Commit 时重建顶层
+    if (m_objectInstance[object] >= 0) {
+        SceneInstance& instance = m_instances[m_objectInstance[object]];
+        const auto it = m_prototypeKeyed[instance.prototype]
+            ? m_meshPrototype.find(CBlackHole_MeshCache::MeshKey(mesh, ON_Xform::IdentityTransformation)) : m_meshPrototype.end();
+        if (it != m_meshPrototype.end() && it->second == instance.prototype) {
+            instance.xform = xform;
+        }
+        else if (!m_prototypeKeyed[instance.prototype]) {
+            // 单独放置的网格（带简化级别的大网格）：原型只属于这个实例，三角形在世界坐标
+            // 旧原型可能还被渲染中的快照共用，在它的副本上重拟合；简化级别作废，由 RebuildLods 在后台重建
+            std::shared_ptr<CBlackHole_Scene> pPrototype = m_prototypes[instance.prototype]->Clone();
+            SceneUpdateStats partStats;
+            if (!pPrototype->UpdateMesh(0, mesh, xform) || !pPrototype->Commit(&partStats)) return false;
+            m_pending.nodesRefit += partStats.nodesRefit;
+            m_pending.trianglesRebuilt += partStats.trianglesRebuilt;
+            m_prototypes[instance.prototype] = pPrototype;
+            instance.xform = ON_Xform::IdentityTransformation;
+        }
+        else {
+            return false;
+        }
+        instance.inverse = instance.xform.Inverse();
+        instance.lodScale = LodScale(instance.xform);
+        m_bTopDirty = true;
+        m_pending.objectsUpdated++;
+        return true;
+    }
+    if (m_layout != SceneLayout::Wide8) return false;
+    InvalidateLods();
+
+    const int first = m_objectFirst[object];
+    const int count = m_objectFirst[object + 1] - first;
+
+    std::vector<SceneTriangle> tris;
+    tris.reserve(count);
+    MeshTriangles(mesh, xform, tris);
+    if ((int)tris.size() != count) return false;
+
+    EnsureRefitTables();
+    for (int j = 0; j < count; ++j) {
+        const int p = m_triPosition[first + j];
+        m_tris[p] = tris[j];
+        MarkLeaf(p);
+    }
+    m_pending.objectsUpdated++;
+    return true;
+}
+
+void CBlackHole_Scene::SetAlbedo(int object, const ON_Color& albedo) {
+    m_albedo[object] = LinearAlbedo(albedo);
+}
+
+void CBlackHole_Scene::RemoveObject(int object) {
+    if (m_objectInstance[object] >= 0) {
+        m_instances[m_objectInstance[object]].bAlive = false;
+        m_bTopDirty = true;
+    }
+    else if (m_layout != SceneLayout::Wide8) {
+        m_bRebuildRequired = true;
+        return;
+    }
+    else {
+        InvalidateLods();
+    }
+
+    EnsureRefitTables();
+    const int first = m_objectFirst[object];
+    for (int j = first; j < m_objectFirst[object + 1]; ++j) {
+        const int p = m_triPosition[j];
+        if (m_triObject[p] < 0) continue;
+        // 边向量置零后行列式为 0，求交永远不命中
+        SceneTriangle& t = m_tris[p];
+        t.e1[0] = t.e1[1] = t.e1[2] = 0.0f;
+        t.e2[0] = t.e2[1] = t.e2[2] = 0.0f;
+        m_triObject[p] = -1;
+        m_deadTris++;
+        MarkLeaf(p);
+    }
+
+    std::vector<int>& objects = m_ownerObjects[m_objectOwner[object]];
+    objects.erase(std::remove(objects.begin(), objects.end(), object), objects.end());
+    if (objects.empty()) m_ownerObjects.erase(m_objectOwner[object]);
+    m_objectOwner[object] = ON_nil_uuid;
+    m_pending.objectsRemoved++;
+}
+
+// 按叶子槽位内仍存活的三角形、内部槽位子节点的范围重算各槽位并重新量化，同时更新 m_sahSum
+// 返回节点自身代价是否变差到需要重建
+bool CBlackHole_Scene::RefitNode(int nodeIndex) {
+    WideBVHNode& nd = m_wide[nodeIndex];
+    const double oldCost = CBlackHole_WideBVH::Cost(nd);
+
+    float mn[8][3], mx[8][3];
+    for (int slot = 0; slot < 8; ++slot) {
+        float* bmin = mn[slot];
+        float* bmax = mx[slot];
+        bmin[0] = bmin[1] = bmin[2] = FLT_MAX;
+        bmax[0] = bmax[1] = bmax[2] = -FLT_MAX;
+        if (nd.imask >> slot & 1) {
+            CBlackHole_WideBVH::NodeBounds(m_wide[CBlackHole_WideBVH::ChildIndex(nd, slot)], bmin, bmax);
+            continue;
+        }
+        const int count = nd.meta[slot] >> 5;
+        if (count == 0) continue;
+        const int first = nd.triBase + (nd.meta[slot] & 31);
+        for (int p = first; p < first + count; ++p) {
+            if (m_triObject[p] >= 0) GrowBounds(bmin, bmax, m_tris[p]);
+        }
+        // 槽位里全是已删除的三角形：缩成一点（边为零的三角形的包围盒就是 v0）
+        if (bmin[0] > bmax[0]) GrowBounds(bmin, bmax, m_tris[first]);
+    }
+    CBlackHole_WideBVH::Quantize(nd, mn, mx);
+
+    const double newCost = CBlackHole_WideBVH::Cost(nd);
+    m_sahSum += newCost - oldCost;
+    return newCost > kRebuildSAHRatio * oldCost;
+}
+
+bool CBlackHole_Scene::Commit(SceneUpdateStats* pStats) {
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    SceneUpdateStats stats = m_pending;
+    m_pending = SceneUpdateStats();
+
+    bool bOk = !m_bRebuildRequired;
+    if (!m_dirtyLeaves.empty()) {
+        // 1. 受影响的节点及其全部祖先；子节点下标总比父节点大，按下标从大到小处理即为自底向上
+        std::vector<int> dirty;
+        for (int leaf : m_dirtyLeaves) {
+            for (int i = leaf; i >= 0 && !m_nodeMark[i]; i = m_parent[i]) {
+                m_nodeMark[i] = 1;
+                dirty.push_back(i);
+            }
+        }
+        m_dirtyLeaves.clear();
+        std::sort(dirty.begin(), dirty.end(), [](int a, int b) { return a > b; });
+        std::vector<int> degraded;
+        for (int i : dirty) {
+            if (RefitNode(i)) degraded.push_back(i);
+        }
+        stats.nodesRefit = (int)dirty.size();
+
+        // 2. 总代价变差太多时，找到自身变差的节点的最近公共祖先，重建它的子树
+        //    物体移远后变差的是它一路往上的祖先，而不是它自己所在的节点
+        //    标记 3 为自身变差，2 为在通往变差节点的路径上
+        if (m_sahSum > kRebuildSAHRatio * m_sahBuilt && !degraded.empty()) {
+            for (int node : degraded) {
+                for (int i = m_parent[node]; i >= 0 && m_nodeMark[i] < 2; i = m_parent[i]) m_nodeMark[i] = 2;
+            }
+            for (int node : degraded) m_nodeMark[node] = 3;
+
+            int lca = 0;
+            while (m_nodeMark[lca] != 3) {
+                const WideBVHNode& nd = m_wide[lca];
+                int next = -1, marked = 0;
+                for (int slot = 0; slot < 8; ++slot) {
+                    if (!(nd.imask >> slot & 1)) continue;
+                    const int child = CBlackHole_WideBVH::ChildIndex(nd, slot);
+                    if (m_nodeMark[child] >= 2) {
+                        next = child;
+                        marked++;
+                    }
+                }
+                if (marked != 1) break;
+                lca = next;
+            }
+            // 公共祖先是根时整棵树都要重建，交给调用者
+            if (lca == 0) bOk = false;
+            else RebuildSubtree(lca, stats);
+        }
+        for (int i : dirty) m_nodeMark[i] = 0;
+    }
+
+    // 实例移动或删除只重建顶层，原型不动
+    if (m_bTopDirty) BuildTopLevel();
+
+    // 重建后仍然太差、或删除与废弃节点积累太多时，整体重建一次
+    if (m_sahSum > kRebuildSAHRatio * m_sahBuilt || m_deadTris * 4 > (int)m_tris.size() || m_garbageNodes * 2 > (int)m_wide.size())
+        bOk = false;
+
+    stats.updateMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+    if (pStats) *pStats = stats;
+    return bOk;
+}
+
+void CBlackHole_Scene::RebuildSubtree(int nodeIndex, SceneUpdateStats& stats) {
+    // 子树的三角形在重排后是连续的一段
+    const int first = m_wide[nodeIndex].triBase;
+    const int count = CBlackHole_WideBVH::SubtreeEnd(m_wide, nodeIndex) - first;
+
+    // 旧子树的代价与节点数，除占位的根以外都变成废弃节点
+    double oldCost = 0.0;
+    int oldNodes = 0;
+    std::vector<int> stack = { nodeIndex };
+    while (!stack.empty()) {
+        const WideBVHNode& nd = m_wide[stack.back()];
+        stack.pop_back();
+        oldCost += CBlackHole_WideBVH::Cost(nd);
+        oldNodes++;
+        for (int slot = 0; slot < 8; ++slot) {
+            if (nd.imask >> slot & 1) stack.push_back(CBlackHole_WideBVH::ChildIndex(nd, slot));
+        }
+    }
+
+    // 已删除的三角形边为零，包围盒是一个点，一起参与构建
+    std::vector<BVHPrimBounds> bounds(count);
+    for (int i = 0; i < count; ++i) {
+        bounds[i].bmin[0] = bounds[i].bmin[1] = bounds[i].bmin[2] = FLT_MAX;
+        bounds[i].bmax[0] = bounds[i].bmax[1] = bounds[i].bmax[2] = -FLT_MAX;
+        GrowBounds(bounds[i].bmin, bounds[i].bmax, m_tris[first + i]);
+    }
+    const bool bParallel = count > kParallelSubtree;
+    std::vector<BVHNode> binary;
+    std::vector<int> binaryOrder, order;
+    std::vector<WideBVHNode> sub;
+    CBlackHole_BVHBuilder::Build(bounds, binary, binaryOrder, bParallel);
+    CBlackHole_WideBVH::Collapse(binary, sub, order, bParallel);
+    for (int i = 0; i < count; ++i) order[i] = binaryOrder[order[i]];
+
+    // 新子树根写回原位，其余节点接在数组末尾
+    const int base = (int)m_wide.size() - 1;
+    double newCost = 0.0;
+    for (size_t j = 0; j < sub.size(); ++j) {
+        WideBVHNode nd = sub[j];
+        nd.childBase += base;
+        nd.triBase += first;
+        newCost += CBlackHole_WideBVH::Cost(nd);
+        if (j == 0) m_wide[nodeIndex] = nd;
+        else m_wide.push_back(nd);
+    }
+    m_parent.resize(m_wide.size(), -1);
+    m_nodeMark.resize(m_wide.size(), 0);
+    for (size_t j = 0; j < sub.size(); ++j) {
+        const int i = j == 0 ? nodeIndex : base + (int)j;
+        const WideBVHNode& nd = m_wide[i];
+        for (int slot = 0; slot < 8; ++slot) {
+            if (nd.imask >> slot & 1) {
+                m_parent[CBlackHole_WideBVH::ChildIndex(nd, slot)] = i;
+            }
+            else {
+                const int p0 = nd.triBase + (nd.meta[slot] & 31);
+                for (int p = p0; p < p0 + (nd.meta[slot] >> 5); ++p) m_triLeaf[p] = i;
+            }
+        }
+    }
+
+    // 区间内的三角形按新槽位顺序重排
+    std::vector<SceneTriangle> tris(m_tris.begin() + first, m_tris.begin() + first + count);
+    std::vector<int> triObject(m_triObject.begin() + first, m_triObject.begin() + first + count);
+    std::vector<int> triSource(m_triSource.begin() + first, m_triSource.begin() + first + count);
+    for (int i = 0; i < count; ++i) {
+        const int p = first + i;
+        m_tris[p] = tris[order[i]];
+        m_triObject[p] = triObject[order[i]];
+        m_triSource[p] = triSource[order[i]];
+        m_triPosition[m_triSource[p]] = p;
+    }
+
+    m_sahSum += newCost - oldCost;
+    m_garbageNodes += oldNodes - 1;
+    stats.trianglesRebuilt += count;
+
+    // 已删除三角形的点可能落在重拟合后的盒子外，祖先重新合并一次
+    for (int i = m_parent[nodeIndex]; i >= 0; i = m_parent[i]) RefitNode(i);
+}
+
+// ==========================================
+// 磁盘缓存
+
+bool CBlackHole_Scene::WriteCache(const std::wstring& path) const {
+    if (!m_bBuilt || m_layout != SceneLayout::Wide8 || m_objectFirst.empty()) return false;
+
+    FILE* fp = nullptr;
+    if (0 != _wfopen_s(&fp, path.c_str(), L"wb") || nullptr == fp) return false;
+    bool ok = WriteCacheTo(fp);
+    ok = (0 == fclose(fp)) && ok;
+    return ok;
+}
+
+bool CBlackHole_Scene::WriteCacheTo(FILE* fp) const {
+    SceneCacheHeader header = {};
+    memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+    header.version = kCacheVersion;
+    header.objectCount = (uint32_t)m_albedo.size();
+    header.triCount = m_tris.size();
+    header.nodeCount = m_wide.size();
+    header.sahCost = m_buildStats.sahCost;
+    header.maxDepth = m_buildStats.maxDepth;
+    header.leafCount = m_buildStats.leafCount;
+
+    const size_t n = m_tris.size();
+    const uint32_t lodCount = (uint32_t)m_lods.size();
+    bool ok = 1 == fwrite(&header, sizeof(header), 1, fp);
+    ok = ok && m_objectFirst.size() == fwrite(m_objectFirst.data(), sizeof(int), m_objectFirst.size(), fp);
+    ok = ok && n == fwrite(m_tris.data(), sizeof(SceneTriangle), n, fp);
+    ok = ok && n == fwrite(m_triObject.data(), sizeof(int), n, fp);
+    ok = ok && n == fwrite(m_triSource.data(), sizeof(int), n, fp);
+    ok = ok && m_wide.size() == fwrite(m_wide.data(), sizeof(WideBVHNode), m_wide.size(), fp);
+    ok = ok && 1 == fwrite(&lodCount, sizeof(lodCount), 1, fp);
+    ok = ok && lodCount == fwrite(m_lodSize.data(), sizeof(float), lodCount, fp);
+    for (const auto& pLod : m_lods) ok = ok && pLod->WriteCacheTo(fp);
+    return ok;
+}
+
+bool CBlackHole_Scene::ReadCache(const std::wstring& path, unsigned long long* pBytesRead) {
+    const auto t0 = std::chrono::high_resolution_clock::now();
+
+    // 1. 映射整个文件，顺序读取
+    HANDLE hFile = ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (INVALID_HANDLE_VALUE == hFile) return false;
+
+    LARGE_INTEGER size = {};
+    HANDLE hMapping = NULL;
+    const uint8_t* pView = nullptr;
+    if (::GetFileSizeEx(hFile, &size) && size.QuadPart >= (LONGLONG)sizeof(SceneCacheHeader)) {
+        hMapping = ::CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (NULL != hMapping) pView = (const uint8_t*)::MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    }
+
+    // 2. 逐条解析，整个文件恰好是一条记录（连同其中的简化级别）才算有效
+    const uint8_t* pEnd = pView ? pView + size.QuadPart : nullptr;
+    const bool ok = nullptr != pView && pEnd == ReadCacheFrom(pView, pEnd);
+    if (ok) {
+        m_buildStats.buildMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+        if (pBytesRead) *pBytesRead = (unsigned long long)size.QuadPart;
+    }
+
+    if (pView) ::UnmapViewOfFile(pView);
+    if (hMapping) ::CloseHandle(hMapping);
+    ::CloseHandle(hFile);
+    return ok;
+}
+
+// 解析从 p 开始的一条记录，成功时返回记录之后的位置；失败返回 nullptr，场景不变
+const unsigned char* CBlackHole_Scene::ReadCacheFrom(const unsigned char* p, const unsigned char* end) {
+    // 1. 校验记录头、各段长度与物体划分
+    if ((size_t)(end - p) < sizeof(SceneCacheHeader)) return nullptr;
+    SceneCacheHeader header;
+    memcpy(&header, p, sizeof(header));
+    const uint64_t n = header.triCount;
+    if (0 != memcmp(header.magic, kCacheMagic, sizeof(kCacheMagic)) || kCacheVersion != header.version ||
+        n >= (1ull << 31) || header.nodeCount >= (1ull << 31) || header.objectCount >= (1u << 31))
+        return nullptr;
+    const uint64_t bytes = (header.objectCount + 1ull) * sizeof(int) + n * (sizeof(SceneTriangle) + 2 * sizeof(int)) +
+        header.nodeCount * sizeof(WideBVHNode) + sizeof(uint32_t);
+    if ((uint64_t)(end - p) - sizeof(SceneCacheHeader) < bytes) return nullptr;
+
+    const int* pObjectFirst = (const int*)(p + sizeof(SceneCacheHeader));
+    if (!m_albedo.empty()) {
+        if (m_albedo.size() != header.objectCount || m_tris.size() != n ||
+            0 != memcmp(m_objectFirst.data(), pObjectFirst, m_objectFirst.size() * sizeof(int)))
+            return nullptr;
+    }
+    const uint8_t* q = (const uint8_t*)(pObjectFirst + header.objectCount + 1);
+    const SceneTriangle* pTris = (const SceneTriangle*)q;
+    q += n * sizeof(SceneTriangle);
+    const int* pTriObject = (const int*)q;
+    q += n * sizeof(int);
+    const int* pTriSource = (const int*)q;
+    q += n * sizeof(int);
+    const WideBVHNode* pNodes = (const WideBVHNode*)q;
+    q += header.nodeCount * sizeof(WideBVHNode);
+
+    // 2. 简化级别各是一条完整的记录，先全部解析成功再动本场景
+    uint32_t lodCount;
+    memcpy(&lodCount, q, sizeof(lodCount));
+    q += sizeof(lodCount);
+    if (lodCount > (uint32_t)kMaxLods || (size_t)(end - q) < lodCount * sizeof(float)) return nullptr;
+    std::vector<float> lodSize(lodCount);
+    memcpy(lodSize.data(), q, lodCount * sizeof(float));
+    q += lodCount * sizeof(float);
+    std::vector<std::shared_ptr<CBlackHole_Scene>> lods(lodCount);
+    for (uint32_t k = 0; k < lodCount; ++k) {
+        lods[k] = std::make_shared<CBlackHole_Scene>();
+        q = lods[k]->ReadCacheFrom(q, end);
+        if (!q) return nullptr;
+    }
+
+    // 3. 拷进场景：增量更新会改写三角形与节点，不能直接指向映射
+    if (m_albedo.empty()) {
+        m_albedo.assign(header.objectCount, ON_3fVector(1.0f, 1.0f, 1.0f));
+        m_objectOwner.assign(header.objectCount, ON_nil_uuid);
+        m_objectInstance.assign(header.objectCount, -1);
+        m_objectFirst.assign(pObjectFirst, pObjectFirst + header.objectCount + 1);
+    }
+    m_tris.assign(pTris, pTris + n);
+    m_triObject.assign(pTriObject, pTriObject + n);
+    m_triSource.assign(pTriSource, pTriSource + n);
+    m_lods.swap(lods);
+    m_lodSize.swap(lodSize);
+
+    BeginBuild(false, SceneLayout::Wide8);
+    m_wide.assign(pNodes, pNodes + header.nodeCount);
+
+    m_buildStats = BVHBuildStats();
+    m_buildStats.sahCost = header.sahCost;
+    m_buildStats.maxDepth = header.maxDepth;
+    m_buildStats.leafCount = header.leafCount;
+    m_buildStats.nodeCount = (int)header.nodeCount;
+    return q;
+}
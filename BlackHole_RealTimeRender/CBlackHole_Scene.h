@@ -0,0 +1,229 @@
+﻿// CBlackHole_Scene.h
+// 渲染器自己的三角形场景：从 Rhino render mesh 拷贝出世界坐标三角形并建立 BVH，
+// 供弯曲光线逐段求交（每个 RK4 步是一条短线段）
+#pragma once
+#include "stdafx.h"
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <string>
+#include <cstdio>
+#include "CBlackHole_Common.h"
+#include "CBlackHole_BVHBuilder.h"
+#include "CBlackHole_WideBVH.h"
+
+// 预先算好边向量的三角形，BVH 建好后按叶子顺序重排，求交时不需要间接索引
+struct SceneTriangle {
+    float v0[3];
+    float e1[3];    // v1 - v0
+    float e2[3];    // v2 - v0
+};
+
+// 线段求交结果
+struct SceneHit {
+    float t = 1.0f;     // 线段参数 [0, 1]
+    int   prim = -1;    // 三角形编号（重排后）；命中实例时为原型中的编号
+    int   instance = -1;
+    float u = 0.0f, v = 0.0f;
+    int   lod = 0;      // 命中的简化级别，0 为原始网格，prim 是该级别中的编号
+};
+
+// 求交统计，调用者每个线程一份，不做同步
+struct SceneQueryStats {
+    unsigned long long segments = 0;
+    unsigned long long nodesVisited = 0;
+    unsigned long long trianglesTested = 0;
+    double curvedLength = 0.0;      // 按 RK4 步逐段求交的光线长度
+    double straightLength = 0.0;    // 弯曲可忽略、整段按直线求交的光线长度
+    unsigned long long lodTests = 0;    // 改在简化网格上求交的次数（每个网格算一次）
+};
+
+// 一次增量更新的统计
+struct SceneUpdateStats {
+    double updateMs = 0.0;
+    int    objectsUpdated = 0;
+    int    objectsRemoved = 0;
+    int    nodesRefit = 0;
+    int    trianglesRebuilt = 0;    // 部分重建的子树包含的三角形数
+};
+
+// 块实例：同一网格的多个实例共享一份局部坐标下的原型（底层 BVH），顶层 BVH 建在各实例的世界包围盒上
+// 移动实例只需要换变换、重建顶层
+struct SceneInstance {
+    ON_Xform xform;     // 局部 -> 世界
+    ON_Xform inverse;
+    int      prototype;
+    int      object;
+    bool     bAlive;
+    float    lodScale;  // 世界长度换算到局部长度的最小倍数（1 / 变换的最大奇异值），选简化级别时宁细勿粗
+};
+
+// 求交用的树：二叉树只是构建的中间结果，保留下来用于性能对比
+enum class SceneLayout {
+    Binary,
+    Wide8,
+};
+
+class CBlackHole_Scene {
+public:
+    CBlackHole_Scene() = default;
+
+    CBlackHole_Scene& operator=(const CBlackHole_Scene&) = delete;
+
+    // ==========================================
+    // 1. 构建（主线程）
+
+    void Clear();
+
+    // 加入一个网格，四边形拆成两个三角形；返回物体编号。owner 为所属 Rhino 物体，增量更新时据此查找
+    int AddMesh(const ON_Mesh& mesh, const ON_Xform& xform, const ON_Color& albedo, const ON_UUID& owner = ON_nil_uuid);
+
+    // 以实例方式加入：内容相同的网格（块定义的几何）只拷贝、构建一次；返回物体编号
+    int AddInstance(const ON_Mesh& mesh, const ON_Xform& xform, const ON_Color& albedo, const ON_UUID& owner = ON_nil_uuid);
+
+    // 原型已在别处构建（后台加载）；key 为原型网格的内容哈希（MeshKey，单位变换），相同的键只保留第一个原型，为 0 时不去重
+    // 网格地址在 Rhino 释放后可能被新网格重用，不能跨采集作为标识，所以按内容去重
+    int AddInstance(std::shared_ptr<CBlackHole_Scene> pPrototype, uint64_t key, const ON_Xform& xform, const ON_Color& albedo, const ON_UUID& owner = ON_nil_uuid);
+
+    // 并入一个单独构建的单物体场景，效果与用同一网格调用 AddMesh 相同，但不再转换网格
+    int AddPart(const CBlackHole_Scene& part, const ON_Color& albedo, const ON_UUID& owner = ON_nil_uuid);
+
+    // 加完所有网格后调用，之前的 BVH 作废；并行构建使用共享线程池，不能在池内线程中调用
+    // Wide8 先建二叉树再折叠成 8 叉树，二叉树随后释放
+    void Build(bool bParallel = true, SceneLayout layout = SceneLayout::Wide8);
+
+    // Build 之后调用：按顶点聚类生成逐级变粗的简化网格（格子每级加倍），每级有自己的 BVH
+    // 只对三角形足够多的 Wide8 场景生效；作为原型时由顶层按光线覆盖范围选级别
+    void BuildLods();
+
+    // ==========================================
+    // 2. 查询（任意线程，只读）
+
+    // 线段 a -> b 与场景的最近交点。footprint 为这段光线一个像素在世界坐标中的宽度，
+    // 不小于某一级简化网格的三角形尺寸时改在那一级上求交；0 表示总用原始网格
+    bool IntersectSegment(const ON_3dPoint& a, const ON_3dPoint& b, SceneHit& hit, SceneQueryStats* pStats = nullptr, double footprint = 0.0) const;
+
+    ON_3dVector Normal(const SceneHit& hit) const;     // 几何法线（单位向量，未定向）
+    int         Object(const SceneHit& hit) const { return hit.instance >= 0 ? m_instances[hit.instance].object : Lod(hit.lod).m_triObject[hit.prim]; }
+    ON_3dVector Albedo(int object) const;   // 线性 RGB 漫反射率
+    bool        AlbedoEquals(int object, const ON_Color& albedo) const;    // 与 SetAlbedo(albedo) 的结果相同
+
+    bool            IsEmpty() const { return m_nodes.empty() && m_wide.empty() && m_topNodes.empty(); }
+    size_t          TriangleCount() const { return m_tris.size(); }    // 不含实例
+    size_t          InstanceCount() const { return m_instances.size(); }
+    size_t          PrototypeCount() const { return m_prototypes.size(); }
+    size_t          InstancedTriangleCount() const;                    // 所有实例展开后的三角形数
+    bool            HasLods() const { return m_bHasLods; }             // 自身或某个原型有简化级别
+    int             LodCount() const { return (int)m_lods.size(); }
+    size_t          LodTriangleCount() const;                          // 各级简化网格的三角形总数，含原型
+    size_t          NodeCount() const { return m_layout == SceneLayout::Wide8 ? m_wide.size() : m_nodes.size(); }
+    size_t          NodeBytes() const { return m_nodes.size() * sizeof(BVHNode) + m_wide.size() * sizeof(WideBVHNode); }
+    size_t          MemoryBytes() const;
+    SceneLayout     Layout() const { return m_layout; }
+    ON_BoundingBox  BoundingBox() const;
+    double          BuildMs() const { return m_buildStats.buildMs; }
+    const BVHBuildStats& BuildStats() const { return m_buildStats; }
+
+    // 影响渲染结果的内容的 64 位哈希：三角形（按原始编号，与 BVH 重排无关）、物体颜色、实例的原型与变换、简化级别的尺寸
+    // 同样的场景在不同会话中得到同样的键，离线渲染的检查点据此判断场景是否变了
+    uint64_t        ContentKey() const;
+
+    // ==========================================
+    // 3. 增量更新（主线程，只改自己的副本）
+    // 已发布的快照可能正被渲染线程读取，不能就地修改：先 Clone，改完再把副本作为新快照发布
+    // 修改先记下受影响的叶子，Commit 时只重拟合这些叶子及其祖先；SAH 代价比上次整体构建差太多时重建受影响的子树
+    // UpdateMesh / Commit 返回 false 表示无法增量处理，调用者应 Clear 后整体重建；只有 Wide8 支持增量更新
+
+    // 拷贝自己的三角形、树与增量表；原型与简化级别构建后只读，与原场景共享
+    std::shared_ptr<CBlackHole_Scene> Clone() const;
+
+    // 增量更新只重拟合原始网格的 BVH，简化级别随之作废；LodsStale 表示自身或某个原型的简化级别等待重建
+    // RebuildLods 返回一个副本，其中作废的简化级别已重建（原型各自拷贝后重建，原场景不变），在后台线程调用；取消时返回 nullptr
+    bool LodsStale() const;
+    std::shared_ptr<CBlackHole_Scene> RebuildLods(const std::atomic<bool>& bCancel) const;
+
+    bool IsBuilt() const { return m_bBuilt; }
+    int  FindObjects(const ON_UUID& owner, std::vector<int>& objects) const;  // 属于 owner 的物体编号，按加入顺序
+    bool UpdateMesh(int object, const ON_Mesh& mesh, const ON_Xform& xform);  // 三角形数必须与原来相同；共享原型的实例只能换变换
+    void SetAlbedo(int object, const ON_Color& albedo);
+    void RemoveObject(int object);                                            // 三角形退化为点，留到下次整体重建再回收
+    bool Commit(SceneUpdateStats* pStats = nullptr);
+
+    // ==========================================
+    // 4. 磁盘缓存（任意线程，只操作自己的场景）
+    // 文件保存重排后的三角形与 8 叉 BVH（连同各级简化网格），读回即可求交，省去网格转换与构建；实例不写入，读回后照常构建顶层
+
+    bool WriteCache(const std::wstring& path) const;   // 只支持构建过的 Wide8 场景
+
+    // 代替 AddMesh + Build。场景没有物体时按文件建立物体（白色、没有所属物体）；
+    // 已加入物体时物体划分必须与文件一致，读入的三角形替换原有的。失败时场景不变
+    bool ReadCache(const std::wstring& path, unsigned long long* pBytesRead = nullptr);
+
+private:
+    CBlackHole_Scene(const CBlackHole_Scene&) = default;   // 只供 Clone 使用
+
+    void BeginBuild(bool bParallel, SceneLayout layout);   // 清掉旧的树与增量表，构建原型与顶层
+    bool WriteCacheTo(FILE* fp) const;
+    const unsigned char* ReadCacheFrom(const unsigned char* p, const unsigned char* end);
+
+    const CBlackHole_Scene& Lod(int level) const { return level > 0 ? *m_lods[level - 1] : *this; }
+    int  SelectLod(double footprint) const;     // 三角形尺寸不超过 footprint 的最粗级别
+    void Cluster(float cell, CBlackHole_Scene& out) const;
+    void DropLods() { m_lods.clear(); m_lodSize.clear(); }
+    void InvalidateLods() { m_bLodsStale = m_bLodsStale || !m_lods.empty(); DropLods(); }  // 简化网格不跟随增量更新，之后在后台重建
+
+    bool IntersectBinary(const float o[3], const float d[3], const float invD[3], SceneHit& hit, SceneQueryStats* pStats) const;
+    bool IntersectWide(const float o[3], const float d[3], const float invD[3], SceneHit& hit, SceneQueryStats* pStats) const;
+    bool IntersectInstances(const ON_3dPoint& a, const ON_3dPoint& b, SceneHit& hit, SceneQueryStats* pStats, double footprint) const;
+    void BuildTopLevel();
+
+    void EnsureRefitTables();
+    void MarkLeaf(int prim) { m_dirtyLeaves.push_back(m_triLeaf[prim]); }
+    bool RefitNode(int nodeIndex);
+    void RebuildSubtree(int nodeIndex, SceneUpdateStats& stats);
+
+    std::vector<SceneTriangle> m_tris;
+    std::vector<int>           m_triObject;    // 三角形所属物体
+    std::vector<ON_3fVector>   m_albedo;       // 每个物体一项
+    std::vector<BVHNode>       m_nodes;        // SceneLayout::Binary
+    std::vector<WideBVHNode>   m_wide;         // SceneLayout::Wide8
+    SceneLayout                m_layout = SceneLayout::Wide8;
+
+    // 实例：原型按网格内容哈希去重，增量更新时同样按内容找回原型
+    std::vector<std::shared_ptr<CBlackHole_Scene>> m_prototypes;   // 构建后只读，可被多个场景共享
+    std::vector<char>          m_prototypeKeyed;   // 按内容去重的原型；其余的只属于一个实例
+    std::map<uint64_t, int>    m_meshPrototype;
+    std::vector<SceneInstance> m_instances;
+    std::vector<int>           m_objectInstance;   // 物体 -> 实例编号，普通网格为 -1
+    std::vector<BVHNode>       m_topNodes;         // 存活实例上的二叉 BVH
+    std::vector<int>           m_topOrder;         // 顶层叶子位置 -> 实例编号
+    bool                       m_bTopDirty = false;
+    BVHBuildStats              m_buildStats;
+    bool                       m_bBuilt = false;
+
+    // 简化级别：m_lods[k] 的三角形尺寸约为 m_lodSize[k]，逐级加倍
+    std::vector<std::shared_ptr<CBlackHole_Scene>> m_lods;
+    std::vector<float>         m_lodSize;
+    bool                       m_bHasLods = false;
+    bool                       m_bLodsStale = false;
+
+    // 物体：原始三角形编号 [m_objectFirst[k], m_objectFirst[k + 1])，即 AddMesh 时的顺序
+    std::vector<int>           m_objectFirst;
+    std::vector<ON_UUID>       m_objectOwner;
+    std::map<ON_UUID, std::vector<int>, UuidLess> m_ownerObjects;
+    std::vector<int>           m_triSource;    // 重排后位置 -> 原始编号
+
+    // 增量更新用的表，第一次更新时才建立，不拖慢首次构建
+    std::vector<int>           m_triPosition;  // 原始编号 -> 重排后位置
+    std::vector<int>           m_triLeaf;      // 重排后位置 -> 叶子槽位所在的 8 叉节点
+    std::vector<int>           m_parent;       // 8 叉节点的父节点，根节点为 -1
+    std::vector<char>          m_nodeMark;
+    std::vector<int>           m_dirtyLeaves;
+    double                     m_sahSum = 0.0;     // sum(槽位面积 * 代价权重)，未归一化
+    double                     m_sahBuilt = 0.0;   // 上次整体构建时的 m_sahSum
+    bool                       m_bRebuildRequired = false;  // 二叉树上删除了物体
+    int                        m_deadTris = 0;
+    int                        m_garbageNodes = 0; // 部分重建后不再引用的旧节点
+    SceneUpdateStats           m_pending;
+};
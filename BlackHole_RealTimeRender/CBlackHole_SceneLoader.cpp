@@ -0,0 +1,303 @@
+﻿// CBlackHole_SceneLoader.cpp
+#include "stdafx.h"
+#include <chrono>
+#include <map>
+#include "CBlackHole_ThreadPool.h"
+#include "CBlackHole_Log.h"
+#include "CBlackHole_SceneLoader.h"
+
+static const int kParallelPart = 1 << 16;  // 面数超过这个值的网格在协调线程上并行构建，其余各自串行、彼此并行
+static const int kPublishMs = 100;         // 两次发布快照的最短间隔
+static const int kPoolShare = 4;           // 小部件同时在池上的任务数不超过线程数的这个几分之一，渲染提交的任务不必排在整个加载后面
+
+void CBlackHole_SceneLoader::Start(std::vector<SceneLoadRecord>&& records) {
+    Cancel();
+    m_bCancel = false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_current.reset();
+    m_bComplete = records.empty();
+    m_bLoading = !records.empty();
+    if (records.empty()) {
+        // 空场景也发布一个已构建的场景，之后新增物体时走整体重建
+        m_current = std::make_shared<CBlackHole_Scene>();
+        m_current->Build(false);
+    }
+    ++m_revision;
+    if (m_bLoading) m_thread = std::thread(&CBlackHole_SceneLoader::Run, this, std::move(records));
+}
+
+void CBlackHole_SceneLoader::Cancel() {
+    m_bCancel = true;
+    if (m_thread.joinable()) m_thread.join();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this] { return m_lodTasks == 0; });
+}
+
+std::shared_ptr<const CBlackHole_Scene> CBlackHole_SceneLoader::Current(bool* pbComplete) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (pbComplete) *pbComplete = m_bComplete;
+    return m_current;
+}
+
+bool CBlackHole_SceneLoader::IsComplete() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bComplete;
+}
+
+bool CBlackHole_SceneLoader::IsLoading() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bLoading;
+}
+
+bool CBlackHole_SceneLoader::WaitComplete(int timeoutMs) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] { return m_bComplete || !m_bLoading; });
+    return m_bComplete;
+}
+
+std::shared_ptr<CBlackHole_Scene> CBlackHole_SceneLoader::EditableCopy(int timeoutMs) {
+    std::shared_ptr<const CBlackHole_Scene> pScene;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] { return !m_bLoading; })) return nullptr;
+        if (!m_bComplete || !m_current) return nullptr;
+        pScene = m_current;
+    }
+    // 拷贝在锁外进行，渲染线程取快照不必等
+    return pScene->Clone();
+}
+
+void CBlackHole_SceneLoader::Replace(std::shared_ptr<CBlackHole_Scene> scene) {
+    const bool bLods = scene->LodsStale();
+    const std::shared_ptr<const CBlackHole_Scene> pBase = scene;
+    Publish(std::move(scene), true);
+    if (!bLods) return;
+
+    // 上一次的重建不必等：它完成时场景已被替换，结果直接丢弃
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_lodTasks;
+    }
+    CBlackHole_ThreadPool::Shared().Submit([this, pBase]() { RebuildLods(pBase); });
+}
+
+void CBlackHole_SceneLoader::RebuildLods(std::shared_ptr<const CBlackHole_Scene> pBase) {
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    std::shared_ptr<CBlackHole_Scene> pScene;
+    if (!m_bCancel) pScene = pBase->RebuildLods(m_bCancel);
+
+    bool bPublished = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (pScene && m_current == pBase) {
+            m_current = std::move(pScene);
+            ++m_revision;
+            bPublished = true;
+        }
+        --m_lodTasks;
+    }
+    m_cv.notify_all();
+
+    if (bPublished) {
+        ON_wString str;
+        str.Format(L"BlackHole: simplified meshes rebuilt in background in %.1f ms\n",
+            std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count());
+        CBlackHole_Log::Post(str);
+    }
+}
+
+void CBlackHole_SceneLoader::Publish(std::shared_ptr<CBlackHole_Scene> scene, bool bComplete) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_current = std::move(scene);
+        m_bComplete = bComplete;
+        ++m_revision;
+    }
+    m_cv.notify_all();
+}
+
+void CBlackHole_SceneLoader::Run(std::vector<SceneLoadRecord> records) {
+    typedef std::chrono::high_resolution_clock Clock;
+    const auto t0 = Clock::now();
+    m_cache.ResetStats();
+    auto elapsedMs = [&]() { return std::chrono::duration<double, std::milli>(Clock::now() - t0).count(); };
+
+    // 1. 要构建的部件：普通网格各一个，直接转换到世界坐标；共用的网格只在局部坐标建一份原型
+    // 共用的网格在采集时只拷贝一份，这里按拷贝的地址分组（拷贝在加载期间一直存活）；场景里的原型再按内容哈希去重
+    std::vector<int> recordPart(records.size());
+    std::vector<int> partRecord;
+    std::map<const ON_Mesh*, int> meshPart;
+    for (int i = 0; i < (int)records.size(); ++i) {
+        if (records[i].bInstance) {
+            const auto it = meshPart.find(records[i].mesh.get());
+            if (it != meshPart.end()) {
+                recordPart[i] = it->second;
+                continue;
+            }
+            meshPart[records[i].mesh.get()] = (int)partRecord.size();
+        }
+        recordPart[i] = (int)partRecord.size();
+        partRecord.push_back(i);
+    }
+
+    // 2. 小部件分批提交到线程池，同时在途的不超过几个，完成一个补一个；池是先进先出的，一次全部提交的话渲染线程的任务要排在整个加载后面
+    // 大部件等小部件都完成后由本线程逐个并行构建；取消后任务直接返回，但仍要等它们全部结束
+    const int partCount = (int)partRecord.size();
+    std::vector<std::shared_ptr<CBlackHole_Scene>> parts(partCount);
+    std::vector<uint64_t> partKey(partCount);
+    std::mutex partMutex;
+    std::condition_variable partReady;
+    int partsDone = 0;
+    int inFlight = 0;       // 已提交到池上还没完成的小部件
+
+    auto buildPart = [&](int k, bool bParallel) {
+        std::shared_ptr<CBlackHole_Scene> pPart;
+        if (!m_bCancel) {
+            // 键总要算，合并后的场景用各部件的键组合成自己的键；小网格不进缓存
+            const SceneLoadRecord& r = records[partRecord[k]];
+            const ON_Xform& xform = r.bInstance ? ON_Xform::IdentityTransformation : r.xform;
+            partKey[k] = CBlackHole_MeshCache::MeshKey(*r.mesh, xform);
+            const bool bCached = r.mesh->FaceCount() >= m_cache.minTriangles;
+
+            // 大网格同时生成简化级别（小网格不生成），随 BVH 一起缓存
+            pPart = std::make_shared<CBlackHole_Scene>();
+            if (!bCached || !m_cache.Load(partKey[k], *pPart)) {
+                pPart->AddMesh(*r.mesh, xform, r.albedo);
+                pPart->Build(bParallel);
+                pPart->BuildLods();
+                if (bCached) m_cache.Store(partKey[k], *pPart);
+            }
+        }
+        // 持锁通知：协调线程看到全部完成后就会返回，之后不能再访问这里的局部变量
+        std::lock_guard<std::mutex> lock(partMutex);
+        parts[k] = pPart;
+        ++partsDone;
+        if (!bParallel) --inFlight;
+        partReady.notify_all();
+    };
+
+    std::vector<int> large, small;
+    for (int k = 0; k < partCount; ++k) {
+        if (records[partRecord[k]].mesh->FaceCount() > kParallelPart) large.push_back(k);
+        else small.push_back(k);
+    }
+    CBlackHole_ThreadPool& pool = CBlackHole_ThreadPool::Shared();
+    const int maxInFlight = (pool.ThreadCount() / kPoolShare > 1) ? pool.ThreadCount() / kPoolShare : 1;
+    int nextSmall = 0;
+
+    // 3. 快照：已就绪的部件都作为实例加入，只需要建顶层，渲染线程拿到后立即可用
+    int published = 0;
+    double firstMs = -1.0;
+    auto publishSnapshot = [&]() {
+        if (m_bCancel) return;
+        std::vector<std::shared_ptr<CBlackHole_Scene>> ready;
+        {
+            std::lock_guard<std::mutex> lock(partMutex);
+            if (partsDone == published) return;
+            published = partsDone;
+            ready = parts;
+        }
+
+        auto pScene = std::make_shared<CBlackHole_Scene>();
+        for (int i = 0; i < (int)records.size(); ++i) {
+            const SceneLoadRecord& r = records[i];
+            const std::shared_ptr<CBlackHole_Scene>& pPart = ready[recordPart[i]];
+            if (!pPart) continue;
+            if (r.bInstance) pScene->AddInstance(pPart, partKey[recordPart[i]], r.xform, r.albedo, r.owner);
+            else pScene->AddInstance(pPart, 0, ON_Xform::IdentityTransformation, r.albedo, r.owner);
+        }
+        pScene->Build(false);
+        if (firstMs < 0.0) firstMs = elapsedMs();
+        Publish(pScene, published == partCount);
+    };
+
+    // 有空位就补交任务，到了发布间隔或小部件全部完成时发布快照
+    const int smallCount = (int)small.size();
+    auto nextPublish = Clock::now() + std::chrono::milliseconds(kPublishMs);
+    for (;;) {
+        bool bAll;
+        {
+            std::unique_lock<std::mutex> lock(partMutex);
+            while (nextSmall < smallCount && inFlight < maxInFlight) {
+                const int k = small[nextSmall++];
+                ++inFlight;
+                pool.Submit([&buildPart, k]() { buildPart(k, false); });
+            }
+            partReady.wait_until(lock, nextPublish, [&] {
+                return partsDone == smallCount || (inFlight < maxInFlight && nextSmall < smallCount);
+            });
+            bAll = partsDone == smallCount;
+        }
+        if (bAll || Clock::now() >= nextPublish) {
+            publishSnapshot();
+            nextPublish = Clock::now() + std::chrono::milliseconds(kPublishMs);
+        }
+        if (bAll) break;
+    }
+
+    for (int k : large) {
+        buildPart(k, true);
+        publishSnapshot();
+    }
+
+    if (!m_bCancel) {
+        const double completeMs = elapsedMs();
+
+        // 4. 合并成平铺场景：普通网格的三角形拷进同一棵树，块实例保留两层结构；完成后替换实例快照
+        // 有简化级别的大网格也保留为单独的实例，求交时才能按覆盖范围选级别
+        // 平铺部分的树只取决于各网格的键和物体顺序，整棵树也按这个组合键缓存
+        auto pScene = std::make_shared<CBlackHole_Scene>();
+        uint64_t sceneKey = CBlackHole_MeshCache::Combine(0, records.size());
+        for (int i = 0; i < (int)records.size() && !m_bCancel; ++i) {
+            const SceneLoadRecord& r = records[i];
+            const std::shared_ptr<CBlackHole_Scene>& pPart = parts[recordPart[i]];
+            const bool bFlat = !r.bInstance && !pPart->HasLods();
+            if (r.bInstance) pScene->AddInstance(pPart, partKey[recordPart[i]], r.xform, r.albedo, r.owner);
+            else if (!bFlat) pScene->AddInstance(pPart, 0, ON_Xform::IdentityTransformation, r.albedo, r.owner);
+            else pScene->AddPart(*pPart, r.albedo, r.owner);
+            sceneKey = CBlackHole_MeshCache::Combine(sceneKey, bFlat ? partKey[recordPart[i]] : 1);
+        }
+        if (!m_bCancel) {
+            std::vector<std::shared_ptr<CBlackHole_Scene>>().swap(parts);
+            const bool bCached = (int)pScene->TriangleCount() >= m_cache.minTriangles;
+            if (!bCached || !m_cache.Load(sceneKey, *pScene)) {
+                pScene->Build();
+                if (bCached) m_cache.Store(sceneKey, *pScene);
+            }
+            Publish(pScene, true);
+
+            ON_wString str;
+            str.Format(L"BlackHole: %d meshes loaded in background, first objects after %.1f ms, all after %.1f ms, merged after %.1f ms\n",
+                partCount, firstMs, completeMs, elapsedMs());
+            CBlackHole_Log::Post(str);
+
+            if (!pScene->IsEmpty()) {
+                const BVHBuildStats& bs = pScene->BuildStats();
+                str.Format(L"BlackHole: scene %I64u triangles, %I64u BVH nodes, %.1f MB, built in %.1f ms (SAH %.1f, depth %d, %d subtrees)\n",
+                    (unsigned __int64)pScene->TriangleCount(), (unsigned __int64)pScene->NodeCount(),
+                    pScene->MemoryBytes() / 1048576.0, bs.buildMs, bs.sahCost, bs.maxDepth, bs.subtreeTasks);
+                CBlackHole_Log::Post(str);
+
+                if (pScene->InstanceCount() > 0) {
+                    str.Format(L"BlackHole: %I64u instances of %I64u shared meshes (%I64u triangles if flattened)\n",
+                        (unsigned __int64)pScene->InstanceCount(), (unsigned __int64)pScene->PrototypeCount(),
+                        (unsigned __int64)pScene->InstancedTriangleCount());
+                    CBlackHole_Log::Post(str);
+                }
+            }
+
+            str.Format(L"BlackHole: mesh cache %I64u hits, %I64u misses, %.1f MB read, %.1f MB written\n",
+                m_cache.Hits(), m_cache.Misses(), m_cache.BytesRead() / 1048576.0, m_cache.BytesWritten() / 1048576.0);
+            CBlackHole_Log::Post(str);
+            m_cache.Trim();
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bLoading = false;
+    }
+    m_cv.notify_all();
+}
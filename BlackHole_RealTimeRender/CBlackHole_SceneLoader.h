@@ -0,0 +1,82 @@
+﻿// CBlackHole_SceneLoader.h
+// 后台场景加载：网格转换与各物体的 BVH 在线程池上构建，渲染不必等待
+// 已就绪的物体以实例方式组成场景快照逐步发布，全部就绪后合并成一个平铺场景
+#pragma once
+#include "stdafx.h"
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+#include "CBlackHole_Scene.h"
+#include "CBlackHole_MeshCache.h"
+
+// 一个 render mesh；网格在主线程拷贝，迭代器返回的网格只在主线程有效
+struct SceneLoadRecord {
+    std::shared_ptr<const ON_Mesh> mesh;
+    ON_Xform                       xform;
+    ON_Color                       albedo;
+    ON_UUID                        owner = ON_nil_uuid;
+    bool                           bInstance = false;  // 网格被多个 render mesh 共用
+};
+
+class CBlackHole_SceneLoader {
+public:
+    CBlackHole_SceneLoader() = default;
+    ~CBlackHole_SceneLoader() { Cancel(); }
+
+    CBlackHole_SceneLoader(const CBlackHole_SceneLoader&) = delete;
+    CBlackHole_SceneLoader& operator=(const CBlackHole_SceneLoader&) = delete;
+
+    // ==========================================
+    // 1. UI 线程接口
+
+    // 取消进行中的加载，开始加载新的一组网格；立即返回，当前场景先变为空
+    void Start(std::vector<SceneLoadRecord>&& records);
+
+    // 等待加载结束，返回完整场景的副本供增量更新；没有场景或超时返回 nullptr
+    // 当前快照可能正被渲染线程读取，修改只在副本上进行，改完用 Replace 发布
+    std::shared_ptr<CBlackHole_Scene> EditableCopy(int timeoutMs);
+
+    // 发布修改后的副本，之后 Current() 返回它；还持有旧快照的线程不受影响
+    // 更新使简化级别作废时在线程池上重建，完成时场景没有再被替换就再发布一次
+    void Replace(std::shared_ptr<CBlackHole_Scene> scene);
+
+    // 停止后台加载并等待已提交的任务结束，插件卸载时在关闭线程池之前调用
+    void Cancel();
+
+    // ==========================================
+    // 2. 任意线程接口
+
+    // 当前场景快照（已构建，只读）；pbComplete 返回它是否已包含全部物体
+    std::shared_ptr<const CBlackHole_Scene> Current(bool* pbComplete = nullptr) const;
+
+    bool IsComplete() const;
+    bool IsLoading() const;     // 加载被取消时既不在加载也不完整
+
+    // 每次 Current() 指向新的快照时加一
+    unsigned int Revision() const { return m_revision; }
+
+    // 等待全部物体就绪，超时返回 false
+    bool WaitComplete(int timeoutMs);
+
+    // 转换结果的磁盘缓存，各网格与合并后的平铺场景都经过它
+    CBlackHole_MeshCache& MeshCache() { return m_cache; }
+
+private:
+    void Run(std::vector<SceneLoadRecord> records);
+    void Publish(std::shared_ptr<CBlackHole_Scene> scene, bool bComplete);
+    void RebuildLods(std::shared_ptr<const CBlackHole_Scene> pBase);
+
+    mutable std::mutex                m_mutex;
+    std::condition_variable           m_cv;
+    std::thread                       m_thread;            // 协调线程：不是池内线程，可以调用 ParallelFor
+    std::atomic<bool>                 m_bCancel{ false };
+    std::shared_ptr<CBlackHole_Scene> m_current;
+    bool                              m_bComplete = true;
+    bool                              m_bLoading = false;
+    std::atomic<unsigned int>         m_revision{ 0 };
+    int                               m_lodTasks = 0;      // 排队或进行中的简化级别重建，Cancel 等它们结束
+    CBlackHole_MeshCache              m_cache;
+};
@@ -0,0 +1,170 @@
+﻿// CBlackHole_SkyboxLoader.cpp
+#include "stdafx.h"
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <cstdio>
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include "CBlackHole_ThreadPool.h"
+#include "CBlackHole_SkyboxLoader.h"
+
+using SkyClock = std::chrono::high_resolution_clock;
+
+static double ElapsedMs(SkyClock::time_point a, SkyClock::time_point b) {
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+// 任务共享状态：后台任务只写这里，从不触碰加载器本身，加载器销毁后任务也能安全结束
+struct CBlackHole_SkyboxLoader::Job {
+    std::mutex                        mutex;
+    std::atomic<bool>                 cancelled{ false };
+    SkyboxLoadState                   state = SkyboxLoadState::Pending;
+    ComPtr<ID3D11ShaderResourceView>  srv;
+    SkyboxLoadMetrics                 metrics;
+};
+
+void CBlackHole_SkyboxLoader::RequestLoad(const std::wstring& path, ID3D11Device* pDevice) {
+    Cancel();
+    if (nullptr == pDevice) return;
+
+    auto pJob = std::make_shared<Job>();
+    m_pJob = pJob;
+
+    // 持有设备引用，保证任务执行期间设备存活
+    ComPtr<ID3D11Device> device(pDevice);
+    const auto submitTime = SkyClock::now();
+
+    CBlackHole_ThreadPool::Shared().Submit([pJob, device, path, submitTime]() {
+        const auto t0 = SkyClock::now();
+        if (pJob->cancelled) return;
+
+        // 1. 解码
+        SkyImage image;
+        std::string error;
+        bool ok = DecodeFile(path, image, error);
+        const auto t1 = SkyClock::now();
+
+        // 2. 创建显存纹理（不经过立即上下文，不与渲染线程争用）
+        ComPtr<ID3D11ShaderResourceView> srv;
+        if (ok && !pJob->cancelled) {
+            ok = CreateTexture(device.Get(), image, srv);
+            if (!ok) error = "CreateTexture2D failed (texture larger than 16384 or out of video memory)";
+        }
+        const auto t2 = SkyClock::now();
+
+        // 3. 发布结果
+        std::lock_guard<std::mutex> lock(pJob->mutex);
+        pJob->metrics.queueMs  = ElapsedMs(submitTime, t0);
+        pJob->metrics.decodeMs = ElapsedMs(t0, t1);
+        pJob->metrics.uploadMs = ElapsedMs(t1, t2);
+        pJob->metrics.totalMs  = ElapsedMs(submitTime, t2);
+        pJob->metrics.width  = image.width;
+        pJob->metrics.height = image.height;
+        pJob->metrics.failReason = error;
+        pJob->srv = srv;
+        pJob->state = ok ? SkyboxLoadState::Ready : SkyboxLoadState::Failed;
+    });
+}
+
+SkyboxLoadState CBlackHole_SkyboxLoader::Poll(ComPtr<ID3D11ShaderResourceView>& srvOut, SkyboxLoadMetrics& metricsOut) {
+    if (!m_pJob) return SkyboxLoadState::Idle;
+
+    std::lock_guard<std::mutex> lock(m_pJob->mutex);
+    const SkyboxLoadState state = m_pJob->state;
+    if (state == SkyboxLoadState::Pending) return state;
+
+    srvOut = m_pJob->srv;
+    metricsOut = m_pJob->metrics;
+    m_pJob->srv.Reset();
+    m_pJob->state = SkyboxLoadState::Idle;
+    return state;
+}
+
+SkyboxLoadState CBlackHole_SkyboxLoader::State() const {
+    if (!m_pJob) return SkyboxLoadState::Idle;
+
+    std::lock_guard<std::mutex> lock(m_pJob->mutex);
+    return m_pJob->state;
+}
+
+void CBlackHole_SkyboxLoader::Cancel() {
+    if (m_pJob) {
+        m_pJob->cancelled = true;
+        m_pJob.reset();
+    }
+}
+
+bool CBlackHole_SkyboxLoader::DecodeFile(const std::wstring& path, SkyImage& imageOut, std::string& errorOut) {
+    // stbi_loadf 只接受窄字符路径，这里自己打开文件以支持中文路径
+    FILE* fp = nullptr;
+    if (0 != _wfopen_s(&fp, path.c_str(), L"rb") || nullptr == fp) {
+        errorOut = "cannot open file";
+        return false;
+    }
+
+    int width = 0, height = 0, channels = 0;
+    float* data = stbi_loadf_from_file(fp, &width, &height, &channels, 4);    // 强制转换成 RGBA 四通道
+    fclose(fp);
+
+    if (nullptr == data) {
+        const char* reason = stbi_failure_reason();
+        errorOut = reason ? reason : "decode failed";
+        return false;
+    }
+
+    imageOut.width = width;
+    imageOut.height = height;
+    imageOut.rgba.assign(data, data + (size_t)width * height * 4);
+    stbi_image_free(data);
+    return true;
+}
+
+bool CBlackHole_SkyboxLoader::CreateTexture(ID3D11Device* pDevice, const SkyImage& image, ComPtr<ID3D11ShaderResourceView>& srvOut) {
+    if (nullptr == pDevice || image.width <= 0 || image.height <= 0) return false;
+
+    D3D11_TEXTURE2D_DESC texDescHDR = {};
+    texDescHDR.Width = image.width;
+    texDescHDR.Height = image.height;
+    texDescHDR.MipLevels = 1;   // 原始超清图，不生成缩略图
+    texDescHDR.ArraySize = 1;
+    texDescHDR.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+    texDescHDR.SampleDesc.Count = 1;
+    texDescHDR.Usage = D3D11_USAGE_IMMUTABLE;   // 创建后不可修改
+    texDescHDR.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+    D3D11_SUBRESOURCE_DATA initData = {};
+    initData.pSysMem = image.rgba.data();
+    initData.SysMemPitch = image.width * 4 * sizeof(float);
+
+    ComPtr<ID3D11Texture2D> pHDRTex;
+    if (FAILED(pDevice->CreateTexture2D(&texDescHDR, &initData, &pHDRTex))) return false;
+
+    ComPtr<ID3D11ShaderResourceView> srv;
+    if (FAILED(pDevice->CreateShaderResourceView(pHDRTex.Get(), nullptr, &srv))) return false;
+
+    srvOut = srv;
+    return true;
+}
+
+bool CBlackHole_SkyboxLoader::CreatePlaceholder(ID3D11Device* pDevice, ComPtr<ID3D11ShaderResourceView>& srvOut) {
+    // 64x32 的暗色渐变：天顶深蓝，地平线略亮，天底接近黑色
+    SkyImage image;
+    image.width = 64;
+    image.height = 32;
+    image.rgba.resize((size_t)image.width * image.height * 4);
+
+    for (int y = 0; y < image.height; ++y) {
+        const float v = (y + 0.5f) / image.height;             // 0 = 天顶，1 = 天底
+        const float horizon = 1.0f - fabsf(v - 0.5f) * 2.0f;    // 地平线处为 1
+        const float up = v < 0.5f ? 1.0f : 0.25f;
+        for (int x = 0; x < image.width; ++x) {
+            float* p = &image.rgba[((size_t)y * image.width + x) * 4];
+            p[0] = 0.010f + 0.030f * horizon;
+            p[1] = 0.015f + 0.040f * horizon;
+            p[2] = (0.040f + 0.060f * horizon) * up;
+            p[3] = 1.0f;
+        }
+    }
+    return CreateTexture(pDevice, image, srvOut);
+}
@@ -0,0 +1,65 @@
+﻿// CBlackHole_SkyboxLoader.h
+// 天空盒异步加载器：后台线程解码 HDR 并创建显存纹理，渲染线程每帧只做一次指针交换
+#pragma once
+#include "stdafx.h"
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <memory>
+#include <string>
+#include "CBlackHole_Common.h"
+
+using Microsoft::WRL::ComPtr;
+
+// 单次加载的耗时统计（毫秒），用于追踪首帧时间与贴图就绪时间
+struct SkyboxLoadMetrics {
+    double      queueMs  = 0.0;   // 在线程池中排队
+    double      decodeMs = 0.0;   // 文件读取 + 解码
+    double      uploadMs = 0.0;   // 创建显存纹理
+    double      totalMs  = 0.0;   // 从提交到可用
+    int         width  = 0;
+    int         height = 0;
+    std::string failReason;       // 失败原因，成功时为空
+};
+
+enum class SkyboxLoadState {
+    Idle,       // 没有任务，或结果已被取走
+    Pending,    // 后台正在解码 / 上传
+    Ready,      // 完整贴图已就绪，等待渲染线程换入
+    Failed      // 加载失败，占位天空继续使用
+};
+
+class CBlackHole_SkyboxLoader {
+public:
+    CBlackHole_SkyboxLoader() = default;
+    ~CBlackHole_SkyboxLoader() { Cancel(); }
+
+    // ==========================================
+    // 1. 异步任务
+
+    // 提交加载任务后立即返回；新的请求会取消尚未完成的旧请求
+    void RequestLoad(const std::wstring& path, ID3D11Device* pDevice);
+
+    // 渲染线程每帧调用。Ready / Failed 只返回一次，之后回到 Idle
+    SkyboxLoadState Poll(ComPtr<ID3D11ShaderResourceView>& srvOut, SkyboxLoadMetrics& metricsOut);
+
+    void Cancel();
+
+    // 只查看当前状态，不取走结果；渲染线程空闲时用它判断是否需要重画
+    SkyboxLoadState State() const;
+
+    // ==========================================
+    // 2. 同步工具函数（调用方负责在后台线程调用）
+
+    // 读取并解码 HDR/LDR 图像为 RGBA32F，支持中文路径
+    static bool DecodeFile(const std::wstring& path, SkyImage& imageOut, std::string& errorOut);
+
+    // 以 CPU 图像创建不可变纹理及其视图。D3D11 设备的资源创建是线程安全的
+    static bool CreateTexture(ID3D11Device* pDevice, const SkyImage& image, ComPtr<ID3D11ShaderResourceView>& srvOut);
+
+    // 低分辨率占位天空（程序生成，无需读盘），保证第一帧不等待解码
+    static bool CreatePlaceholder(ID3D11Device* pDevice, ComPtr<ID3D11ShaderResourceView>& srvOut);
+
+private:
+    struct Job;                   // 后台任务与加载器共同持有的状态
+    std::shared_ptr<Job> m_pJob;
+};
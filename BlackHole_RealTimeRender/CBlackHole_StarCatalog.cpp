@@ -0,0 +1,394 @@
+﻿// CBlackHole_StarCatalog.cpp
+#include "stdafx.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include "CBlackHole_StarCatalog.h"
+
+static const char     kCatalogMagic[8] = { 'B', 'H', 'S', 'T', 'A', 'R', 'S', '1' };
+static const uint32_t kCatalogVersion = 1;
+static const int      kMaxCatalogOrder = 12;    // 12 * 4^12 个格子，偏移表约 1.6 GB，已足够细
+static const int      kImportBucketOrder = 2;   // CSV 导入的外部排序按 192 个粗格子分桶，每桶一个临时文件
+static const int      kImportBufferBytes = 1 << 16;
+
+// ==========================================
+// HEALPix nested 编码
+
+// 把 32 位整数的每一位分散到偶数位上 (Morton 编码)
+static uint64_t SpreadBits(uint64_t v) {
+    v &= 0xFFFFFFFFull;
+    v = (v | (v << 16)) & 0x0000FFFF0000FFFFull;
+    v = (v | (v << 8))  & 0x00FF00FF00FF00FFull;
+    v = (v | (v << 4))  & 0x0F0F0F0F0F0F0F0Full;
+    v = (v | (v << 2))  & 0x3333333333333333ull;
+    v = (v | (v << 1))  & 0x5555555555555555ull;
+    return v;
+}
+
+static uint64_t CompressBits(uint64_t v) {
+    v &= 0x5555555555555555ull;
+    v = (v | (v >> 1))  & 0x3333333333333333ull;
+    v = (v | (v >> 2))  & 0x0F0F0F0F0F0F0F0Full;
+    v = (v | (v >> 4))  & 0x00FF00FF00FF00FFull;
+    v = (v | (v >> 8))  & 0x0000FFFF0000FFFFull;
+    v = (v | (v >> 16)) & 0x00000000FFFFFFFFull;
+    return v;
+}
+
+uint64_t CBlackHole_StarCatalog::DirToPixNest(int order, const ON_3dVector& d) {
+    const int64_t nside = 1ll << order;
+    const double len = d.Length();
+    const double z = len > 0.0 ? d.z / len : 1.0;
+    const double za = fabs(z);
+    double phi = atan2(d.y, d.x);
+    if (phi < 0.0) phi += 2.0 * ON_PI;
+    double tt = phi / (0.5 * ON_PI);            // [0, 4)
+    if (tt >= 4.0) tt -= 4.0;
+
+    int64_t face, ix, iy;
+    if (za <= 2.0 / 3.0) {
+        // 赤道带
+        const double temp1 = nside * (0.5 + tt);
+        const double temp2 = nside * z * 0.75;
+        const int64_t jp = (int64_t)(temp1 - temp2);
+        const int64_t jm = (int64_t)(temp1 + temp2);
+        const int64_t ifp = jp >> order;
+        const int64_t ifm = jm >> order;
+        face = (ifp == ifm) ? (ifp | 4) : ((ifp < ifm) ? ifp : (ifm + 8));
+        ix = jm & (nside - 1);
+        iy = nside - (jp & (nside - 1)) - 1;
+    }
+    else {
+        // 极冠
+        int64_t ntt = (int64_t)tt;
+        if (ntt >= 4) ntt = 3;
+        const double tp = tt - ntt;
+        const double tmp = nside * sqrt(3.0 * (1.0 - za));
+        int64_t jp = (int64_t)(tp * tmp);
+        int64_t jm = (int64_t)((1.0 - tp) * tmp);
+        if (jp >= nside) jp = nside - 1;
+        if (jm >= nside) jm = nside - 1;
+        if (z >= 0) { face = ntt;     ix = nside - jm - 1; iy = nside - jp - 1; }
+        else        { face = ntt + 8; ix = jp;             iy = jm; }
+    }
+    return ((uint64_t)face << (2 * order)) + SpreadBits((uint64_t)ix) + (SpreadBits((uint64_t)iy) << 1);
+}
+
+ON_3dVector CBlackHole_StarCatalog::PixNestToDir(int order, uint64_t pix) {
+    static const int jrll[12] = { 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4 };
+    static const int jpll[12] = { 1, 3, 5, 7, 0, 2, 4, 6, 1, 3, 5, 7 };
+
+    const int64_t nside = 1ll << order;
+    const int64_t npface = nside * nside;
+    const double fact2 = 4.0 / (12.0 * npface);
+    const double fact1 = (nside << 1) * fact2;
+
+    const int face = (int)(pix >> (2 * order));
+    const uint64_t ipf = pix & (npface - 1);
+    const int64_t ix = (int64_t)CompressBits(ipf);
+    const int64_t iy = (int64_t)CompressBits(ipf >> 1);
+
+    const int64_t jr = jrll[face] * nside - ix - iy - 1;
+    int64_t nr, kshift;
+    double z;
+    if (jr < nside)          { nr = jr;             z = 1.0 - nr * nr * fact2; kshift = 0; }
+    else if (jr > 3 * nside) { nr = 4 * nside - jr; z = nr * nr * fact2 - 1.0; kshift = 0; }
+    else                     { nr = nside;          z = (2 * nside - jr) * fact1; kshift = (jr - nside) & 1; }
+
+    int64_t jp = (jpll[face] * nr + ix - iy + 1 + kshift) / 2;
+    if (jp > 4 * nside) jp -= 4 * nside;
+    if (jp < 1) jp += 4 * nside;
+    const double phi = (jp - (kshift + 1) * 0.5) * (0.5 * ON_PI / nr);
+
+    const double sth = sqrt((1.0 - z) * (1.0 + z));
+    return ON_3dVector(sth * cos(phi), sth * sin(phi), z);
+}
+
+double CBlackHole_StarCatalog::MaxPixelRadius(int order) {
+    // 实测最大值约为 0.84 / nside（order 0）到 1.06 / nside（高阶），取 1.5 / nside 保守剔除
+    return 1.5 / (double)(1ll << order);
+}
+
+// ==========================================
+// 打开 / 关闭
+
+bool CBlackHole_StarCatalog::Open(const std::wstring& path, std::wstring& errorOut) {
+    Close();
+
+    // 1. 打开文件并映射整个视图，随机访问提示让系统不做顺序预读
+    m_hFile = ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (INVALID_HANDLE_VALUE == m_hFile) {
+        errorOut = L"cannot open file";
+        return false;
+    }
+
+    LARGE_INTEGER size = {};
+    if (!::GetFileSizeEx(m_hFile, &size) || size.QuadPart < (LONGLONG)sizeof(CatalogHeader)) {
+        errorOut = L"file too small";
+        Close();
+        return false;
+    }
+    m_fileBytes = (uint64_t)size.QuadPart;
+
+    m_hMapping = ::CreateFileMappingW(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (NULL == m_hMapping) {
+        errorOut = L"CreateFileMapping failed";
+        Close();
+        return false;
+    }
+    m_pView = (const uint8_t*)::MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0);
+    if (nullptr == m_pView) {
+        errorOut = L"MapViewOfFile failed";
+        Close();
+        return false;
+    }
+
+    // 2. 校验文件头与各段长度
+    const CatalogHeader* pHeader = (const CatalogHeader*)m_pView;
+    if (0 != memcmp(pHeader->magic, kCatalogMagic, sizeof(kCatalogMagic)) || kCatalogVersion != pHeader->version ||
+        pHeader->order > (uint32_t)kMaxCatalogOrder) {
+        errorOut = L"not a BlackHole star catalogue";
+        Close();
+        return false;
+    }
+
+    const uint64_t cellCount = 12ull << (2 * pHeader->order);
+    const uint64_t offsetBytes = (cellCount + 1) * sizeof(uint64_t);
+    const uint64_t expected = sizeof(CatalogHeader) + offsetBytes + pHeader->starCount * sizeof(CatalogStar);
+    if (expected != m_fileBytes) {
+        errorOut = L"catalogue size does not match its header";
+        Close();
+        return false;
+    }
+
+    m_order = (int)pHeader->order;
+    m_starCount = pHeader->starCount;
+    m_pOffsets = (const uint64_t*)(m_pView + sizeof(CatalogHeader));
+    m_pStars = (const CatalogStar*)(m_pView + sizeof(CatalogHeader) + offsetBytes);
+    return true;
+}
+
+void CBlackHole_StarCatalog::Close() {
+    if (m_pView) ::UnmapViewOfFile(m_pView);
+    if (m_hMapping) ::CloseHandle(m_hMapping);
+    if (INVALID_HANDLE_VALUE != m_hFile) ::CloseHandle(m_hFile);
+
+    m_pView = nullptr;
+    m_hMapping = NULL;
+    m_hFile = INVALID_HANDLE_VALUE;
+    m_pOffsets = nullptr;
+    m_pStars = nullptr;
+    m_starCount = 0;
+    m_fileBytes = 0;
+    m_order = 0;
+}
+
+// ==========================================
+// 查询
+
+void CBlackHole_StarCatalog::QueryDisc(const ON_3dVector& dir, double radius,
+    const std::function<void(const CatalogStar&)>& visit, CatalogQueryStats* pStats) const {
+    if (!IsOpen()) return;
+    if (pStats) ++pStats->queries;
+
+    const double cosLimit = cos(radius);
+    for (uint64_t base = 0; base < 12; ++base) {
+        QueryCell(0, base, dir, cosLimit, radius, visit, pStats);
+    }
+}
+
+void CBlackHole_StarCatalog::QueryCell(int order, uint64_t pix, const ON_3dVector& dir, double cosLimit, double radius,
+    const std::function<void(const CatalogStar&)>& visit, CatalogQueryStats* pStats) const {
+    // 1. 锥体剔除：格子外接圆与查询圆不相交则整棵子树跳过
+    const ON_3dVector center = PixNestToDir(order, pix);
+    double c = center * dir;
+    c = c > 1.0 ? 1.0 : (c < -1.0 ? -1.0 : c);
+    if (acos(c) > radius + MaxPixelRadius(order)) return;
+
+    // 2. 未到叶子层则细分为 4 个子格子
+    if (order < m_order) {
+        for (uint64_t k = 0; k < 4; ++k) {
+            QueryCell(order + 1, pix * 4 + k, dir, cosLimit, radius, visit, pStats);
+        }
+        return;
+    }
+
+    // 3. 叶子格子内的星在文件中连续存放，只有这里会触碰星数据
+    const uint64_t begin = m_pOffsets[pix];
+    const uint64_t end = m_pOffsets[pix + 1];
+    if (pStats) {
+        ++pStats->cellsVisited;
+        pStats->starsTested += end - begin;
+    }
+    for (uint64_t i = begin; i < end; ++i) {
+        const CatalogStar& s = m_pStars[i];
+        const double d = s.dir[0] * dir.x + s.dir[1] * dir.y + s.dir[2] * dir.z;
+        if (d >= cosLimit) visit(s);
+    }
+}
+
+// ==========================================
+// 生成星表
+
+// 按格子排序后整块写出，同时把每格的星数累加到 offsets[pix + 1]；stars 被重排
+static bool WriteSorted(FILE* fp, std::vector<CatalogStar>& stars, int order, std::vector<uint64_t>& offsets) {
+    std::vector<std::pair<uint64_t, uint32_t>> keys(stars.size());
+    for (size_t i = 0; i < stars.size(); ++i) {
+        const CatalogStar& s = stars[i];
+        keys[i] = { CBlackHole_StarCatalog::DirToPixNest(order, ON_3dVector(s.dir[0], s.dir[1], s.dir[2])), (uint32_t)i };
+    }
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<CatalogStar> sorted(stars.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        sorted[i] = stars[keys[i].second];
+        ++offsets[keys[i].first + 1];
+    }
+    stars.swap(sorted);
+    return stars.empty() || stars.size() == fwrite(stars.data(), sizeof(CatalogStar), stars.size(), fp);
+}
+
+// 文件头与全零的偏移表占位，星数据写完后回填偏移表
+static bool WriteHeader(FILE* fp, int order, uint64_t starCount, const std::vector<uint64_t>& offsets) {
+    CatalogHeader header = {};
+    memcpy(header.magic, kCatalogMagic, sizeof(kCatalogMagic));
+    header.version = kCatalogVersion;
+    header.order = (uint32_t)order;
+    header.starCount = starCount;
+    return 1 == fwrite(&header, sizeof(header), 1, fp) &&
+        offsets.size() == fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), fp);
+}
+
+static bool WriteOffsets(FILE* fp, std::vector<uint64_t>& offsets) {
+    for (size_t c = 1; c < offsets.size(); ++c) offsets[c] += offsets[c - 1];
+    return 0 == _fseeki64(fp, sizeof(CatalogHeader), SEEK_SET) &&
+        offsets.size() == fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), fp);
+}
+
+bool CBlackHole_StarCatalog::Write(const std::wstring& path, std::vector<CatalogStar>& stars, int order, std::wstring& errorOut) {
+    if (order < 0 || order > kMaxCatalogOrder) {
+        errorOut = L"HEALPix order out of range";
+        return false;
+    }
+
+    FILE* fp = nullptr;
+    if (0 != _wfopen_s(&fp, path.c_str(), L"wb") || nullptr == fp) {
+        errorOut = L"cannot create file";
+        return false;
+    }
+
+    std::vector<uint64_t> offsets((12ull << (2 * order)) + 1, 0);
+    bool ok = WriteHeader(fp, order, stars.size(), offsets);
+    ok = ok && WriteSorted(fp, stars, order, offsets);
+    ok = ok && WriteOffsets(fp, offsets);
+    ok = (0 == fclose(fp)) && ok;
+
+    if (!ok) errorOut = L"write failed (disk full?)";
+    return ok;
+}
+
+bool CBlackHole_StarCatalog::ImportCsv(const std::wstring& csvPath, const std::wstring& outPath, int& orderInOut,
+    uint64_t& starCountOut, std::wstring& errorOut) {
+    FILE* fp = nullptr;
+    if (0 != _wfopen_s(&fp, csvPath.c_str(), L"r") || nullptr == fp) {
+        errorOut = L"cannot open file";
+        return false;
+    }
+
+    // 1. 逐行解析，按粗格子追加到临时文件；粗格子的 nested 编号是细格子编号的前缀，逐桶排序后首尾相接即整体有序
+    const int bucketCount = 12 << (2 * kImportBucketOrder);
+    std::vector<FILE*> buckets(bucketCount, nullptr);
+    std::vector<uint64_t> bucketStars(bucketCount, 0);
+    auto bucketPath = [&](int b) { return outPath + L"." + std::to_wstring(b) + L".tmp"; };
+    auto removeBuckets = [&]() {
+        for (int b = 0; b < bucketCount; ++b) {
+            if (nullptr == buckets[b]) continue;
+            fclose(buckets[b]);
+            _wremove(bucketPath(b).c_str());
+        }
+    };
+
+    bool ok = true;
+    uint64_t starCount = 0;
+    char line[512];
+    while (ok && fgets(line, sizeof(line), fp)) {
+        double ra = 0, dec = 0, mag = 0, teff = 0;
+        const int n = sscanf_s(line, "%lf , %lf , %lf , %lf", &ra, &dec, &mag, &teff);
+        if (n < 3) continue;    // 表头或空行
+
+        const double a = ra * ON_PI / 180.0, b = dec * ON_PI / 180.0;
+        CatalogStar s;
+        s.dir[0] = (float)(cos(b) * cos(a));
+        s.dir[1] = (float)(cos(b) * sin(a));
+        s.dir[2] = (float)sin(b);
+        s.flux = (float)pow(10.0, -0.4 * mag);
+        s.temperature = (float)(n >= 4 && teff > 0 ? teff : 5800.0);
+
+        // 桶文件用到时才创建，CRT 缓冲攒满再落盘
+        const int bucket = (int)DirToPixNest(kImportBucketOrder, ON_3dVector(s.dir[0], s.dir[1], s.dir[2]));
+        FILE*& fb = buckets[bucket];
+        if (nullptr == fb) {
+            ok = 0 == _wfopen_s(&fb, bucketPath(bucket).c_str(), L"w+b") && nullptr != fb;
+            if (ok) setvbuf(fb, nullptr, _IOFBF, kImportBufferBytes);
+        }
+        ok = ok && 1 == fwrite(&s, sizeof(CatalogStar), 1, fb);
+        bucketStars[bucket]++;
+        starCount++;
+    }
+    fclose(fp);
+
+    if (!ok) {
+        removeBuckets();
+        errorOut = L"cannot write temporary file next to the catalogue (disk full?)";
+        return false;
+    }
+    if (0 == starCount) {
+        removeBuckets();
+        errorOut = L"no stars found (expected ra_deg, dec_deg, mag [, teff] per line)";
+        return false;
+    }
+
+    // 未指定级别时每格平均约 16 颗星
+    int order = orderInOut;
+    if (order < 0) {
+        order = 0;
+        while (order < 10 && (12ull << (2 * order)) * 16 < starCount) order++;
+    }
+    if (order > kMaxCatalogOrder) {
+        removeBuckets();
+        errorOut = L"HEALPix order out of range";
+        return false;
+    }
+
+    // 2. 逐桶读回、排序，一次写出；内存中只有一个桶与偏移表
+    FILE* out = nullptr;
+    if (0 != _wfopen_s(&out, outPath.c_str(), L"wb") || nullptr == out) {
+        removeBuckets();
+        errorOut = L"cannot create file";
+        return false;
+    }
+
+    std::vector<uint64_t> offsets((12ull << (2 * order)) + 1, 0);
+    ok = WriteHeader(out, order, starCount, offsets);
+    std::vector<CatalogStar> stars;
+    for (int b = 0; ok && b < bucketCount; ++b) {
+        if (0 == bucketStars[b]) continue;
+        stars.resize((size_t)bucketStars[b]);
+        ok = 0 == fflush(buckets[b]) && 0 == _fseeki64(buckets[b], 0, SEEK_SET) &&
+            stars.size() == fread(stars.data(), sizeof(CatalogStar), stars.size(), buckets[b]);
+        ok = ok && WriteSorted(out, stars, order, offsets);
+    }
+    ok = ok && WriteOffsets(out, offsets);
+    ok = (0 == fclose(out)) && ok;
+    removeBuckets();
+
+    if (!ok) {
+        _wremove(outPath.c_str());
+        errorOut = L"write failed (disk full?)";
+        return false;
+    }
+    orderInOut = order;
+    starCountOut = starCount;
+    return true;
+}
@@ -0,0 +1,92 @@
+﻿// CBlackHole_StarCatalog.h
+// 内存映射星表：按 HEALPix (nested) 格子排序存储，查询只触碰视野覆盖到的格子，与星表总量无关
+#pragma once
+#include "stdafx.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <functional>
+#include <atomic>
+
+// 磁盘上的单颗星，20 字节
+#pragma pack(push, 1)
+struct CatalogStar {
+    float dir[3];       // 天球单位方向（与 Rhino 世界坐标一致，+Z 为天顶）
+    float flux;         // 线性亮度，1.0 约对应零等星
+    float temperature;  // 色温 (K)
+};
+
+// 文件头，后接 (12 * nside^2 + 1) 个 uint64 的格子起始下标表，再接星数据
+struct CatalogHeader {
+    char     magic[8];      // "BHSTARS1"
+    uint32_t version;
+    uint32_t order;         // nside = 2^order
+    uint64_t starCount;
+};
+#pragma pack(pop)
+
+// 一次渲染中的访问统计
+struct CatalogQueryStats {
+    std::atomic<uint64_t> queries{ 0 };
+    std::atomic<uint64_t> cellsVisited{ 0 };    // 到达叶子层的格子数（含重复）
+    std::atomic<uint64_t> starsTested{ 0 };     // 读取过的星数（含重复）
+};
+
+class CBlackHole_StarCatalog {
+public:
+    CBlackHole_StarCatalog() = default;
+    ~CBlackHole_StarCatalog() { Close(); }
+
+    CBlackHole_StarCatalog(const CBlackHole_StarCatalog&) = delete;
+    CBlackHole_StarCatalog& operator=(const CBlackHole_StarCatalog&) = delete;
+
+    // ==========================================
+    // 1. 打开 / 关闭（只建立映射，不读取数据，操作系统按页调入）
+
+    bool Open(const std::wstring& path, std::wstring& errorOut);
+    void Close();
+    bool IsOpen() const { return nullptr != m_pStars; }
+
+    uint64_t StarCount() const { return m_starCount; }
+    int      Order() const { return m_order; }
+    uint64_t FileBytes() const { return m_fileBytes; }
+
+    // ==========================================
+    // 2. 查询
+
+    // 枚举与 dir 夹角不超过 radius（弧度）的所有星。按格子层级做锥体剔除，只访问相交的叶子格子
+    void QueryDisc(const ON_3dVector& dir, double radius,
+        const std::function<void(const CatalogStar&)>& visit, CatalogQueryStats* pStats = nullptr) const;
+
+    // ==========================================
+    // 3. 生成星表（按格子排序后写盘）
+
+    // 内存中的星按格子排序（stars 被重排）后整块写出
+    static bool Write(const std::wstring& path, std::vector<CatalogStar>& stars, int order, std::wstring& errorOut);
+
+    // 从 CSV 生成星表：每行 ra_deg, dec_deg, mag [, teff]，赤道坐标直接作为世界坐标
+    // CSV 可能比内存大：先按粗格子分桶写入 outPath 旁的临时文件，再逐桶读回排序写出，内存中只有一个桶与偏移表
+    // orderInOut < 0 时按星数选择级别（每格平均约 16 颗星），返回实际使用的级别
+    static bool ImportCsv(const std::wstring& csvPath, const std::wstring& outPath, int& orderInOut,
+        uint64_t& starCountOut, std::wstring& errorOut);
+
+    // ==========================================
+    // 4. HEALPix nested 工具
+
+    static uint64_t DirToPixNest(int order, const ON_3dVector& dir);
+    static ON_3dVector PixNestToDir(int order, uint64_t pix);     // 格子中心
+    static double MaxPixelRadius(int order);                      // 格子中心到角点的保守上界
+
+private:
+    void QueryCell(int order, uint64_t pix, const ON_3dVector& dir, double cosLimit, double radius,
+        const std::function<void(const CatalogStar&)>& visit, CatalogQueryStats* pStats) const;
+
+    HANDLE               m_hFile = INVALID_HANDLE_VALUE;
+    HANDLE               m_hMapping = NULL;
+    const uint8_t*       m_pView = nullptr;
+    const uint64_t*      m_pOffsets = nullptr;   // 每个叶子格子的起始星下标
+    const CatalogStar*   m_pStars = nullptr;
+    uint64_t             m_starCount = 0;
+    uint64_t             m_fileBytes = 0;
+    int                  m_order = 0;
+};
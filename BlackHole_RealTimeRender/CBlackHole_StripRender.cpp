@@ -0,0 +1,64 @@
+﻿// CBlackHole_StripRender.cpp
+#include "stdafx.h"
+#include <algorithm>
+#include <climits>
+#include "CBlackHole_StripRender.h"
+
+// ==========================================
+// 1. 条高
+
+bool CBlackHole_StripRender::Plan(int width, int height, int apron, int rowAlign, uint64_t bytesPerPixel, uint64_t fixedBytes,
+    uint64_t budgetBytes, StripPlan& plan) {
+    const uint64_t rowBytes = (uint64_t)(width > 0 ? width : 1) * bytesPerPixel;
+    const int fullRows = (height + rowAlign - 1) / rowAlign * rowAlign;
+
+    // 预算扣掉固定部分后能放下的行数，减去上下边距，向下取整到 rowAlign
+    long long rows = 0;
+    if (budgetBytes > fixedBytes)
+        rows = (long long)std::min<uint64_t>((budgetBytes - fixedBytes) / rowBytes, INT_MAX) - 2LL * apron;
+    rows = (rows > 0) ? rows / rowAlign * rowAlign : 0;
+    const bool ok = rows >= rowAlign;
+
+    // 整幅放得下时只有一条
+    plan.stripRows = (int)std::min<long long>(std::max<long long>(rows, rowAlign), fullRows);
+    plan.frameRows = std::min(plan.stripRows + 2 * apron, height);
+    plan.bytes = fixedBytes + rowBytes * plan.frameRows;
+    return ok;
+}
+
+// ==========================================
+// 2. 预览
+
+CBlackHole_StripPreview::CBlackHole_StripPreview(int width, int height, int maxSize)
+    : m_width(width), m_height(height) {
+    const int longest = std::max(width, height);
+    m_scale = std::max(1, (longest + maxSize - 1) / maxSize);
+    m_previewWidth = (width + m_scale - 1) / m_scale;
+    m_previewHeight = (height + m_scale - 1) / m_scale;
+    m_sum.assign((size_t)m_previewWidth * 4, 0.0f);
+    m_row.assign((size_t)m_previewWidth * 4, 0.0f);
+}
+
+void CBlackHole_StripPreview::AddRows(const float* rgba, int rows, const std::function<void(int y, const float* row)>& emit) {
+    for (int r = 0; r < rows && m_rowsIn < m_height; ++r) {
+        const float* src = rgba + (size_t)r * m_width * 4;
+        for (int x = 0; x < m_width; ++x) {
+            float* dst = &m_sum[(size_t)(x / m_scale) * 4];
+            for (int c = 0; c < 4; ++c) dst[c] += src[(size_t)x * 4 + c];
+        }
+        m_rowsIn++;
+        if (0 != m_rowsIn % m_scale && m_rowsIn != m_height)
+            continue;
+
+        // 一行预览凑齐：右边与底边的方块可能不满
+        const int y = (m_rowsIn - 1) / m_scale;
+        const int boxRows = m_rowsIn - y * m_scale;
+        for (int px = 0; px < m_previewWidth; ++px) {
+            const int boxCols = std::min(m_scale, m_width - px * m_scale);
+            const float scale = 1.0f / (float)(boxRows * boxCols);
+            for (int c = 0; c < 4; ++c) m_row[(size_t)px * 4 + c] = m_sum[(size_t)px * 4 + c] * scale;
+        }
+        std::fill(m_sum.begin(), m_sum.end(), 0.0f);
+        emit(y, m_row.data());
+    }
+}
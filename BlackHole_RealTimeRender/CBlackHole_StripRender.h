@@ -0,0 +1,47 @@
+﻿// CBlackHole_StripRender.h
+// 分条渲染：整帧缓冲放不下时（十万像素见方的海报），每次只追踪整幅宽、若干行高的一条，定稿的行直接写盘
+// 每条上下多追踪几行作边距，覆盖范围、边缘判断看到的邻居与整帧渲染相同，条与条之间没有接缝
+#pragma once
+#include "stdafx.h"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+struct StripPlan {
+    int      stripRows = 0;     // 每条定稿的行数
+    int      frameRows = 0;     // 一条最多追踪的行数，含上下边距
+    uint64_t bytes = 0;         // 估计的峰值内存
+};
+
+class CBlackHole_StripRender {
+public:
+    // 在内存预算内取最高的条：bytesPerPixel 为按条中像素分配的缓冲，fixedBytes 为与条高无关的部分
+    // 条高取 rowAlign 的整数倍；一条 rowAlign 行也放不下时返回 false，plan 中是这时所需的内存
+    static bool Plan(int width, int height, int apron, int rowAlign, uint64_t bytesPerPixel, uint64_t fixedBytes,
+        uint64_t budgetBytes, StripPlan& plan);
+};
+
+// 渲染窗口中的缩小预览：整幅图的行按顺序交入，按 scale x scale 的方块平均
+class CBlackHole_StripPreview {
+public:
+    static const int MaxSize = 2048;    // 预览长边的默认上限
+
+    CBlackHole_StripPreview(int width, int height, int maxSize = MaxSize);
+
+    int Scale() const { return m_scale; }
+    int Width() const { return m_previewWidth; }
+    int Height() const { return m_previewHeight; }
+
+    // rows 行线性 RGBA；每凑满一行预览就回调它的行号与 Width() 个 RGBA
+    void AddRows(const float* rgba, int rows, const std::function<void(int y, const float* row)>& emit);
+
+private:
+    int m_width = 0;
+    int m_height = 0;
+    int m_scale = 1;
+    int m_previewWidth = 0;
+    int m_previewHeight = 0;
+    int m_rowsIn = 0;
+    std::vector<float> m_sum;
+    std::vector<float> m_row;
+};
@@ -0,0 +1,108 @@
+﻿// CBlackHole_ThreadPool.cpp
+#include "stdafx.h"
+#include "CBlackHole_ThreadPool.h"
+
+static CBlackHole_ThreadPool* s_pSharedPool = nullptr;
+static std::mutex             s_sharedMutex;
+static thread_local int       s_workerIndex = -1;
+
+CBlackHole_ThreadPool::CBlackHole_ThreadPool(int threadCount) {
+    if (threadCount <= 0) threadCount = (int)std::thread::hardware_concurrency();
+    if (threadCount <= 0) threadCount = 1;
+
+    m_workers.reserve(threadCount);
+    for (int i = 0; i < threadCount; ++i) {
+        m_workers.emplace_back([this, i] { WorkerLoop(i); });
+    }
+}
+
+CBlackHole_ThreadPool::~CBlackHole_ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bStopping = true;
+    }
+    m_cvJob.notify_all();
+    for (auto& t : m_workers) {
+        if (t.joinable()) t.join();
+    }
+}
+
+void CBlackHole_ThreadPool::Submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+    }
+    m_cvJob.notify_one();
+}
+
+void CBlackHole_ThreadPool::WaitIdle() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cvIdle.wait(lock, [this] { return m_jobs.empty() && m_activeJobs == 0; });
+}
+
+void CBlackHole_ThreadPool::ParallelFor(int count, const std::function<void(int)>& body) {
+    if (count <= 0) return;
+
+    // 每个工作线程领一个任务，任务内部用原子计数器动态领取下标，负载自然均衡
+    const int taskCount = ThreadCount() < count ? ThreadCount() : count;
+    std::atomic<int>        next{ 0 };
+    std::mutex              doneMutex;
+    std::condition_variable doneCv;
+    int                     doneTasks = 0;
+
+    for (int t = 0; t < taskCount; ++t) {
+        Submit([&]() {
+            for (int i = next++; i < count; i = next++) body(i);
+
+            std::lock_guard<std::mutex> lock(doneMutex);
+            if (++doneTasks == taskCount) doneCv.notify_one();
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(doneMutex);
+    doneCv.wait(lock, [&] { return doneTasks == taskCount; });
+}
+
+int CBlackHole_ThreadPool::CurrentWorker() {
+    return s_workerIndex;
+}
+
+void CBlackHole_ThreadPool::WorkerLoop(int index) {
+    s_workerIndex = index;
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cvJob.wait(lock, [this] { return m_bStopping || !m_jobs.empty(); });
+            // 停止时仍把已入队的任务做完，保证提交者持有的状态能收到结果
+            if (m_jobs.empty()) return;
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            ++m_activeJobs;
+        }
+
+        job();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_activeJobs;
+            if (m_jobs.empty() && m_activeJobs == 0) m_cvIdle.notify_all();
+        }
+    }
+}
+
+CBlackHole_ThreadPool& CBlackHole_ThreadPool::Shared() {
+    std::lock_guard<std::mutex> lock(s_sharedMutex);
+    if (nullptr == s_pSharedPool) s_pSharedPool = new CBlackHole_ThreadPool();
+    return *s_pSharedPool;
+}
+
+void CBlackHole_ThreadPool::ShutdownShared() {
+    CBlackHole_ThreadPool* pPool = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(s_sharedMutex);
+        pPool = s_pSharedPool;
+        s_pSharedPool = nullptr;
+    }
+    delete pPool;   // 析构中等待所有工作线程退出
+}
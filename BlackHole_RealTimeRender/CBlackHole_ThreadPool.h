@@ -0,0 +1,52 @@
+﻿// CBlackHole_ThreadPool.h
+// 后台任务线程池：把贴图解码等耗时工作移出 UI 线程与渲染线程
+#pragma once
+#include "stdafx.h"
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+class CBlackHole_ThreadPool {
+public:
+    explicit CBlackHole_ThreadPool(int threadCount = 0);   // 0 表示使用全部硬件线程
+    ~CBlackHole_ThreadPool();
+
+    CBlackHole_ThreadPool(const CBlackHole_ThreadPool&) = delete;
+    CBlackHole_ThreadPool& operator=(const CBlackHole_ThreadPool&) = delete;
+
+    // ==========================================
+    // 1. 任务提交
+
+    void Submit(std::function<void()> job);     // 投递一个后台任务，立即返回
+    void WaitIdle();                            // 阻塞直到队列清空且没有任务在执行
+    int  ThreadCount() const { return (int)m_workers.size(); }
+
+    // 当前线程在所属线程池中的编号 [0, ThreadCount())，不是池内线程时返回 -1
+    static int CurrentWorker();
+
+    // 把 [0, count) 分给所有工作线程，阻塞到全部完成。只等待本批任务，不受其他后台任务影响
+    // 不能在池内线程中调用，否则会占住工作线程等自己
+    void ParallelFor(int count, const std::function<void(int)>& body);
+
+    // ==========================================
+    // 2. 插件级共享实例
+    // 由插件在卸载时显式关闭，不能依赖静态析构（DLL 卸载期间 join 线程会死锁）
+
+    static CBlackHole_ThreadPool& Shared();
+    static void ShutdownShared();
+
+private:
+    void WorkerLoop(int index);
+
+    std::vector<std::thread>          m_workers;
+    std::deque<std::function<void()>> m_jobs;        // 待执行任务
+    std::mutex                        m_mutex;
+    std::condition_variable           m_cvJob;       // 有新任务
+    std::condition_variable           m_cvIdle;      // 全部完成
+    int                               m_activeJobs = 0;
+    bool                              m_bStopping = false;
+};
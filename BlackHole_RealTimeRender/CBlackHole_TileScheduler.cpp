@@ -0,0 +1,96 @@
+﻿// CBlackHole_TileScheduler.cpp
+#include "stdafx.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include "CBlackHole_TileScheduler.h"
+
+double TileScheduleStats::Balance() const {
+    if (busyMs.empty() || wallMs <= 0.0) return 1.0;
+    double sum = 0.0;
+    for (const double ms : busyMs) sum += ms;
+    return sum / busyMs.size() / wallMs;
+}
+
+CBlackHole_TileScheduler::CBlackHole_TileScheduler(CBlackHole_ThreadPool& pool, int tilesPerThread, int minWidth)
+    : m_pool(pool), m_tilesPerThread(tilesPerThread > 0 ? tilesPerThread : 1), m_minWidth(minWidth > 0 ? minWidth : 1) {
+    m_stats.busyMs.assign(m_pool.ThreadCount(), 0.0);
+}
+
+std::vector<RenderTile> CBlackHole_TileScheduler::Split(const float* cost, int width, int y0, int y1, double target, int minWidth) {
+    std::vector<RenderTile> tiles;
+    for (int y = y0; y < y1; ++y) {
+        const float* row = cost + (size_t)(y - y0) * width;
+        RenderTile tile;
+        tile.y = y;
+        for (int x = 0; x < width; ++x) {
+            tile.cost += row[x];
+            tile.x1 = x + 1;
+            if (tile.cost >= target && tile.x1 - tile.x0 >= minWidth) {
+                tiles.push_back(tile);
+                tile.x0 = tile.x1;
+                tile.cost = 0.0;
+            }
+        }
+        if (tile.x1 > tile.x0 && tile.cost > 0.0) tiles.push_back(tile);
+    }
+    tiles.erase(std::remove_if(tiles.begin(), tiles.end(), [](const RenderTile& t) { return t.cost <= 0.0; }), tiles.end());
+
+    // 最长处理时间优先：贵的先发，先做完的线程接着领便宜的，批次末尾的空等不超过最小的几个瓦片
+    std::stable_sort(tiles.begin(), tiles.end(), [](const RenderTile& a, const RenderTile& b) { return a.cost > b.cost; });
+    return tiles;
+}
+
+bool CBlackHole_TileScheduler::Prepare(const float* cost, int width, int y0, int y1, std::vector<RenderTile>& tiles) const {
+    double total = 0.0;
+    for (size_t i = 0, n = (size_t)(y1 - y0) * width; i < n; ++i) total += cost[i];
+    if (total <= 0.0) return false;
+
+    const double target = total / ((double)m_pool.ThreadCount() * m_tilesPerThread);
+    tiles = Split(cost, width, y0, y1, target, m_minWidth);
+    return !tiles.empty();
+}
+
+// 每个工作线程只写自己的槽位，ParallelFor 返回前已全部完成
+void CBlackHole_TileScheduler::AddBusy(double ms) {
+    const int worker = CBlackHole_ThreadPool::CurrentWorker();
+    if (worker >= 0 && worker < (int)m_stats.busyMs.size()) m_stats.busyMs[worker] += ms;
+}
+
+void CBlackHole_TileScheduler::Run(const float* cost, int width, int y0, int y1, const std::function<void(const RenderTile&)>& body) {
+    std::vector<RenderTile> tiles;
+    if (!Prepare(cost, width, y0, y1, tiles)) return;
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    m_pool.ParallelFor((int)tiles.size(), [&](int i) {
+        const auto tileStart = std::chrono::high_resolution_clock::now();
+        body(tiles[i]);
+        AddBusy(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tileStart).count());
+    });
+    m_stats.wallMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    m_stats.batches++;
+    m_stats.tiles += (int)tiles.size();
+}
+
+void CBlackHole_TileScheduler::RunStream(const float* cost, int width, int y0, int y1, const std::function<void(const TileQueue& next)>& worker) {
+    std::vector<RenderTile> tiles;
+    if (!Prepare(cost, width, y0, y1, tiles)) return;
+
+    std::atomic<int> nextTile{ 0 };
+    const TileQueue next = [&](RenderTile& tile) {
+        const int i = nextTile++;
+        if (i >= (int)tiles.size()) return false;
+        tile = tiles[i];
+        return true;
+    };
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    m_pool.ParallelFor(m_pool.ThreadCount(), [&](int) {
+        const auto workerStart = std::chrono::high_resolution_clock::now();
+        worker(next);
+        AddBusy(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - workerStart).count());
+    });
+    m_stats.wallMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    m_stats.batches++;
+    m_stats.tiles += (int)tiles.size();
+}
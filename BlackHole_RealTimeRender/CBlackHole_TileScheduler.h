@@ -0,0 +1,55 @@
+﻿// CBlackHole_TileScheduler.h
+// 按预测代价调度渲染瓦片：纯天空与临界曲线附近的像素积分步数相差两个数量级以上，按行均分时整块要等最慢的几行
+// 每行按像素的预测代价切成代价相近的段（贵的地方段更短），按代价从高到低发给线程池，收尾时剩下的都是便宜的小段
+#pragma once
+#include "stdafx.h"
+#include <functional>
+#include <vector>
+#include "CBlackHole_ThreadPool.h"
+
+// 瓦片是一行中的一段 [x0, x1)
+struct RenderTile {
+    int    y = 0;
+    int    x0 = 0, x1 = 0;
+    double cost = 0.0;      // 段内预测代价之和
+};
+
+// 各工作线程在调度的瓦片上花的时间，用来检查负载是否均衡
+struct TileScheduleStats {
+    int                 batches = 0;
+    int                 tiles = 0;
+    double              wallMs = 0.0;   // 各批从开始到最后一个瓦片完成的时间之和
+    std::vector<double> busyMs;         // 按工作线程编号
+
+    // 平均忙碌时间 / 墙钟时间，1 表示没有线程在批次末尾空等
+    double Balance() const;
+};
+
+class CBlackHole_TileScheduler {
+public:
+    // 每批的目标瓦片数为线程数的 tilesPerThread 倍；段宽不小于 minWidth，单个像素就超过目标的段除外
+    explicit CBlackHole_TileScheduler(CBlackHole_ThreadPool& pool, int tilesPerThread = 8, int minWidth = 4);
+
+    // cost 指向第 y0 行的首个像素，行主序、每行 width 个；代价为 0 的像素不需要处理，整段为 0 的瓦片不会交给 body
+    // 阻塞到这一批全部完成，不能在池内线程中调用
+    void Run(const float* cost, int width, int y0, int y1, const std::function<void(const RenderTile&)>& body);
+
+    // 同样的切块与顺序，但每个工作线程只调用一次 worker，由它通过 next 自己领取瓦片直到返回 false
+    // 给自带在途队列的执行者（如波前积分）用：一个瓦片的光线还没走完就能接着领下一个，忙碌时间按整个调用计
+    using TileQueue = std::function<bool(RenderTile&)>;
+    void RunStream(const float* cost, int width, int y0, int y1, const std::function<void(const TileQueue& next)>& worker);
+
+    const TileScheduleStats& Stats() const { return m_stats; }
+
+    // 切块并按代价从高到低排序，不执行
+    static std::vector<RenderTile> Split(const float* cost, int width, int y0, int y1, double target, int minWidth);
+
+private:
+    bool Prepare(const float* cost, int width, int y0, int y1, std::vector<RenderTile>& tiles) const;
+    void AddBusy(double ms);
+
+    CBlackHole_ThreadPool& m_pool;
+    int                    m_tilesPerThread;
+    int                    m_minWidth;
+    TileScheduleStats      m_stats;
+};
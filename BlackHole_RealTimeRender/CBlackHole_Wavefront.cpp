@@ -0,0 +1,296 @@
+﻿// CBlackHole_Wavefront.cpp
+#include "stdafx.h"
+#include <algorithm>
+#include <cmath>
+#include <immintrin.h>
+#include "CBlackHole_CPUFeatures.h"
+#include "CBlackHole_Wavefront.h"
+
+// 光线状态：还在积分，或已结束待移出
+enum : char { Active = 0, Captured, Escaped, OutOfSteps };
+
+void WavefrontStats::Merge(const WavefrontStats& other) {
+    rays += other.rays;
+    raySteps += other.raySteps;
+    laneSteps += other.laneSteps;
+}
+
+CBlackHole_Wavefront::CBlackHole_Wavefront(int capacity, int batchSteps)
+    : m_capacity(capacity < 4 ? 4 : (capacity + 3) & ~3), m_batchSteps(batchSteps > 0 ? batchSteps : 1) {
+    for (auto* a : { &m_px, &m_py, &m_pz, &m_vx, &m_vy, &m_vz, &m_dx, &m_dy, &m_dz, &m_affine, &m_swept, &m_invR2, &m_halfStepH })
+        a->assign(m_capacity, 0.0);
+    m_steps.assign(m_capacity, 0);
+    m_id.assign(m_capacity, -1);
+    m_state.assign(m_capacity, Active);
+}
+
+// 与 CBlackHole_CPUTracer::Acceleration 逐项相同的运算顺序，结果与标量版本一致
+static inline void Acceleration4(__m256d px, __m256d py, __m256d pz, __m256d vx, __m256d vy, __m256d vz,
+    __m256d mass3, __m256d& ax, __m256d& ay, __m256d& az) {
+    const __m256d r2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(px, px), _mm256_mul_pd(py, py)), _mm256_mul_pd(pz, pz));
+    const __m256d r5 = _mm256_mul_pd(_mm256_mul_pd(r2, r2), _mm256_sqrt_pd(r2));
+
+    const __m256d hx = _mm256_sub_pd(_mm256_mul_pd(py, vz), _mm256_mul_pd(vy, pz));
+    const __m256d hy = _mm256_sub_pd(_mm256_mul_pd(pz, vx), _mm256_mul_pd(vz, px));
+    const __m256d hz = _mm256_sub_pd(_mm256_mul_pd(px, vy), _mm256_mul_pd(vx, py));
+    const __m256d h2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(hx, hx), _mm256_mul_pd(hy, hy)), _mm256_mul_pd(hz, hz));
+
+    __m256d k = _mm256_div_pd(_mm256_mul_pd(mass3, h2), r5);
+    k = _mm256_and_pd(k, _mm256_cmp_pd(r5, _mm256_set1_pd(0.0001), _CMP_GE_OQ));
+    k = _mm256_xor_pd(k, _mm256_set1_pd(-0.0));
+    ax = _mm256_mul_pd(k, px);
+    ay = _mm256_mul_pd(k, py);
+    az = _mm256_mul_pd(k, pz);
+}
+
+static inline __m256d Madd(__m256d a, __m256d s, __m256d b) {
+    return _mm256_add_pd(a, _mm256_mul_pd(s, b));
+}
+
+void CBlackHole_Wavefront::Run(const CBlackHole_CPUTracer& tracer, const RaySource& source, const RaySink& sink) {
+    const ON_3dPoint origin = tracer.CameraPosition();
+    const double mass = tracer.Mass();
+
+    bool bSourceEmpty = false;
+    m_count = 0;
+    for (;;) {
+        // 1. 补满：新光线接在在途光线后面
+        while (!bSourceEmpty && m_count < m_capacity) {
+            int id = -1;
+            ON_3dVector dir;
+            if (!source(id, dir)) {
+                bSourceEmpty = true;
+                break;
+            }
+            const int i = m_count++;
+            m_px[i] = origin.x;  m_py[i] = origin.y;  m_pz[i] = origin.z;
+            m_vx[i] = dir.x;     m_vy[i] = dir.y;     m_vz[i] = dir.z;
+            m_dx[i] = dir.x;     m_dy[i] = dir.y;     m_dz[i] = dir.z;
+            m_affine[i] = 0.0;
+            m_swept[i] = 0.0;
+            m_invR2[i] = 1.0 / (ON_3dVector(origin) * ON_3dVector(origin));
+            m_halfStepH[i] = 0.5 * tracer.stepSize * ON_CrossProduct(ON_3dVector(origin), dir).Length();
+            m_steps[i] = 0;
+            m_id[i] = id;
+            m_state[i] = Active;
+        }
+        if (0 == m_count) break;
+
+        // 2. 推进：尾部不满四条的组用已结束的占位通道补齐
+        const int padded = (m_count + 3) & ~3;
+        for (int i = m_count; i < padded; ++i) m_state[i] = OutOfSteps;
+
+        static const bool bAVX2 = CBlackHole_CPUFeatures::HasAVX2();
+        if (bAVX2) AdvanceAVX2(tracer, padded);
+        else AdvanceScalar(tracer, padded);
+
+        // 3. 压缩：结束的光线交给 sink，其余的前移保持连续
+        int kept = 0;
+        for (int i = 0; i < m_count; ++i) {
+            if (Active != m_state[i]) {
+                GeodesicResult res;
+                res.steps = m_steps[i];
+                const ON_3dVector vel(m_vx[i], m_vy[i], m_vz[i]);
+                if (Captured == m_state[i]) {
+                    res.captured = true;
+                    res.exitDir = ON_3dVector::ZeroVector;
+                }
+                else {
+                    res.exitDir = vel;
+                    res.exitDir.Unitize();
+                }
+                res.affineLength = m_affine[i];
+                CBlackHole_CPUTracer::FinishAovs(res, m_swept[i], ON_3dVector(origin), ON_3dVector(m_dx[i], m_dy[i], m_dz[i]),
+                    ON_3dVector(m_px[i], m_py[i], m_pz[i]), vel, mass);
+                m_stats.rays++;
+                sink(m_id[i], res);
+                continue;
+            }
+            if (kept != i) {
+                m_px[kept] = m_px[i];  m_py[kept] = m_py[i];  m_pz[kept] = m_pz[i];
+                m_vx[kept] = m_vx[i];  m_vy[kept] = m_vy[i];  m_vz[kept] = m_vz[i];
+                m_dx[kept] = m_dx[i];  m_dy[kept] = m_dy[i];  m_dz[kept] = m_dz[i];
+                m_affine[kept] = m_affine[i];
+                m_swept[kept] = m_swept[i];
+                m_invR2[kept] = m_invR2[i];
+                m_halfStepH[kept] = m_halfStepH[i];
+                m_steps[kept] = m_steps[i];
+                m_id[kept] = m_id[i];
+                m_state[kept] = Active;
+            }
+            ++kept;
+        }
+        m_count = kept;
+    }
+}
+
+// 四条光线一组装进 AVX2 寄存器，组内有光线结束后用掩码保持原值，直到整组结束或推进满一批
+void CBlackHole_Wavefront::AdvanceAVX2(const CBlackHole_CPUTracer& tracer, int padded) {
+    const int maxSteps = tracer.maxSteps;
+    const double rs = 2.0 * tracer.Mass();
+    const double escape = tracer.EscapeRadius();
+    const __m256d mass3 = _mm256_set1_pd(3.0 * tracer.Mass());
+    const __m256d h = _mm256_set1_pd(tracer.stepSize);
+    const __m256d halfH = _mm256_set1_pd(0.5 * tracer.stepSize);
+    const __m256d sixthH = _mm256_set1_pd(tracer.stepSize / 6.0);
+    const __m256d two = _mm256_set1_pd(2.0);
+    const __m256d rs2 = _mm256_set1_pd(rs * rs);
+    const __m256d escape2 = _mm256_set1_pd(escape * escape);
+    const __m256d one = _mm256_set1_pd(1.0);
+
+    for (int g = 0; g < padded; g += 4) {
+        __m256d px = _mm256_loadu_pd(&m_px[g]), py = _mm256_loadu_pd(&m_py[g]), pz = _mm256_loadu_pd(&m_pz[g]);
+        __m256d vx = _mm256_loadu_pd(&m_vx[g]), vy = _mm256_loadu_pd(&m_vy[g]), vz = _mm256_loadu_pd(&m_vz[g]);
+        __m256d affine = _mm256_loadu_pd(&m_affine[g]), swept = _mm256_loadu_pd(&m_swept[g]), invR2 = _mm256_loadu_pd(&m_invR2[g]);
+        const __m256d halfStepH = _mm256_loadu_pd(&m_halfStepH[g]);
+        int steps[4], state[4];
+        int activeMask = 0;
+        for (int l = 0; l < 4; ++l) {
+            steps[l] = m_steps[g + l];
+            state[l] = m_state[g + l];
+            if (Active == state[l]) activeMask |= 1 << l;
+        }
+
+        for (int s = 0; s < m_batchSteps && activeMask; ++s) {
+            m_stats.laneSteps += 4;
+            m_stats.raySteps += _mm_popcnt_u32(activeMask);
+
+            __m256d kv1x, kv1y, kv1z, kv2x, kv2y, kv2z, kv3x, kv3y, kv3z, kv4x, kv4y, kv4z;
+            Acceleration4(px, py, pz, vx, vy, vz, mass3, kv1x, kv1y, kv1z);
+
+            const __m256d v2x = Madd(vx, halfH, kv1x), v2y = Madd(vy, halfH, kv1y), v2z = Madd(vz, halfH, kv1z);
+            Acceleration4(Madd(px, halfH, vx), Madd(py, halfH, vy), Madd(pz, halfH, vz), v2x, v2y, v2z, mass3, kv2x, kv2y, kv2z);
+
+            const __m256d v3x = Madd(vx, halfH, kv2x), v3y = Madd(vy, halfH, kv2y), v3z = Madd(vz, halfH, kv2z);
+            Acceleration4(Madd(px, halfH, v2x), Madd(py, halfH, v2y), Madd(pz, halfH, v2z), v3x, v3y, v3z, mass3, kv3x, kv3y, kv3z);
+
+            const __m256d v4x = Madd(vx, h, kv3x), v4y = Madd(vy, h, kv3y), v4z = Madd(vz, h, kv3z);
+            Acceleration4(Madd(px, h, v3x), Madd(py, h, v3y), Madd(pz, h, v3z), v4x, v4y, v4z, mass3, kv4x, kv4y, kv4z);
+
+            // pos += h/6 * (kr1 + 2 v2 + 2 v3 + v4)，vel 同理；已结束的通道保持原值
+            const __m256d active = _mm256_castsi256_pd(_mm256_setr_epi64x(
+                (activeMask & 1) ? -1 : 0, (activeMask & 2) ? -1 : 0, (activeMask & 4) ? -1 : 0, (activeMask & 8) ? -1 : 0));
+            auto update = [&](__m256d p, __m256d k1, __m256d k2, __m256d k3, __m256d k4) {
+                const __m256d sum = _mm256_add_pd(Madd(Madd(k1, two, k2), two, k3), k4);
+                return _mm256_blendv_pd(p, Madd(p, sixthH, sum), active);
+            };
+            const __m256d npx = update(px, vx, v2x, v3x, v4x);
+            const __m256d npy = update(py, vy, v2y, v3y, v4y);
+            const __m256d npz = update(pz, vz, v2z, v3z, v4z);
+            vx = update(vx, kv1x, kv2x, kv3x, kv4x);
+            vy = update(vy, kv1y, kv2y, kv3y, kv4y);
+            vz = update(vz, kv1z, kv2z, kv3z, kv4z);
+            px = npx;  py = npy;  pz = npz;
+
+            // 终止：撞击视界优先于逃逸，步数用完最后判断
+            const __m256d r2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(px, px), _mm256_mul_pd(py, py)), _mm256_mul_pd(pz, pz));
+
+            // 辅助输出：仿射长度逐步累加，扫过的角度按 |h| / r^2 的梯形积分
+            const __m256d invR2Next = _mm256_div_pd(one, r2);
+            affine = _mm256_blendv_pd(affine, _mm256_add_pd(affine, h), active);
+            swept = _mm256_blendv_pd(swept, Madd(swept, halfStepH, _mm256_add_pd(invR2, invR2Next)), active);
+            invR2 = _mm256_blendv_pd(invR2, invR2Next, active);
+
+            const int captured = _mm256_movemask_pd(_mm256_cmp_pd(r2, rs2, _CMP_LT_OQ)) & activeMask;
+            const int escaped = _mm256_movemask_pd(_mm256_cmp_pd(r2, escape2, _CMP_GT_OQ)) & activeMask & ~captured;
+            for (int l = 0; l < 4; ++l) {
+                if (!(activeMask & (1 << l))) continue;
+                ++steps[l];
+                if (captured & (1 << l))     state[l] = Captured;
+                else if (escaped & (1 << l)) state[l] = Escaped;
+                else if (steps[l] >= maxSteps) state[l] = OutOfSteps;
+                if (Active != state[l]) activeMask &= ~(1 << l);
+            }
+        }
+
+        _mm256_storeu_pd(&m_px[g], px);  _mm256_storeu_pd(&m_py[g], py);  _mm256_storeu_pd(&m_pz[g], pz);
+        _mm256_storeu_pd(&m_vx[g], vx);  _mm256_storeu_pd(&m_vy[g], vy);  _mm256_storeu_pd(&m_vz[g], vz);
+        _mm256_storeu_pd(&m_affine[g], affine);  _mm256_storeu_pd(&m_swept[g], swept);  _mm256_storeu_pd(&m_invR2[g], invR2);
+        for (int l = 0; l < 4; ++l) {
+            m_steps[g + l] = steps[l];
+            m_state[g + l] = (char)state[l];
+        }
+    }
+}
+
+// 不支持 AVX2 的 CPU：逐条光线调用 CBlackHole_CPUTracer::StepRK4，结果与 AVX2 版本相同；统计仍按四条一组计
+void CBlackHole_Wavefront::AdvanceScalar(const CBlackHole_CPUTracer& tracer, int padded) {
+    const int maxSteps = tracer.maxSteps;
+    const double mass = tracer.Mass();
+    const double h = tracer.stepSize;
+    const double rs2 = 4.0 * mass * mass;
+    const double escape2 = tracer.EscapeRadius() * tracer.EscapeRadius();
+
+    for (int g = 0; g < padded; g += 4) {
+        int groupSteps = 0;     // 组内走得最远的光线这一批推进的步数，即四条通道一起推进的次数
+        for (int i = g; i < g + 4; ++i) {
+            if (Active != m_state[i]) continue;
+            ON_3dVector pos(m_px[i], m_py[i], m_pz[i]);
+            ON_3dVector vel(m_vx[i], m_vy[i], m_vz[i]);
+            int s = 0;
+            while (s < m_batchSteps && Active == m_state[i]) {
+                CBlackHole_CPUTracer::StepRK4(pos, vel, h, mass);
+                ++s;
+
+                const double r2 = pos * pos;
+                const double invR2Next = 1.0 / r2;
+                m_affine[i] += h;
+                m_swept[i] += m_halfStepH[i] * (m_invR2[i] + invR2Next);
+                m_invR2[i] = invR2Next;
+
+                ++m_steps[i];
+                if (r2 < rs2)                     m_state[i] = Captured;
+                else if (r2 > escape2)            m_state[i] = Escaped;
+                else if (m_steps[i] >= maxSteps)  m_state[i] = OutOfSteps;
+            }
+            m_px[i] = pos.x;  m_py[i] = pos.y;  m_pz[i] = pos.z;
+            m_vx[i] = vel.x;  m_vy[i] = vel.y;  m_vz[i] = vel.z;
+            m_stats.raySteps += s;
+            if (s > groupSteps) groupSteps = s;
+        }
+        m_stats.laneSteps += 4 * (uint64_t)groupSteps;
+    }
+}
+
+// ==========================================
+// 光线重排
+
+CBlackHole_RayBinner::CBlackHole_RayBinner(const ON_3dPoint& origin, int batchSize)
+    : m_batchSize(batchSize > 0 ? batchSize : 1) {
+    m_toward = -ON_3dVector(origin);
+    if (!m_toward.Unitize()) m_toward = ON_3dVector::ZAxis;
+    m_e1.PerpendicularTo(m_toward);
+    m_e1.Unitize();
+    m_e2 = ON_CrossProduct(m_toward, m_e1);
+    m_rays.reserve(m_batchSize);
+}
+
+uint64_t CBlackHole_RayBinner::Key(const ON_3dVector& dir) const {
+    // 不计场景时行程只取决于夹角；方位角只在与场景求交时影响分支，放在低位
+    double c = dir * m_toward;
+    c = c < -1.0 ? -1.0 : (c > 1.0 ? 1.0 : c);
+    const uint64_t angle = (uint64_t)(acos(c) / ON_PI * 1048575.0);
+
+    const ON_3dVector n = ON_CrossProduct(m_toward, dir);
+    const double phi = atan2(n * m_e2, n * m_e1);
+    const uint64_t azimuth = (uint64_t)((phi + ON_PI) / (2.0 * ON_PI) * 4095.0);
+    return angle << 12 | azimuth;
+}
+
+bool CBlackHole_RayBinner::Next(const CBlackHole_Wavefront::RaySource& fill, int& id, ON_3dVector& dir) {
+    if (m_next >= m_rays.size()) {
+        m_rays.clear();
+        m_next = 0;
+        Ray ray;
+        while ((int)m_rays.size() < m_batchSize && fill(ray.id, ray.dir)) {
+            ray.key = Key(ray.dir);
+            m_rays.push_back(ray);
+        }
+        if (m_rays.empty()) return false;
+        std::sort(m_rays.begin(), m_rays.end(), [](const Ray& a, const Ray& b) { return a.key < b.key; });
+    }
+    id = m_rays[m_next].id;
+    dir = m_rays[m_next].dir;
+    ++m_next;
+    return true;
+}
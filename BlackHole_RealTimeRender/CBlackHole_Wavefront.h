@@ -0,0 +1,81 @@
+﻿// CBlackHole_Wavefront.h
+// 波前式测地线积分：在途光线的状态按分量分开存放（SoA），每次 AVX2 四条通道一起推进若干步（不支持 AVX2 的 CPU 上逐条推进）
+// 每批之间把结束的光线移出、从来源补入新光线，通道不会因为被吞噬的短光线或光子球附近的长光线而空转
+#pragma once
+#include "stdafx.h"
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "CBlackHole_CPUTracer.h"
+
+// 通道利用率：有效步数 / 发出的通道步数
+struct WavefrontStats {
+    uint64_t rays = 0;
+    uint64_t raySteps = 0;      // 光线实际积分的步数之和
+    uint64_t laneSteps = 0;     // 四条通道一起推进的次数 × 4，包括空转的通道
+
+    double Utilisation() const { return laneSteps ? (double)raySteps / laneSteps : 1.0; }
+    void   Merge(const WavefrontStats& other);
+};
+
+class CBlackHole_Wavefront {
+public:
+    // 有空位时取下一根光线，返回 false 表示来源已空；id 原样交给 RaySink
+    using RaySource = std::function<bool(int& id, ON_3dVector& dir)>;
+    using RaySink = std::function<void(int id, const GeodesicResult& res)>;
+
+    // capacity 为同时在途的光线数（取 4 的倍数），batchSteps 为两次压缩之间推进的步数
+    explicit CBlackHole_Wavefront(int capacity = 256, int batchSteps = 16);
+
+    // 从相机出发只追踪天空，不与场景求交；积分、步数、终止条件与辅助输出都和 CBlackHole_CPUTracer::TraceFrom 相同
+    // 每根光线结束时调用一次 sink，顺序与取出顺序无关
+    void Run(const CBlackHole_CPUTracer& tracer, const RaySource& source, const RaySink& sink);
+
+    const WavefrontStats& Stats() const { return m_stats; }
+
+private:
+    // 前 padded 条光线（四条一组）中还在积分的各推进至多 m_batchSteps 步，结束的记下状态
+    void AdvanceAVX2(const CBlackHole_CPUTracer& tracer, int padded);
+    void AdvanceScalar(const CBlackHole_CPUTracer& tracer, int padded);
+
+    int m_capacity;
+    int m_batchSteps;
+
+    // 在途光线：位置、速度、已走步数与 id，前 m_count 个有效
+    // 另有辅助输出需要的初始方向、仿射长度、扫过的角度与上一步的 1/r^2
+    std::vector<double> m_px, m_py, m_pz, m_vx, m_vy, m_vz;
+    std::vector<double> m_dx, m_dy, m_dz, m_affine, m_swept, m_invR2, m_halfStepH;
+    std::vector<int>    m_steps, m_id;
+    std::vector<char>   m_state;
+    int                 m_count = 0;
+
+    WavefrontStats      m_stats;
+};
+
+// 可选的重排阶段：从来源攒够一批光线，按 (冲击参数, 轨道平面朝向) 排序后再交给波前
+// 同一组四条通道的光线行程长度与分支接近；结果仍按 id 写回像素，不需要额外的散射步骤
+// 屏幕上相邻像素的行程本来就接近，实测按屏幕顺序的通道利用率已在 99% 以上，渲染默认不重排（BlackHoleImageOutput 的 ReorderRays 打开）；
+// BlackHoleBenchmark 对比两种顺序
+class CBlackHole_RayBinner {
+public:
+    CBlackHole_RayBinner(const ON_3dPoint& origin, int batchSize = 256);
+
+    // 用作波前的 RaySource：内部缓冲取空时从 fill 补一批并排序
+    bool Next(const CBlackHole_Wavefront::RaySource& fill, int& id, ON_3dVector& dir);
+
+    // 排序键：高位为射线与黑洞方向的夹角（相机处冲击参数 b = r sinθ，区分朝内与朝外），低位为轨道平面的方位角
+    uint64_t Key(const ON_3dVector& dir) const;
+
+private:
+    struct Ray {
+        uint64_t    key;
+        int         id;
+        ON_3dVector dir;
+    };
+
+    ON_3dVector      m_toward;           // 相机指向黑洞的单位向量
+    ON_3dVector      m_e1, m_e2;         // 与它垂直的基，量轨道平面法线的方位角
+    int              m_batchSize;
+    std::vector<Ray> m_rays;
+    size_t           m_next = 0;
+};
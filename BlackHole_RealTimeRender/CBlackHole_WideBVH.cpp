@@ -0,0 +1,318 @@
+﻿// CBlackHole_WideBVH.cpp
+#include "stdafx.h"
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <immintrin.h>
+#include "CBlackHole_CPUFeatures.h"
+#include "CBlackHole_ThreadPool.h"
+#include "CBlackHole_WideBVH.h"
+
+static inline int PopCount8(unsigned int v) {
+    static const unsigned char kNibble[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+    return kNibble[v & 15] + kNibble[(v >> 4) & 15];
+}
+
+// 2^e，e 在 [-126, 127]，直接拼浮点数的指数位
+static inline float Pow2(int e) {
+    const unsigned int bits = (unsigned int)(e + 127) << 23;
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+// ==========================================
+// 节点编码
+
+int CBlackHole_WideBVH::ValidMask(const WideBVHNode& node) {
+    int mask = node.imask;
+    for (int i = 0; i < 8; ++i) {
+        if (node.meta[i]) mask |= 1 << i;
+    }
+    return mask;
+}
+
+int CBlackHole_WideBVH::ChildIndex(const WideBVHNode& node, int slot) {
+    return node.childBase + PopCount8(node.imask & ((1u << slot) - 1));
+}
+
+int CBlackHole_WideBVH::SubtreeEnd(const std::vector<WideBVHNode>& wide, int nodeIndex) {
+    // 最后一个内部子节点的子树排在最后，一路往下直到没有内部子节点的节点
+    for (;;) {
+        const WideBVHNode& node = wide[nodeIndex];
+        if (node.imask == 0) {
+            int end = node.triBase;
+            for (int i = 0; i < 8; ++i) end += node.meta[i] >> 5;
+            return end;
+        }
+        nodeIndex = node.childBase + PopCount8(node.imask) - 1;
+    }
+}
+
+void CBlackHole_WideBVH::Quantize(WideBVHNode& node, const float slotMin[8][3], const float slotMax[8][3]) {
+    const int valid = ValidMask(node);
+    float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (int i = 0; i < 8; ++i) {
+        if (!(valid >> i & 1)) continue;
+        for (int k = 0; k < 3; ++k) {
+            if (slotMin[i][k] < lo[k]) lo[k] = slotMin[i][k];
+            if (slotMax[i][k] > hi[k]) hi[k] = slotMax[i][k];
+        }
+    }
+
+    for (int k = 0; k < 3; ++k) {
+        if (!valid) lo[k] = hi[k] = 0.0f;
+        node.origin[k] = lo[k];
+
+        // 量化步长取 2 的幂且略大于 extent / 255，向外取整后最多用到 255
+        int e = 0;
+        frexpf((hi[k] - lo[k]) / 254.0f, &e);
+        e = e < -126 ? -126 : (e > 127 ? 127 : e);
+        node.exp[k] = (signed char)e;
+        const float scale = Pow2(e), inv = Pow2(-e < -126 ? -126 : -e);
+
+        for (int i = 0; i < 8; ++i) {
+            if (!(valid >> i & 1)) {
+                node.qlo[k][i] = node.qhi[k][i] = 0;
+                continue;
+            }
+            int qlo = (int)floorf((slotMin[i][k] - lo[k]) * inv);
+            int qhi = (int)ceilf((slotMax[i][k] - lo[k]) * inv);
+            qlo = qlo < 0 ? 0 : (qlo > 255 ? 255 : qlo);
+            qhi = qhi < 0 ? 0 : (qhi > 255 ? 255 : qhi);
+            // 浮点舍入可能让解码结果缩进一点，逐格放宽直到真正包住
+            while (qlo > 0 && lo[k] + qlo * scale > slotMin[i][k]) qlo--;
+            while (qhi < 255 && lo[k] + qhi * scale < slotMax[i][k]) qhi++;
+            node.qlo[k][i] = (unsigned char)qlo;
+            node.qhi[k][i] = (unsigned char)qhi;
+        }
+    }
+}
+
+void CBlackHole_WideBVH::DecodeSlot(const WideBVHNode& node, int slot, float bmin[3], float bmax[3]) {
+    for (int k = 0; k < 3; ++k) {
+        const float scale = Pow2(node.exp[k]);
+        bmin[k] = node.origin[k] + node.qlo[k][slot] * scale;
+        bmax[k] = node.origin[k] + node.qhi[k][slot] * scale;
+    }
+}
+
+void CBlackHole_WideBVH::NodeBounds(const WideBVHNode& node, float bmin[3], float bmax[3]) {
+    const int valid = ValidMask(node);
+    for (int k = 0; k < 3; ++k) {
+        bmin[k] = FLT_MAX;
+        bmax[k] = -FLT_MAX;
+    }
+    for (int i = 0; i < 8; ++i) {
+        if (!(valid >> i & 1)) continue;
+        float lo[3], hi[3];
+        DecodeSlot(node, i, lo, hi);
+        for (int k = 0; k < 3; ++k) {
+            if (lo[k] < bmin[k]) bmin[k] = lo[k];
+            if (hi[k] > bmax[k]) bmax[k] = hi[k];
+        }
+    }
+}
+
+double CBlackHole_WideBVH::Cost(const WideBVHNode& node) {
+    const int valid = ValidMask(node);
+    double cost = 0.0;
+    for (int i = 0; i < 8; ++i) {
+        if (!(valid >> i & 1)) continue;
+        float lo[3], hi[3];
+        DecodeSlot(node, i, lo, hi);
+        const double dx = hi[0] - lo[0], dy = hi[1] - lo[1], dz = hi[2] - lo[2];
+        const int weight = (node.imask >> i & 1) ? 1 : (node.meta[i] >> 5);
+        cost += 2.0 * (dx * dy + dy * dz + dz * dx) * weight;
+    }
+    return cost;
+}
+
+// ==========================================
+// 折叠
+
+struct CollapseTask {
+    int binary;     // 二叉子树的根
+    int wide;       // 已经占好的 8 叉节点位置
+    int cursor;     // 子树图元写入的起点
+};
+
+static int BinarySubtreeCount(const std::vector<BVHNode>& bin, int b) {
+    int l = b, r = b;
+    while (bin[l].count == 0) l = bin[l].leftFirst;
+    while (bin[r].count == 0) r = bin[r].leftFirst + 1;
+    return bin[r].leftFirst + bin[r].count - bin[l].leftFirst;
+}
+
+static float BinaryArea(const BVHNode& n) {
+    const float dx = n.bmax[0] - n.bmin[0], dy = n.bmax[1] - n.bmin[1], dz = n.bmax[2] - n.bmin[2];
+    return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+// 以二叉节点 b 为根压出一个 8 叉节点写到 wide[w]，子树图元的新位置从 cursor 开始
+// pTasks 不为空时，不超过 taskSize 个图元的子树只占位，留给并行任务
+static void CollapseNode(const std::vector<BVHNode>& bin, int b, std::vector<WideBVHNode>& wide, int w, int cursor,
+    int* order, std::vector<CollapseTask>* pTasks, int taskSize) {
+    int slots[8];
+    int n = 0;
+    if (bin[b].count > 0) {
+        slots[n++] = b;
+    }
+    else {
+        slots[n++] = bin[b].leftFirst;
+        slots[n++] = bin[b].leftFirst + 1;
+        while (n < 8) {
+            int best = -1;
+            float bestArea = -1.0f;
+            for (int i = 0; i < n; ++i) {
+                if (bin[slots[i]].count == 0 && BinaryArea(bin[slots[i]]) > bestArea) {
+                    best = i;
+                    bestArea = BinaryArea(bin[slots[i]]);
+                }
+            }
+            if (best < 0) break;
+            const int c = bin[slots[best]].leftFirst;
+            slots[best] = c;
+            slots[n++] = c + 1;
+        }
+    }
+
+    WideBVHNode node;
+    memset(&node, 0, sizeof(node));
+    node.triBase = cursor;
+    float mn[8][3], mx[8][3];
+    int internalCount = 0;
+    int c = cursor;
+    for (int i = 0; i < n; ++i) {
+        const BVHNode& s = bin[slots[i]];
+        for (int k = 0; k < 3; ++k) {
+            mn[i][k] = s.bmin[k];
+            mx[i][k] = s.bmax[k];
+        }
+        if (s.count == 0) {
+            node.imask |= 1 << i;
+            internalCount++;
+            continue;
+        }
+        // 叶子槽位的图元先排，紧接在 triBase 之后
+        node.meta[i] = (unsigned char)((s.count << 5) | (c - cursor));
+        for (int j = 0; j < s.count; ++j) order[c + j] = s.leftFirst + j;
+        c += s.count;
+    }
+
+    node.childBase = (int)wide.size();
+    CBlackHole_WideBVH::Quantize(node, mn, mx);
+    wide[w] = node;
+    wide.resize(wide.size() + internalCount);
+
+    // 内部子节点按槽位顺序占用连续的编号与图元区间
+    int child = node.childBase;
+    for (int i = 0; i < n; ++i) {
+        if (!(node.imask >> i & 1)) continue;
+        const int count = BinarySubtreeCount(bin, slots[i]);
+        if (pTasks && count <= taskSize) pTasks->push_back({ slots[i], child, c });
+        else CollapseNode(bin, slots[i], wide, child, c, order, pTasks, taskSize);
+        child++;
+        c += count;
+    }
+}
+
+void CBlackHole_WideBVH::Collapse(const std::vector<BVHNode>& binary, std::vector<WideBVHNode>& wide, std::vector<int>& order, bool bParallel) {
+    wide.clear();
+    order.clear();
+    if (binary.empty()) return;
+
+    const int n = BinarySubtreeCount(binary, 0);
+    order.resize(n);
+    wide.reserve(binary.size() / 4 + 1);
+    wide.emplace_back();
+    if (!bParallel) {
+        CollapseNode(binary, 0, wide, 0, 0, order.data(), nullptr, 0);
+        return;
+    }
+
+    // 与构建器相同：上层串行折叠，每个线程分到约 4 棵子树
+    CBlackHole_ThreadPool& pool = CBlackHole_ThreadPool::Shared();
+    int taskSize = n / (pool.ThreadCount() * 4);
+    if (taskSize < 4096) taskSize = 4096;
+
+    std::vector<CollapseTask> tasks;
+    CollapseNode(binary, 0, wide, 0, 0, order.data(), &tasks, taskSize);
+
+    std::vector<std::vector<WideBVHNode>> local(tasks.size());
+    pool.ParallelFor((int)tasks.size(), [&](int i) {
+        local[i].reserve(BinarySubtreeCount(binary, tasks[i].binary) / 4 + 1);
+        local[i].emplace_back();
+        CollapseNode(binary, tasks[i].binary, local[i], 0, tasks[i].cursor, order.data(), nullptr, 0);
+    });
+
+    // 拼接：子树根写回占位节点，其余接在末尾，子节点编号整体平移
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        const int base = (int)wide.size() - 1;
+        for (size_t j = 0; j < local[i].size(); ++j) {
+            WideBVHNode node = local[i][j];
+            node.childBase += base;
+            if (j == 0) wide[tasks[i].wide] = node;
+            else wide.push_back(node);
+        }
+        std::vector<WideBVHNode>().swap(local[i]);
+    }
+    wide.shrink_to_fit();
+}
+
+// ==========================================
+// 求交
+
+// 与 CBlackHole_Scene 的 SlabEntry 相同的写法：NaN 时保留已有的区间端点
+static int IntersectSlotsScalar(const WideBVHNode& node, const float o[3], const float invD[3], float tMax, float tEnter[8]) {
+    const int valid = CBlackHole_WideBVH::ValidMask(node);
+    float base[3], step[3];
+    for (int k = 0; k < 3; ++k) {
+        base[k] = (node.origin[k] - o[k]) * invD[k];
+        step[k] = Pow2(node.exp[k]) * invD[k];
+    }
+
+    int mask = 0;
+    for (int i = 0; i < 8; ++i) {
+        tEnter[i] = FLT_MAX;
+        if (!(valid >> i & 1)) continue;
+        float t0 = 0.0f, t1 = tMax;
+        for (int k = 0; k < 3; ++k) {
+            float tn = base[k] + node.qlo[k][i] * step[k];
+            float tf = base[k] + node.qhi[k][i] * step[k];
+            if (tn > tf) { const float tmp = tn; tn = tf; tf = tmp; }
+            t0 = tn > t0 ? tn : t0;
+            t1 = tf < t1 ? tf : t1;
+        }
+        if (t0 <= t1) {
+            tEnter[i] = t0;
+            mask |= 1 << i;
+        }
+    }
+    return mask;
+}
+
+// 8 个槽位的 8 位坐标一次展开成 8 个浮点数，每个轴 4 次乘加
+static int IntersectSlotsAVX2(const WideBVHNode& node, const float o[3], const float invD[3], float tMax, float tEnter[8]) {
+    __m256 tNear = _mm256_setzero_ps();
+    __m256 tFar = _mm256_set1_ps(tMax);
+    for (int k = 0; k < 3; ++k) {
+        const __m256 base = _mm256_set1_ps((node.origin[k] - o[k]) * invD[k]);
+        const __m256 step = _mm256_set1_ps(Pow2(node.exp[k]) * invD[k]);
+        const __m256 qlo = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)node.qlo[k])));
+        const __m256 qhi = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)node.qhi[k])));
+        const __m256 t0 = _mm256_add_ps(base, _mm256_mul_ps(qlo, step));
+        const __m256 t1 = _mm256_add_ps(base, _mm256_mul_ps(qhi, step));
+        // max/min 在有 NaN 时返回第二个操作数，累计值放在第二位
+        tNear = _mm256_max_ps(_mm256_min_ps(t0, t1), tNear);
+        tFar = _mm256_min_ps(_mm256_max_ps(t0, t1), tFar);
+    }
+    _mm256_storeu_ps(tEnter, tNear);
+    const int hit = _mm256_movemask_ps(_mm256_cmp_ps(tNear, tFar, _CMP_LE_OQ));
+    return hit & CBlackHole_WideBVH::ValidMask(node);
+}
+
+int CBlackHole_WideBVH::IntersectSlots(const WideBVHNode& node, const float o[3], const float invD[3], float tMax, float tEnter[8]) {
+    static const bool bAVX2 = CBlackHole_CPUFeatures::HasAVX2();
+    return bAVX2 ? IntersectSlotsAVX2(node, o, invD, tMax, tEnter) : IntersectSlotsScalar(node, o, invD, tMax, tEnter);
+}
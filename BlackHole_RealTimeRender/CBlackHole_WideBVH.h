@@ -0,0 +1,45 @@
+﻿// CBlackHole_WideBVH.h
+// 8 叉压缩 BVH：由二叉 BVH 折叠而来，子节点包围盒量化成 8 位，遍历时一条线段一次测试 8 个盒子
+#pragma once
+#include "stdafx.h"
+#include <vector>
+#include "CBlackHole_BVHBuilder.h"
+
+// 80 字节。子包围盒为 origin + q * 2^exp，q 为 8 位整数，向外取整保证包住真实盒子
+// 槽位 i：imask 位 i 为内部节点，编号 childBase + 它前面内部槽位的个数；
+// 否则 meta[i] 高 3 位为三角形数（0 表示空槽），低 5 位为相对 triBase 的偏移
+// 子树的三角形是连续的一段：先是本节点的叶子槽位，再依次是各内部子节点的子树
+struct WideBVHNode {
+    float         origin[3];
+    signed char   exp[3];
+    unsigned char imask;
+    int           childBase;
+    int           triBase;
+    unsigned char meta[8];
+    unsigned char qlo[3][8];
+    unsigned char qhi[3][8];
+};
+static_assert(sizeof(WideBVHNode) == 80, "WideBVHNode must stay 80 bytes");
+static_assert(CBlackHole_BVHBuilder::maxLeafSize * 8 <= 32, "leaf offsets must fit in 5 bits");
+
+class CBlackHole_WideBVH {
+public:
+    // 把二叉 BVH 折叠成 8 叉：反复展开面积最大的内部子节点直到 8 个槽位
+    // order[i] 为新位置 i 上的图元在二叉树顺序中的位置，调用者据此重排
+    // bParallel 为 true 时小子树在共享线程池上并行折叠，不能在池内线程中调用
+    static void Collapse(const std::vector<BVHNode>& binary, std::vector<WideBVHNode>& wide, std::vector<int>& order, bool bParallel);
+
+    // 按各槽位的真实包围盒重新量化；哪些槽位有效由 imask 与 meta 决定
+    static void Quantize(WideBVHNode& node, const float slotMin[8][3], const float slotMax[8][3]);
+
+    static void DecodeSlot(const WideBVHNode& node, int slot, float bmin[3], float bmax[3]);
+    static void NodeBounds(const WideBVHNode& node, float bmin[3], float bmax[3]);
+    static double Cost(const WideBVHNode& node);    // sum(槽位面积 * 三角形数)，内部槽位权重取 1
+    static int  ValidMask(const WideBVHNode& node);
+    static int  ChildIndex(const WideBVHNode& node, int slot);
+    static int  SubtreeEnd(const std::vector<WideBVHNode>& wide, int nodeIndex);   // 子树三角形区间的末尾
+
+    // 线段 o + t * d（t 在 [0, tMax]）与 8 个槽位求交，返回命中槽位的掩码，tEnter 为各槽位的进入参数
+    // 支持 AVX2 的 CPU 上 8 个盒子一起算，否则逐个算
+    static int  IntersectSlots(const WideBVHNode& node, const float o[3], const float invD[3], float tMax, float tEnter[8]);
+};
@@ -0,0 +1,221 @@
+﻿// cmdBlackHole_Benchmark.cpp : command file
+// BlackHoleBenchmark 命令：在 1 万到 1000 万三角形的合成场景上测量 BVH 构建与弯曲光线的逐步求交开销
+// 另外对比无场景时波前积分的光线顺序：屏幕顺序与按冲击参数重排
+
+#include "stdafx.h"
+#include <chrono>
+#include "BlackHole_RealTimeRenderPlugIn.h"
+#include "CBlackHole_CPUTracer.h"
+#include "CBlackHole_Scene.h"
+#include "CBlackHole_Wavefront.h"
+
+////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////
+//
+// BEGIN BlackHoleBenchmark command
+//
+
+#pragma region BlackHoleBenchmark command
+
+class CCommandBlackHoleBenchmark : public CRhinoCommand
+{
+public:
+  CCommandBlackHoleBenchmark() = default;
+  ~CCommandBlackHoleBenchmark() = default;
+
+  UUID CommandUUID() override
+  {
+    // {7A1EEC68-4120-4056-BA55-031AE39B4FEE}
+    static const GUID BlackHoleBenchmarkCommand_UUID =
+    {0x7a1eec68,0x4120,0x4056,{0xba,0x55,0x03,0x1a,0xe3,0x9b,0x4f,0xee}};
+    return BlackHoleBenchmarkCommand_UUID;
+  }
+
+  const wchar_t* EnglishCommandName() override { return L"BlackHoleBenchmark"; }
+
+  CRhinoCommand::result RunCommand(const CRhinoCommandContext& context) override;
+};
+
+// The one and only CCommandBlackHoleBenchmark object
+static class CCommandBlackHoleBenchmark theBlackHoleBenchmarkCommand;
+
+// 绕黑洞的圆环（主半径 8，管半径 1.5），约 triangleCount 个三角形
+// 相机看到正面的直接像，也看到绕过黑洞的次级像，与真实场景的求交分布接近
+static void MakeTorus(ON_Mesh& mesh, int triangleCount)
+{
+  int nv = (int)sqrt(triangleCount / 8.0);
+  if (nv < 3) nv = 3;
+  const int nu = 4 * nv;
+
+  mesh.Destroy();
+  mesh.m_V.Reserve(nu * nv);
+  mesh.m_F.Reserve(nu * nv);
+  for (int i = 0; i < nu; i++)
+  {
+    const double u = 2.0 * ON_PI * i / nu;
+    for (int j = 0; j < nv; j++)
+    {
+      const double v = 2.0 * ON_PI * j / nv;
+      const double r = 8.0 + 1.5 * cos(v);
+      mesh.m_V.Append(ON_3fPoint((float)(r * cos(u)), (float)(r * sin(u)), (float)(1.5 * sin(v))));
+    }
+  }
+  for (int i = 0; i < nu; i++)
+  {
+    for (int j = 0; j < nv; j++)
+    {
+      ON_MeshFace& f = mesh.m_F.AppendNew();
+      f.vi[0] = i * nv + j;
+      f.vi[1] = ((i + 1) % nu) * nv + j;
+      f.vi[2] = ((i + 1) % nu) * nv + (j + 1) % nv;
+      f.vi[3] = i * nv + (j + 1) % nv;
+    }
+  }
+}
+
+CRhinoCommand::result CCommandBlackHoleBenchmark::RunCommand(const CRhinoCommandContext& context)
+{
+  UNREFERENCED_PARAMETER(context);
+
+  int maxTriangles = 10000000;
+  int raysX = 160;
+
+  CRhinoGetOption go;
+  go.SetCommandPrompt(L"Intersection benchmark");
+  go.AcceptNothing();
+  go.AddCommandOptionInteger(RHCMDOPTNAME(L"MaxTriangles"), &maxTriangles, L"Largest scene size", 10000.0, 100000000.0);
+  go.AddCommandOptionInteger(RHCMDOPTNAME(L"RaysX"), &raysX, L"Rays per row (16:9 image)", 16.0, 4096.0);
+  for (;;)
+  {
+    const CRhinoGet::result res = go.GetOption();
+    if (res == CRhinoGet::cancel)
+      return CRhinoCommand::cancel;
+    if (res == CRhinoGet::option)
+      continue;
+    break;
+  }
+
+  // 固定相机：斜上方看向黑洞，圆环的背面经透镜出现在黑洞上方
+  CameraParameters cam;
+  cam.pos = ON_3dPoint(0.0, -30.0, 4.0);
+  cam.dir = ON_3dPoint::Origin - cam.pos;
+  cam.up = ON_3dVector::ZAxis;
+  cam.viewAngle = 0.8;
+  const int raysY = raysX * 9 / 16;
+
+  // 单线程测量，结果是每一步的真实开销而不是吞吐量
+  auto run = [&](const CBlackHole_Scene* pScene, SceneQueryStats& stats, unsigned long long& steps, int& hits)
+  {
+    CBlackHole_CPUTracer tracer(cam, raysX, raysY, 1.0);
+    tracer.SetScene(pScene);
+    steps = 0;
+    hits = 0;
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    for (int y = 0; y < raysY; y++)
+    {
+      for (int x = 0; x < raysX; x++)
+      {
+        const GeodesicResult r = tracer.Trace(tracer.PrimaryRay(x + 0.5, y + 0.5), &stats);
+        steps += r.steps;
+        if (r.hitSurface) hits++;
+      }
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+  };
+
+  // 1. 无场景基线：纯积分的每步开销
+  SceneQueryStats baseStats;
+  unsigned long long baseSteps = 0;
+  int baseHits = 0;
+  const double baseMs = run(nullptr, baseStats, baseSteps, baseHits);
+  const double baseNsPerStep = baseMs * 1e6 / (baseSteps ? baseSteps : 1);
+
+  ON_wString str;
+  str.Format(L"BlackHole: benchmark %dx%d rays, integration only %.1f ns/step\n", raysX, raysY, baseNsPerStep);
+  RhinoApp().Print(str);
+
+  // 波前积分：同一组光线按屏幕顺序或重排后送入；in-flight 为 4 时就是不做压缩的固定四光线包
+  {
+    CBlackHole_CPUTracer tracer(cam, raysX, raysY, 1.0);
+    RhinoApp().Print(L"  wavefront   in-flight   order      ns/step   lane use %\n");
+    const int capacities[3] = { 4, 64, 256 };
+    for (const int capacity : capacities)
+    {
+      for (int binned = 0; binned < 2; binned++)
+      {
+        CBlackHole_Wavefront wave(capacity, 4 == capacity ? tracer.maxSteps : 16);
+        CBlackHole_RayBinner binner(tracer.CameraPosition());
+        int next = 0;
+        const CBlackHole_Wavefront::RaySource screen = [&](int& id, ON_3dVector& dir)
+        {
+          if (next >= raysX * raysY)
+            return false;
+          id = next++;
+          dir = tracer.PrimaryRay(id % raysX + 0.5, id / raysX + 0.5);
+          return true;
+        };
+        const CBlackHole_Wavefront::RaySource source = binned
+          ? CBlackHole_Wavefront::RaySource([&](int& id, ON_3dVector& dir) { return binner.Next(screen, id, dir); })
+          : screen;
+
+        const auto t0 = std::chrono::high_resolution_clock::now();
+        wave.Run(tracer, source, [](int, const GeodesicResult&) {});
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+
+        const WavefrontStats& stats = wave.Stats();
+        str.Format(L"              %9d   %-8ls   %7.1f   %10.1f\n", capacity, binned ? L"binned" : L"screen",
+          ms * 1e6 / (stats.raySteps ? stats.raySteps : 1), 100.0 * stats.Utilisation());
+        RhinoApp().Print(str);
+      }
+    }
+  }
+
+  RhinoApp().Print(L"  triangles      layout   build ms   1T ms      SAH      MB   BVH B/tri   ns/step   isect ns/step   nodes/seg   tris/seg   straight %   hit %\n");
+
+  // 2. 各规模场景，二叉树与 8 叉树在同一组弯曲光线上对比
+  const SceneLayout layouts[2] = { SceneLayout::Binary, SceneLayout::Wide8 };
+  for (int n = 10000; n <= maxTriangles; n *= 10)
+  {
+    ON_Mesh mesh;
+    MakeTorus(mesh, n);
+
+    CBlackHole_Scene scene;
+    scene.AddMesh(mesh, ON_Xform::IdentityTransformation, ON_Color(204, 204, 204));
+    mesh.Destroy();
+
+    for (const SceneLayout layout : layouts)
+    {
+      // 先单线程构建一次作对照，再并行重建；重建只是换了三角形顺序，工作量相同
+      scene.Build(false, layout);
+      const double serialMs = scene.BuildMs();
+      scene.Build(true, layout);
+
+      SceneQueryStats stats;
+      unsigned long long steps = 0;
+      int hits = 0;
+      const double ms = run(&scene, stats, steps, hits);
+      const double nsPerStep = ms * 1e6 / (steps ? steps : 1);
+      const double segs = stats.segments ? (double)stats.segments : 1.0;
+
+      str.Format(L"  %-12I64u   %-6ls   %8.1f   %8.1f   %6.1f   %7.1f   %9.1f   %7.1f   %13.1f   %9.1f   %8.1f   %10.1f   %5.1f\n",
+        (unsigned __int64)scene.TriangleCount(), layout == SceneLayout::Wide8 ? L"wide8" : L"binary",
+        scene.BuildMs(), serialMs, scene.BuildStats().sahCost, scene.MemoryBytes() / 1048576.0,
+        (double)scene.NodeBytes() / scene.TriangleCount(),
+        nsPerStep, nsPerStep - baseNsPerStep, stats.nodesVisited / segs, stats.trianglesTested / segs,
+        100.0 * stats.straightLength / (stats.curvedLength + stats.straightLength > 0.0 ? stats.curvedLength + stats.straightLength : 1.0),
+        100.0 * hits / (raysX * raysY));
+      RhinoApp().Print(str);
+      RhinoApp().Wait(0);
+    }
+  }
+
+  return CRhinoCommand::success;
+}
+
+#pragma endregion
+
+//
+// END BlackHoleBenchmark command
+//
+////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////
@@ -0,0 +1,175 @@
+﻿// cmdBlackHole_ImageOutput.cpp : command file
+// BlackHoleImageOutput 命令：设置离线渲染边渲染边写的输出文件（.exr / .pfm / .png）与格式选项
+// 这些选项同样用于脚本中的 SaveRenderedImage；输出文件留空表示只在渲染窗口中显示
+// Strips 打开时超大的图分条渲染，内存不超过 MemoryMB；DeepZoom 同时生成供缩放浏览的瓦片金字塔
+// CheckpointSeconds 不为 0 时定期保存检查点，崩溃或取消后再次渲染同一场景从中断处接着渲染（不需要输出文件）
+// ViewportAovs 让实时显示模式也输出步数、偏折角等辅助通道，下次启动实时显示时生效
+// ReorderRays 让离线渲染的纯天空光线按冲击参数分组后再积分，默认关闭，BlackHoleBenchmark 可对比两种顺序的速度
+
+#include "stdafx.h"
+#include "BlackHole_RealTimeRenderPlugIn.h"
+
+////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////
+//
+// BEGIN BlackHoleImageOutput command
+//
+
+#pragma region BlackHoleImageOutput command
+
+class CCommandBlackHoleImageOutput : public CRhinoCommand
+{
+public:
+  CCommandBlackHoleImageOutput() = default;
+  ~CCommandBlackHoleImageOutput() = default;
+
+  UUID CommandUUID() override
+  {
+    // {B32CB8A9-ED8E-47C8-8D2A-7FFC0CC07C32}
+    static const GUID BlackHoleImageOutputCommand_UUID =
+    {0xb32cb8a9,0xed8e,0x47c8,{0x8d,0x2a,0x7f,0xfc,0x0c,0xc0,0x7c,0x32}};
+    return BlackHoleImageOutputCommand_UUID;
+  }
+
+  const wchar_t* EnglishCommandName() override { return L"BlackHoleImageOutput"; }
+
+  CRhinoCommand::result RunCommand(const CRhinoCommandContext& context) override;
+
+private:
+  // 读取输出文件路径，"None" 表示不写
+  bool PickPath(std::wstring& pathInOut);
+};
+
+// The one and only CCommandBlackHoleImageOutput object
+static class CCommandBlackHoleImageOutput theBlackHoleImageOutputCommand;
+
+CRhinoCommand::result CCommandBlackHoleImageOutput::RunCommand(const CRhinoCommandContext& context)
+{
+  UNREFERENCED_PARAMETER(context);
+
+  ImageOutputSettings output = BlackHole_RealTimeRenderPlugIn().GetImageOutput();
+
+  // 1. 命令行选项
+  CRhinoCommandOptionValue pngBits[2];
+  pngBits[0] = RHCMDOPTVALUE(L"8");
+  pngBits[1] = RHCMDOPTVALUE(L"16");
+  int pngBitsIndex = (16 == output.write.pngBits) ? 1 : 0;
+  bool bHalf = output.write.exrHalf;
+  bool bTiled = output.write.exrTiled;
+  bool bStrips = output.strips;
+  bool bDeepZoom = output.deepZoom;
+  int memoryMB = output.memoryBudgetMB;
+  int checkpointSeconds = output.checkpointSeconds;
+  bool bViewportAovs = output.viewportAovs;
+  bool bReorderRays = output.reorderRays;
+
+  for (;;)
+  {
+    CRhinoGetOption go;
+    go.SetCommandPrompt(L"Black hole image output");
+    go.AcceptNothing();
+    const int fileOption = go.AddCommandOption(RHCMDOPTNAME(L"File"));
+    go.AddCommandOptionToggle(RHCMDOPTNAME(L"ExrPrecision"), RHCMDOPTVALUE(L"Float"), RHCMDOPTVALUE(L"Half"), bHalf, &bHalf);
+    go.AddCommandOptionToggle(RHCMDOPTNAME(L"ExrLayout"), RHCMDOPTVALUE(L"Scanline"), RHCMDOPTVALUE(L"Tiled"), bTiled, &bTiled);
+    const int bitsOption = go.AddCommandOptionList(RHCMDOPTNAME(L"PngBits"), 2, pngBits, pngBitsIndex);
+    go.AddCommandOptionToggle(RHCMDOPTNAME(L"Strips"), RHCMDOPTVALUE(L"Off"), RHCMDOPTVALUE(L"On"), bStrips, &bStrips);
+    go.AddCommandOptionInteger(RHCMDOPTNAME(L"MemoryMB"), &memoryMB, L"Memory budget for strip rendering (MB)", 256.0, 1048576.0);
+    go.AddCommandOptionToggle(RHCMDOPTNAME(L"DeepZoom"), RHCMDOPTVALUE(L"Off"), RHCMDOPTVALUE(L"On"), bDeepZoom, &bDeepZoom);
+    go.AddCommandOptionInteger(RHCMDOPTNAME(L"CheckpointSeconds"), &checkpointSeconds, L"Seconds between render checkpoints (0 = off)", 0.0, 86400.0);
+    go.AddCommandOptionToggle(RHCMDOPTNAME(L"ViewportAovs"), RHCMDOPTVALUE(L"Off"), RHCMDOPTVALUE(L"On"), bViewportAovs, &bViewportAovs);
+    go.AddCommandOptionToggle(RHCMDOPTNAME(L"ReorderRays"), RHCMDOPTVALUE(L"Off"), RHCMDOPTVALUE(L"On"), bReorderRays, &bReorderRays);
+
+    const CRhinoGet::result res = go.GetOption();
+    if (res == CRhinoGet::cancel)
+      return CRhinoCommand::cancel;
+
+    if (res == CRhinoGet::option)
+    {
+      const CRhinoCommandOption* opt = go.Option();
+      if (opt && opt->m_option_index == fileOption)
+        PickPath(output.path);
+      else if (opt && opt->m_option_index == bitsOption)
+        pngBitsIndex = opt->m_list_option_current;
+      continue;
+    }
+
+    // 回车确认
+    break;
+  }
+
+  // 2. 写回插件，下一次离线渲染开始时读取
+  output.write.exrHalf = bHalf;
+  output.write.exrTiled = bTiled;
+  output.write.pngBits = (1 == pngBitsIndex) ? 16 : 8;
+  output.strips = bStrips;
+  output.memoryBudgetMB = memoryMB;
+  output.deepZoom = bDeepZoom;
+  output.checkpointSeconds = checkpointSeconds;
+  output.viewportAovs = bViewportAovs;
+  output.reorderRays = bReorderRays;
+  BlackHole_RealTimeRenderPlugIn().SetImageOutput(output);
+
+  ON_wString str;
+  if (output.path.empty())
+    str.Format(L"BlackHole: no render output file; EXR %s %s, PNG %d-bit\n",
+      bHalf ? L"half" : L"float", bTiled ? L"tiled" : L"scanline", output.write.pngBits);
+  else
+    str.Format(L"BlackHole: rendering to \"%s\"; EXR %s %s, PNG %d-bit\n", output.path.c_str(),
+      bHalf ? L"half" : L"float", bTiled ? L"tiled" : L"scanline", output.write.pngBits);
+  RhinoApp().Print(str);
+
+  if (bStrips || bDeepZoom)
+  {
+    str.Format(L"BlackHole: strip rendering %s (%d MB budget), Deep Zoom pyramid %s\n",
+      bStrips ? L"on" : L"off", memoryMB, bDeepZoom ? L"on" : L"off");
+    RhinoApp().Print(str);
+  }
+
+  if (checkpointSeconds > 0)
+  {
+    str.Format(L"BlackHole: offline renders save a checkpoint every %d s and resume after a crash or cancel\n", checkpointSeconds);
+    RhinoApp().Print(str);
+  }
+
+  if (bViewportAovs)
+    RhinoApp().Print(L"BlackHole: the realtime display mode also writes the AOV channels (takes effect when it restarts)\n");
+
+  if (bReorderRays)
+    RhinoApp().Print(L"BlackHole: offline sky rays are grouped by impact parameter before integration (usually slower, see BlackHoleBenchmark)\n");
+
+  return CRhinoCommand::success;
+}
+
+bool CCommandBlackHoleImageOutput::PickPath(std::wstring& pathInOut)
+{
+  CRhinoGetString gs;
+  gs.SetCommandPrompt(L"Output file (.exr, .pfm or .png; None to disable)");
+  gs.SetDefaultString(pathInOut.empty() ? L"None" : pathInOut.c_str());
+  if (gs.GetLiteralString() != CRhinoGet::string)
+    return false;
+
+  ON_wString path = gs.String();
+  path.TrimLeftAndRight(L" \"");
+  if (path.IsEmpty() || 0 == path.CompareNoCase(L"None"))
+  {
+    pathInOut.clear();
+    return true;
+  }
+
+  ImageFileFormat format;
+  if (!CBlackHole_ImageWriter::FormatFromPath(static_cast<const wchar_t*>(path), format))
+  {
+    RhinoApp().Print(L"BlackHole: unsupported file type (use .exr, .pfm or .png)\n");
+    return false;
+  }
+  pathInOut = static_cast<const wchar_t*>(path);
+  return true;
+}
+
+#pragma endregion
+
+//
+// END BlackHoleImageOutput command
+//
+////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////
@@ -0,0 +1,161 @@
+﻿// cmdBlackHole_Sky.cpp : command file
+// BlackHoleSky 命令：切换天空来源（HDR 贴图 / 程序星空 / 星表 / Rhino 环境）并调整星空参数
+
+#include "stdafx.h"
+#include "BlackHole_RealTimeRenderPlugIn.h"
+#include "CBlackHole_StarCatalog.h"
+
+////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////
+//
+// BEGIN BlackHoleSky command
+//
+
+#pragma region BlackHoleSky command
+
+class CCommandBlackHoleSky : public CRhinoCommand
+{
+public:
+  CCommandBlackHoleSky() = default;
+  ~CCommandBlackHoleSky() = default;
+
+  UUID CommandUUID() override
+  {
+    // {88DF5E25-246A-4831-AE6D-0D614551439A}
+    static const GUID BlackHoleSkyCommand_UUID =
+    {0x88df5e25,0x246a,0x4831,{0xae,0x6d,0x0d,0x61,0x45,0x51,0x43,0x9a}};
+    return BlackHoleSkyCommand_UUID;
+  }
+
+  const wchar_t* EnglishCommandName() override { return L"BlackHoleSky"; }
+
+  CRhinoCommand::result RunCommand(const CRhinoCommandContext& context) override;
+
+private:
+  // 选择星表文件；CSV 会先转换成同名 .bhstars
+  bool PickCatalog(std::wstring& pathInOut);
+};
+
+// The one and only CCommandBlackHoleSky object
+static class CCommandBlackHoleSky theBlackHoleSkyCommand;
+
+CRhinoCommand::result CCommandBlackHoleSky::RunCommand(const CRhinoCommandContext& context)
+{
+  SkySettings sky = BlackHole_RealTimeRenderPlugIn().GetSkySettings();
+
+  // 1. 命令行选项，数值类选项由 Rhino 直接写回变量
+  CRhinoCommandOptionValue sources[4];
+  sources[0] = RHCMDOPTVALUE(L"Texture");
+  sources[1] = RHCMDOPTVALUE(L"Stars");
+  sources[2] = RHCMDOPTVALUE(L"Catalog");
+  sources[3] = RHCMDOPTVALUE(L"Environment");
+  int sourceIndex = (int)sky.source;
+
+  double grid = sky.starGrid;
+  double brightness = sky.starBrightness;
+  int seed = (int)sky.starSeed;
+
+  for (;;)
+  {
+    CRhinoGetOption go;
+    go.SetCommandPrompt(L"Black hole sky settings");
+    go.AcceptNothing();
+    const int sourceOption = go.AddCommandOptionList(RHCMDOPTNAME(L"Source"), 4, sources, sourceIndex);
+    const int catalogOption = go.AddCommandOption(RHCMDOPTNAME(L"CatalogFile"));
+    go.AddCommandOptionNumber(RHCMDOPTNAME(L"StarGrid"), &grid, L"Grid cells per cube face edge", TRUE, 16.0, 8192.0);
+    go.AddCommandOptionNumber(RHCMDOPTNAME(L"StarBrightness"), &brightness, L"Star brightness multiplier", FALSE, 0.0, 1000.0);
+    go.AddCommandOptionInteger(RHCMDOPTNAME(L"Seed"), &seed, L"Star field random seed", 0.0);
+
+    const CRhinoGet::result res = go.GetOption();
+    if (res == CRhinoGet::cancel)
+      return CRhinoCommand::cancel;
+
+    if (res == CRhinoGet::option)
+    {
+      const CRhinoCommandOption* opt = go.Option();
+      if (opt && opt->m_option_index == sourceOption)
+        sourceIndex = opt->m_list_option_current;
+      else if (opt && opt->m_option_index == catalogOption && PickCatalog(sky.catalogPath))
+        sourceIndex = (int)SkySource::Catalog;
+      continue;
+    }
+
+    // 回车确认
+    break;
+  }
+
+  // 2. 写回插件，渲染线程发现版本号变化后自动重画
+  sky.source = (SkySource)sourceIndex;
+  sky.starGrid = (float)grid;
+  sky.starBrightness = (float)brightness;
+  sky.starSeed = (unsigned int)seed;
+  BlackHole_RealTimeRenderPlugIn().SetSkySettings(sky);
+  if (sky.source == SkySource::Environment && context.Document())
+    BlackHole_RealTimeRenderPlugIn().EnvironmentCache().Update(*context.Document(), true);
+
+  ON_wString str;
+  str.Format(L"BlackHole: sky source %s, grid %.0f, brightness %.2f, seed %u\n",
+    sources[sourceIndex].m_english_option_value, grid, brightness, sky.starSeed);
+  RhinoApp().Print(str);
+
+  return CRhinoCommand::success;
+}
+
+bool CCommandBlackHoleSky::PickCatalog(std::wstring& pathInOut)
+{
+  CRhinoGetString gs;
+  gs.SetCommandPrompt(L"Star catalogue (.bhstars, or .csv with ra_deg, dec_deg, mag [, teff])");
+  gs.SetDefaultString(pathInOut.c_str());
+  if (gs.GetLiteralString() != CRhinoGet::string)
+    return false;
+
+  ON_wString path = gs.String();
+  path.TrimLeftAndRight(L" \"");
+  if (path.IsEmpty())
+    return false;
+
+  // 1. 已经是星表：只检查能否打开
+  ON_wString ext = path.Right(4);
+  ext.MakeLowerOrdinal();
+  if (ext != L".csv")
+  {
+    CBlackHole_StarCatalog catalog;
+    std::wstring error;
+    if (!catalog.Open(static_cast<const wchar_t*>(path), error))
+    {
+      ON_wString str;
+      str.Format(L"BlackHole: cannot open star catalogue (%s)\n", error.c_str());
+      RhinoApp().Print(str);
+      return false;
+    }
+    pathInOut = static_cast<const wchar_t*>(path);
+    return true;
+  }
+
+  // 2. CSV：流式导入，按 HEALPix 格子外部排序写成星表，每格平均约 16 颗星
+  ON_wString outPath = path.Left(path.Length() - 4) + L".bhstars";
+  int order = -1;
+  uint64_t starCount = 0;
+  std::wstring error;
+  if (!CBlackHole_StarCatalog::ImportCsv(static_cast<const wchar_t*>(path), static_cast<const wchar_t*>(outPath), order, starCount, error))
+  {
+    ON_wString str;
+    str.Format(L"BlackHole: CSV import failed (%s)\n", error.c_str());
+    RhinoApp().Print(str);
+    return false;
+  }
+
+  ON_wString str;
+  str.Format(L"BlackHole: wrote %I64u stars to %s (HEALPix order %d)\n", (unsigned __int64)starCount, static_cast<const wchar_t*>(outPath), order);
+  RhinoApp().Print(str);
+  pathInOut = static_cast<const wchar_t*>(outPath);
+  return true;
+}
+
+#pragma endregion
+
+//
+// END BlackHoleSky command
+//
+////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////